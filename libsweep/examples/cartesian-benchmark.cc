@@ -0,0 +1,104 @@
+// Make use of the CMake build system or compile manually, e.g. with:
+// g++ -std=c++11 -O2 cartesian-benchmark.cc -lsweep
+
+// Reports the time per scan of the lookup table based polar to Cartesian conversion against calling libm's cos and sin
+// per sample, and the largest deviation from a double precision reference. Does not need a device.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <sweep/sweep.h>
+
+const double kPi = 3.14159265358979323846;
+
+// Per sample libm calls, the way scans were converted before the lookup table
+static void convert_libm(const std::vector<std::int32_t>& angle, const std::vector<std::int32_t>& distance,
+                         std::int32_t mount_angle, float mount_x, float mount_y, float* x, float* y) {
+  for (std::size_t n = 0; n < angle.size(); ++n) {
+    const float radian = (angle[n] + mount_angle) / 1000.0f * static_cast<float>(kPi) / 180.0f;
+
+    x[n] = mount_x + std::cos(radian) * distance[n];
+    y[n] = mount_y + std::sin(radian) * distance[n];
+  }
+}
+
+template <typename Fn> static double time_per_scan_us(int repetitions, Fn&& fn) {
+  const auto start = std::chrono::steady_clock::now();
+
+  for (int n = 0; n < repetitions; ++n)
+    fn();
+
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repetitions;
+}
+
+int main() {
+  const std::int32_t mount_angle = 30000;
+  const float mount_x = 12.5f;
+  const float mount_y = -7.0f;
+  const int repetitions = 2000;
+
+  std::mt19937 rng{42};
+  std::uniform_int_distribution<std::int32_t> distances{10, 4000};
+
+  std::cout << "samples  table us/scan  int16 us/scan  libm us/scan  speedup  max error/cm" << std::endl;
+
+  for (const std::int32_t count : {500, 1000, 2000, 4096}) {
+    sweep_error_s error = nullptr;
+    sweep_scan_s scan = sweep_scan_construct(count, &error);
+
+    if (error) {
+      std::cerr << "Error: " << sweep_error_message(error) << std::endl;
+      sweep_error_destruct(error);
+      return 1;
+    }
+
+    // Angles as the device reports them, 1/16 degree steps spread over one rotation
+    std::vector<std::int32_t> angle(count);
+    std::vector<std::int32_t> distance(count);
+
+    for (std::int32_t n = 0; n < count; ++n) {
+      const std::int32_t step = n * 5760 / count;
+
+      angle[n] = static_cast<std::int32_t>(step * 1000 / 16.0f);
+      distance[n] = distances(rng);
+
+      sweep_scan_set_sample(scan, n, angle[n], distance[n], 100);
+    }
+
+    std::vector<float> x(count), y(count), libm_x(count), libm_y(count);
+    std::vector<std::int16_t> x16(count), y16(count);
+
+    const double table_us = time_per_scan_us(repetitions, [&] {
+      sweep_scan_to_cartesian(scan, mount_angle, mount_x, mount_y, x.data(), y.data());
+    });
+
+    const double int16_us = time_per_scan_us(repetitions, [&] {
+      sweep_scan_to_cartesian_int16(scan, mount_angle, mount_x, mount_y, x16.data(), y16.data());
+    });
+
+    const double libm_us = time_per_scan_us(repetitions, [&] {
+      convert_libm(angle, distance, mount_angle, mount_x, mount_y, libm_x.data(), libm_y.data());
+    });
+
+    double max_error = 0.0;
+
+    for (std::int32_t n = 0; n < count; ++n) {
+      const double radian = (angle[n] + mount_angle) / 1000.0 * kPi / 180.0;
+
+      const double dx = x[n] - (mount_x + std::cos(radian) * distance[n]);
+      const double dy = y[n] - (mount_y + std::sin(radian) * distance[n]);
+
+      max_error = std::max(max_error, std::hypot(dx, dy));
+    }
+
+    std::cout << count << "\t " << table_us << "\t\t" << int16_us << "\t       " << libm_us << "\t     " << libm_us / table_us
+              << "\t" << max_error << std::endl;
+
+    sweep_scan_destruct(scan);
+  }
+}
@@ -0,0 +1,261 @@
+// Make use of the CMake build system or compile manually, e.g. with:
+// g++ -std=c++11 -O2 clusterer-benchmark.cc -lsweep
+
+// Reports the time per scan of the single pass clusterer against DBSCAN on a k-d tree, and how many of the people
+// standing in a synthetic 10 x 8 meter room each of them separates into a cluster of their own. Does not need a device.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <sweep/sweep.hpp>
+
+const std::int32_t kSamples = 1000;
+const std::int32_t kPeople = 6;
+const float kPersonRadius = 20.0f; // cm
+const float kPi = 3.14159265358979f;
+
+struct scene {
+  sweep::scan scan;
+  std::vector<std::int32_t> truth; // per sample the person hit, -1 for walls
+};
+
+// People at random places in the room around the sensor, centimeter noise
+static scene simulate(std::mt19937& rng) {
+  std::uniform_real_distribution<float> place_x{-450.0f, 450.0f};
+  std::uniform_real_distribution<float> place_y{-350.0f, 350.0f};
+  std::normal_distribution<float> noise{0.0f, 1.0f};
+
+  std::vector<sweep::point> people;
+
+  while (people.size() < kPeople) {
+    const sweep::point p{place_x(rng), place_y(rng)};
+
+    if (std::hypot(p.x, p.y) > 2 * kPersonRadius)
+      people.push_back(p);
+  }
+
+  scene result;
+
+  for (std::int32_t n = 0; n < kSamples; ++n) {
+    const std::int32_t angle = static_cast<std::int32_t>(n * 5760 / kSamples * 1000 / 16.0f);
+    const float radian = angle / 1000.0f * kPi / 180.0f;
+    const float cosine = std::cos(radian), sine = std::sin(radian);
+
+    const float wall_x = cosine > 0 ? 500.0f / cosine : cosine < 0 ? -500.0f / cosine : 1e9f;
+    const float wall_y = sine > 0 ? 400.0f / sine : sine < 0 ? -400.0f / sine : 1e9f;
+
+    float distance = std::min(wall_x, wall_y);
+    std::int32_t hit = -1;
+
+    // Nearest ray circle intersection
+    for (std::int32_t p = 0; p < kPeople; ++p) {
+      const float along = people[p].x * cosine + people[p].y * sine;
+      const float across = people[p].x * sine - people[p].y * cosine;
+
+      if (along <= 0 || std::abs(across) >= kPersonRadius)
+        continue;
+
+      const float entry = along - std::sqrt(kPersonRadius * kPersonRadius - across * across);
+
+      if (entry < distance) {
+        distance = entry;
+        hit = p;
+      }
+    }
+
+    result.scan.samples.push_back(sweep::sample{angle, static_cast<std::int32_t>(distance + noise(rng)), 100});
+    result.truth.push_back(hit);
+  }
+
+  return result;
+}
+
+// Implicit 2d k-d tree: nodes reordered so that every subrange's median splits it along alternating axes
+struct kd_tree {
+  struct node {
+    sweep::point point;
+    std::int32_t id;
+  };
+
+  std::vector<node> nodes;
+
+  void build(const std::vector<sweep::point>& points) {
+    nodes.resize(points.size());
+
+    for (std::size_t n = 0; n < points.size(); ++n)
+      nodes[n] = node{points[n], static_cast<std::int32_t>(n)};
+
+    split(0, static_cast<std::int32_t>(nodes.size()), 0);
+  }
+
+  void split(std::int32_t first, std::int32_t last, std::int32_t axis) {
+    if (last - first <= 1)
+      return;
+
+    const std::int32_t middle = first + (last - first) / 2;
+
+    std::nth_element(nodes.begin() + first, nodes.begin() + middle, nodes.begin() + last, [axis](const node& lhs, const node& rhs) {
+      return axis == 0 ? lhs.point.x < rhs.point.x : lhs.point.y < rhs.point.y;
+    });
+
+    split(first, middle, 1 - axis);
+    split(middle + 1, last, 1 - axis);
+  }
+
+  void within(const sweep::point& query, float radius, std::vector<std::int32_t>& found) const {
+    found.clear();
+    within(query, radius, 0, static_cast<std::int32_t>(nodes.size()), 0, found);
+  }
+
+  void within(const sweep::point& query, float radius, std::int32_t first, std::int32_t last, std::int32_t axis,
+              std::vector<std::int32_t>& found) const {
+    if (first >= last)
+      return;
+
+    const std::int32_t middle = first + (last - first) / 2;
+    const auto& p = nodes[middle].point;
+
+    if ((p.x - query.x) * (p.x - query.x) + (p.y - query.y) * (p.y - query.y) <= radius * radius)
+      found.push_back(nodes[middle].id);
+
+    const float offset = axis == 0 ? query.x - p.x : query.y - p.y;
+
+    if (offset - radius <= 0)
+      within(query, radius, first, middle, 1 - axis, found);
+    if (offset + radius >= 0)
+      within(query, radius, middle + 1, last, 1 - axis, found);
+  }
+};
+
+// Textbook DBSCAN: clusters grow from core points with at least min_points neighbours within eps, the rest is noise
+static std::int32_t dbscan(const std::vector<sweep::point>& points, float eps, std::int32_t min_points,
+                           std::vector<std::int32_t>& labels) {
+  kd_tree tree;
+  tree.build(points);
+
+  const std::int32_t unvisited = -2, noise = -1;
+  labels.assign(points.size(), unvisited);
+
+  std::vector<std::int32_t> neighbours, expansion, queue;
+  std::int32_t clusters = 0;
+
+  for (std::size_t n = 0; n < points.size(); ++n) {
+    if (labels[n] != unvisited)
+      continue;
+
+    tree.within(points[n], eps, neighbours);
+
+    if (static_cast<std::int32_t>(neighbours.size()) < min_points) {
+      labels[n] = noise;
+      continue;
+    }
+
+    const std::int32_t cluster = clusters++;
+    labels[n] = cluster;
+    queue = neighbours;
+
+    while (!queue.empty()) {
+      const std::int32_t q = queue.back();
+      queue.pop_back();
+
+      if (labels[q] == noise)
+        labels[q] = cluster;
+
+      if (labels[q] != unvisited)
+        continue;
+
+      labels[q] = cluster;
+      tree.within(points[q], eps, expansion);
+
+      if (static_cast<std::int32_t>(expansion.size()) >= min_points)
+        queue.insert(queue.end(), expansion.begin(), expansion.end());
+    }
+  }
+
+  return clusters;
+}
+
+// A visible person is separated if some cluster holds at least 80% of their returns and is at least 80% made of them
+static std::int32_t separated(const std::vector<std::int32_t>& truth, const std::vector<std::int32_t>& labels,
+                              std::int32_t clusters, std::int32_t& visible) {
+  std::int32_t found = 0;
+
+  for (std::int32_t person = 0; person < kPeople; ++person) {
+    std::vector<std::int32_t> hits(clusters), sizes(clusters);
+    std::int32_t returns = 0;
+
+    for (std::size_t n = 0; n < truth.size(); ++n) {
+      returns += truth[n] == person;
+
+      if (labels[n] >= 0) {
+        sizes[labels[n]] += 1;
+        hits[labels[n]] += truth[n] == person;
+      }
+    }
+
+    if (returns < 3)
+      continue;
+
+    visible += 1;
+
+    for (std::int32_t c = 0; c < clusters; ++c) {
+      if (hits[c] * 5 >= returns * 4 && hits[c] * 5 >= sizes[c] * 4) {
+        found += 1;
+        break;
+      }
+    }
+  }
+
+  return found;
+}
+
+int main() try {
+  const std::int32_t scenes = 200;
+  const float eps = 15.0f; // cm
+  const std::int32_t min_points = 3;
+
+  std::mt19937 rng{42};
+
+  sweep::clusterer clusterer;
+  clusterer.set_thresholds(10.0f, 0.02f, min_points);
+
+  std::vector<std::int32_t> ids, labels;
+  std::vector<sweep::cluster> clusters;
+
+  std::chrono::steady_clock::duration single_pass{}, kd_dbscan{};
+  std::int32_t visible = 0, single_pass_found = 0, dbscan_found = 0, dbscan_visible = 0;
+
+  for (std::int32_t n = 0; n < scenes; ++n) {
+    const auto s = simulate(rng);
+
+    auto start = std::chrono::steady_clock::now();
+    clusterer.run(s.scan, ids, clusters);
+    single_pass += std::chrono::steady_clock::now() - start;
+
+    single_pass_found += separated(s.truth, ids, static_cast<std::int32_t>(clusters.size()), visible);
+
+    // DBSCAN sees the same Cartesian points, converting them is not part of its time either
+    const auto points = sweep::to_cartesian(s.scan);
+
+    start = std::chrono::steady_clock::now();
+    const auto count = dbscan(points, eps, min_points, labels);
+    kd_dbscan += std::chrono::steady_clock::now() - start;
+
+    dbscan_found += separated(s.truth, labels, count, dbscan_visible);
+  }
+
+  const auto single_pass_us = std::chrono::duration<double, std::micro>(single_pass).count() / scenes;
+  const auto kd_dbscan_us = std::chrono::duration<double, std::micro>(kd_dbscan).count() / scenes;
+
+  std::cout << "method              us/scan  people separated" << std::endl;
+  std::cout << "single pass\t    " << single_pass_us << "\t     " << single_pass_found << "/" << visible << std::endl;
+  std::cout << "k-d tree DBSCAN\t    " << kd_dbscan_us << "\t     " << dbscan_found << "/" << dbscan_visible << std::endl;
+  std::cout << std::endl << "speedup " << kd_dbscan_us / single_pass_us << std::endl;
+} catch (const sweep::device_error& e) {
+  std::cerr << "Error: " << e.what() << std::endl;
+}
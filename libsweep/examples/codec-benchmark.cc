@@ -0,0 +1,110 @@
+// Make use of the CMake build system or compile manually, e.g. with:
+// g++ -std=c++11 -O2 codec-benchmark.cc -lsweep
+
+// Reports the scan codec's compression ratio and throughput, with and without prediction from the previous scan.
+// Records scans from the device if given one, otherwise uses a synthetic scene.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <sweep/sweep.hpp>
+
+// Sensor standing in a 10 x 8 meter room, 1000 samples per rotation with centimeter noise and occasional dropouts
+static std::vector<sweep::scan> synthesize(int count) {
+  std::mt19937 rng{42};
+  std::normal_distribution<float> noise{0.0f, 1.0f};
+  std::bernoulli_distribution dropout{0.02};
+  std::uniform_int_distribution<int> phase{0, 5};
+
+  std::vector<sweep::scan> scans(count);
+
+  for (auto& scan : scans) {
+    const int offset = phase(rng);
+
+    for (int n = 0; n < 1000; ++n) {
+      const int step = (n * 5760 / 1000 + offset) % 5760;
+      const auto angle = static_cast<std::int32_t>(step * 1000 / 16.0f);
+      const float radian = step / 16.0f * 3.14159265f / 180.0f;
+
+      const float c = std::abs(std::cos(radian)), s = std::abs(std::sin(radian));
+      const float wall = std::min(c > 0 ? 500.0f / c : 1e9f, s > 0 ? 400.0f / s : 1e9f);
+
+      const auto distance = dropout(rng) ? 0 : static_cast<std::int32_t>(wall + noise(rng));
+      const auto signal = distance == 0 ? 0 : std::max(0, std::min(255, static_cast<int>(200 - wall / 10 + noise(rng) * 5)));
+
+      scan.samples.push_back(sweep::sample{angle, distance, signal});
+    }
+  }
+
+  return scans;
+}
+
+static std::vector<sweep::scan> record(const char* port, int count) {
+  sweep::sweep device{port};
+  device.start_scanning();
+
+  std::vector<sweep::scan> scans;
+
+  for (int n = 0; n < count; ++n)
+    scans.push_back(device.get_scan());
+
+  device.stop_scanning();
+  return scans;
+}
+
+int main(int argc, char* argv[]) try {
+  const int count = 200;
+  const auto scans = argc > 1 ? record(argv[1], count) : synthesize(count);
+
+  std::size_t samples = 0;
+  for (const auto& scan : scans)
+    samples += scan.samples.size();
+
+  // Three int32 per sample in memory, 7 bytes per sample in the device's scan packets
+  const auto raw = samples * sizeof(sweep::sample);
+
+  std::cout << "keyframes  bytes/sample  ratio  encode MB/s  decode MB/s" << std::endl;
+
+  for (const std::int32_t keyframe_interval : {0, 10}) {
+    sweep::encoder encoder{keyframe_interval};
+    sweep::decoder decoder;
+
+    std::vector<std::uint8_t> stream;
+
+    const auto encode_start = std::chrono::steady_clock::now();
+
+    for (const auto& scan : scans)
+      encoder.encode(scan, stream);
+
+    const auto encode_elapsed = std::chrono::steady_clock::now() - encode_start;
+
+    sweep::scan decoded;
+    std::size_t offset = 0;
+    bool lossless = true;
+
+    const auto decode_start = std::chrono::steady_clock::now();
+
+    for (const auto& scan : scans) {
+      offset += decoder.decode(stream.data() + offset, stream.size() - offset, decoded);
+
+      for (std::size_t n = 0; n < scan.samples.size(); ++n)
+        lossless = lossless && decoded.samples[n].distance == scan.samples[n].distance;
+    }
+
+    const auto decode_elapsed = std::chrono::steady_clock::now() - decode_start;
+
+    const auto mb_per_s = [raw](std::chrono::steady_clock::duration elapsed) {
+      return raw / std::chrono::duration<double, std::micro>(elapsed).count();
+    };
+
+    std::cout << keyframe_interval << "\t   " << static_cast<double>(stream.size()) / samples << "\t  "
+              << static_cast<double>(raw) / stream.size() << "\t " << mb_per_s(encode_elapsed) << "\t      "
+              << mb_per_s(decode_elapsed) << (lossless ? "" : "  (mismatch!)") << std::endl;
+  }
+} catch (const sweep::device_error& e) {
+  std::cerr << "Error: " << e.what() << std::endl;
+}
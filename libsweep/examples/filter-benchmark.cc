@@ -0,0 +1,139 @@
+// Make use of the CMake build system or compile manually, e.g. with:
+// g++ -std=c++11 -O2 filter-benchmark.cc -lsweep
+
+// Reports the time per scan of every filter stage on its own and of all stages chained, on a synthetic 1000 sample scan
+// of a room with noise, dropouts and speckles. Does not need a device.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sweep/sweep.h>
+
+struct raw_sample {
+  std::int32_t angle;
+  std::int32_t distance;
+  std::int32_t signal_strength;
+};
+
+// Sensor standing in a 10 x 8 meter room, centimeter noise, 2% dropouts and 1% speckles
+static std::vector<raw_sample> synthesize(int count) {
+  std::mt19937 rng{42};
+  std::normal_distribution<float> noise{0.0f, 1.0f};
+  std::bernoulli_distribution dropout{0.02};
+  std::bernoulli_distribution speckle{0.01};
+  std::uniform_int_distribution<int> signal{20, 220};
+
+  std::vector<raw_sample> samples;
+
+  for (int n = 0; n < count; ++n) {
+    const int step = n * 5760 / count;
+    const float radian = step / 16.0f * 3.14159265f / 180.0f;
+
+    const float c = std::abs(std::cos(radian)), s = std::abs(std::sin(radian));
+    const float wall = std::min(c > 0 ? 500.0f / c : 1e9f, s > 0 ? 400.0f / s : 1e9f);
+
+    std::int32_t distance = static_cast<std::int32_t>(wall + noise(rng));
+
+    if (speckle(rng))
+      distance /= 3;
+
+    if (dropout(rng))
+      distance = 0;
+
+    samples.push_back(raw_sample{static_cast<std::int32_t>(step * 1000 / 16.0f), distance, signal(rng)});
+  }
+
+  return samples;
+}
+
+static void fill(sweep_scan_s scan, const std::vector<raw_sample>& samples) {
+  const auto count = static_cast<std::int32_t>(samples.size());
+
+  sweep_scan_set_number_of_samples(scan, count);
+
+  for (std::int32_t n = 0; n < count; ++n)
+    sweep_scan_set_sample(scan, n, samples[n].angle, samples[n].distance, samples[n].signal_strength);
+}
+
+// Filters apply in place, so every repetition starts from a fresh copy; the time refilling takes is subtracted
+static double time_per_scan_us(sweep_scan_s scan, const std::vector<raw_sample>& samples, sweep_filter_s filter) {
+  const int repetitions = 5000;
+
+  const auto fill_start = std::chrono::steady_clock::now();
+
+  for (int n = 0; n < repetitions; ++n)
+    fill(scan, samples);
+
+  const auto fill_elapsed = std::chrono::steady_clock::now() - fill_start;
+
+  const auto start = std::chrono::steady_clock::now();
+
+  for (int n = 0; n < repetitions; ++n) {
+    fill(scan, samples);
+    sweep_filter_apply(filter, scan);
+  }
+
+  const auto elapsed = std::chrono::steady_clock::now() - start - fill_elapsed;
+
+  return std::chrono::duration<double, std::micro>(elapsed).count() / repetitions;
+}
+
+int main() {
+  const auto samples = synthesize(1000);
+
+  sweep_error_s error = nullptr;
+  sweep_scan_s scan = sweep_scan_construct(0, &error);
+
+  if (error) {
+    std::cerr << "Error: " << sweep_error_message(error) << std::endl;
+    sweep_error_destruct(error);
+    return 1;
+  }
+
+  using stages = std::function<void(sweep_filter_s)>;
+
+  const std::vector<std::pair<std::string, stages>> configurations{
+      {"range gate", [&](sweep_filter_s f) { sweep_filter_add_range_gate(f, 10, 4000, &error); }},
+      {"signal threshold", [&](sweep_filter_s f) { sweep_filter_add_signal_threshold(f, 50, &error); }},
+      {"median radius 1", [&](sweep_filter_s f) { sweep_filter_add_median(f, 1, &error); }},
+      {"median radius 2", [&](sweep_filter_s f) { sweep_filter_add_median(f, 2, &error); }},
+      {"median radius 4", [&](sweep_filter_s f) { sweep_filter_add_median(f, 4, &error); }},
+      {"median radius 16", [&](sweep_filter_s f) { sweep_filter_add_median(f, 16, &error); }},
+      {"speckle removal", [&](sweep_filter_s f) { sweep_filter_add_speckle_removal(f, 20, &error); }},
+      {"all four, median radius 2", [&](sweep_filter_s f) {
+         sweep_filter_add_range_gate(f, 10, 4000, &error);
+         sweep_filter_add_signal_threshold(f, 50, &error);
+         sweep_filter_add_median(f, 2, &error);
+         sweep_filter_add_speckle_removal(f, 20, &error);
+       }},
+  };
+
+  std::cout << "stages                     us/scan  Msamples/s  samples left" << std::endl;
+
+  for (const auto& configuration : configurations) {
+    sweep_filter_s filter = sweep_filter_construct(&error);
+    configuration.second(filter);
+
+    if (error) {
+      std::cerr << "Error: " << sweep_error_message(error) << std::endl;
+      sweep_error_destruct(error);
+      return 1;
+    }
+
+    const double us = time_per_scan_us(scan, samples, filter);
+
+    std::cout << configuration.first << std::string(27 - configuration.first.size(), ' ') << us << "\t  "
+              << samples.size() / us << "\t      " << sweep_scan_get_number_of_samples(scan) << std::endl;
+
+    sweep_filter_destruct(filter);
+  }
+
+  sweep_scan_destruct(scan);
+}
@@ -0,0 +1,124 @@
+// Make use of the CMake build system or compile manually, e.g. with:
+// g++ -std=c++11 -O2 localizer-benchmark.cc -lsweep
+
+// Localizes a simulated robot driving through a synthetic 40 x 40 meter warehouse map and reports the time per update
+// against the number of particles, threads and beam subsampling. Does not need a device.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <sweep/sweep.hpp>
+
+const std::int32_t kSize = 800; // cells per axis
+const float kResolution = 5.0f; // cm per cell
+const float kOrigin = -2000.0f; // map corner in cm, the map is centered on the origin
+const float kPi = 3.14159265358979f;
+
+struct map {
+  std::vector<std::uint8_t> occupied;
+
+  bool at(float x, float y) const {
+    const auto cx = static_cast<std::int32_t>((x - kOrigin) / kResolution);
+    const auto cy = static_cast<std::int32_t>((y - kOrigin) / kResolution);
+    return cx < 0 || cy < 0 || cx >= kSize || cy >= kSize || occupied[cy * kSize + cx];
+  }
+};
+
+// Outer walls and rows of shelves with aisles in between
+static map make_map() {
+  map m{std::vector<std::uint8_t>(kSize * kSize)};
+
+  for (std::int32_t cy = 0; cy < kSize; ++cy) {
+    for (std::int32_t cx = 0; cx < kSize; ++cx) {
+      const bool wall = cx < 2 || cy < 2 || cx >= kSize - 2 || cy >= kSize - 2;
+      const bool shelf = cy % 120 >= 80 && cy % 120 < 100 && cx > 60 && cx < kSize - 60 && cx % 200 > 10;
+
+      m.occupied[cy * kSize + cx] = wall || shelf;
+    }
+  }
+
+  return m;
+}
+
+// Marches half a cell at a time until hitting an obstacle, with centimeter noise on the distance
+static sweep::scan simulate(const map& m, const sweep::pose& pose, std::mt19937& rng) {
+  std::normal_distribution<float> noise{0.0f, 2.0f};
+
+  sweep::scan scan;
+
+  for (std::int32_t step = 0; step < 5760; step += 5) {
+    const std::int32_t angle = static_cast<std::int32_t>(step * 1000 / 16.0f);
+    const float radian = (angle + pose.angle) / 1000.0f * kPi / 180.0f;
+
+    float distance = 10.0f;
+    while (distance < 4000.0f && !m.at(pose.x + distance * std::cos(radian), pose.y + distance * std::sin(radian)))
+      distance += kResolution / 2;
+
+    const auto measured = distance < 4000.0f ? static_cast<std::int32_t>(distance + noise(rng)) : 0;
+    scan.samples.push_back(sweep::sample{angle, measured, 100});
+  }
+
+  return scan;
+}
+
+int main() try {
+  const auto m = make_map();
+  const int updates = 50;
+
+  std::mt19937 rng{42};
+
+  // Drive along an aisle, 10 cm forward and turning by 0.2 degree per update
+  const sweep::pose motion{200, 10.0f, 0.0f};
+
+  std::vector<sweep::pose> path{sweep::pose{0, -1500.0f, -1100.0f}};
+  std::vector<sweep::scan> scans;
+
+  for (int n = 0; n < updates; ++n) {
+    if (n > 0) {
+      const auto& last = path.back();
+      const float radian = last.angle / 1000.0f * kPi / 180.0f;
+
+      path.push_back(sweep::pose{last.angle + motion.angle, last.x + motion.x * std::cos(radian) - motion.y * std::sin(radian),
+                                 last.y + motion.x * std::sin(radian) + motion.y * std::cos(radian)});
+    }
+
+    scans.push_back(simulate(m, path.back(), rng));
+  }
+
+  std::cout << "threads  beams  particles  us/update  error/cm" << std::endl;
+
+  for (const std::int32_t threads : {1, 0}) {
+    for (const std::int32_t beam_step : {1, 4}) {
+      for (const std::int32_t particles : {1000, 2000, 5000, 10000}) {
+        sweep::localizer localizer{particles, threads};
+        localizer.set_map(m.occupied, kSize, kSize, kResolution, sweep::point{kOrigin, kOrigin});
+        localizer.set_beam_step(beam_step);
+        localizer.reset(particles, path[0], 5000, 30.0f);
+
+        std::chrono::steady_clock::duration elapsed{};
+
+        for (int n = 0; n < updates; ++n) {
+          if (n > 0)
+            localizer.predict(motion, 500, 2.0f);
+
+          const auto start = std::chrono::steady_clock::now();
+          localizer.update(scans[n]);
+          elapsed += std::chrono::steady_clock::now() - start;
+        }
+
+        const auto estimate = localizer.get_pose();
+        const auto error = std::hypot(estimate.x - path.back().x, estimate.y - path.back().y);
+        const auto us = std::chrono::duration<double, std::micro>(elapsed).count() / updates;
+
+        std::cout << (threads == 0 ? "all" : "1") << "\t " << scans[0].samples.size() / beam_step << "\t" << particles << "\t   "
+                  << us << "\t      " << error << std::endl;
+      }
+    }
+  }
+} catch (const sweep::device_error& e) {
+  std::cerr << "Error: " << e.what() << std::endl;
+}
@@ -1,3 +1,4 @@
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 
@@ -26,6 +27,9 @@ void subscriber() {
 
   std::cout << "Subscribing." << std::endl;
 
+  sweep::decoder decoder;
+  sweep::scan scan;
+
   for (;;) {
     zmq::message_t msg;
 
@@ -35,12 +39,20 @@ void subscriber() {
     sweep::proto::scan in;
     in.ParseFromArray(msg.data(), msg.size());
 
-    const auto n = in.angle_size();
+    if (in.has_encoded()) {
+      const auto& encoded = in.encoded();
+      decoder.decode(reinterpret_cast<const std::uint8_t*>(encoded.data()), encoded.size(), scan);
+    } else {
+      scan.samples.clear();
+
+      for (auto i = 0; i < in.angle_size(); ++i)
+        scan.samples.push_back(sweep::sample{in.angle(i), in.distance(i), in.signal_strength(i)});
+    }
 
-    for (auto i = 0; i < n; ++i) {
-      std::cout << "Angle: " << in.angle(i)                      //
-                << " Distance: " << in.distance(i)               //
-                << " Signal strength: " << in.signal_strength(i) //
+    for (const sweep::sample& sample : scan.samples) {
+      std::cout << "Angle: " << sample.angle                      //
+                << " Distance: " << sample.distance               //
+                << " Signal strength: " << sample.signal_strength //
                 << std::endl;
     }
   }
@@ -58,16 +70,18 @@ void publisher(const std::string& dev) try {
 
   std::cout << "Publishing. Each dot is a full 360 degree scan." << std::endl;
 
+  // Subscribers may join at any time, every scan is encoded on its own
+  sweep::encoder encoder;
+  std::vector<std::uint8_t> frame;
+
   for (;;) {
     const sweep::scan scan = device.get_scan();
 
-    sweep::proto::scan out;
+    frame.clear();
+    encoder.encode(scan, frame);
 
-    for (const sweep::sample& sample : scan.samples) {
-      out.add_angle(sample.angle);
-      out.add_distance(sample.distance);
-      out.add_signal_strength(sample.signal_strength);
-    }
+    sweep::proto::scan out;
+    out.set_encoded(frame.data(), frame.size());
 
     auto encoded = out.SerializeAsString();
 
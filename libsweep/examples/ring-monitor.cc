@@ -0,0 +1,57 @@
+// Make use of the CMake build system or compile manually, e.g. with:
+// g++ -std=c++11 -O2 ring-monitor.cc -lsweep
+
+// Reads scans published by sweepd without copying them and reports once a second how many arrived, how many were
+// missed and how long they took from the daemon to this process. Run as many of them as you like next to each other.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+#include <sweep/sweep.hpp>
+
+static std::int64_t now_us() {
+  const auto now = std::chrono::system_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+int main(int argc, char* argv[]) try {
+  sweep::ring_reader reader{argc > 1 ? argv[1] : "sweepd"};
+
+  std::int64_t scans = 0, latency = 0, torn = 0;
+  std::int32_t nearest = 0;
+
+  auto report = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+  for (;;) {
+    sweep::ring_entry entry;
+
+    if (reader.next(entry, 1000)) {
+      latency += now_us() - entry.timestamp;
+
+      // Works on the samples in place, then makes sure the daemon did not overwrite them meanwhile
+      std::int32_t closest = 0;
+      for (std::int32_t n = 0; n < entry.count; ++n)
+        if (entry.samples[n].distance > 0 && (closest == 0 || entry.samples[n].distance < closest))
+          closest = entry.samples[n].distance;
+
+      if (reader.is_valid(entry)) {
+        nearest = closest;
+        scans += 1;
+      } else {
+        torn += 1;
+      }
+    }
+
+    if (std::chrono::steady_clock::now() >= report) {
+      std::cout << scans << " scans/s, " << (scans > 0 ? latency / scans : 0) << " us latency, nearest " << nearest
+                << " cm, " << reader.get_dropped() << " dropped, " << torn << " overwritten while in use" << std::endl;
+
+      scans = latency = 0;
+      report += std::chrono::seconds(1);
+    }
+  }
+} catch (const sweep::device_error& e) {
+  std::cerr << "Error: " << e.what() << std::endl;
+}
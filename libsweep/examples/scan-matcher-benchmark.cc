@@ -0,0 +1,152 @@
+// Make use of the CMake build system or compile manually, e.g. with:
+// g++ -std=c++11 -O2 scan-matcher-benchmark.cc -lsweep
+
+// Registers simulated scans taken at random offsets from a reference pose in a synthetic 12 x 9 meter room and reports
+// the time per match, how often the match converges and the remaining error, against the offset size and search window.
+// Does not need a device.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <sweep/sweep.hpp>
+
+const std::int32_t kWidth = 240; // cells
+const std::int32_t kHeight = 180;
+const float kResolution = 5.0f; // cm per cell
+const float kOriginX = -400.0f; // map corner in cm, the reference pose is at the origin
+const float kOriginY = -300.0f;
+const float kPi = 3.14159265358979f;
+
+struct map {
+  std::vector<std::uint8_t> occupied;
+
+  bool at(float x, float y) const {
+    const auto cx = static_cast<std::int32_t>(std::floor((x - kOriginX) / kResolution));
+    const auto cy = static_cast<std::int32_t>(std::floor((y - kOriginY) / kResolution));
+    return cx < 0 || cy < 0 || cx >= kWidth || cy >= kHeight || occupied[cy * kWidth + cx];
+  }
+};
+
+// Walls, a cabinet along one wall, two pillars and a table, so that no offset along a wall looks like another
+static map make_map() {
+  map m{std::vector<std::uint8_t>(kWidth * kHeight)};
+
+  for (std::int32_t cy = 0; cy < kHeight; ++cy) {
+    for (std::int32_t cx = 0; cx < kWidth; ++cx) {
+      const bool wall = cx < 2 || cy < 2 || cx >= kWidth - 2 || cy >= kHeight - 2;
+      const bool cabinet = cx >= 30 && cx < 70 && cy >= 2 && cy < 14;
+      const bool pillar = std::hypot(cx - 150.0f, cy - 60.0f) < 6.0f || std::hypot(cx - 60.0f, cy - 130.0f) < 4.0f;
+      const bool table = cx >= 170 && cx < 200 && cy >= 120 && cy < 140;
+
+      m.occupied[cy * kWidth + cx] = wall || cabinet || pillar || table;
+    }
+  }
+
+  return m;
+}
+
+// Marches half a cell at a time until hitting an obstacle, with centimeter noise on the distance
+static sweep::scan simulate(const map& m, const sweep::pose& pose, std::mt19937& rng) {
+  std::normal_distribution<float> noise{0.0f, 2.0f};
+
+  sweep::scan scan;
+
+  for (std::int32_t step = 0; step < 5760; step += 5) {
+    const std::int32_t angle = static_cast<std::int32_t>(step * 1000 / 16.0f);
+    const float radian = (angle + pose.angle) / 1000.0f * kPi / 180.0f;
+
+    float distance = 10.0f;
+    while (distance < 4000.0f && !m.at(pose.x + distance * std::cos(radian), pose.y + distance * std::sin(radian)))
+      distance += kResolution / 2;
+
+    const auto measured = distance < 4000.0f ? static_cast<std::int32_t>(distance + noise(rng)) : 0;
+    scan.samples.push_back(sweep::sample{angle, measured, 100});
+  }
+
+  return scan;
+}
+
+int main() try {
+  const auto m = make_map();
+  const int trials = 100;
+
+  // A match converged if it lands within a few cells of the true pose
+  const float converged_distance = 5.0f;  // cm
+  const float converged_angle = 1000.0f; // millidegrees
+
+  std::mt19937 rng{42};
+
+  sweep::scan_matcher matcher;
+
+  const auto reference = simulate(m, sweep::pose{0, 0.0f, 0.0f}, rng);
+
+  const auto reference_start = std::chrono::steady_clock::now();
+  matcher.set_reference(reference);
+  const auto reference_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - reference_start).count();
+
+  std::cout << "reference preparation " << reference_us << " us" << std::endl << std::endl;
+  std::cout << "window     offset/cm  offset/deg  us/match  converged  mean error/cm  mean error/deg" << std::endl;
+
+  struct window {
+    const char* name;
+    float linear;
+    std::int32_t angular;
+  };
+
+  const window windows[] = {{"icp only", 0.0f, 0}, {"30cm 5deg", 30.0f, 5000}};
+
+  for (const auto& w : windows) {
+    matcher.set_search_window(w.linear, w.angular, 5.0f);
+
+    // Offsets beyond the window show where matching stops converging
+    for (const float offset : {5.0f, 30.0f, 60.0f, 120.0f}) {
+      for (const std::int32_t rotation : {1000, 10000, 30000}) {
+        std::uniform_real_distribution<float> linear{-offset, offset};
+        std::uniform_int_distribution<std::int32_t> angular{-rotation, rotation};
+
+        std::chrono::steady_clock::duration elapsed{};
+
+        int converged = 0;
+        double distance_error = 0.0;
+        double angle_error = 0.0;
+
+        for (int n = 0; n < trials; ++n) {
+          const sweep::pose truth{angular(rng), linear(rng), linear(rng)};
+          const auto scan = simulate(m, truth, rng);
+
+          // No odometry: the guess is the reference pose itself
+          sweep::pose guess{0, 0.0f, 0.0f};
+
+          const auto start = std::chrono::steady_clock::now();
+          matcher.match(scan, guess);
+          elapsed += std::chrono::steady_clock::now() - start;
+
+          const float distance = std::hypot(guess.x - truth.x, guess.y - truth.y);
+          // Matched angles come back in [0, 360) degree
+          const std::int32_t difference = ((guess.angle - truth.angle) % 360000 + 360000) % 360000;
+          const float angle = static_cast<float>(std::min(difference, 360000 - difference));
+
+          if (distance < converged_distance && angle < converged_angle) {
+            converged += 1;
+            distance_error += distance;
+            angle_error += angle / 1000.0f;
+          }
+        }
+
+        const auto us = std::chrono::duration<double, std::micro>(elapsed).count() / trials;
+        const auto successes = std::max(converged, 1);
+
+        std::cout << w.name << "\t   " << offset << "\t      " << rotation / 1000 << "\t  " << us << "\t   "
+                  << converged * 100 / trials << "%\t  " << distance_error / successes << "\t\t " << angle_error / successes
+                  << std::endl;
+      }
+    }
+  }
+} catch (const sweep::device_error& e) {
+  std::cerr << "Error: " << e.what() << std::endl;
+}
@@ -0,0 +1,169 @@
+// Make use of the CMake build system or compile manually, e.g. with:
+// g++ -std=c++11 -O2 spatial-index-benchmark.cc -lsweep
+
+// Reports the time per nearest neighbour and radius query of the bucket grid against checking every point, and how often
+// the answers differ, over a short history of scans in a synthetic 10 x 8 meter room. Does not need a device.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <sweep/sweep.hpp>
+
+const float kCellSize = 20.0f; // cm
+const float kExtent = 1000.0f; // cm, queries go beyond it
+
+// Sensor at pose in a 10 x 8 meter room around the origin, centimeter noise
+static sweep::scan simulate(const sweep::pose& pose, std::mt19937& rng) {
+  std::normal_distribution<float> noise{0.0f, 1.0f};
+
+  sweep::scan scan;
+
+  for (std::int32_t n = 0; n < 1000; ++n) {
+    const std::int32_t angle = static_cast<std::int32_t>(n * 5760 / 1000 * 1000 / 16.0f);
+    const float radian = (angle + pose.angle) / 1000.0f * 3.14159265f / 180.0f;
+
+    const float c = std::cos(radian), s = std::sin(radian);
+    const float wall_x = c > 0 ? (500.0f - pose.x) / c : c < 0 ? (-500.0f - pose.x) / c : 1e9f;
+    const float wall_y = s > 0 ? (400.0f - pose.y) / s : s < 0 ? (-400.0f - pose.y) / s : 1e9f;
+
+    const auto distance = static_cast<std::int32_t>(std::min(wall_x, wall_y) + noise(rng));
+    scan.samples.push_back(sweep::sample{angle, distance, 100});
+  }
+
+  return scan;
+}
+
+static float squared_distance(const sweep::point& a, const sweep::point& b) {
+  return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y);
+}
+
+// Checks every point, the reference the index has to agree with
+static std::int32_t brute_nearest(const std::vector<sweep::point>& points, const sweep::point& query, float max_distance) {
+  float best_squared = max_distance * max_distance;
+  std::int32_t best = -1;
+
+  for (std::size_t n = 0; n < points.size(); ++n) {
+    const float squared = squared_distance(points[n], query);
+
+    if (squared <= best_squared) {
+      best_squared = squared;
+      best = static_cast<std::int32_t>(n);
+    }
+  }
+
+  return best;
+}
+
+static void brute_within(const std::vector<sweep::point>& points, const sweep::point& query, float radius,
+                         std::vector<std::int32_t>& ids) {
+  ids.clear();
+
+  for (std::size_t n = 0; n < points.size(); ++n)
+    if (squared_distance(points[n], query) <= radius * radius)
+      ids.push_back(static_cast<std::int32_t>(n));
+}
+
+template <typename Fn> static double time_us(Fn&& fn) {
+  const auto start = std::chrono::steady_clock::now();
+  fn();
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() try {
+  std::mt19937 rng{42};
+
+  // The latest scan plus a short history while the sensor moves through the room
+  const sweep::pose poses[] = {{0, 0.0f, 0.0f}, {5000, 40.0f, 10.0f}, {10000, 80.0f, 25.0f}, {15000, 120.0f, 45.0f}};
+
+  sweep::spatial_index index{kCellSize, kExtent, 4000};
+  std::vector<sweep::point> points;
+
+  for (const auto& pose : poses) {
+    const auto scan = simulate(pose, rng);
+    index.add_scan(scan, pose);
+  }
+
+  index.build();
+
+  for (std::int32_t id = 0; id < 4000; ++id)
+    points.push_back(index.get_point(id));
+
+  // Near the walls where matching asks, and anywhere including outside the grid
+  std::vector<sweep::point> queries;
+  std::normal_distribution<float> jitter{0.0f, 15.0f};
+  std::uniform_real_distribution<float> anywhere{-1.2f * kExtent, 1.2f * kExtent};
+
+  for (std::int32_t n = 0; n < 2000; ++n) {
+    const auto& p = points[rng() % points.size()];
+    queries.push_back(n % 4 == 0 ? sweep::point{anywhere(rng), anywhere(rng)} : sweep::point{p.x + jitter(rng), p.y + jitter(rng)});
+  }
+
+  const auto count = static_cast<double>(queries.size());
+  const float infinity = std::numeric_limits<float>::infinity();
+
+  std::cout << "query         distance/cm  index us/query  brute us/query  speedup  differing" << std::endl;
+
+  for (const float max_distance : {10.0f, 50.0f, 200.0f, infinity}) {
+    std::vector<std::int32_t> ids, expected(queries.size());
+
+    const double index_us = time_us([&] { index.nearest(queries, max_distance, ids); }) / count;
+
+    const double brute_us = time_us([&] {
+      for (std::size_t n = 0; n < queries.size(); ++n)
+        expected[n] = brute_nearest(points, queries[n], max_distance);
+    }) / count;
+
+    // Ties may pick different points at the same distance
+    std::int32_t differing = 0;
+
+    for (std::size_t n = 0; n < queries.size(); ++n) {
+      if (ids[n] == expected[n])
+        continue;
+
+      if (ids[n] < 0 || expected[n] < 0 ||
+          squared_distance(points[ids[n]], queries[n]) != squared_distance(points[expected[n]], queries[n]))
+        differing += 1;
+    }
+
+    std::cout << "nearest\t      " << max_distance << "\t   " << index_us << "\t   " << brute_us << "\t    "
+              << brute_us / index_us << "\t     " << differing << std::endl;
+  }
+
+  for (const float radius : {10.0f, 50.0f, 200.0f}) {
+    std::vector<std::int32_t> ids, expected;
+    double index_us = 0.0, brute_us = 0.0;
+    std::int32_t differing = 0;
+
+    for (const auto& query : queries) {
+      index_us += time_us([&] { index.within(query, radius, ids); });
+      brute_us += time_us([&] { brute_within(points, query, radius, expected); });
+
+      std::sort(ids.begin(), ids.end());
+
+      if (ids != expected)
+        differing += 1;
+    }
+
+    std::cout << "within\t      " << radius << "\t   " << index_us / count << "\t   " << brute_us / count << "\t    "
+              << brute_us / index_us << "\t     " << differing << std::endl;
+  }
+
+  // Unbounded queries far off an empty index stay bounded by the grid size
+  sweep::spatial_index empty{kCellSize, kExtent, 1};
+  empty.build();
+
+  const std::vector<sweep::point> far{{1e30f, -1e30f}, {infinity, 0.0f}, {0.0f, 0.0f}};
+  std::vector<std::int32_t> ids;
+
+  const double empty_us = time_us([&] { empty.nearest(far, infinity, ids); }) / far.size();
+
+  std::cout << std::endl << "empty index, unbounded distance " << empty_us << " us/query" << std::endl;
+} catch (const sweep::device_error& e) {
+  std::cerr << "Error: " << e.what() << std::endl;
+}
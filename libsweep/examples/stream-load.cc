@@ -0,0 +1,227 @@
+// Make use of the CMake build system or compile manually, e.g. with:
+// g++ -std=c++11 -O2 stream-load.cc -lsweep -pthread
+
+// Load generator for sweep-stream: publishes synthetic scans into the ring "stream-load" at a given rate and connects
+// TCP subscribers over loopback, some of them reading slower than scans arrive. Reports subscribers x scans/s
+// delivered, throughput, latency and the scans subscribers missed. Run the server next to it:
+//
+//   sweep-stream ring:stream-load &
+//   ./stream-load [subscribers=8] [scans/s=100] [seconds=10] [slow subscribers=0] [port=5000]
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <sweep/sweep.hpp>
+
+static const std::size_t kHeaderBytes = 32;
+
+static std::int64_t now_us() {
+  const auto now = std::chrono::system_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+static std::uint64_t get_le(const std::uint8_t* in, std::size_t bytes) {
+  std::uint64_t value = 0;
+  for (std::size_t n = 0; n < bytes; ++n)
+    value |= static_cast<std::uint64_t>(in[n]) << (8 * n);
+  return value;
+}
+
+struct totals {
+  std::atomic<std::int64_t> frames{0};
+  std::atomic<std::int64_t> bytes{0};
+  std::atomic<std::int64_t> missed{0};
+  std::atomic<std::int64_t> latency{0};
+  std::atomic<std::int64_t> decoded{0};
+  std::atomic<bool> stop{false};
+};
+
+static int connect_to(std::uint16_t port, bool slow) {
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+  // Small socket buffers, so the server's queue for a slow subscriber fills up within seconds
+  if (fd != -1 && slow) {
+    const int bytes = 16 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+  }
+
+  if (fd == -1 || connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1)
+    throw std::runtime_error{"connecting to sweep-stream failed"};
+
+  // Wakes up regularly to check whether to stop
+  timeval timeout{0, 200000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  return fd;
+}
+
+// Reads frames, checking their sequence numbers for gaps; the first subscriber also decodes every scan
+static void subscribe(totals& t, std::uint16_t port, bool decode, bool slow) try {
+  const int fd = connect_to(port, slow);
+
+  // Drop-oldest is the server's default; a slow subscriber asks for it explicitly to show how to pick one
+  if (slow) {
+    const std::string line = "policy drop-oldest\n";
+    (void)send(fd, line.data(), line.size(), 0);
+  }
+
+  sweep::decoder decoder;
+  sweep::scan scan;
+
+  std::vector<std::uint8_t> buffer(1 << 16);
+  std::size_t filled = 0;
+
+  std::int64_t last = -1;
+
+  while (!t.stop) {
+    if (slow)
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    const auto wanted = slow ? std::min<std::size_t>(4096, buffer.size() - filled) : buffer.size() - filled;
+    const auto received = recv(fd, buffer.data() + filled, wanted, 0);
+
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+      continue;
+
+    if (received <= 0)
+      break;
+
+    filled += static_cast<std::size_t>(received);
+
+    std::size_t offset = 0;
+
+    while (filled - offset >= kHeaderBytes) {
+      const std::uint8_t* header = buffer.data() + offset;
+
+      if (get_le(header, 4) != 0x46535753)
+        throw std::runtime_error{"stream out of sync"};
+
+      const auto payload = static_cast<std::size_t>(get_le(header + 24, 4));
+
+      if (filled - offset < kHeaderBytes + payload)
+        break;
+
+      const auto sequence = static_cast<std::int64_t>(get_le(header + 8, 8));
+      const auto timestamp = static_cast<std::int64_t>(get_le(header + 16, 8));
+
+      if (last >= 0 && sequence > last + 1)
+        t.missed += sequence - last - 1;
+
+      last = sequence;
+
+      if (decode && decoder.decode(header + kHeaderBytes, payload, scan) > 0)
+        t.decoded += 1;
+
+      t.frames += 1;
+      t.bytes += static_cast<std::int64_t>(kHeaderBytes + payload);
+      t.latency += now_us() - timestamp;
+
+      offset += kHeaderBytes + payload;
+    }
+
+    std::memmove(buffer.data(), buffer.data() + offset, filled - offset);
+    filled -= offset;
+  }
+
+  close(fd);
+} catch (const std::exception& e) {
+  std::cerr << "Error: " << e.what() << std::endl;
+}
+
+// A sensor in a 10 x 8 meter room, 1000 samples per rotation
+static sweep::scan synthesize() {
+  sweep::scan scan;
+
+  for (int n = 0; n < 1000; ++n) {
+    const auto angle = static_cast<std::int32_t>(n * 360000 / 1000);
+    scan.samples.push_back(sweep::sample{angle, 300 + (n * 7) % 200, 200});
+  }
+
+  return scan;
+}
+
+int main(int argc, char* argv[]) try {
+  const int subscribers = argc > 1 ? std::stoi(argv[1]) : 8;
+  const int rate = argc > 2 ? std::stoi(argv[2]) : 100;
+  const int seconds = argc > 3 ? std::stoi(argv[3]) : 10;
+  const int slow = argc > 4 ? std::stoi(argv[4]) : 0;
+  const auto port = static_cast<std::uint16_t>(argc > 5 ? std::stoi(argv[5]) : 5000);
+
+  sweep::ring_writer ring{"stream-load"};
+  const auto scan = synthesize();
+
+  // Gives sweep-stream time to attach to the ring, which it retries once a second
+  std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+
+  totals fast_totals, slow_totals;
+  std::vector<std::thread> threads;
+
+  for (int n = 0; n < subscribers; ++n) {
+    const bool is_slow = n >= subscribers - slow;
+    threads.emplace_back(subscribe, std::ref(is_slow ? slow_totals : fast_totals), port, n == 0, is_slow);
+  }
+
+  const auto period = std::chrono::microseconds(1000000 / rate);
+  auto next = std::chrono::steady_clock::now();
+  std::int64_t published = 0;
+
+  const auto begin = std::chrono::steady_clock::now();
+
+  for (int second = 0; second < seconds; ++second) {
+    const auto frames = fast_totals.frames.load();
+    const auto bytes = fast_totals.bytes.load();
+    const auto latency = fast_totals.latency.load();
+
+    for (int n = 0; n < rate; ++n) {
+      ring.publish(scan, now_us());
+      published += 1;
+
+      next += period;
+      std::this_thread::sleep_until(next);
+    }
+
+    const auto delivered = fast_totals.frames - frames;
+
+    std::cout << delivered << " scans/s delivered to " << subscribers - slow << " subscribers, "
+              << (fast_totals.bytes - bytes) / (1024.0 * 1024.0) << " MiB/s, "
+              << (delivered > 0 ? (fast_totals.latency - latency) / delivered : 0) << " us latency, "
+              << fast_totals.missed << " missed" << std::endl;
+  }
+
+  const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  fast_totals.stop = slow_totals.stop = true;
+
+  for (auto& thread : threads)
+    thread.join();
+
+  std::cout << "published " << published << " scans in " << elapsed << " s; subscribers got " << fast_totals.frames
+            << " of " << published * (subscribers - slow) << ", first one decoded " << fast_totals.decoded << "; slow ones got "
+            << slow_totals.frames << " and missed " << slow_totals.missed << std::endl;
+} catch (const std::exception& e) {
+  std::cerr << "Error: " << e.what() << std::endl;
+  return 1;
+}
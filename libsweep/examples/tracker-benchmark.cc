@@ -0,0 +1,74 @@
+// Make use of the CMake build system or compile manually, e.g. with:
+// g++ -std=c++11 -O2 tracker-benchmark.cc -lsweep
+
+// Tracks synthetic objects moving around the sensor and reports the time per update against the number of objects.
+// Does not need a device.
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <sweep/sweep.hpp>
+
+struct object {
+  float x, y;   // in cm
+  float vx, vy; // in cm/s
+};
+
+int main() try {
+  const float dt = 0.1f;        // 10 Hz rotation
+  const float half_side = 1000; // objects move within 20 x 20 meter around the sensor
+  const int updates = 500;
+
+  std::mt19937 rng{42};
+  std::uniform_real_distribution<float> position{-half_side, half_side};
+  std::uniform_real_distribution<float> velocity{-150.0f, 150.0f};
+  std::normal_distribution<float> noise{0.0f, 3.0f};
+  std::bernoulli_distribution missed{0.05};
+
+  std::cout << "objects  us/update  tracks" << std::endl;
+
+  for (const int count : {10, 50, 100, 200, 500, 1000}) {
+    std::vector<object> objects(count);
+
+    for (auto& o : objects)
+      o = object{position(rng), position(rng), velocity(rng), velocity(rng)};
+
+    sweep::tracker tracker{2 * count};
+
+    std::vector<sweep::point> detections;
+    std::vector<sweep::track> tracks;
+
+    std::chrono::steady_clock::duration elapsed{};
+
+    for (int n = 0; n < updates; ++n) {
+      detections.clear();
+
+      for (auto& o : objects) {
+        o.x += o.vx * dt;
+        o.y += o.vy * dt;
+
+        if (std::abs(o.x) > half_side)
+          o.vx = -o.vx;
+        if (std::abs(o.y) > half_side)
+          o.vy = -o.vy;
+
+        if (!missed(rng))
+          detections.push_back(sweep::point{o.x + noise(rng), o.y + noise(rng)});
+      }
+
+      const auto start = std::chrono::steady_clock::now();
+      tracker.update(detections, dt, tracks);
+      elapsed += std::chrono::steady_clock::now() - start;
+    }
+
+    const auto us = std::chrono::duration<double, std::micro>(elapsed).count() / updates;
+
+    std::cout << count << "\t " << us << "\t    " << tracks.size() << std::endl;
+  }
+} catch (const sweep::device_error& e) {
+  std::cerr << "Error: " << e.what() << std::endl;
+}
@@ -1,8 +1,7 @@
 // Make use of the CMake build system or compile manually, e.g. with:
 // g++ -std=c++11 viewer.cc -lsweep -lsfml-graphics -lsfml-window -lsfml-system
 
-#include <cmath>
-
+#include <cstddef>
 #include <cstdlib>
 #include <iostream>
 #include <mutex>
@@ -87,8 +86,11 @@ int main(int argc, char* argv[]) try {
 
     PointCloud localPointCloud;
 
-    for (auto sample : scan.samples) {
-      const constexpr auto kDegreeToRadian = 0.017453292519943295;
+    // From angle / distance to Cartesian, rotated by 90 degree to adjust to device orientation
+    const auto points = sweep::to_cartesian(scan, sweep::pose{90 * 1000, 0.0f, 0.0f});
+
+    for (std::size_t n = 0; n < scan.samples.size(); ++n) {
+      const auto& sample = scan.samples[n];
 
       const auto distance = static_cast<double>(sample.distance);
 
@@ -96,17 +98,9 @@ int main(int argc, char* argv[]) try {
       if (distance > kMaxLaserDistance)
         continue;
 
-      // From milli degree to degree and adjust to device orientation
-      const auto degree = std::fmod((static_cast<double>(sample.angle) / 1000. + 90.), 360.);
-      const auto radian = degree * kDegreeToRadian;
-
-      // From angle / distance to to Cartesian
-      auto x = std::cos(radian) * distance;
-      auto y = std::sin(radian) * distance;
-
       // Make positive
-      x = x + kMaxLaserDistance;
-      y = y + kMaxLaserDistance;
+      auto x = points[n].x + kMaxLaserDistance;
+      auto y = points[n].y + kMaxLaserDistance;
 
       // Scale to window size
       x = (x / (2 * kMaxLaserDistance)) * windowMinSize;
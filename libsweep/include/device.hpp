@@ -0,0 +1,29 @@
+#ifndef SWEEP_DEVICE_5B17E0C94A2D_HPP
+#define SWEEP_DEVICE_5B17E0C94A2D_HPP
+
+/*
+ * Hooks into a device's acquisition.
+ * Implementation detail; not exported.
+ */
+
+#include "scan.hpp"
+
+#include "sweep.h"
+
+#include <exception>
+#include <functional>
+#include <memory>
+
+namespace sweep {
+namespace device {
+
+// Takes each scan, or the error ending acquisition with a null scan; called from the device's background thread
+using sink = std::function<void(std::unique_ptr<sweep_scan> scan, std::exception_ptr error)>;
+
+// Hands scans to the sink instead of queueing them for sweep_device_get_scan; set while the device is not scanning
+void set_sink(sweep_device_s device, sink fn);
+
+} // ns device
+} // ns sweep
+
+#endif
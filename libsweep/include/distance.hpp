@@ -0,0 +1,44 @@
+#ifndef SWEEP_DISTANCE_7C2E5A9F13B8_HPP
+#define SWEEP_DISTANCE_7C2E5A9F13B8_HPP
+
+/*
+ * Exact Euclidean distance transform over grids.
+ * Implementation detail; not exported.
+ */
+
+#include "pool.hpp"
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace sweep {
+namespace distance {
+
+// Working buffers for transforming grids of a fixed size, sized once and reused for every transform
+struct transform {
+  transform(int32_t width, int32_t height);
+
+  int32_t width;
+  int32_t height;
+
+  std::vector<int32_t> columns; // distance in cells to the nearest seed along the column, row-major
+
+  // Lower envelope of parabolas per block of rows, see squared below
+  std::vector<int32_t> parabolas;
+  std::vector<float> boundaries;
+};
+
+// Squared distance in cells from every cell to the nearest non-zero seed cell, both row-major width x height.
+// Cells in a grid without any seed get infinity. Linear time in the number of cells (Felzenszwalb and Huttenlocher):
+// a pass along the columns, run on strips of columns in parallel, then a lower envelope of parabolas per row, run on
+// blocks of rows in parallel.
+void squared(transform& transform, const uint8_t* seeds, float* distance, pool::pool& pool);
+
+// Same as above but writes the Euclidean distance multiplied by scale, e.g. the cell size to get metric distances
+void euclidean(transform& transform, const uint8_t* seeds, float* distance, float scale, pool::pool& pool);
+
+} // ns distance
+} // ns sweep
+
+#endif
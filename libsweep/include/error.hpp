@@ -6,7 +6,10 @@
  * Implementation detail; not exported.
  */
 
+#include "sweep.h"
+
 #include <stdexcept>
+#include <string>
 
 namespace sweep {
 namespace error {
@@ -19,4 +22,11 @@ struct error : std::runtime_error {
 } // ns errors
 } // ns sweep
 
+struct sweep_error {
+  std::string what;
+};
+
+// Constructor hidden from users
+sweep_error_s sweep_error_construct(const char* what);
+
 #endif
@@ -0,0 +1,58 @@
+#ifndef SWEEP_FILE_3A9C41D07B52_HPP
+#define SWEEP_FILE_3A9C41D07B52_HPP
+
+/*
+ * Append-only files flushed to stable storage, read-only memory mappings and named shared memory.
+ * Implementation detail; not exported.
+ */
+
+#include "error.hpp"
+
+#include "sweep.h"
+
+#include <stdint.h>
+
+namespace sweep {
+namespace file {
+
+struct error : sweep::error::error {
+  using base = sweep::error::error;
+  using base::base;
+};
+
+// Truncates an existing file
+using writer_s = struct writer*;
+
+writer_s writer_construct(const char* path);
+void writer_destruct(writer_s writer);
+
+void writer_write(writer_s writer, const void* from, int64_t len);
+// Blocks until everything written so far reached stable storage
+void writer_sync(writer_s writer);
+
+// Maps the whole file read-only; an empty file maps to a null pointer
+using mapping_s = struct mapping*;
+
+mapping_s mapping_construct(const char* path);
+void mapping_destruct(mapping_s mapping);
+
+const uint8_t* mapping_data(mapping_s mapping);
+int64_t mapping_size(mapping_s mapping);
+
+// Named shared memory, zero-initialized; the creating side owns the name and removes it again, replacing a stale one
+// left behind by a crash. The creating side maps it read-write, the opening side read-only; atomics in it have to be
+// lock-free, so loading them does not write.
+using shared_s = struct shared*;
+
+shared_s shared_create(const char* name, int64_t size);
+shared_s shared_open(const char* name);
+void shared_destruct(shared_s shared);
+
+// Only written to by the creating side
+uint8_t* shared_data(shared_s shared);
+int64_t shared_size(shared_s shared);
+
+} // ns file
+} // ns sweep
+
+#endif
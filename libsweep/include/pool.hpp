@@ -0,0 +1,144 @@
+#ifndef SWEEP_POOL_A3F05C7D19B2_HPP
+#define SWEEP_POOL_A3F05C7D19B2_HPP
+
+/*
+ * Fixed-size thread pool for data parallel loops.
+ * Implementation detail; not exported.
+ */
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sweep {
+namespace pool {
+
+class pool {
+public:
+  // Spawns threads - 1 workers, the thread calling parallel_for is the last one; zero uses all cores
+  explicit pool(int32_t threads) {
+    if (threads <= 0)
+      threads = std::max(1, static_cast<int32_t>(std::thread::hardware_concurrency()));
+
+    for (int32_t n = 1; n < threads; ++n)
+      workers.emplace_back(&pool::work, this);
+  }
+
+  ~pool() {
+    {
+      std::lock_guard<std::mutex> lock(the_mutex);
+      shutdown = true;
+    }
+
+    wake_workers.notify_all();
+
+    for (auto& worker : workers)
+      worker.join();
+  }
+
+  pool(const pool&) = delete;
+  pool& operator=(const pool&) = delete;
+
+  int32_t size() const { return static_cast<int32_t>(workers.size()) + 1; }
+
+  // Runs fn(task) for all tasks in [0, tasks) and blocks until all of them are done.
+  // Tasks are handed out dynamically, one at a time; fn must not throw.
+  void parallel_for(int32_t tasks, std::function<void(int32_t)> fn) {
+    if (tasks <= 0)
+      return;
+
+    {
+      std::lock_guard<std::mutex> lock(the_mutex);
+      job = std::move(fn);
+      total = tasks;
+      next = 0;
+      pending = tasks;
+      generation += 1;
+      joined = 0;
+    }
+
+    wake_workers.notify_all();
+
+    run_tasks();
+
+    // Every worker has to have joined this job and left it again: one waking up late would otherwise join the next job
+    // while it is being set up, pairing this job's task counter with the next one's tasks
+    std::unique_lock<std::mutex> lock(the_mutex);
+    while (pending != 0 || active != 0 || joined != static_cast<int32_t>(workers.size()))
+      all_done.wait(lock);
+
+    job = nullptr;
+  }
+
+private:
+  void run_tasks() {
+    for (;;) {
+      const int32_t task = next.fetch_add(1);
+
+      if (task >= total)
+        return;
+
+      job(task);
+
+      if (pending.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(the_mutex);
+        all_done.notify_all();
+      }
+    }
+  }
+
+  void work() {
+    uint64_t seen = 0;
+
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(the_mutex);
+
+        while (!shutdown && generation == seen)
+          wake_workers.wait(lock);
+
+        if (shutdown)
+          return;
+
+        seen = generation;
+        active += 1;
+        joined += 1;
+      }
+
+      run_tasks();
+
+      {
+        std::lock_guard<std::mutex> lock(the_mutex);
+        active -= 1;
+      }
+
+      all_done.notify_all();
+    }
+  }
+
+  std::vector<std::thread> workers;
+
+  std::function<void(int32_t)> job;
+  int32_t total = 0;
+  std::atomic<int32_t> next{0};
+  std::atomic<int32_t> pending{0};
+  uint64_t generation = 0;
+  int32_t joined = 0; // workers that saw the current generation
+  int32_t active = 0;
+  bool shutdown = false;
+
+  std::mutex the_mutex;
+  std::condition_variable wake_workers;
+  std::condition_variable all_done;
+};
+
+} // ns pool
+} // ns sweep
+
+#endif
@@ -185,6 +185,13 @@ response_param_s read_response_param(sweep::serial::device_s serial, const uint8
 
 response_scan_packet_s read_response_scan(sweep::serial::device_s serial);
 
+// Checksums and carries an angle within a rotation
+bool is_valid_scan_packet(const response_scan_packet_s& packet);
+
+// Offset of the first of count consecutive valid scan packets in bytes, or -1; tells a device streaming scans apart from
+// responses and noise, all zero packets checksum too and do not count
+int32_t find_scan_packets(const uint8_t* bytes, int32_t size, int32_t count);
+
 response_info_motor_ready_s read_response_info_motor_ready(sweep::serial::device_s serial);
 
 response_info_motor_speed_s read_response_info_motor_speed(sweep::serial::device_s serial);
@@ -9,6 +9,7 @@
 #include <stdint.h>
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
@@ -55,6 +56,18 @@ public:
     return v;
   }
 
+  // Waits at most timeout ms for an element; returns false if none became available
+  bool dequeue_for(T& v, int32_t timeout) {
+    std::unique_lock<std::mutex> lock(the_mutex);
+
+    if (!the_cond_var.wait_for(lock, std::chrono::milliseconds(timeout), [this] { return !the_queue.empty(); }))
+      return false;
+
+    v = std::move(the_queue.front());
+    the_queue.pop();
+    return true;
+  }
+
 private:
   int32_t max_size;
   std::queue<T> the_queue;
@@ -0,0 +1,26 @@
+#ifndef SWEEP_SCAN_8D1A3C6E20F4_HPP
+#define SWEEP_SCAN_8D1A3C6E20F4_HPP
+
+/*
+ * In-memory representation of a full scan.
+ * Implementation detail; not exported.
+ */
+
+#include "sweep.h"
+
+#include <stdint.h>
+
+#define SWEEP_MAX_SAMPLES 4096
+
+struct sample {
+  int32_t angle;           // in millidegrees
+  int32_t distance;        // in cm
+  int32_t signal_strength; // range 0:255
+};
+
+struct sweep_scan {
+  sample samples[SWEEP_MAX_SAMPLES];
+  int32_t count;
+};
+
+#endif
@@ -12,6 +12,9 @@
 
 #include <stdint.h>
 
+#include <string>
+#include <vector>
+
 namespace sweep {
 namespace serial {
 
@@ -29,6 +32,12 @@ void device_read(device_s serial, void* to, int32_t len);
 void device_write(device_s serial, const void* from, int32_t len);
 void device_flush(device_s serial);
 
+// Reads whatever arrives within timeout ms, at most len bytes; returns the number of bytes read, zero on timeout
+int32_t device_read_some(device_s serial, void* to, int32_t len, int32_t timeout);
+
+// Ports devices may be attached to, e.g. all USB serial adapters present
+std::vector<std::string> enumerate_ports();
+
 } // ns serial
 } // ns sweep
 
@@ -44,21 +44,52 @@ SWEEP_API bool sweep_is_abi_compatible(void);
 typedef struct sweep_error* sweep_error_s;
 typedef struct sweep_device* sweep_device_s;
 typedef struct sweep_scan* sweep_scan_s;
+typedef struct sweep_filter* sweep_filter_s;
+typedef struct sweep_occupancy_grid* sweep_occupancy_grid_s;
+typedef struct sweep_scan_matcher* sweep_scan_matcher_s;
+typedef struct sweep_spatial_index* sweep_spatial_index_s;
+typedef struct sweep_line_extractor* sweep_line_extractor_s;
+typedef struct sweep_clusterer* sweep_clusterer_s;
+typedef struct sweep_background* sweep_background_s;
+typedef struct sweep_tracker* sweep_tracker_s;
+typedef struct sweep_zone_monitor* sweep_zone_monitor_s;
+typedef struct sweep_localizer* sweep_localizer_s;
+typedef struct sweep_clearance_map* sweep_clearance_map_s;
+typedef struct sweep_free_space* sweep_free_space_s;
+typedef struct sweep_scan_encoder* sweep_scan_encoder_s;
+typedef struct sweep_scan_decoder* sweep_scan_decoder_s;
+typedef struct sweep_log_writer* sweep_log_writer_s;
+typedef struct sweep_log_reader* sweep_log_reader_s;
+typedef struct sweep_ring_writer* sweep_ring_writer_s;
+typedef struct sweep_ring_reader* sweep_ring_reader_s;
+typedef struct sweep_fleet* sweep_fleet_s;
+typedef struct sweep_fusion* sweep_fusion_s;
+typedef struct sweep_discovery* sweep_discovery_s;
+
+// Called with the bit mask of intruded zones and the intruding sample
+typedef void (*sweep_zone_callback_f)(void* user, uint32_t zones, int32_t angle, int32_t distance);
 
 SWEEP_API const char* sweep_error_message(sweep_error_s error);
 SWEEP_API void sweep_error_destruct(sweep_error_s error);
 
 SWEEP_API sweep_device_s sweep_device_construct_simple(const char* port, sweep_error_s* error);
 SWEEP_API sweep_device_s sweep_device_construct(const char* port, int32_t bitrate, sweep_error_s* error);
+// Constructs without the stop handshake: a streaming device's scans are adopted and can be retrieved right away, an idle
+// device is left as is; devices in neither state are stopped as sweep_device_construct does
+SWEEP_API sweep_device_s sweep_device_construct_warm(const char* port, int32_t bitrate, sweep_error_s* error);
 SWEEP_API void sweep_device_destruct(sweep_device_s device);
 
 // Blocks until device is ready to start scanning, then starts scanning
 SWEEP_API void sweep_device_start_scanning(sweep_device_s device, sweep_error_s* error);
 // Stops stream, blocks while leftover stream is flushed, and sends stop once more to validate response
 SWEEP_API void sweep_device_stop_scanning(sweep_device_s device, sweep_error_s* error);
+// Whether scans can be retrieved, e.g. after warm construction adopted a running stream
+SWEEP_API bool sweep_device_get_scanning(sweep_device_s device);
 
 // Retrieves a scan from the queue (will block until scan is available)
 SWEEP_API sweep_scan_s sweep_device_get_scan(sweep_device_s device, sweep_error_s* error);
+// Like sweep_device_get_scan but waits at most timeout ms; returns null on timeout
+SWEEP_API sweep_scan_s sweep_device_get_scan_timeout(sweep_device_s device, int32_t timeout, sweep_error_s* error);
 
 SWEEP_API bool sweep_device_get_motor_ready(sweep_device_s device, sweep_error_s* error);
 SWEEP_API int32_t sweep_device_get_motor_speed(sweep_device_s device, sweep_error_s* error);
@@ -68,13 +99,391 @@ SWEEP_API void sweep_device_set_motor_speed(sweep_device_s device, int32_t hz, s
 SWEEP_API int32_t sweep_device_get_sample_rate(sweep_device_s device, sweep_error_s* error);
 SWEEP_API void sweep_device_set_sample_rate(sweep_device_s device, int32_t hz, sweep_error_s* error);
 
+// Packets received since scanning started, how many of them had error bits set and how many failed their checksum;
+// the stream resynchronizes after a corrupted packet instead of failing
+SWEEP_API void sweep_device_get_packet_counts(sweep_device_s device, int64_t* packets, int64_t* error_packets,
+                                              int64_t* checksum_failures);
+
 SWEEP_API int32_t sweep_scan_get_number_of_samples(sweep_scan_s scan);
 SWEEP_API int32_t sweep_scan_get_angle(sweep_scan_s scan, int32_t sample);
 SWEEP_API int32_t sweep_scan_get_distance(sweep_scan_s scan, int32_t sample);
 SWEEP_API int32_t sweep_scan_get_signal_strength(sweep_scan_s scan, int32_t sample);
 
+SWEEP_API sweep_scan_s sweep_scan_construct(int32_t number_of_samples, sweep_error_s* error);
+// Shrinks or grows (zero-initialized) the scan, for re-using scan objects; holds at most 4096 samples
+SWEEP_API void sweep_scan_set_number_of_samples(sweep_scan_s scan, int32_t number_of_samples);
+SWEEP_API void sweep_scan_set_sample(sweep_scan_s scan, int32_t sample, int32_t angle, int32_t distance,
+                                     int32_t signal_strength);
 SWEEP_API void sweep_scan_destruct(sweep_scan_s scan);
 
+// Converts all samples to Cartesian coordinates in cm; x and y have to hold sweep_scan_get_number_of_samples elements
+SWEEP_API void sweep_scan_to_cartesian_simple(sweep_scan_s scan, float* x, float* y);
+// Same as above, additionally transforming by the sensor's mount pose (angle in millidegrees, offset in cm) in one pass
+SWEEP_API void sweep_scan_to_cartesian(sweep_scan_s scan, int32_t mount_angle, float mount_x, float mount_y, float* x,
+                                       float* y);
+SWEEP_API void sweep_scan_to_cartesian_int16(sweep_scan_s scan, int32_t mount_angle, float mount_x, float mount_y,
+                                             int16_t* x, int16_t* y);
+
+// How samples falling into the same angular bin are reduced to a single distance
+#define SWEEP_REDUCTION_MIN 0
+#define SWEEP_REDUCTION_NEAREST 1
+#define SWEEP_REDUCTION_MEDIAN 2
+
+// Resamples onto a fixed grid of bins each 360 / bins degree wide; distance and valid have to hold bins elements
+SWEEP_API void sweep_scan_to_range_image(sweep_scan_s scan, int32_t bins, int32_t reduction, int32_t* distance,
+                                         uint8_t* valid);
+
+// Finds retroreflectors as runs of adjacent samples with at least min_signal_strength, between min_samples samples and
+// max_width cm wide. Writes up to capacity signal weighted centres in cm and their covariances (xx, xy, yy; three floats
+// per reflector) in the sensor's frame; returns the number of reflectors found, which may exceed capacity.
+SWEEP_API int32_t sweep_scan_find_reflectors(sweep_scan_s scan, int32_t min_signal_strength, int32_t min_samples, float max_width,
+                                             float* x, float* y, float* covariance, int32_t capacity);
+
+// Filter stages run in the order they were added; sweep_filter_apply works in place and does not allocate.
+// Scans are taken for full rotations: median and speckle removal neighbourhoods wrap around from the last to the first sample
+SWEEP_API sweep_filter_s sweep_filter_construct(sweep_error_s* error);
+SWEEP_API void sweep_filter_destruct(sweep_filter_s filter);
+
+SWEEP_API void sweep_filter_add_range_gate(sweep_filter_s filter, int32_t min_distance, int32_t max_distance,
+                                           sweep_error_s* error);
+SWEEP_API void sweep_filter_add_signal_threshold(sweep_filter_s filter, int32_t min_signal_strength, sweep_error_s* error);
+// Median over radius neighbours on both sides; larger radii fail
+#define SWEEP_FILTER_MAX_MEDIAN_RADIUS 16
+SWEEP_API void sweep_filter_add_median(sweep_filter_s filter, int32_t radius, sweep_error_s* error);
+SWEEP_API void sweep_filter_add_speckle_removal(sweep_filter_s filter, int32_t max_jump, sweep_error_s* error);
+
+SWEEP_API void sweep_filter_apply(sweep_filter_s filter, sweep_scan_s scan);
+
+// Log-odds occupancy grid of width x height cells, resolution in cm per cell; threads zero uses all cores
+SWEEP_API sweep_occupancy_grid_s sweep_occupancy_grid_construct(int32_t width, int32_t height, int32_t resolution,
+                                                                int32_t threads, sweep_error_s* error);
+SWEEP_API void sweep_occupancy_grid_destruct(sweep_occupancy_grid_s grid);
+
+// Log-odds updates in hundredths, applied per hit and per traversed cell, with cells clamped to [min, max]
+SWEEP_API void sweep_occupancy_grid_set_log_odds(sweep_occupancy_grid_s grid, int32_t hit, int32_t miss, int32_t min,
+                                                 int32_t max);
+SWEEP_API void sweep_occupancy_grid_clear(sweep_occupancy_grid_s grid);
+
+// Integrates a scan taken at the sensor pose (angle in millidegrees, position in cm) relative to the grid's center
+SWEEP_API void sweep_occupancy_grid_update(sweep_occupancy_grid_s grid, sweep_scan_s scan, int32_t pose_angle, float pose_x,
+                                           float pose_y);
+// Copies the log-odds in row-major order; log_odds has to hold width x height elements
+SWEEP_API void sweep_occupancy_grid_get_log_odds(sweep_occupancy_grid_s grid, int16_t* log_odds);
+
+// Registers scans against a reference scan: correlative search on a coarse and a fine grid, then point-to-line ICP
+SWEEP_API sweep_scan_matcher_s sweep_scan_matcher_construct(sweep_error_s* error);
+SWEEP_API void sweep_scan_matcher_destruct(sweep_scan_matcher_s matcher);
+
+// Linear window and resolution in cm, angular window in millidegrees; zero windows skip the correlative search
+SWEEP_API void sweep_scan_matcher_set_search_window(sweep_scan_matcher_s matcher, float linear_window, int32_t angular_window,
+                                                    float resolution);
+// ICP iterations and maximum point-to-reference distance in cm for correspondences
+SWEEP_API void sweep_scan_matcher_set_refinement(sweep_scan_matcher_s matcher, int32_t iterations, float max_distance);
+
+SWEEP_API void sweep_scan_matcher_set_reference(sweep_scan_matcher_s matcher, sweep_scan_s scan, sweep_error_s* error);
+// Takes an initial guess for the scan's pose in the reference's frame and refines it; returns the number of correspondences
+SWEEP_API int32_t sweep_scan_matcher_match(sweep_scan_matcher_s matcher, sweep_scan_s scan, int32_t* angle, float* x, float* y);
+
+// Bucket grid over the square [-extent, extent]^2 in cm for nearest neighbour and radius queries, rebuilt per scan
+SWEEP_API sweep_spatial_index_s sweep_spatial_index_construct(float cell_size, float extent, int32_t max_points,
+                                                              sweep_error_s* error);
+SWEEP_API void sweep_spatial_index_destruct(sweep_spatial_index_s index);
+
+// Add scans (e.g. the latest one plus a short history) at their poses, then build before querying
+SWEEP_API void sweep_spatial_index_clear(sweep_spatial_index_s index);
+SWEEP_API void sweep_spatial_index_add_scan(sweep_spatial_index_s index, sweep_scan_s scan, int32_t pose_angle, float pose_x,
+                                            float pose_y);
+SWEEP_API void sweep_spatial_index_build(sweep_spatial_index_s index);
+
+SWEEP_API int32_t sweep_spatial_index_get_number_of_points(sweep_spatial_index_s index);
+SWEEP_API void sweep_spatial_index_get_point(sweep_spatial_index_s index, int32_t point, float* x, float* y);
+
+// Writes the nearest point within max_distance for each of the count queries into points, -1 if there is none
+SWEEP_API void sweep_spatial_index_nearest(sweep_spatial_index_s index, const float* x, const float* y, int32_t count,
+                                           float max_distance, int32_t* points);
+// Writes up to capacity points within radius into points; returns the number of points within radius
+SWEEP_API int32_t sweep_spatial_index_within(sweep_spatial_index_s index, float x, float y, float radius, int32_t* points,
+                                             int32_t capacity);
+
+// Fits line segments to consecutive samples in a single pass, as they arrive in angular order; never allocates after construction
+SWEEP_API sweep_line_extractor_s sweep_line_extractor_construct(sweep_error_s* error);
+SWEEP_API void sweep_line_extractor_destruct(sweep_line_extractor_s extractor);
+
+// Maximum point-to-line deviation and gap between consecutive points in cm, minimum samples and length in cm per segment
+SWEEP_API void sweep_line_extractor_set_thresholds(sweep_line_extractor_s extractor, float max_deviation, float max_gap,
+                                                   int32_t min_samples, float min_length);
+
+// Incremental use: begin a rotation, push its samples as they stream in, finish it; push and finish return the number of
+// segments completed so far, which can be read out right away and do not change afterwards. The segment starting at the
+// rotation's first return may still merge with the last one and is only reported by finish, as the last segment.
+SWEEP_API void sweep_line_extractor_begin(sweep_line_extractor_s extractor);
+SWEEP_API int32_t sweep_line_extractor_push(sweep_line_extractor_s extractor, int32_t angle, int32_t distance);
+SWEEP_API int32_t sweep_line_extractor_finish(sweep_line_extractor_s extractor);
+// Same as begin, push for all samples, finish
+SWEEP_API int32_t sweep_line_extractor_extract(sweep_line_extractor_s extractor, sweep_scan_s scan);
+
+SWEEP_API int32_t sweep_line_extractor_get_number_of_segments(sweep_line_extractor_s extractor);
+// Endpoints in cm in the sensor's frame
+SWEEP_API void sweep_line_extractor_get_segment(sweep_line_extractor_s extractor, int32_t segment, float* start_x,
+                                                float* start_y, float* end_x, float* end_y);
+// Line x cos(alpha) + y sin(alpha) = r, alpha in radian, r in cm; covariance holds var(alpha), cov(alpha, r), var(r)
+SWEEP_API void sweep_line_extractor_get_segment_line(sweep_line_extractor_s extractor, int32_t segment, float* alpha, float* r,
+                                                     float* covariance);
+// Supporting samples [first, last] in push order; first > last if the segment wraps around the rotation's start
+SWEEP_API void sweep_line_extractor_get_segment_samples(sweep_line_extractor_s extractor, int32_t segment, int32_t* first,
+                                                        int32_t* last);
+
+// Groups angularly adjacent returns into clusters, e.g. people or pillars, in a single pass; never allocates after construction
+SWEEP_API sweep_clusterer_s sweep_clusterer_construct(sweep_error_s* error);
+SWEEP_API void sweep_clusterer_destruct(sweep_clusterer_s clusterer);
+
+// Consecutive returns are adjacent within base_distance cm plus range_factor times their range; smaller clusters are dropped
+SWEEP_API void sweep_clusterer_set_thresholds(sweep_clusterer_s clusterer, float base_distance, float range_factor,
+                                              int32_t min_samples);
+// Writes each sample's cluster id into ids, -1 for samples without return or in dropped clusters; returns the number of clusters
+SWEEP_API int32_t sweep_clusterer_run(sweep_clusterer_s clusterer, sweep_scan_s scan, int32_t* ids);
+
+SWEEP_API int32_t sweep_clusterer_get_number_of_clusters(sweep_clusterer_s clusterer);
+// Centroid and bounding box in cm in the sensor's frame
+SWEEP_API void sweep_clusterer_get_cluster(sweep_clusterer_s clusterer, int32_t cluster, float* centroid_x, float* centroid_y,
+                                           int32_t* number_of_samples);
+SWEEP_API void sweep_clusterer_get_cluster_extent(sweep_clusterer_s clusterer, int32_t cluster, float* min_x, float* min_y,
+                                                  float* max_x, float* max_y);
+
+// Per angular bin running mean and variance of the range for static sensors, separating foreground from learned background
+SWEEP_API sweep_background_s sweep_background_construct(int32_t bins, sweep_error_s* error);
+SWEEP_API void sweep_background_destruct(sweep_background_s background);
+
+// Forgetting rate in (0, 1]; returns nearer than threshold standard deviations and min_deviation cm are foreground
+SWEEP_API void sweep_background_set_parameters(sweep_background_s background, float learning_rate, float threshold,
+                                               float min_deviation);
+// Rate in [0, 1] at which update pulls bins towards foreground returns, much slower than learning; zero never retrains
+SWEEP_API void sweep_background_set_retraining_rate(sweep_background_s background, float retraining_rate);
+SWEEP_API void sweep_background_clear(sweep_background_s background);
+
+// Learns from all returns, e.g. while the scene is known to be empty
+SWEEP_API void sweep_background_learn(sweep_background_s background, sweep_scan_s scan);
+// Write non-zero for foreground samples into foreground and return their number; update also learns from background samples
+// and retrains bins towards foreground samples; bins which never saw a return learn from their first one
+SWEEP_API int32_t sweep_background_classify(sweep_background_s background, sweep_scan_s scan, uint8_t* foreground);
+SWEEP_API int32_t sweep_background_update(sweep_background_s background, sweep_scan_s scan, uint8_t* foreground);
+
+SWEEP_API int32_t sweep_background_get_number_of_bins(sweep_background_s background);
+SWEEP_API void sweep_background_get_bin(sweep_background_s background, int32_t bin, float* mean, float* variance,
+                                        int32_t* count);
+
+// Persists the learned model, not the parameters, so restarts can skip learning
+SWEEP_API void sweep_background_save(sweep_background_s background, const char* path, sweep_error_s* error);
+SWEEP_API sweep_background_s sweep_background_load(const char* path, sweep_error_s* error);
+
+// Tracks moving objects, e.g. cluster centroids, across scans with constant velocity Kalman filters; capacity fixed at construction
+SWEEP_API sweep_tracker_s sweep_tracker_construct(int32_t max_tracks, sweep_error_s* error);
+SWEEP_API void sweep_tracker_destruct(sweep_tracker_s tracker);
+
+// Gate in cm around predicted positions; tracks are reported after confirm_hits updates and dropped after max_misses misses
+SWEEP_API void sweep_tracker_set_association(sweep_tracker_s tracker, float max_distance, int32_t confirm_hits,
+                                             int32_t max_misses);
+// Acceleration noise in cm^2/s^3 and measurement variance in cm^2
+SWEEP_API void sweep_tracker_set_noise(sweep_tracker_s tracker, float process_noise, float measurement_noise);
+SWEEP_API void sweep_tracker_clear(sweep_tracker_s tracker);
+
+// Advances by dt seconds and associates the count detections in cm in the sensor's frame; returns the number of tracks
+SWEEP_API int32_t sweep_tracker_update(sweep_tracker_s tracker, const float* x, const float* y, int32_t count, float dt);
+
+SWEEP_API int32_t sweep_tracker_get_number_of_tracks(sweep_tracker_s tracker);
+// Ids are unique over the tracker's lifetime; velocities in cm/s
+SWEEP_API void sweep_tracker_get_track(sweep_tracker_s tracker, int32_t track, int32_t* id, float* x, float* y, float* vx,
+                                       float* vy);
+
+// Protective zones checked per sample in constant time regardless of the number of zones; at most 32 zones, of which
+// at most 4 may overlap along any direction, a polygon crossing a direction repeatedly counting once per crossing
+SWEEP_API sweep_zone_monitor_s sweep_zone_monitor_construct(sweep_error_s* error);
+SWEEP_API void sweep_zone_monitor_destruct(sweep_zone_monitor_s monitor);
+
+// Add zones before attaching the monitor to a device; both return the zone's bit index
+SWEEP_API int32_t sweep_zone_monitor_add_sector(sweep_zone_monitor_s monitor, int32_t start_angle, int32_t end_angle,
+                                               int32_t min_distance, int32_t max_distance, sweep_error_s* error);
+// Polygon in cm in the sensor's frame, vertices in order
+SWEEP_API int32_t sweep_zone_monitor_add_polygon(sweep_zone_monitor_s monitor, const float* x, const float* y, int32_t count,
+                                                sweep_error_s* error);
+// The callback runs on the thread checking samples, for devices the acquisition thread, and must return quickly. Set
+// it before attaching the monitor to a device; it is read without synchronization.
+SWEEP_API void sweep_zone_monitor_set_callback(sweep_zone_monitor_s monitor, sweep_zone_callback_f callback, void* user);
+
+// Returns the mask of zones the sample intrudes, raising their triggered flags and calling the callback if non-zero;
+// samples with an angle outside [0, 360000) intrude no zone
+SWEEP_API uint32_t sweep_zone_monitor_check(sweep_zone_monitor_s monitor, int32_t angle, int32_t distance);
+SWEEP_API uint32_t sweep_zone_monitor_check_scan(sweep_zone_monitor_s monitor, sweep_scan_s scan);
+
+// Triggered flags stay raised until cleared; clear returns the flags it cleared
+SWEEP_API uint32_t sweep_zone_monitor_get_triggered(sweep_zone_monitor_s monitor);
+SWEEP_API uint32_t sweep_zone_monitor_clear_triggered(sweep_zone_monitor_s monitor);
+
+// Checks every sample against the monitor as soon as it is received, before the scan is complete; null detaches.
+// The monitor has to outlive scanning.
+SWEEP_API void sweep_device_set_zone_monitor(sweep_device_s device, sweep_zone_monitor_s monitor);
+
+// Monte Carlo localization against a known map; particles are evaluated in parallel, threads zero uses all cores
+SWEEP_API sweep_localizer_s sweep_localizer_construct(int32_t max_particles, int32_t threads, sweep_error_s* error);
+SWEEP_API void sweep_localizer_destruct(sweep_localizer_s localizer);
+
+// Row-major width x height cells, non-zero for obstacles; resolution in cm per cell, origin is the first cell's corner in cm.
+// Precomputes the likelihood field from the map's distance transform.
+SWEEP_API void sweep_localizer_set_map(sweep_localizer_s localizer, const uint8_t* occupied, int32_t width, int32_t height,
+                                       float resolution, float origin_x, float origin_y, sweep_error_s* error);
+// Beam end points are Gaussian around obstacles with sigma in cm, mixed with a uniform likelihood of random in (0, 1)
+SWEEP_API void sweep_localizer_set_model(sweep_localizer_s localizer, float sigma, float random);
+// Evaluates every beam_step-th sample with a return only
+SWEEP_API void sweep_localizer_set_beam_step(sweep_localizer_s localizer, int32_t beam_step);
+
+// Scatters count particles normally around the pose (angle in millidegrees, position in cm) with the given spreads
+SWEEP_API void sweep_localizer_reset(sweep_localizer_s localizer, int32_t count, int32_t angle, float x, float y,
+                                     int32_t angular_spread, float linear_spread);
+// Moves all particles by the motion in their own frame, adding normal noise with the given standard deviations
+SWEEP_API void sweep_localizer_predict(sweep_localizer_s localizer, int32_t angle, float x, float y, int32_t angular_noise,
+                                       float linear_noise);
+// Weights particles by the scan's likelihood and resamples when degenerate; returns the effective number of particles
+SWEEP_API float sweep_localizer_update(sweep_localizer_s localizer, sweep_scan_s scan);
+
+// Weighted mean pose
+SWEEP_API void sweep_localizer_get_pose(sweep_localizer_s localizer, int32_t* angle, float* x, float* y);
+SWEEP_API int32_t sweep_localizer_get_number_of_particles(sweep_localizer_s localizer);
+// All buffers have to hold sweep_localizer_get_number_of_particles elements
+SWEEP_API void sweep_localizer_get_particles(sweep_localizer_s localizer, int32_t* angle, float* x, float* y, float* weight);
+
+// Distance to the nearest return for width x height cells centered on the sensor, resolution in cm per cell;
+// threads zero uses all cores
+SWEEP_API sweep_clearance_map_s sweep_clearance_map_construct(int32_t width, int32_t height, float resolution, int32_t threads,
+                                                              sweep_error_s* error);
+SWEEP_API void sweep_clearance_map_destruct(sweep_clearance_map_s map);
+
+// Writes the distance in cm from every cell to the nearest return in the window, row-major, infinity without any;
+// distance has to hold width x height elements. Returns the number of returns within the window.
+SWEEP_API int32_t sweep_clearance_map_update(sweep_clearance_map_s map, sweep_scan_s scan, float* distance);
+
+// Simplified polygon bounding the free space visible from the sensor
+SWEEP_API sweep_free_space_s sweep_free_space_construct(sweep_error_s* error);
+SWEEP_API void sweep_free_space_destruct(sweep_free_space_s space);
+
+// Samples without a return or beyond max_range in cm lie at max_range; bins zero uses every sample, otherwise the
+// nearest sample per angular bin; vertices may deviate tolerance cm from the boundary, zero keeps all of them
+SWEEP_API void sweep_free_space_set_parameters(sweep_free_space_s space, float max_range, int32_t bins, float tolerance);
+// Writes up to capacity vertices in cm counter-clockwise in the sensor's frame; returns the number of vertices,
+// which may exceed capacity
+SWEEP_API int32_t sweep_free_space_extract(sweep_free_space_s space, sweep_scan_s scan, float* x, float* y, int32_t capacity);
+
+// Compact lossless scan encoding: delta coded angles, bit-packed distances and signal strengths; frames are
+// self-delimiting so they can be concatenated into streams
+SWEEP_API int32_t sweep_scan_encode_bound(int32_t number_of_samples);
+
+// Keyframe interval zero or one encodes every scan on its own; otherwise scans with as many samples as the previous
+// one are predicted from it, with every keyframe_interval-th frame on its own
+SWEEP_API sweep_scan_encoder_s sweep_scan_encoder_construct(int32_t keyframe_interval, sweep_error_s* error);
+SWEEP_API void sweep_scan_encoder_destruct(sweep_scan_encoder_s encoder);
+// The next frame is encoded on its own, e.g. when a new client starts decoding
+SWEEP_API void sweep_scan_encoder_reset(sweep_scan_encoder_s encoder);
+// Capacity has to be at least sweep_scan_encode_bound bytes; returns the number of bytes written
+SWEEP_API int32_t sweep_scan_encoder_encode(sweep_scan_encoder_s encoder, sweep_scan_s scan, uint8_t* buffer, int32_t capacity);
+
+SWEEP_API sweep_scan_decoder_s sweep_scan_decoder_construct(sweep_error_s* error);
+SWEEP_API void sweep_scan_decoder_destruct(sweep_scan_decoder_s decoder);
+SWEEP_API void sweep_scan_decoder_reset(sweep_scan_decoder_s decoder);
+// Decodes the frame at the buffer's start into the scan; returns the number of bytes consumed, zero if the buffer does
+// not hold a complete frame yet, leaving the scan untouched
+SWEEP_API int32_t sweep_scan_decoder_decode(sweep_scan_decoder_s decoder, const uint8_t* buffer, int32_t size, sweep_scan_s scan,
+                                            sweep_error_s* error);
+
+// Append-only scan log with timestamps, written in the background and indexed by time for reading back windows
+SWEEP_API sweep_log_writer_s sweep_log_writer_construct(const char* path, sweep_error_s* error);
+// Writes what is pending and the index, blocking until both reached the disk
+SWEEP_API void sweep_log_writer_destruct(sweep_log_writer_s writer);
+// Copies the scan and returns without waiting on the disk; timestamps in micro-seconds, e.g. since the epoch, have to be
+// non-decreasing. Failures to write earlier scans are reported here.
+SWEEP_API void sweep_log_writer_append(sweep_log_writer_s writer, sweep_scan_s scan, int64_t timestamp, sweep_error_s* error);
+// Scans dropped because the disk could not keep up
+SWEEP_API int64_t sweep_log_writer_get_dropped(sweep_log_writer_s writer);
+
+// Maps the log into memory; logs not closed properly, e.g. still being written, are indexed up to their last full chunk
+SWEEP_API sweep_log_reader_s sweep_log_reader_construct(const char* path, sweep_error_s* error);
+SWEEP_API void sweep_log_reader_destruct(sweep_log_reader_s reader);
+// Whether the log was closed properly and its index read from the file instead of recovered
+SWEEP_API bool sweep_log_reader_is_indexed(sweep_log_reader_s reader);
+SWEEP_API int32_t sweep_log_reader_get_number_of_scans(sweep_log_reader_s reader);
+// Returns the index of the first scan at or after the timestamp, the number of scans if there is none
+SWEEP_API int32_t sweep_log_reader_seek(sweep_log_reader_s reader, int64_t timestamp);
+SWEEP_API int64_t sweep_log_reader_get_timestamp(sweep_log_reader_s reader, int32_t index);
+// Returns the scan's samples in place as angle, distance, signal strength triples, valid until the reader is destructed
+SWEEP_API const int32_t* sweep_log_reader_get_samples(sweep_log_reader_s reader, int32_t index, int32_t* count);
+SWEEP_API void sweep_log_reader_read(sweep_log_reader_s reader, int32_t index, sweep_scan_s scan);
+
+// Lock-free ring of scans in named shared memory, written by a single process and read by any number of others
+SWEEP_API sweep_ring_writer_s sweep_ring_writer_construct(const char* name, int32_t slots, sweep_error_s* error);
+// Readers still attached see the ring closed
+SWEEP_API void sweep_ring_writer_destruct(sweep_ring_writer_s writer);
+// Copies the scan into the ring with its timestamp in micro-seconds; returns its sequence number
+SWEEP_API int64_t sweep_ring_writer_publish(sweep_ring_writer_s writer, sweep_scan_s scan, int64_t timestamp);
+
+// Starts with the next scan published
+SWEEP_API sweep_ring_reader_s sweep_ring_reader_construct(const char* name, sweep_error_s* error);
+SWEEP_API void sweep_ring_reader_destruct(sweep_ring_reader_s reader);
+// Waits up to timeout ms for the next scan and returns its sequence number, -1 on timeout; samples point into the ring
+// as angle, distance, signal strength triples until the writer laps the reader, see sweep_ring_reader_is_valid
+SWEEP_API int64_t sweep_ring_reader_next(sweep_ring_reader_s reader, int32_t timeout, int64_t* timestamp, const int32_t** samples,
+                                         int32_t* count, sweep_error_s* error);
+// Whether the scan with the sequence number is still in the ring, i.e. samples used since were not overwritten
+SWEEP_API bool sweep_ring_reader_is_valid(sweep_ring_reader_s reader, int64_t sequence);
+// Like sweep_ring_reader_next but copies the scan, skipping scans overwritten while copying
+SWEEP_API int64_t sweep_ring_reader_read(sweep_ring_reader_s reader, int32_t timeout, sweep_scan_s scan, int64_t* timestamp,
+                                         sweep_error_s* error);
+// Scans missed because the reader fell behind by the ring's number of slots
+SWEEP_API int64_t sweep_ring_reader_get_dropped(sweep_ring_reader_s reader);
+
+// Several devices opened, configured and started concurrently, so bring-up takes as long as the slowest device; motor
+// speed and sample rate of zero keep the devices' settings. Fails as a whole if any device fails to come up.
+SWEEP_API sweep_fleet_s sweep_fleet_construct(const char* const* ports, int32_t count, int32_t motor_speed, int32_t sample_rate,
+                                              sweep_error_s* error);
+// Stops and closes all devices concurrently, without waiting for devices which stopped sending scans
+SWEEP_API void sweep_fleet_destruct(sweep_fleet_s fleet);
+SWEEP_API int32_t sweep_fleet_get_number_of_devices(sweep_fleet_s fleet);
+// Waits up to timeout ms for a scan from any device and writes the index of the device it came from; returns null on
+// timeout. A device failing is reported once, with its index; the other devices keep scanning.
+SWEEP_API sweep_scan_s sweep_fleet_get_scan(sweep_fleet_s fleet, int32_t timeout, int32_t* device, sweep_error_s* error);
+// Scans dropped because the caller did not keep up
+SWEEP_API int64_t sweep_fleet_get_dropped(sweep_fleet_s fleet);
+
+// Merges scans of several devices into one point set in a common frame every period microseconds, each set holding the
+// samples taken within the last window microseconds; devices rotating at different phases and rates line up in time.
+SWEEP_API sweep_fusion_s sweep_fusion_construct(int32_t devices, int64_t period, int64_t window, sweep_error_s* error);
+SWEEP_API void sweep_fusion_destruct(sweep_fusion_s fusion);
+// Mount pose in the common frame (angle in millidegrees, offset in cm) and microseconds added to the device's timestamps
+SWEEP_API void sweep_fusion_set_device(sweep_fusion_s fusion, int32_t device, int32_t mount_angle, float mount_x,
+                                       float mount_y, int64_t clock_offset);
+// Takes a scan the device completed at timestamp, in microseconds
+SWEEP_API void sweep_fusion_add_scan(sweep_fusion_s fusion, int32_t device, sweep_scan_s scan, int64_t timestamp);
+// Returns the number of points in the set due at now sorted by angle (in millidegrees) or -1 if none is due yet; the
+// points stay valid until the next merge
+SWEEP_API int32_t sweep_fusion_merge(sweep_fusion_s fusion, int64_t now, const float** x, const float** y,
+                                     const int32_t** angle, const int32_t** device);
+// When the next set is due, zero until the first scan arrives
+SWEEP_API int64_t sweep_fusion_get_next(sweep_fusion_s fusion);
+
+// Probes ports for devices concurrently, waiting up to timeout ms for each; with a count of zero all ports devices may be
+// attached to are probed, e.g. /dev/ttyUSB* or COM ports present. Devices are neither stopped nor reconfigured.
+SWEEP_API sweep_discovery_s sweep_discover_devices(const char* const* ports, int32_t count, int32_t timeout,
+                                                   sweep_error_s* error);
+SWEEP_API void sweep_discovery_destruct(sweep_discovery_s discovery);
+SWEEP_API int32_t sweep_discovery_get_number_of_devices(sweep_discovery_s discovery);
+SWEEP_API const char* sweep_discovery_get_port(sweep_discovery_s discovery, int32_t index);
+// Whether the device is streaming scans; if it does not answer queries meanwhile, its serial number is empty and the
+// other properties are unknown
+SWEEP_API bool sweep_discovery_get_scanning(sweep_discovery_s discovery, int32_t index);
+SWEEP_API const char* sweep_discovery_get_serial_number(sweep_discovery_s discovery, int32_t index);
+// Major version in the upper, minor version in the lower 16 bits as with sweep_get_version; zero if unknown
+SWEEP_API int32_t sweep_discovery_get_firmware_version(sweep_discovery_s discovery, int32_t index);
+// In Hz, -1 if unknown
+SWEEP_API int32_t sweep_discovery_get_motor_speed(sweep_discovery_s discovery, int32_t index);
+SWEEP_API int32_t sweep_discovery_get_sample_rate(sweep_discovery_s discovery, int32_t index);
+
 SWEEP_API void sweep_device_reset(sweep_device_s device, sweep_error_s* error);
 
 #ifdef __cplusplus
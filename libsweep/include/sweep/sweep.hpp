@@ -8,13 +8,41 @@
  * sweep::sweep  - device to interact with
  * sweep::scan   - a full scan returned by the device
  * sweep::sample - a single sample in a full scan
+ * sweep::point  - a sample converted to Cartesian coordinates
+ * sweep::range_image - a scan resampled onto a fixed angular grid
+ * sweep::reflector - a retroreflector found in a scan by its signal strength
+ * sweep::filter - composable in place scan filtering
+ * sweep::occupancy_grid - log-odds occupancy grid built from scans
+ * sweep::scan_matcher - scan to scan registration
+ * sweep::spatial_index - nearest neighbour and radius queries over scan points
+ * sweep::line_extractor - line segments fitted to scans
+ * sweep::clusterer - groups of adjacent returns in scans
+ * sweep::background - learned background for foreground extraction
+ * sweep::tracker - moving objects tracked across scans
+ * sweep::zone_monitor - protective zones checked per sample
+ * sweep::localizer - Monte Carlo localization against a known map
+ * sweep::clearance_map - distance to the nearest return around the sensor
+ * sweep::free_space - simplified polygon of the visible free space
+ * sweep::encoder - compact lossless scan encoding
+ * sweep::decoder - decoding of encoded scans
+ * sweep::log_writer - timestamped scans recorded to a file in the background
+ * sweep::log_reader - random access by time into recorded scans
+ * sweep::ring_writer - scans published to other processes through shared memory
+ * sweep::ring_reader - scans read from shared memory without copying
+ * sweep::packet_counts - packets received while scanning, with error and checksum failure counts
+ * sweep::fleet - several devices brought up together, scans taken from whichever device has one
+ * sweep::fusion - time-aligned point sets merged from several devices in a common frame
+ * sweep::device_info - a device found by probing serial ports
  *
  * On error sweep::device_error gets thrown.
  */
 
+#include <algorithm>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 #include <sweep/sweep.h>
@@ -40,21 +68,470 @@ struct scan {
   std::vector<sample> samples;
 };
 
+struct point {
+  float x; // in cm
+  float y; // in cm
+};
+
+// Where the device is mounted in a target frame
+struct pose {
+  std::int32_t angle; // in millidegrees
+  float x;            // in cm
+  float y;            // in cm
+};
+
+std::vector<point> to_cartesian(const scan& scan, const pose& mount = pose{0, 0.0f, 0.0f});
+
+enum class reduction : std::int32_t {
+  min = SWEEP_REDUCTION_MIN,
+  nearest = SWEEP_REDUCTION_NEAREST,
+  median = SWEEP_REDUCTION_MEDIAN,
+};
+
+// Bin n covers angles [n * 360 / bins, (n + 1) * 360 / bins) degree
+struct range_image {
+  std::vector<std::int32_t> distance; // in cm
+  std::vector<std::uint8_t> valid;    // non-zero if at least one sample fell into the bin
+};
+
+// Reuses the image's buffers when called with the same number of bins over and over again
+void to_range_image(const scan& scan, std::int32_t bins, reduction reduce, range_image& image);
+
+struct reflector {
+  point position;      // signal weighted centre in cm
+  float covariance[3]; // xx, xy, yy in cm^2
+};
+
+void find_reflectors(const scan& scan, std::int32_t min_signal_strength, std::int32_t min_samples, float max_width,
+                     std::vector<reflector>& reflectors);
+
+class filter {
+public:
+  filter();
+  filter& range_gate(std::int32_t min_distance, std::int32_t max_distance);
+  filter& signal_threshold(std::int32_t min_signal_strength);
+  filter& median(std::int32_t radius);
+  filter& remove_speckles(std::int32_t max_jump);
+  void apply(scan& scan);
+
+private:
+  std::unique_ptr<::sweep_filter, decltype(&::sweep_filter_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+};
+
+class occupancy_grid {
+public:
+  // Resolution in cm per cell; threads zero uses all cores
+  occupancy_grid(std::int32_t width, std::int32_t height, std::int32_t resolution, std::int32_t threads = 0);
+  void set_log_odds(std::int32_t hit, std::int32_t miss, std::int32_t min, std::int32_t max);
+  void clear();
+  void update(const scan& scan, const pose& sensor);
+  // Row-major log-odds in hundredths
+  std::vector<std::int16_t> get_log_odds();
+
+private:
+  std::int32_t width;
+  std::int32_t height;
+  std::unique_ptr<::sweep_occupancy_grid, decltype(&::sweep_occupancy_grid_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+};
+
+class scan_matcher {
+public:
+  scan_matcher();
+  // Linear window and resolution in cm, angular window in millidegrees; zero windows skip the correlative search
+  void set_search_window(float linear_window, std::int32_t angular_window, float resolution);
+  void set_refinement(std::int32_t iterations, float max_distance);
+  void set_reference(const scan& scan);
+  // Refines the guess for the scan's pose in the reference's frame; returns the number of correspondences
+  std::int32_t match(const scan& scan, pose& guess);
+
+private:
+  std::unique_ptr<::sweep_scan_matcher, decltype(&::sweep_scan_matcher_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+};
+
+class spatial_index {
+public:
+  // Buckets of cell_size cm over the square [-extent, extent]^2 cm; points outside are still found, only slower
+  spatial_index(float cell_size, float extent, std::int32_t max_points);
+  void clear();
+  void add_scan(const scan& scan, const pose& sensor = pose{0, 0.0f, 0.0f});
+  void build();
+  point get_point(std::int32_t id);
+  // Point ids in the order they were added; -1 if there is none within max_distance
+  std::int32_t nearest(const point& query, float max_distance);
+  void nearest(const std::vector<point>& queries, float max_distance, std::vector<std::int32_t>& ids);
+  void within(const point& query, float radius, std::vector<std::int32_t>& ids);
+
+private:
+  std::unique_ptr<::sweep_spatial_index, decltype(&::sweep_spatial_index_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+  std::vector<float> x;
+  std::vector<float> y;
+};
+
+struct segment {
+  point start;
+  point end;
+  float alpha;               // normal direction of x cos(alpha) + y sin(alpha) = r in radian
+  float r;                   // in cm
+  float covariance[3];       // var(alpha), cov(alpha, r), var(r)
+  std::int32_t first_sample; // supporting samples [first_sample, last_sample], wrapping if first_sample > last_sample
+  std::int32_t last_sample;
+};
+
+class line_extractor {
+public:
+  line_extractor();
+  // Maximum point-to-line deviation and gap between consecutive points in cm, minimum samples and length in cm per segment
+  void set_thresholds(float max_deviation, float max_gap, std::int32_t min_samples, float min_length);
+  // Reuses the segments' storage
+  void extract(const scan& scan, std::vector<segment>& segments);
+  // Incremental use while samples stream in; push and finish return the number of segments completed so far.
+  // The segment starting at the rotation's first return is held back until finish, which reports it last.
+  void begin();
+  std::int32_t push(const sample& sample);
+  std::int32_t finish();
+  segment get_segment(std::int32_t index);
+
+private:
+  std::unique_ptr<::sweep_line_extractor, decltype(&::sweep_line_extractor_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+};
+
+struct cluster {
+  point centroid;
+  point min; // bounding box
+  point max;
+  std::int32_t samples;
+};
+
+class clusterer {
+public:
+  clusterer();
+  // Consecutive returns are adjacent within base_distance cm plus range_factor times their range
+  void set_thresholds(float base_distance, float range_factor, std::int32_t min_samples);
+  // Per sample cluster ids, -1 for none; reuses the ids' and clusters' storage
+  void run(const scan& scan, std::vector<std::int32_t>& ids, std::vector<cluster>& clusters);
+
+private:
+  std::unique_ptr<::sweep_clusterer, decltype(&::sweep_clusterer_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+};
+
+class background {
+public:
+  background(std::int32_t bins);
+  // Loads a model persisted with save
+  background(const char* path);
+  void set_parameters(float learning_rate, float threshold, float min_deviation);
+  // Slower than learning; zero never retrains bins towards foreground returns
+  void set_retraining_rate(float retraining_rate);
+  void clear();
+  void learn(const scan& scan);
+  // Per sample foreground mask and the foreground samples; update also learns from background samples and slowly
+  // retrains towards persisting foreground samples
+  void classify(const scan& scan, std::vector<std::uint8_t>& mask, ::sweep::scan& foreground);
+  void update(const scan& scan, std::vector<std::uint8_t>& mask, ::sweep::scan& foreground);
+  void save(const char* path);
+
+private:
+  std::unique_ptr<::sweep_background, decltype(&::sweep_background_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+};
+
+struct track {
+  std::int32_t id;
+  point position;
+  point velocity; // in cm/s
+};
+
+class tracker {
+public:
+  tracker(std::int32_t max_tracks);
+  // Gate in cm around predicted positions; tracks are reported after confirm_hits updates and dropped after max_misses misses
+  void set_association(float max_distance, std::int32_t confirm_hits, std::int32_t max_misses);
+  void set_noise(float process_noise, float measurement_noise);
+  void clear();
+  // Advances by dt seconds; reuses the tracks' storage
+  void update(const std::vector<point>& detections, float dt, std::vector<track>& tracks);
+  void update(const std::vector<cluster>& clusters, float dt, std::vector<track>& tracks);
+
+private:
+  std::unique_ptr<::sweep_tracker, decltype(&::sweep_tracker_destruct)> handle;
+  std::vector<float> x;
+  std::vector<float> y;
+
+  void update(float dt, std::vector<track>& tracks);
+};
+
+class zone_monitor {
+public:
+  using callback = std::function<void(std::uint32_t zones, const sample& sample)>;
+
+  zone_monitor();
+  // Both return the zone's bit index; add zones before attaching the monitor to a device
+  std::int32_t add_sector(std::int32_t start_angle, std::int32_t end_angle, std::int32_t min_distance, std::int32_t max_distance);
+  std::int32_t add_polygon(const std::vector<point>& polygon);
+  // Runs on the acquisition thread and must return quickly; set it while the monitor is not attached to a device
+  void set_callback(callback on_intrusion);
+  std::uint32_t check(const scan& scan);
+  std::uint32_t get_triggered();
+  std::uint32_t clear_triggered();
+
+private:
+  friend class sweep;
+
+  std::unique_ptr<::sweep_zone_monitor, decltype(&::sweep_zone_monitor_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+  // Heap allocated so its address handed to the library survives moving the monitor
+  std::unique_ptr<callback> on_intrusion;
+};
+
+struct particle {
+  std::int32_t angle; // in millidegrees
+  point position;
+  float weight;
+};
+
+class localizer {
+public:
+  // Threads zero uses all cores
+  localizer(std::int32_t max_particles, std::int32_t threads = 0);
+  // Row-major width x height cells, non-zero for obstacles; resolution in cm per cell, origin is the first cell's corner
+  void set_map(const std::vector<std::uint8_t>& occupied, std::int32_t width, std::int32_t height, float resolution,
+               const point& origin);
+  void set_model(float sigma, float random);
+  void set_beam_step(std::int32_t beam_step);
+  void reset(std::int32_t count, const pose& pose, std::int32_t angular_spread, float linear_spread);
+  // Motion in the robot's own frame
+  void predict(const pose& motion, std::int32_t angular_noise, float linear_noise);
+  // Returns the effective number of particles
+  float update(const scan& scan);
+  pose get_pose();
+  // Reuses the particles' storage
+  void get_particles(std::vector<particle>& particles);
+
+private:
+  std::unique_ptr<::sweep_localizer, decltype(&::sweep_localizer_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+  std::vector<std::int32_t> angle;
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> weight;
+};
+
+class clearance_map {
+public:
+  // Cells centered on the sensor, resolution in cm per cell; threads zero uses all cores
+  clearance_map(std::int32_t width, std::int32_t height, float resolution, std::int32_t threads = 0);
+  // Row-major distances in cm, infinity without any return in the window; reuses the distance's storage.
+  // Returns the number of returns within the window.
+  std::int32_t update(const scan& scan, std::vector<float>& distance);
+
+private:
+  std::unique_ptr<::sweep_clearance_map, decltype(&::sweep_clearance_map_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+  std::size_t cells;
+};
+
+class free_space {
+public:
+  free_space();
+  // Range in cm for samples without a return; bins zero uses every sample; tolerance in cm, zero keeps all vertices
+  void set_parameters(float max_range, std::int32_t bins, float tolerance);
+  // Vertices counter-clockwise in the sensor's frame; reuses the polygon's storage
+  void extract(const scan& scan, std::vector<point>& polygon);
+
+private:
+  std::unique_ptr<::sweep_free_space, decltype(&::sweep_free_space_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+  std::vector<float> x;
+  std::vector<float> y;
+};
+
+class encoder {
+public:
+  // Keyframe interval zero or one encodes every scan on its own, otherwise scans are predicted from the previous one
+  explicit encoder(std::int32_t keyframe_interval = 0);
+  // The next frame is encoded on its own
+  void reset();
+  // Appends the encoded frame to out
+  void encode(const scan& scan, std::vector<std::uint8_t>& out);
+
+private:
+  std::unique_ptr<::sweep_scan_encoder, decltype(&::sweep_scan_encoder_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+};
+
+class decoder {
+public:
+  decoder();
+  void reset();
+  // Decodes the frame at data's start; returns the bytes consumed, zero if data does not hold a complete frame yet
+  std::size_t decode(const std::uint8_t* data, std::size_t size, scan& scan);
+
+private:
+  std::unique_ptr<::sweep_scan_decoder, decltype(&::sweep_scan_decoder_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+};
+
+// A recorded scan with its samples referred to in place, valid as long as the log_reader it came from
+struct log_entry {
+  std::int64_t timestamp;
+  const sample* samples;
+  std::int32_t count;
+};
+
+class log_writer {
+public:
+  explicit log_writer(const char* path);
+  // Copies the scan and returns without waiting on the disk; timestamps have to be non-decreasing
+  void append(const scan& scan, std::int64_t timestamp);
+  // Scans dropped because the disk could not keep up
+  std::int64_t get_dropped();
+
+private:
+  std::unique_ptr<::sweep_log_writer, decltype(&::sweep_log_writer_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+};
+
+class log_reader {
+public:
+  explicit log_reader(const char* path);
+  // Whether the log was closed properly instead of being indexed up to its last full chunk
+  bool is_indexed();
+  std::int32_t get_number_of_scans();
+  // Index of the first scan at or after the timestamp, the number of scans if there is none
+  std::int32_t seek(std::int64_t timestamp);
+  // Without copying the samples
+  log_entry get(std::int32_t index);
+  void read(std::int32_t index, scan& scan);
+
+private:
+  std::unique_ptr<::sweep_log_reader, decltype(&::sweep_log_reader_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+};
+
+// A published scan with its samples referred to in place until the writer laps the reader
+struct ring_entry {
+  std::int64_t sequence;
+  std::int64_t timestamp;
+  const sample* samples;
+  std::int32_t count;
+};
+
+class ring_writer {
+public:
+  ring_writer(const char* name, std::int32_t slots = 64);
+  // Returns the scan's sequence number
+  std::int64_t publish(const scan& scan, std::int64_t timestamp);
+
+private:
+  std::unique_ptr<::sweep_ring_writer, decltype(&::sweep_ring_writer_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+};
+
+class ring_reader {
+public:
+  explicit ring_reader(const char* name);
+  // Waits up to timeout ms for the next scan without copying it; returns false on timeout
+  bool next(ring_entry& entry, std::int32_t timeout);
+  // Whether the entry's samples were not overwritten since, to be checked after using them
+  bool is_valid(const ring_entry& entry);
+  // Copies the next scan; returns false on timeout
+  bool read(scan& scan, std::int64_t& timestamp, std::int32_t timeout);
+  std::int64_t get_dropped();
+
+private:
+  std::unique_ptr<::sweep_ring_reader, decltype(&::sweep_ring_reader_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+};
+
+// Packets received since scanning started
+struct packet_counts {
+  std::int64_t packets;
+  std::int64_t error_packets;     // with error bits set
+  std::int64_t checksum_failures; // corrupted, dropped while resynchronizing
+};
+
+class fleet {
+public:
+  // Brings all devices up concurrently; motor speed and sample rate of zero keep the devices' settings
+  explicit fleet(const std::vector<std::string>& ports, std::int32_t motor_speed = 0, std::int32_t sample_rate = 0);
+  std::int32_t get_number_of_devices();
+  // Waits up to timeout ms for a scan from any device, returns false on timeout; the device index is set before a
+  // device failing is thrown
+  bool get_scan(scan& scan, std::int32_t& device, std::int32_t timeout);
+  std::int64_t get_dropped();
+
+private:
+  std::unique_ptr<::sweep_fleet, decltype(&::sweep_fleet_destruct)> handle;
+};
+
+// Sorted by angle around the common frame's origin
+struct fused_points {
+  std::vector<float> x;             // in cm
+  std::vector<float> y;             // in cm
+  std::vector<std::int32_t> angle;  // in millidegrees
+  std::vector<std::int32_t> device; // index of the device the point came from
+};
+
+class fusion {
+public:
+  // A set every period microseconds, holding the samples taken within the last window microseconds
+  fusion(std::int32_t devices, std::int64_t period, std::int64_t window);
+  // The clock offset in microseconds is added to the device's timestamps
+  void set_device(std::int32_t device, const pose& mount, std::int64_t clock_offset = 0);
+  // Takes a scan the device completed at timestamp, in microseconds
+  void add_scan(std::int32_t device, const scan& scan, std::int64_t timestamp);
+  // Returns false if no set is due at now yet; reuses the points' buffers
+  bool merge(std::int64_t now, fused_points& points);
+  std::int64_t get_next();
+
+private:
+  std::unique_ptr<::sweep_fusion, decltype(&::sweep_fusion_destruct)> handle;
+  std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)> scratch;
+};
+
+struct device_info {
+  std::string port;
+  bool scanning;                 // streaming scans; the properties below are unknown if it did not answer meanwhile
+  std::string serial_number;
+  std::int32_t firmware_version; // major << 16 | minor
+  std::int32_t motor_speed;      // in Hz
+  std::int32_t sample_rate;      // in Hz
+};
+
+// Probes the ports concurrently, waiting up to timeout ms for each; no ports probes all ports devices may be attached to
+std::vector<device_info> discover_devices(std::int32_t timeout = 250, const std::vector<std::string>& ports = {});
+
 class sweep {
 public:
   sweep(const char* port);
   sweep(const char* port, std::int32_t bitrate);
+  // Leaves a running device running, see sweep_device_construct_warm; check get_scanning before starting to scan
+  static sweep attach(const char* port, std::int32_t bitrate = 115200);
   void start_scanning();
   void stop_scanning();
+  bool get_scanning();
   bool get_motor_ready();
   std::int32_t get_motor_speed();
   void set_motor_speed(std::int32_t speed);
   std::int32_t get_sample_rate();
   void set_sample_rate(std::int32_t speed);
   scan get_scan();
+  // Waits up to timeout ms for the next scan, returns false on timeout
+  bool get_scan(scan& scan, std::int32_t timeout);
+  packet_counts get_packet_counts();
+  // Checks samples as soon as they are received; the monitor has to outlive scanning, null detaches
+  void set_zone_monitor(zone_monitor* monitor);
   void reset();
 
 private:
+  explicit sweep(::sweep_device_s handle);
+
   std::unique_ptr<::sweep_device, decltype(&::sweep_device_destruct)> device;
 };
 
@@ -74,6 +551,43 @@ struct error_to_exception {
 
   ::sweep_error_s error = nullptr;
 };
+
+using scan_owner = std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)>;
+
+// Copies a scan into an existing library owned scan handle, re-using its storage
+inline void assign_scan_handle(::sweep_scan_s handle, const scan& scan) {
+  const auto num_samples = static_cast<std::int32_t>(scan.samples.size());
+
+  ::sweep_scan_set_number_of_samples(handle, num_samples);
+
+  for (std::int32_t n = 0; n < num_samples; ++n) {
+    const auto& sample = scan.samples[n];
+    ::sweep_scan_set_sample(handle, n, sample.angle, sample.distance, sample.signal_strength);
+  }
+}
+
+// Copies a scan into a library owned scan handle for free functions operating on handles; the handle is kept per
+// thread and reused by the next call on that thread, instead of allocating a full scan every call
+inline ::sweep_scan_s to_scratch_handle(const scan& scan) {
+  static thread_local const scan_owner scratch{::sweep_scan_construct(0, error_to_exception{}), &::sweep_scan_destruct};
+  assign_scan_handle(scratch.get(), scan);
+  return scratch.get();
+}
+
+// Copies a library owned scan handle into a scan, re-using the scan's storage
+inline void assign_scan(scan& scan, ::sweep_scan_s handle) {
+  const auto num_samples = ::sweep_scan_get_number_of_samples(handle);
+
+  scan.samples.resize(num_samples);
+
+  for (std::int32_t n = 0; n < num_samples; ++n) {
+    // clang-format off
+    scan.samples[n].angle           = ::sweep_scan_get_angle          (handle, n);
+    scan.samples[n].distance        = ::sweep_scan_get_distance       (handle, n);
+    scan.samples[n].signal_strength = ::sweep_scan_get_signal_strength(handle, n);
+    // clang-format on
+  }
+}
 } // namespace detail
 
 inline sweep::sweep(const char* port)
@@ -82,10 +596,18 @@ inline sweep::sweep(const char* port)
 inline sweep::sweep(const char* port, std::int32_t bitrate)
     : device{::sweep_device_construct(port, bitrate, detail::error_to_exception{}), &::sweep_device_destruct} {}
 
+inline sweep::sweep(::sweep_device_s handle) : device{handle, &::sweep_device_destruct} {}
+
+inline sweep sweep::attach(const char* port, std::int32_t bitrate) {
+  return sweep{::sweep_device_construct_warm(port, bitrate, detail::error_to_exception{})};
+}
+
 inline void sweep::start_scanning() { ::sweep_device_start_scanning(device.get(), detail::error_to_exception{}); }
 
 inline void sweep::stop_scanning() { ::sweep_device_stop_scanning(device.get(), detail::error_to_exception{}); }
 
+inline bool sweep::get_scanning() { return ::sweep_device_get_scanning(device.get()); }
+
 inline bool sweep::get_motor_ready() { return ::sweep_device_get_motor_ready(device.get(), detail::error_to_exception{}); }
 
 inline std::int32_t sweep::get_motor_speed() {
@@ -105,25 +627,696 @@ inline void sweep::set_sample_rate(std::int32_t rate) {
 }
 
 inline scan sweep::get_scan() {
-  using scan_owner = std::unique_ptr<::sweep_scan, decltype(&::sweep_scan_destruct)>;
+  const detail::scan_owner releasing_scan{::sweep_device_get_scan(device.get(), detail::error_to_exception{}), &::sweep_scan_destruct};
+
+  scan result;
+  detail::assign_scan(result, releasing_scan.get());
+  return result;
+}
 
-  const scan_owner releasing_scan{::sweep_device_get_scan(device.get(), detail::error_to_exception{}), &::sweep_scan_destruct};
+inline bool sweep::get_scan(scan& scan, std::int32_t timeout) {
+  const detail::scan_owner releasing_scan{::sweep_device_get_scan_timeout(device.get(), timeout, detail::error_to_exception{}),
+                                          &::sweep_scan_destruct};
 
-  const auto num_samples = ::sweep_scan_get_number_of_samples(releasing_scan.get());
+  if (!releasing_scan)
+    return false;
 
-  scan result{std::vector<sample>(num_samples)};
-  for (std::int32_t n = 0; n < num_samples; ++n) {
-    // clang-format off
-    result.samples[n].angle           = ::sweep_scan_get_angle          (releasing_scan.get(), n);
-    result.samples[n].distance        = ::sweep_scan_get_distance       (releasing_scan.get(), n);
-    result.samples[n].signal_strength = ::sweep_scan_get_signal_strength(releasing_scan.get(), n);
-    // clang-format on
+  detail::assign_scan(scan, releasing_scan.get());
+  return true;
+}
+
+inline packet_counts sweep::get_packet_counts() {
+  packet_counts counts;
+  ::sweep_device_get_packet_counts(device.get(), &counts.packets, &counts.error_packets, &counts.checksum_failures);
+  return counts;
+}
+
+inline void sweep::set_zone_monitor(zone_monitor* monitor) {
+  ::sweep_device_set_zone_monitor(device.get(), monitor ? monitor->handle.get() : nullptr);
+}
+
+inline void sweep::reset() { ::sweep_device_reset(device.get(), detail::error_to_exception{}); }
+
+inline std::vector<point> to_cartesian(const scan& scan, const pose& mount) {
+  const auto handle = detail::to_scratch_handle(scan);
+  const auto num_samples = scan.samples.size();
+
+  std::vector<float> x(num_samples);
+  std::vector<float> y(num_samples);
+
+  ::sweep_scan_to_cartesian(handle, mount.angle, mount.x, mount.y, x.data(), y.data());
+
+  std::vector<point> result(num_samples);
+  for (std::size_t n = 0; n < num_samples; ++n)
+    result[n] = point{x[n], y[n]};
+
+  return result;
+}
+
+inline void to_range_image(const scan& scan, std::int32_t bins, reduction reduce, range_image& image) {
+  const auto handle = detail::to_scratch_handle(scan);
+
+  image.distance.resize(bins);
+  image.valid.resize(bins);
+
+  ::sweep_scan_to_range_image(handle, bins, static_cast<std::int32_t>(reduce), image.distance.data(), image.valid.data());
+}
+
+inline void find_reflectors(const scan& scan, std::int32_t min_signal_strength, std::int32_t min_samples, float max_width,
+                            std::vector<reflector>& reflectors) {
+  const auto handle = detail::to_scratch_handle(scan);
+
+  // A run needs at least one sample, so there are never more reflectors than samples
+  const auto capacity = static_cast<std::int32_t>(scan.samples.size());
+
+  std::vector<float> x(capacity);
+  std::vector<float> y(capacity);
+  std::vector<float> covariance(3 * capacity);
+
+  const auto count = ::sweep_scan_find_reflectors(handle, min_signal_strength, min_samples, max_width, x.data(), y.data(),
+                                                  covariance.data(), capacity);
+
+  reflectors.resize(count);
+
+  for (std::int32_t n = 0; n < count; ++n)
+    reflectors[n] = reflector{point{x[n], y[n]}, {covariance[3 * n], covariance[3 * n + 1], covariance[3 * n + 2]}};
+}
+
+inline filter::filter()
+    : handle{::sweep_filter_construct(detail::error_to_exception{}), &::sweep_filter_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline filter& filter::range_gate(std::int32_t min_distance, std::int32_t max_distance) {
+  ::sweep_filter_add_range_gate(handle.get(), min_distance, max_distance, detail::error_to_exception{});
+  return *this;
+}
+
+inline filter& filter::signal_threshold(std::int32_t min_signal_strength) {
+  ::sweep_filter_add_signal_threshold(handle.get(), min_signal_strength, detail::error_to_exception{});
+  return *this;
+}
+
+inline filter& filter::median(std::int32_t radius) {
+  ::sweep_filter_add_median(handle.get(), radius, detail::error_to_exception{});
+  return *this;
+}
+
+inline filter& filter::remove_speckles(std::int32_t max_jump) {
+  ::sweep_filter_add_speckle_removal(handle.get(), max_jump, detail::error_to_exception{});
+  return *this;
+}
+
+inline void filter::apply(scan& scan) {
+  detail::assign_scan_handle(scratch.get(), scan);
+  ::sweep_filter_apply(handle.get(), scratch.get());
+  detail::assign_scan(scan, scratch.get());
+}
+
+inline occupancy_grid::occupancy_grid(std::int32_t width, std::int32_t height, std::int32_t resolution, std::int32_t threads)
+    : width{width}, height{height},
+      handle{::sweep_occupancy_grid_construct(width, height, resolution, threads, detail::error_to_exception{}),
+             &::sweep_occupancy_grid_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline void occupancy_grid::set_log_odds(std::int32_t hit, std::int32_t miss, std::int32_t min, std::int32_t max) {
+  ::sweep_occupancy_grid_set_log_odds(handle.get(), hit, miss, min, max);
+}
+
+inline void occupancy_grid::clear() { ::sweep_occupancy_grid_clear(handle.get()); }
+
+inline void occupancy_grid::update(const scan& scan, const pose& sensor) {
+  detail::assign_scan_handle(scratch.get(), scan);
+  ::sweep_occupancy_grid_update(handle.get(), scratch.get(), sensor.angle, sensor.x, sensor.y);
+}
+
+inline std::vector<std::int16_t> occupancy_grid::get_log_odds() {
+  std::vector<std::int16_t> result(static_cast<std::size_t>(width) * height);
+  ::sweep_occupancy_grid_get_log_odds(handle.get(), result.data());
+  return result;
+}
+
+inline scan_matcher::scan_matcher()
+    : handle{::sweep_scan_matcher_construct(detail::error_to_exception{}), &::sweep_scan_matcher_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline void scan_matcher::set_search_window(float linear_window, std::int32_t angular_window, float resolution) {
+  ::sweep_scan_matcher_set_search_window(handle.get(), linear_window, angular_window, resolution);
+}
+
+inline void scan_matcher::set_refinement(std::int32_t iterations, float max_distance) {
+  ::sweep_scan_matcher_set_refinement(handle.get(), iterations, max_distance);
+}
+
+inline void scan_matcher::set_reference(const scan& scan) {
+  detail::assign_scan_handle(scratch.get(), scan);
+  ::sweep_scan_matcher_set_reference(handle.get(), scratch.get(), detail::error_to_exception{});
+}
+
+inline std::int32_t scan_matcher::match(const scan& scan, pose& guess) {
+  detail::assign_scan_handle(scratch.get(), scan);
+  return ::sweep_scan_matcher_match(handle.get(), scratch.get(), &guess.angle, &guess.x, &guess.y);
+}
+
+inline spatial_index::spatial_index(float cell_size, float extent, std::int32_t max_points)
+    : handle{::sweep_spatial_index_construct(cell_size, extent, max_points, detail::error_to_exception{}),
+             &::sweep_spatial_index_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline void spatial_index::clear() { ::sweep_spatial_index_clear(handle.get()); }
+
+inline void spatial_index::add_scan(const scan& scan, const pose& sensor) {
+  detail::assign_scan_handle(scratch.get(), scan);
+  ::sweep_spatial_index_add_scan(handle.get(), scratch.get(), sensor.angle, sensor.x, sensor.y);
+}
+
+inline void spatial_index::build() { ::sweep_spatial_index_build(handle.get()); }
+
+inline point spatial_index::get_point(std::int32_t id) {
+  point result;
+  ::sweep_spatial_index_get_point(handle.get(), id, &result.x, &result.y);
+  return result;
+}
+
+inline std::int32_t spatial_index::nearest(const point& query, float max_distance) {
+  std::int32_t id = -1;
+  ::sweep_spatial_index_nearest(handle.get(), &query.x, &query.y, 1, max_distance, &id);
+  return id;
+}
+
+inline void spatial_index::nearest(const std::vector<point>& queries, float max_distance, std::vector<std::int32_t>& ids) {
+  const auto count = queries.size();
+
+  x.resize(count);
+  y.resize(count);
+  ids.resize(count);
+
+  for (std::size_t n = 0; n < count; ++n) {
+    x[n] = queries[n].x;
+    y[n] = queries[n].y;
   }
 
+  ::sweep_spatial_index_nearest(handle.get(), x.data(), y.data(), static_cast<std::int32_t>(count), max_distance, ids.data());
+}
+
+inline void spatial_index::within(const point& query, float radius, std::vector<std::int32_t>& ids) {
+  // Retry once with the exact size if the ids' current capacity was too small
+  ids.resize(ids.capacity());
+
+  const auto capacity = static_cast<std::int32_t>(ids.size());
+  const auto found = ::sweep_spatial_index_within(handle.get(), query.x, query.y, radius, ids.data(), capacity);
+
+  ids.resize(found);
+
+  if (found > capacity)
+    ::sweep_spatial_index_within(handle.get(), query.x, query.y, radius, ids.data(), found);
+}
+
+inline line_extractor::line_extractor()
+    : handle{::sweep_line_extractor_construct(detail::error_to_exception{}), &::sweep_line_extractor_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline void line_extractor::set_thresholds(float max_deviation, float max_gap, std::int32_t min_samples, float min_length) {
+  ::sweep_line_extractor_set_thresholds(handle.get(), max_deviation, max_gap, min_samples, min_length);
+}
+
+inline void line_extractor::extract(const scan& scan, std::vector<segment>& segments) {
+  detail::assign_scan_handle(scratch.get(), scan);
+
+  const auto count = ::sweep_line_extractor_extract(handle.get(), scratch.get());
+
+  segments.resize(count);
+
+  for (std::int32_t n = 0; n < count; ++n)
+    segments[n] = get_segment(n);
+}
+
+inline void line_extractor::begin() { ::sweep_line_extractor_begin(handle.get()); }
+
+inline std::int32_t line_extractor::push(const sample& sample) {
+  return ::sweep_line_extractor_push(handle.get(), sample.angle, sample.distance);
+}
+
+inline std::int32_t line_extractor::finish() { return ::sweep_line_extractor_finish(handle.get()); }
+
+inline segment line_extractor::get_segment(std::int32_t index) {
+  segment result;
+  ::sweep_line_extractor_get_segment(handle.get(), index, &result.start.x, &result.start.y, &result.end.x, &result.end.y);
+  ::sweep_line_extractor_get_segment_line(handle.get(), index, &result.alpha, &result.r, result.covariance);
+  ::sweep_line_extractor_get_segment_samples(handle.get(), index, &result.first_sample, &result.last_sample);
   return result;
 }
 
-inline void sweep::reset() { ::sweep_device_reset(device.get(), detail::error_to_exception{}); }
+inline clusterer::clusterer()
+    : handle{::sweep_clusterer_construct(detail::error_to_exception{}), &::sweep_clusterer_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline void clusterer::set_thresholds(float base_distance, float range_factor, std::int32_t min_samples) {
+  ::sweep_clusterer_set_thresholds(handle.get(), base_distance, range_factor, min_samples);
+}
+
+inline void clusterer::run(const scan& scan, std::vector<std::int32_t>& ids, std::vector<cluster>& clusters) {
+  detail::assign_scan_handle(scratch.get(), scan);
+
+  ids.resize(scan.samples.size());
+
+  const auto count = ::sweep_clusterer_run(handle.get(), scratch.get(), ids.data());
+
+  clusters.resize(count);
+
+  for (std::int32_t n = 0; n < count; ++n) {
+    auto& c = clusters[n];
+    ::sweep_clusterer_get_cluster(handle.get(), n, &c.centroid.x, &c.centroid.y, &c.samples);
+    ::sweep_clusterer_get_cluster_extent(handle.get(), n, &c.min.x, &c.min.y, &c.max.x, &c.max.y);
+  }
+}
+
+inline background::background(std::int32_t bins)
+    : handle{::sweep_background_construct(bins, detail::error_to_exception{}), &::sweep_background_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline background::background(const char* path)
+    : handle{::sweep_background_load(path, detail::error_to_exception{}), &::sweep_background_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline void background::set_parameters(float learning_rate, float threshold, float min_deviation) {
+  ::sweep_background_set_parameters(handle.get(), learning_rate, threshold, min_deviation);
+}
+
+inline void background::set_retraining_rate(float retraining_rate) {
+  ::sweep_background_set_retraining_rate(handle.get(), retraining_rate);
+}
+
+inline void background::clear() { ::sweep_background_clear(handle.get()); }
+
+inline void background::learn(const scan& scan) {
+  detail::assign_scan_handle(scratch.get(), scan);
+  ::sweep_background_learn(handle.get(), scratch.get());
+}
+
+namespace detail {
+inline void collect_foreground(const scan& scan, const std::vector<std::uint8_t>& mask, ::sweep::scan& foreground) {
+  foreground.samples.clear();
+
+  for (std::size_t n = 0; n < scan.samples.size(); ++n)
+    if (mask[n])
+      foreground.samples.push_back(scan.samples[n]);
+}
+} // namespace detail
+
+inline void background::classify(const scan& scan, std::vector<std::uint8_t>& mask, ::sweep::scan& foreground) {
+  detail::assign_scan_handle(scratch.get(), scan);
+  mask.resize(scan.samples.size());
+  ::sweep_background_classify(handle.get(), scratch.get(), mask.data());
+  detail::collect_foreground(scan, mask, foreground);
+}
+
+inline void background::update(const scan& scan, std::vector<std::uint8_t>& mask, ::sweep::scan& foreground) {
+  detail::assign_scan_handle(scratch.get(), scan);
+  mask.resize(scan.samples.size());
+  ::sweep_background_update(handle.get(), scratch.get(), mask.data());
+  detail::collect_foreground(scan, mask, foreground);
+}
+
+inline void background::save(const char* path) { ::sweep_background_save(handle.get(), path, detail::error_to_exception{}); }
+
+inline tracker::tracker(std::int32_t max_tracks)
+    : handle{::sweep_tracker_construct(max_tracks, detail::error_to_exception{}), &::sweep_tracker_destruct} {}
+
+inline void tracker::set_association(float max_distance, std::int32_t confirm_hits, std::int32_t max_misses) {
+  ::sweep_tracker_set_association(handle.get(), max_distance, confirm_hits, max_misses);
+}
+
+inline void tracker::set_noise(float process_noise, float measurement_noise) {
+  ::sweep_tracker_set_noise(handle.get(), process_noise, measurement_noise);
+}
+
+inline void tracker::clear() { ::sweep_tracker_clear(handle.get()); }
+
+inline void tracker::update(const std::vector<point>& detections, float dt, std::vector<track>& tracks) {
+  x.resize(detections.size());
+  y.resize(detections.size());
+
+  for (std::size_t n = 0; n < detections.size(); ++n) {
+    x[n] = detections[n].x;
+    y[n] = detections[n].y;
+  }
+
+  update(dt, tracks);
+}
+
+inline void tracker::update(const std::vector<cluster>& clusters, float dt, std::vector<track>& tracks) {
+  x.resize(clusters.size());
+  y.resize(clusters.size());
+
+  for (std::size_t n = 0; n < clusters.size(); ++n) {
+    x[n] = clusters[n].centroid.x;
+    y[n] = clusters[n].centroid.y;
+  }
+
+  update(dt, tracks);
+}
+
+inline void tracker::update(float dt, std::vector<track>& tracks) {
+  const auto count = ::sweep_tracker_update(handle.get(), x.data(), y.data(), static_cast<std::int32_t>(x.size()), dt);
+
+  tracks.resize(count);
+
+  for (std::int32_t n = 0; n < count; ++n) {
+    auto& t = tracks[n];
+    ::sweep_tracker_get_track(handle.get(), n, &t.id, &t.position.x, &t.position.y, &t.velocity.x, &t.velocity.y);
+  }
+}
+
+inline zone_monitor::zone_monitor()
+    : handle{::sweep_zone_monitor_construct(detail::error_to_exception{}), &::sweep_zone_monitor_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct}, on_intrusion{new callback} {}
+
+inline std::int32_t zone_monitor::add_sector(std::int32_t start_angle, std::int32_t end_angle, std::int32_t min_distance,
+                                             std::int32_t max_distance) {
+  return ::sweep_zone_monitor_add_sector(handle.get(), start_angle, end_angle, min_distance, max_distance,
+                                         detail::error_to_exception{});
+}
+
+inline std::int32_t zone_monitor::add_polygon(const std::vector<point>& polygon) {
+  std::vector<float> x(polygon.size());
+  std::vector<float> y(polygon.size());
+
+  for (std::size_t n = 0; n < polygon.size(); ++n) {
+    x[n] = polygon[n].x;
+    y[n] = polygon[n].y;
+  }
+
+  return ::sweep_zone_monitor_add_polygon(handle.get(), x.data(), y.data(), static_cast<std::int32_t>(polygon.size()),
+                                          detail::error_to_exception{});
+}
+
+inline void zone_monitor::set_callback(callback function) {
+  *on_intrusion = std::move(function);
+
+  const auto trampoline = [](void* user, std::uint32_t zones, std::int32_t angle, std::int32_t distance) {
+    (*static_cast<callback*>(user))(zones, sample{angle, distance, 0});
+  };
+
+  if (*on_intrusion)
+    ::sweep_zone_monitor_set_callback(handle.get(), trampoline, on_intrusion.get());
+  else
+    ::sweep_zone_monitor_set_callback(handle.get(), nullptr, nullptr);
+}
+
+inline std::uint32_t zone_monitor::check(const scan& scan) {
+  detail::assign_scan_handle(scratch.get(), scan);
+  return ::sweep_zone_monitor_check_scan(handle.get(), scratch.get());
+}
+
+inline std::uint32_t zone_monitor::get_triggered() { return ::sweep_zone_monitor_get_triggered(handle.get()); }
+
+inline std::uint32_t zone_monitor::clear_triggered() { return ::sweep_zone_monitor_clear_triggered(handle.get()); }
+
+inline localizer::localizer(std::int32_t max_particles, std::int32_t threads)
+    : handle{::sweep_localizer_construct(max_particles, threads, detail::error_to_exception{}), &::sweep_localizer_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline void localizer::set_map(const std::vector<std::uint8_t>& occupied, std::int32_t width, std::int32_t height, float resolution,
+                               const point& origin) {
+  if (occupied.size() != static_cast<std::size_t>(width) * height)
+    throw device_error{"map does not hold width x height cells"};
+
+  ::sweep_localizer_set_map(handle.get(), occupied.data(), width, height, resolution, origin.x, origin.y,
+                            detail::error_to_exception{});
+}
+
+inline void localizer::set_model(float sigma, float random) { ::sweep_localizer_set_model(handle.get(), sigma, random); }
+
+inline void localizer::set_beam_step(std::int32_t beam_step) { ::sweep_localizer_set_beam_step(handle.get(), beam_step); }
+
+inline void localizer::reset(std::int32_t count, const pose& pose, std::int32_t angular_spread, float linear_spread) {
+  ::sweep_localizer_reset(handle.get(), count, pose.angle, pose.x, pose.y, angular_spread, linear_spread);
+}
+
+inline void localizer::predict(const pose& motion, std::int32_t angular_noise, float linear_noise) {
+  ::sweep_localizer_predict(handle.get(), motion.angle, motion.x, motion.y, angular_noise, linear_noise);
+}
+
+inline float localizer::update(const scan& scan) {
+  detail::assign_scan_handle(scratch.get(), scan);
+  return ::sweep_localizer_update(handle.get(), scratch.get());
+}
+
+inline pose localizer::get_pose() {
+  pose result;
+  ::sweep_localizer_get_pose(handle.get(), &result.angle, &result.x, &result.y);
+  return result;
+}
+
+inline void localizer::get_particles(std::vector<particle>& particles) {
+  const auto count = ::sweep_localizer_get_number_of_particles(handle.get());
+
+  angle.resize(count);
+  x.resize(count);
+  y.resize(count);
+  weight.resize(count);
+
+  ::sweep_localizer_get_particles(handle.get(), angle.data(), x.data(), y.data(), weight.data());
+
+  particles.resize(count);
+
+  for (std::int32_t n = 0; n < count; ++n)
+    particles[n] = particle{angle[n], point{x[n], y[n]}, weight[n]};
+}
+
+inline clearance_map::clearance_map(std::int32_t width, std::int32_t height, float resolution, std::int32_t threads)
+    : handle{::sweep_clearance_map_construct(width, height, resolution, threads, detail::error_to_exception{}),
+             &::sweep_clearance_map_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct},
+      cells{static_cast<std::size_t>(width) * height} {}
+
+inline std::int32_t clearance_map::update(const scan& scan, std::vector<float>& distance) {
+  detail::assign_scan_handle(scratch.get(), scan);
+
+  distance.resize(cells);
+
+  return ::sweep_clearance_map_update(handle.get(), scratch.get(), distance.data());
+}
+
+inline free_space::free_space()
+    : handle{::sweep_free_space_construct(detail::error_to_exception{}), &::sweep_free_space_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline void free_space::set_parameters(float max_range, std::int32_t bins, float tolerance) {
+  ::sweep_free_space_set_parameters(handle.get(), max_range, bins, tolerance);
+}
+
+inline void free_space::extract(const scan& scan, std::vector<point>& polygon) {
+  detail::assign_scan_handle(scratch.get(), scan);
+
+  auto count = ::sweep_free_space_extract(handle.get(), scratch.get(), x.data(), y.data(), static_cast<std::int32_t>(x.size()));
+
+  // Retries once with enough room; vertices only ever grow the buffers
+  if (count > static_cast<std::int32_t>(x.size())) {
+    x.resize(count);
+    y.resize(count);
+    count = ::sweep_free_space_extract(handle.get(), scratch.get(), x.data(), y.data(), count);
+  }
+
+  polygon.resize(count);
+
+  for (std::int32_t n = 0; n < count; ++n)
+    polygon[n] = point{x[n], y[n]};
+}
+
+inline encoder::encoder(std::int32_t keyframe_interval)
+    : handle{::sweep_scan_encoder_construct(keyframe_interval, detail::error_to_exception{}), &::sweep_scan_encoder_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline void encoder::reset() { ::sweep_scan_encoder_reset(handle.get()); }
+
+inline void encoder::encode(const scan& scan, std::vector<std::uint8_t>& out) {
+  detail::assign_scan_handle(scratch.get(), scan);
+
+  const auto offset = out.size();
+  const auto bound = ::sweep_scan_encode_bound(static_cast<std::int32_t>(scan.samples.size()));
+
+  out.resize(offset + bound);
+  out.resize(offset + ::sweep_scan_encoder_encode(handle.get(), scratch.get(), out.data() + offset, bound));
+}
+
+inline decoder::decoder()
+    : handle{::sweep_scan_decoder_construct(detail::error_to_exception{}), &::sweep_scan_decoder_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline void decoder::reset() { ::sweep_scan_decoder_reset(handle.get()); }
+
+inline std::size_t decoder::decode(const std::uint8_t* data, std::size_t size, scan& scan) {
+  // A frame never comes close to 2 GiB, a larger size can only mean there are more frames
+  const auto clamped = static_cast<std::int32_t>(std::min<std::size_t>(size, 0x7fffffff));
+
+  const auto consumed = ::sweep_scan_decoder_decode(handle.get(), data, clamped, scratch.get(), detail::error_to_exception{});
+
+  if (consumed > 0)
+    detail::assign_scan(scan, scratch.get());
+
+  return static_cast<std::size_t>(consumed > 0 ? consumed : 0);
+}
+
+inline log_writer::log_writer(const char* path)
+    : handle{::sweep_log_writer_construct(path, detail::error_to_exception{}), &::sweep_log_writer_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline void log_writer::append(const scan& scan, std::int64_t timestamp) {
+  detail::assign_scan_handle(scratch.get(), scan);
+  ::sweep_log_writer_append(handle.get(), scratch.get(), timestamp, detail::error_to_exception{});
+}
+
+inline std::int64_t log_writer::get_dropped() { return ::sweep_log_writer_get_dropped(handle.get()); }
+
+inline log_reader::log_reader(const char* path)
+    : handle{::sweep_log_reader_construct(path, detail::error_to_exception{}), &::sweep_log_reader_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline bool log_reader::is_indexed() { return ::sweep_log_reader_is_indexed(handle.get()); }
+
+inline std::int32_t log_reader::get_number_of_scans() { return ::sweep_log_reader_get_number_of_scans(handle.get()); }
+
+inline std::int32_t log_reader::seek(std::int64_t timestamp) { return ::sweep_log_reader_seek(handle.get(), timestamp); }
+
+inline log_entry log_reader::get(std::int32_t index) {
+  static_assert(sizeof(sample) == 3 * sizeof(std::int32_t), "samples are laid out as in the log");
+
+  std::int32_t count = 0;
+  const std::int32_t* samples = ::sweep_log_reader_get_samples(handle.get(), index, &count);
+
+  return log_entry{::sweep_log_reader_get_timestamp(handle.get(), index), reinterpret_cast<const sample*>(samples), count};
+}
+
+inline void log_reader::read(std::int32_t index, scan& scan) {
+  ::sweep_log_reader_read(handle.get(), index, scratch.get());
+  detail::assign_scan(scan, scratch.get());
+}
+
+inline ring_writer::ring_writer(const char* name, std::int32_t slots)
+    : handle{::sweep_ring_writer_construct(name, slots, detail::error_to_exception{}), &::sweep_ring_writer_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline std::int64_t ring_writer::publish(const scan& scan, std::int64_t timestamp) {
+  detail::assign_scan_handle(scratch.get(), scan);
+  return ::sweep_ring_writer_publish(handle.get(), scratch.get(), timestamp);
+}
+
+inline ring_reader::ring_reader(const char* name)
+    : handle{::sweep_ring_reader_construct(name, detail::error_to_exception{}), &::sweep_ring_reader_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline bool ring_reader::next(ring_entry& entry, std::int32_t timeout) {
+  static_assert(sizeof(sample) == 3 * sizeof(std::int32_t), "samples are laid out as in the ring");
+
+  const std::int32_t* samples = nullptr;
+
+  entry.sequence = ::sweep_ring_reader_next(handle.get(), timeout, &entry.timestamp, &samples, &entry.count,
+                                            detail::error_to_exception{});
+  entry.samples = reinterpret_cast<const sample*>(samples);
+
+  return entry.sequence >= 0;
+}
+
+inline bool ring_reader::is_valid(const ring_entry& entry) { return ::sweep_ring_reader_is_valid(handle.get(), entry.sequence); }
+
+inline bool ring_reader::read(scan& scan, std::int64_t& timestamp, std::int32_t timeout) {
+  const auto sequence = ::sweep_ring_reader_read(handle.get(), timeout, scratch.get(), &timestamp, detail::error_to_exception{});
+
+  if (sequence < 0)
+    return false;
+
+  detail::assign_scan(scan, scratch.get());
+  return true;
+}
+
+inline std::int64_t ring_reader::get_dropped() { return ::sweep_ring_reader_get_dropped(handle.get()); }
+
+
+inline fleet::fleet(const std::vector<std::string>& ports, std::int32_t motor_speed, std::int32_t sample_rate)
+    : handle{nullptr, &::sweep_fleet_destruct} {
+  std::vector<const char*> names;
+
+  for (const auto& port : ports)
+    names.push_back(port.c_str());
+
+  handle.reset(::sweep_fleet_construct(names.data(), static_cast<std::int32_t>(names.size()), motor_speed, sample_rate,
+                                       detail::error_to_exception{}));
+}
+
+inline std::int32_t fleet::get_number_of_devices() { return ::sweep_fleet_get_number_of_devices(handle.get()); }
+
+inline bool fleet::get_scan(scan& scan, std::int32_t& device, std::int32_t timeout) {
+  const detail::scan_owner releasing_scan{::sweep_fleet_get_scan(handle.get(), timeout, &device, detail::error_to_exception{}),
+                                          &::sweep_scan_destruct};
+
+  if (!releasing_scan)
+    return false;
+
+  detail::assign_scan(scan, releasing_scan.get());
+  return true;
+}
+
+inline std::int64_t fleet::get_dropped() { return ::sweep_fleet_get_dropped(handle.get()); }
+
+inline fusion::fusion(std::int32_t devices, std::int64_t period, std::int64_t window)
+    : handle{::sweep_fusion_construct(devices, period, window, detail::error_to_exception{}), &::sweep_fusion_destruct},
+      scratch{::sweep_scan_construct(0, detail::error_to_exception{}), &::sweep_scan_destruct} {}
+
+inline void fusion::set_device(std::int32_t device, const pose& mount, std::int64_t clock_offset) {
+  ::sweep_fusion_set_device(handle.get(), device, mount.angle, mount.x, mount.y, clock_offset);
+}
+
+inline void fusion::add_scan(std::int32_t device, const scan& scan, std::int64_t timestamp) {
+  detail::assign_scan_handle(scratch.get(), scan);
+  ::sweep_fusion_add_scan(handle.get(), device, scratch.get(), timestamp);
+}
+
+inline bool fusion::merge(std::int64_t now, fused_points& points) {
+  const float* x = nullptr;
+  const float* y = nullptr;
+  const std::int32_t* angle = nullptr;
+  const std::int32_t* device = nullptr;
+
+  const auto count = ::sweep_fusion_merge(handle.get(), now, &x, &y, &angle, &device);
+
+  if (count < 0)
+    return false;
+
+  points.x.assign(x, x + count);
+  points.y.assign(y, y + count);
+  points.angle.assign(angle, angle + count);
+  points.device.assign(device, device + count);
+  return true;
+}
+
+inline std::int64_t fusion::get_next() { return ::sweep_fusion_get_next(handle.get()); }
+
+inline std::vector<device_info> discover_devices(std::int32_t timeout, const std::vector<std::string>& ports) {
+  std::vector<const char*> names;
+
+  for (const auto& port : ports)
+    names.push_back(port.c_str());
+
+  const std::unique_ptr<::sweep_discovery, decltype(&::sweep_discovery_destruct)> discovery{
+      ::sweep_discover_devices(names.data(), static_cast<std::int32_t>(names.size()), timeout, detail::error_to_exception{}),
+      &::sweep_discovery_destruct};
+
+  std::vector<device_info> devices(::sweep_discovery_get_number_of_devices(discovery.get()));
+
+  for (std::int32_t n = 0; n < static_cast<std::int32_t>(devices.size()); ++n) {
+    auto& device = devices[n];
+
+    device.port = ::sweep_discovery_get_port(discovery.get(), n);
+    device.scanning = ::sweep_discovery_get_scanning(discovery.get(), n);
+    device.serial_number = ::sweep_discovery_get_serial_number(discovery.get(), n);
+    device.firmware_version = ::sweep_discovery_get_firmware_version(discovery.get(), n);
+    device.motor_speed = ::sweep_discovery_get_motor_speed(discovery.get(), n);
+    device.sample_rate = ::sweep_discovery_get_sample_rate(discovery.get(), n);
+  }
+
+  return devices;
+}
 
 } // namespace sweep
 
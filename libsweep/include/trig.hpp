@@ -0,0 +1,49 @@
+#ifndef SWEEP_TRIG_4B7E91D2C5A3_HPP
+#define SWEEP_TRIG_4B7E91D2C5A3_HPP
+
+/*
+ * Trigonometric lookup tables for device angles.
+ * Implementation detail; not exported.
+ */
+
+#include <stdint.h>
+
+namespace sweep {
+namespace trig {
+
+// The device transmits angles as fixed point integers with a scaling factor of 16,
+// therefore there are only 360 * 16 distinct angles a sample can ever be reported at.
+constexpr int32_t ANGLE_STEPS = 360 * 16;
+
+struct table {
+  float cos[ANGLE_STEPS];
+  float sin[ANGLE_STEPS];
+};
+
+// Lazily computed on first use, shared by all callers
+const table& lookup();
+
+// Wraps an arbitrary angle in millidegrees to [0, 360000)
+inline int32_t wrap_millideg(int32_t millideg) {
+  millideg %= 360000;
+  return millideg < 0 ? millideg + 360000 : millideg;
+}
+
+// Inverse of response_scan_packet_s::get_angle_millideg: recovers the 1/16 degree step the device sent from the
+// truncated angle * 62.5 by rounding up, which undoes the truncation exactly. Angles in between steps, e.g. computed
+// ones, round up to the next step too; angles outside [0, 360000) are wrapped first so the step always indexes tables.
+inline int32_t millideg_to_step(int32_t millideg) {
+  if (millideg < 0 || millideg >= 360000)
+    millideg = wrap_millideg(millideg);
+
+  const int32_t step = (millideg * 2 + 124) / 125;
+  return step < ANGLE_STEPS ? step : step - ANGLE_STEPS;
+}
+
+// Converts a 1/16 degree step back to millidegrees
+inline int32_t step_to_millideg(int32_t step) { return static_cast<int32_t>(step * 1000 / 16.0f); }
+
+} // ns trig
+} // ns sweep
+
+#endif
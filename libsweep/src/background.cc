@@ -0,0 +1,270 @@
+#include "error.hpp"
+#include "scan.hpp"
+#include "trig.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// Persisted models start with this magic and version, followed by the number of bins and the per bin arrays
+#define SWEEP_BACKGROUND_MAGIC "SWBG"
+#define SWEEP_BACKGROUND_VERSION 1
+
+// Per angular bin model in structure of arrays layout: the hot loops touch only the arrays they need
+struct sweep_background {
+  sweep_background(int32_t bins) : bins{bins}, mean(bins), variance(bins), count(bins) {}
+
+  int32_t bins;
+
+  float learning_rate = 0.01f;
+  float retraining_rate = 0.001f;
+  float threshold = 3.0f;
+  float min_deviation = 10.0f;
+
+  std::vector<float> mean;     // in cm
+  std::vector<float> variance; // in cm^2
+  std::vector<int32_t> count;  // returns seen, saturating
+};
+
+static int32_t bin_of(const sweep_background& background, int32_t angle) {
+  return sweep::trig::millideg_to_step(angle) * background.bins / sweep::trig::ANGLE_STEPS;
+}
+
+// Running mean and variance: cumulative while a bin has seen few returns, exponentially forgetting afterwards
+static void learn_sample(sweep_background& background, int32_t bin, float distance) {
+  int32_t& count = background.count[bin];
+
+  if (count < std::numeric_limits<int32_t>::max())
+    count += 1;
+
+  const float cumulative = 1.0f / count;
+  const float rate = cumulative > background.learning_rate ? cumulative : background.learning_rate;
+
+  const float delta = distance - background.mean[bin];
+
+  background.mean[bin] += rate * delta;
+  background.variance[bin] = (1.0f - rate) * (background.variance[bin] + rate * delta * delta);
+}
+
+// Foreground returns persisting in a bin, e.g. an object put down in front of the background, slowly pull it towards them
+// until they count as background; returns passing by barely move it. Bins which never saw a return are seeded instead.
+static void retrain_sample(sweep_background& background, int32_t bin, float distance) {
+  if (background.count[bin] == 0) {
+    learn_sample(background, bin, distance);
+    return;
+  }
+
+  const float rate = background.retraining_rate;
+  const float delta = distance - background.mean[bin];
+
+  background.mean[bin] += rate * delta;
+  background.variance[bin] = (1.0f - rate) * (background.variance[bin] + rate * delta * delta);
+}
+
+// Returns nearer than the background by more than threshold standard deviations and the minimum deviation are foreground;
+// bins which never saw a return have no background at all
+static bool is_foreground(const sweep_background& background, int32_t bin, float distance) {
+  if (background.count[bin] == 0)
+    return true;
+
+  const float nearer = background.mean[bin] - distance;
+  const float threshold = background.threshold;
+
+  return nearer > background.min_deviation && nearer * nearer > threshold * threshold * background.variance[bin];
+}
+
+static int32_t classify(sweep_background& background, sweep_scan_s scan, uint8_t* foreground, bool learn) {
+  int32_t found = 0;
+
+  for (int32_t n = 0; n < scan->count; ++n) {
+    const sample& s = scan->samples[n];
+
+    if (s.distance <= 0) {
+      foreground[n] = 0;
+      continue;
+    }
+
+    const int32_t bin = bin_of(background, s.angle);
+    const bool is = is_foreground(background, bin, static_cast<float>(s.distance));
+
+    foreground[n] = is ? 1 : 0;
+    found += is ? 1 : 0;
+
+    if (learn && !is)
+      learn_sample(background, bin, static_cast<float>(s.distance));
+    else if (learn)
+      retrain_sample(background, bin, static_cast<float>(s.distance));
+  }
+
+  return found;
+}
+
+sweep_background_s sweep_background_construct(int32_t bins, sweep_error_s* error) try {
+  SWEEP_ASSERT(bins > 0 && bins <= sweep::trig::ANGLE_STEPS);
+  SWEEP_ASSERT(error);
+
+  return new sweep_background{bins};
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_background_destruct(sweep_background_s background) {
+  SWEEP_ASSERT(background);
+
+  delete background;
+}
+
+void sweep_background_set_parameters(sweep_background_s background, float learning_rate, float threshold, float min_deviation) {
+  SWEEP_ASSERT(background);
+  SWEEP_ASSERT(learning_rate > 0.0f && learning_rate <= 1.0f);
+  SWEEP_ASSERT(threshold >= 0.0f);
+  SWEEP_ASSERT(min_deviation >= 0.0f);
+
+  background->learning_rate = learning_rate;
+  background->threshold = threshold;
+  background->min_deviation = min_deviation;
+}
+
+void sweep_background_set_retraining_rate(sweep_background_s background, float retraining_rate) {
+  SWEEP_ASSERT(background);
+  SWEEP_ASSERT(retraining_rate >= 0.0f && retraining_rate <= 1.0f);
+
+  background->retraining_rate = retraining_rate;
+}
+
+void sweep_background_clear(sweep_background_s background) {
+  SWEEP_ASSERT(background);
+
+  std::fill(background->mean.begin(), background->mean.end(), 0.0f);
+  std::fill(background->variance.begin(), background->variance.end(), 0.0f);
+  std::fill(background->count.begin(), background->count.end(), 0);
+}
+
+void sweep_background_learn(sweep_background_s background, sweep_scan_s scan) {
+  SWEEP_ASSERT(background);
+  SWEEP_ASSERT(scan);
+
+  for (int32_t n = 0; n < scan->count; ++n) {
+    const sample& s = scan->samples[n];
+
+    if (s.distance > 0)
+      learn_sample(*background, bin_of(*background, s.angle), static_cast<float>(s.distance));
+  }
+}
+
+int32_t sweep_background_classify(sweep_background_s background, sweep_scan_s scan, uint8_t* foreground) {
+  SWEEP_ASSERT(background);
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(foreground);
+
+  return classify(*background, scan, foreground, false);
+}
+
+int32_t sweep_background_update(sweep_background_s background, sweep_scan_s scan, uint8_t* foreground) {
+  SWEEP_ASSERT(background);
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(foreground);
+
+  return classify(*background, scan, foreground, true);
+}
+
+int32_t sweep_background_get_number_of_bins(sweep_background_s background) {
+  SWEEP_ASSERT(background);
+
+  return background->bins;
+}
+
+void sweep_background_get_bin(sweep_background_s background, int32_t bin, float* mean, float* variance, int32_t* count) {
+  SWEEP_ASSERT(background);
+  SWEEP_ASSERT(bin >= 0 && bin < background->bins && "bin index out of bounds");
+  SWEEP_ASSERT(mean && variance && count);
+
+  *mean = background->mean[bin];
+  *variance = background->variance[bin];
+  *count = background->count[bin];
+}
+
+using file_owner = std::unique_ptr<std::FILE, decltype(&std::fclose)>;
+
+static void write_all(std::FILE* file, const void* data, size_t size) {
+  if (std::fwrite(data, 1, size, file) != size)
+    throw std::runtime_error{"unable to write background model"};
+}
+
+static void read_all(std::FILE* file, void* data, size_t size) {
+  if (std::fread(data, 1, size, file) != size)
+    throw std::runtime_error{"unable to read background model: file truncated"};
+}
+
+// Parameters are configuration, not learned state, and are not persisted; the format is native endian
+void sweep_background_save(sweep_background_s background, const char* path, sweep_error_s* error) try {
+  SWEEP_ASSERT(background);
+  SWEEP_ASSERT(path);
+  SWEEP_ASSERT(error);
+
+  const file_owner file{std::fopen(path, "wb"), &std::fclose};
+
+  if (!file)
+    throw std::runtime_error{"unable to open background model for writing"};
+
+  const int32_t version = SWEEP_BACKGROUND_VERSION;
+  const auto bins = static_cast<size_t>(background->bins);
+
+  write_all(file.get(), SWEEP_BACKGROUND_MAGIC, 4);
+  write_all(file.get(), &version, sizeof(version));
+  write_all(file.get(), &background->bins, sizeof(background->bins));
+  write_all(file.get(), background->mean.data(), bins * sizeof(float));
+  write_all(file.get(), background->variance.data(), bins * sizeof(float));
+  write_all(file.get(), background->count.data(), bins * sizeof(int32_t));
+
+  if (std::fflush(file.get()) != 0)
+    throw std::runtime_error{"unable to write background model"};
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+}
+
+sweep_background_s sweep_background_load(const char* path, sweep_error_s* error) try {
+  SWEEP_ASSERT(path);
+  SWEEP_ASSERT(error);
+
+  const file_owner file{std::fopen(path, "rb"), &std::fclose};
+
+  if (!file)
+    throw std::runtime_error{"unable to open background model for reading"};
+
+  char magic[4];
+  int32_t version = 0;
+  int32_t bins = 0;
+
+  read_all(file.get(), magic, sizeof(magic));
+  read_all(file.get(), &version, sizeof(version));
+  read_all(file.get(), &bins, sizeof(bins));
+
+  if (std::memcmp(magic, SWEEP_BACKGROUND_MAGIC, 4) != 0)
+    throw std::runtime_error{"unable to read background model: not a background model"};
+
+  if (version != SWEEP_BACKGROUND_VERSION)
+    throw std::runtime_error{"unable to read background model: unsupported version"};
+
+  if (bins <= 0 || bins > sweep::trig::ANGLE_STEPS)
+    throw std::runtime_error{"unable to read background model: invalid number of bins"};
+
+  std::unique_ptr<sweep_background> background{new sweep_background{bins}};
+
+  read_all(file.get(), background->mean.data(), bins * sizeof(float));
+  read_all(file.get(), background->variance.data(), bins * sizeof(float));
+  read_all(file.get(), background->count.data(), bins * sizeof(int32_t));
+
+  return background.release();
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
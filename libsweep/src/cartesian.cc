@@ -0,0 +1,85 @@
+#include "scan.hpp"
+#include "trig.hpp"
+
+#include "sweep.h"
+
+#include <cmath>
+
+// Rigid transformation from the sensor's frame into the target frame
+struct mount_pose {
+  float cos;
+  float sin;
+  float x;
+  float y;
+};
+
+static mount_pose make_mount_pose(int32_t angle, float x, float y) {
+  const double radian = sweep::trig::wrap_millideg(angle) / 1000.0 * 0.017453292519943295;
+  return {static_cast<float>(std::cos(radian)), static_cast<float>(std::sin(radian)), x, y};
+}
+
+static inline int16_t saturate_int16(float v) {
+  const float rounded = v < 0.0f ? v - 0.5f : v + 0.5f;
+
+  if (rounded <= -32768.0f)
+    return -32768;
+  if (rounded >= 32767.0f)
+    return 32767;
+
+  return static_cast<int16_t>(rounded);
+}
+
+// Kernel shared by all output types: no transcendental calls, only table lookups and multiply-adds
+template <typename Store>
+static void scan_to_cartesian(const sweep_scan& scan, const mount_pose& pose, Store store) {
+  const auto& table = sweep::trig::lookup();
+
+  const sample* samples = scan.samples;
+  const int32_t count = scan.count;
+
+  for (int32_t n = 0; n < count; ++n) {
+    const int32_t step = sweep::trig::millideg_to_step(samples[n].angle);
+    const float distance = static_cast<float>(samples[n].distance);
+
+    const float local_x = table.cos[step] * distance;
+    const float local_y = table.sin[step] * distance;
+
+    store(n, pose.cos * local_x - pose.sin * local_y + pose.x, //
+          pose.sin * local_x + pose.cos * local_y + pose.y);
+  }
+}
+
+void sweep_scan_to_cartesian_simple(sweep_scan_s scan, float* x, float* y) {
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(x);
+  SWEEP_ASSERT(y);
+
+  sweep_scan_to_cartesian(scan, 0, 0.0f, 0.0f, x, y);
+}
+
+void sweep_scan_to_cartesian(sweep_scan_s scan, int32_t mount_angle, float mount_x, float mount_y, float* x, float* y) {
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(x);
+  SWEEP_ASSERT(y);
+
+  const auto pose = make_mount_pose(mount_angle, mount_x, mount_y);
+
+  scan_to_cartesian(*scan, pose, [x, y](int32_t n, float px, float py) {
+    x[n] = px;
+    y[n] = py;
+  });
+}
+
+void sweep_scan_to_cartesian_int16(sweep_scan_s scan, int32_t mount_angle, float mount_x, float mount_y, int16_t* x,
+                                   int16_t* y) {
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(x);
+  SWEEP_ASSERT(y);
+
+  const auto pose = make_mount_pose(mount_angle, mount_x, mount_y);
+
+  scan_to_cartesian(*scan, pose, [x, y](int32_t n, float px, float py) {
+    x[n] = saturate_int16(px);
+    y[n] = saturate_int16(py);
+  });
+}
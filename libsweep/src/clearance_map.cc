@@ -0,0 +1,87 @@
+#include "distance.hpp"
+#include "error.hpp"
+#include "pool.hpp"
+#include "scan.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <vector>
+
+struct sweep_clearance_map {
+  sweep_clearance_map(int32_t width, int32_t height, float resolution, int32_t threads)
+      : width{width}, height{height}, resolution{resolution}, seeds(static_cast<size_t>(width) * height),
+        transform{width, height}, x(SWEEP_MAX_SAMPLES), y(SWEEP_MAX_SAMPLES), pool{threads} {}
+
+  int32_t width;
+  int32_t height;
+  float resolution; // in cm per cell
+
+  // Cells holding at least one return of the current scan
+  std::vector<uint8_t> seeds;
+
+  sweep::distance::transform transform;
+
+  // Working buffers, sized once for the largest possible scan
+  std::vector<float> x;
+  std::vector<float> y;
+
+  sweep::pool::pool pool;
+};
+
+sweep_clearance_map_s sweep_clearance_map_construct(int32_t width, int32_t height, float resolution, int32_t threads,
+                                                    sweep_error_s* error) try {
+  SWEEP_ASSERT(width > 0 && width <= 32768);
+  SWEEP_ASSERT(height > 0 && height <= 32768);
+  SWEEP_ASSERT(resolution > 0.0f);
+  SWEEP_ASSERT(threads >= 0);
+  SWEEP_ASSERT(error);
+
+  return new sweep_clearance_map{width, height, resolution, threads};
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_clearance_map_destruct(sweep_clearance_map_s map) {
+  SWEEP_ASSERT(map);
+
+  delete map;
+}
+
+int32_t sweep_clearance_map_update(sweep_clearance_map_s map, sweep_scan_s scan, float* distance) {
+  SWEEP_ASSERT(map);
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(distance);
+
+  std::fill(map->seeds.begin(), map->seeds.end(), static_cast<uint8_t>(0));
+
+  sweep_scan_to_cartesian_simple(scan, map->x.data(), map->y.data());
+
+  const float scale = 1.0f / map->resolution;
+
+  // The map's center cell holds the sensor
+  const auto to_cell = [scale](float v, int32_t size) { return static_cast<int32_t>(std::floor(v * scale)) + size / 2; };
+
+  int32_t count = 0;
+
+  for (int32_t n = 0; n < scan->count; ++n) {
+    if (scan->samples[n].distance <= 0)
+      continue;
+
+    const int32_t cx = to_cell(map->x[n], map->width);
+    const int32_t cy = to_cell(map->y[n], map->height);
+
+    if (cx < 0 || cy < 0 || cx >= map->width || cy >= map->height)
+      continue;
+
+    map->seeds[static_cast<size_t>(cy) * map->width + cx] = 1;
+    count += 1;
+  }
+
+  sweep::distance::euclidean(map->transform, map->seeds.data(), distance, map->resolution, map->pool);
+
+  return count;
+}
@@ -0,0 +1,206 @@
+#include "error.hpp"
+#include "scan.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <exception>
+#include <vector>
+
+struct scan_cluster {
+  double sum_x;
+  double sum_y;
+  float min_x;
+  float min_y;
+  float max_x;
+  float max_y;
+  int32_t count;
+};
+
+struct sweep_clusterer {
+  sweep_clusterer()
+      : x(SWEEP_MAX_SAMPLES), y(SWEEP_MAX_SAMPLES), clusters(SWEEP_MAX_SAMPLES), relabel(SWEEP_MAX_SAMPLES) {}
+
+  float base_distance = 10.0f;
+  float range_factor = 0.05f;
+  int32_t min_samples = 3;
+
+  std::vector<float> x;
+  std::vector<float> y;
+
+  std::vector<scan_cluster> clusters;
+  int32_t number_of_clusters = 0;
+
+  // Maps provisional cluster ids to final ones, -1 for clusters with too few samples
+  std::vector<int32_t> relabel;
+};
+
+static void start_cluster(scan_cluster& cluster, float x, float y) {
+  cluster.sum_x = x;
+  cluster.sum_y = y;
+  cluster.min_x = cluster.max_x = x;
+  cluster.min_y = cluster.max_y = y;
+  cluster.count = 1;
+}
+
+static void add_to_cluster(scan_cluster& cluster, float x, float y) {
+  cluster.sum_x += x;
+  cluster.sum_y += y;
+  cluster.min_x = std::min(cluster.min_x, x);
+  cluster.min_y = std::min(cluster.min_y, y);
+  cluster.max_x = std::max(cluster.max_x, x);
+  cluster.max_y = std::max(cluster.max_y, y);
+  cluster.count += 1;
+}
+
+static void merge_clusters(scan_cluster& into, const scan_cluster& from) {
+  into.sum_x += from.sum_x;
+  into.sum_y += from.sum_y;
+  into.min_x = std::min(into.min_x, from.min_x);
+  into.min_y = std::min(into.min_y, from.min_y);
+  into.max_x = std::max(into.max_x, from.max_x);
+  into.max_y = std::max(into.max_y, from.max_y);
+  into.count += from.count;
+}
+
+// Points farther away are sampled sparser: the allowed distance between neighbours grows with the range
+static bool adjacent(const sweep_clusterer& clusterer, int32_t lhs, int32_t rhs, int32_t range) {
+  const float dx = clusterer.x[rhs] - clusterer.x[lhs];
+  const float dy = clusterer.y[rhs] - clusterer.y[lhs];
+  const float threshold = clusterer.base_distance + clusterer.range_factor * range;
+
+  return dx * dx + dy * dy <= threshold * threshold;
+}
+
+sweep_clusterer_s sweep_clusterer_construct(sweep_error_s* error) try {
+  SWEEP_ASSERT(error);
+
+  return new sweep_clusterer;
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_clusterer_destruct(sweep_clusterer_s clusterer) {
+  SWEEP_ASSERT(clusterer);
+
+  delete clusterer;
+}
+
+void sweep_clusterer_set_thresholds(sweep_clusterer_s clusterer, float base_distance, float range_factor, int32_t min_samples) {
+  SWEEP_ASSERT(clusterer);
+  SWEEP_ASSERT(base_distance >= 0.0f);
+  SWEEP_ASSERT(range_factor >= 0.0f);
+  SWEEP_ASSERT(min_samples >= 1);
+
+  clusterer->base_distance = base_distance;
+  clusterer->range_factor = range_factor;
+  clusterer->min_samples = min_samples;
+}
+
+int32_t sweep_clusterer_run(sweep_clusterer_s clusterer, sweep_scan_s scan, int32_t* ids) {
+  SWEEP_ASSERT(clusterer);
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(ids);
+
+  const sample* samples = scan->samples;
+  const int32_t count = scan->count;
+
+  sweep_scan_to_cartesian_simple(scan, clusterer->x.data(), clusterer->y.data());
+
+  auto& clusters = clusterer->clusters;
+
+  // Single pass over the angularly sorted returns: each one either continues the previous return's cluster or starts a new one
+  int32_t provisional = 0;
+  int32_t first_return = -1;
+  int32_t previous = -1;
+
+  for (int32_t n = 0; n < count; ++n) {
+    if (samples[n].distance <= 0) {
+      ids[n] = -1;
+      continue;
+    }
+
+    if (previous >= 0 && adjacent(*clusterer, previous, n, samples[previous].distance)) {
+      add_to_cluster(clusters[provisional - 1], clusterer->x[n], clusterer->y[n]);
+    } else {
+      start_cluster(clusters[provisional], clusterer->x[n], clusterer->y[n]);
+      provisional += 1;
+    }
+
+    ids[n] = provisional - 1;
+
+    if (first_return < 0)
+      first_return = n;
+
+    previous = n;
+  }
+
+  // The rotation's last cluster continues its first one across the zero angle
+  const bool wraps = provisional > 1 && adjacent(*clusterer, previous, first_return, samples[previous].distance);
+
+  if (wraps)
+    merge_clusters(clusters[0], clusters[provisional - 1]);
+
+  const int32_t unmerged = wraps ? provisional - 1 : provisional;
+
+  // Drop clusters with too few samples and compact the remaining ones in place, keeping their angular order
+  int32_t kept = 0;
+
+  for (int32_t c = 0; c < unmerged; ++c) {
+    if (clusters[c].count < clusterer->min_samples) {
+      clusterer->relabel[c] = -1;
+      continue;
+    }
+
+    clusters[kept] = clusters[c];
+    clusterer->relabel[c] = kept;
+    kept += 1;
+  }
+
+  if (wraps)
+    clusterer->relabel[provisional - 1] = clusterer->relabel[0];
+
+  for (int32_t n = 0; n < count; ++n)
+    if (ids[n] >= 0)
+      ids[n] = clusterer->relabel[ids[n]];
+
+  clusterer->number_of_clusters = kept;
+  return kept;
+}
+
+int32_t sweep_clusterer_get_number_of_clusters(sweep_clusterer_s clusterer) {
+  SWEEP_ASSERT(clusterer);
+
+  return clusterer->number_of_clusters;
+}
+
+static const scan_cluster& get_cluster(sweep_clusterer_s clusterer, int32_t cluster) {
+  SWEEP_ASSERT(clusterer);
+  SWEEP_ASSERT(cluster >= 0 && cluster < clusterer->number_of_clusters && "cluster index out of bounds");
+
+  return clusterer->clusters[cluster];
+}
+
+void sweep_clusterer_get_cluster(sweep_clusterer_s clusterer, int32_t cluster, float* centroid_x, float* centroid_y,
+                                 int32_t* number_of_samples) {
+  SWEEP_ASSERT(centroid_x && centroid_y && number_of_samples);
+
+  const scan_cluster& c = get_cluster(clusterer, cluster);
+
+  *centroid_x = static_cast<float>(c.sum_x / c.count);
+  *centroid_y = static_cast<float>(c.sum_y / c.count);
+  *number_of_samples = c.count;
+}
+
+void sweep_clusterer_get_cluster_extent(sweep_clusterer_s clusterer, int32_t cluster, float* min_x, float* min_y, float* max_x,
+                                        float* max_y) {
+  SWEEP_ASSERT(min_x && min_y && max_x && max_y);
+
+  const scan_cluster& c = get_cluster(clusterer, cluster);
+
+  *min_x = c.min_x;
+  *min_y = c.min_y;
+  *max_x = c.max_x;
+  *max_y = c.max_y;
+}
@@ -0,0 +1,432 @@
+#include "error.hpp"
+#include "scan.hpp"
+#include "trig.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// Residuals are bit-packed in blocks of this many samples, each block with its own bit width
+#define SWEEP_CODEC_BLOCK 32
+
+// Frame flags: distances and signal strengths are predicted from the previous scan instead of the previous sample,
+// angles are stored as 1/16 degree steps the device reports them in instead of millidegrees
+#define SWEEP_CODEC_FLAG_INTER 0x01
+#define SWEEP_CODEC_FLAG_STEPS 0x02
+#define SWEEP_CODEC_FLAGS (SWEEP_CODEC_FLAG_INTER | SWEEP_CODEC_FLAG_STEPS)
+
+// Residuals of int32 values predicted from up to two others need at most 35 bits zigzag encoded; wider ones would
+// overflow decoding
+#define SWEEP_CODEC_MAX_WIDTH 35
+
+// Frame layout: flags byte, varint number of samples, then angles, flags for samples without a return, distances of
+// samples with a return and signal strengths, each as a sequence of blocks. A block is a byte holding the bit width of its zigzag encoded residuals followed by the residuals packed
+// least significant bit first, padded to a full byte.
+
+struct sweep_scan_encoder {
+  explicit sweep_scan_encoder(int32_t keyframe_interval)
+      : keyframe_interval{keyframe_interval}, residuals(SWEEP_MAX_SAMPLES), previous(SWEEP_MAX_SAMPLES) {}
+
+  int32_t keyframe_interval;
+  int32_t since_keyframe = 0;
+
+  std::vector<uint64_t> residuals;
+
+  // Last scan encoded, for predicting the next one
+  std::vector<sample> previous;
+  int32_t previous_count = -1;
+};
+
+struct sweep_scan_decoder {
+  sweep_scan_decoder() : residuals(SWEEP_MAX_SAMPLES), current(SWEEP_MAX_SAMPLES), previous(SWEEP_MAX_SAMPLES) {}
+
+  std::vector<uint64_t> residuals;
+
+  // Decoded into first so incomplete input leaves the previous scan intact, then swapped
+  std::vector<sample> current;
+
+  std::vector<sample> previous;
+  int32_t previous_count = -1;
+};
+
+static uint64_t zigzag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+
+static int64_t unzigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+static int32_t bit_width(uint64_t value) {
+  int32_t width = 0;
+
+  while (value != 0) {
+    value >>= 1;
+    width += 1;
+  }
+
+  return width;
+}
+
+static void put_varint(uint8_t* out, int32_t& size, uint32_t value) {
+  while (value >= 0x80) {
+    out[size++] = static_cast<uint8_t>(value | 0x80);
+    value >>= 7;
+  }
+
+  out[size++] = static_cast<uint8_t>(value);
+}
+
+// Returns false if the input ends before the varint does
+static bool get_varint(const uint8_t* in, int32_t size, int32_t& offset, uint32_t& value) {
+  value = 0;
+
+  for (int32_t shift = 0; shift < 35; shift += 7) {
+    if (offset == size)
+      return false;
+
+    const uint8_t byte = in[offset++];
+    value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+
+    if ((byte & 0x80) == 0)
+      return true;
+  }
+
+  throw std::runtime_error{"invalid varint in encoded scan"};
+}
+
+static void pack_residuals(const uint64_t* residuals, int32_t count, uint8_t* out, int32_t& size) {
+  for (int32_t first = 0; first < count; first += SWEEP_CODEC_BLOCK) {
+    const int32_t last = std::min(first + SWEEP_CODEC_BLOCK, count);
+
+    uint64_t any = 0;
+    for (int32_t n = first; n < last; ++n)
+      any |= residuals[n];
+
+    const int32_t width = bit_width(any);
+    out[size++] = static_cast<uint8_t>(width);
+
+    // At most 7 bits are pending when a value is added in chunks of at most 32 bits
+    uint64_t bits = 0;
+    int32_t pending = 0;
+
+    for (int32_t n = first; n < last; ++n) {
+      uint64_t value = residuals[n];
+
+      for (int32_t left = width; left > 0;) {
+        const int32_t chunk = std::min(left, 32);
+
+        bits |= (value & ((uint64_t{1} << chunk) - 1)) << pending;
+        pending += chunk;
+        value >>= chunk;
+        left -= chunk;
+
+        while (pending >= 8) {
+          out[size++] = static_cast<uint8_t>(bits);
+          bits >>= 8;
+          pending -= 8;
+        }
+      }
+    }
+
+    if (pending > 0)
+      out[size++] = static_cast<uint8_t>(bits);
+  }
+}
+
+// Returns false if the input ends before the blocks do
+static bool unpack_residuals(const uint8_t* in, int32_t size, int32_t& offset, int32_t count, uint64_t* residuals) {
+  for (int32_t first = 0; first < count; first += SWEEP_CODEC_BLOCK) {
+    const int32_t last = std::min(first + SWEEP_CODEC_BLOCK, count);
+
+    if (offset == size)
+      return false;
+
+    const int32_t width = in[offset++];
+
+    if (width > SWEEP_CODEC_MAX_WIDTH)
+      throw std::runtime_error{"invalid bit width in encoded scan"};
+
+    const int32_t bytes = (width * (last - first) + 7) / 8;
+
+    if (size - offset < bytes)
+      return false;
+
+    uint64_t bits = 0;
+    int32_t pending = 0;
+
+    for (int32_t n = first; n < last; ++n) {
+      uint64_t value = 0;
+
+      for (int32_t done = 0; done < width;) {
+        const int32_t chunk = std::min(width - done, 32);
+
+        while (pending < chunk) {
+          bits |= static_cast<uint64_t>(in[offset++]) << pending;
+          pending += 8;
+        }
+
+        value |= (bits & ((uint64_t{1} << chunk) - 1)) << done;
+        bits >>= chunk;
+        pending -= chunk;
+        done += chunk;
+      }
+
+      residuals[n] = value;
+    }
+  }
+
+  return true;
+}
+
+// Angles advance in near constant increments: predicted by linear extrapolation from the last two
+static int64_t predict_angle(int32_t n, int64_t last, int64_t before_last) {
+  if (n >= 2)
+    return 2 * last - before_last;
+  return n == 1 ? last : 0;
+}
+
+int32_t sweep_scan_encode_bound(int32_t number_of_samples) {
+  SWEEP_ASSERT(number_of_samples >= 0 && number_of_samples <= SWEEP_MAX_SAMPLES);
+
+  const int32_t blocks = (number_of_samples + SWEEP_CODEC_BLOCK - 1) / SWEEP_CODEC_BLOCK;
+  // Per block a width byte and up to a byte of padding
+  return 1 + 5 + 4 * (2 * blocks + (number_of_samples * SWEEP_CODEC_MAX_WIDTH + 7) / 8);
+}
+
+sweep_scan_encoder_s sweep_scan_encoder_construct(int32_t keyframe_interval, sweep_error_s* error) try {
+  SWEEP_ASSERT(keyframe_interval >= 0);
+  SWEEP_ASSERT(error);
+
+  return new sweep_scan_encoder{keyframe_interval};
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_scan_encoder_destruct(sweep_scan_encoder_s encoder) {
+  SWEEP_ASSERT(encoder);
+
+  delete encoder;
+}
+
+void sweep_scan_encoder_reset(sweep_scan_encoder_s encoder) {
+  SWEEP_ASSERT(encoder);
+
+  encoder->previous_count = -1;
+  encoder->since_keyframe = 0;
+}
+
+int32_t sweep_scan_encoder_encode(sweep_scan_encoder_s encoder, sweep_scan_s scan, uint8_t* buffer, int32_t capacity) {
+  SWEEP_ASSERT(encoder);
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(buffer);
+  SWEEP_ASSERT(capacity >= sweep_scan_encode_bound(scan->count));
+  (void)capacity;
+
+  const sample* samples = scan->samples;
+  const int32_t count = scan->count;
+
+  // Predicting from the previous scan pays off for sensors standing still or moving slowly; keyframes bound how many
+  // frames a decoder joining late or losing a frame has to skip
+  const bool inter = encoder->keyframe_interval > 1 && encoder->previous_count == count &&
+                     encoder->since_keyframe + 1 < encoder->keyframe_interval;
+
+  bool steps = true;
+  for (int32_t n = 0; n < count && steps; ++n)
+    steps = samples[n].angle >= 0 && samples[n].angle < 360000 &&
+            sweep::trig::step_to_millideg(sweep::trig::millideg_to_step(samples[n].angle)) == samples[n].angle;
+
+  const uint8_t flags = (inter ? SWEEP_CODEC_FLAG_INTER : 0) | (steps ? SWEEP_CODEC_FLAG_STEPS : 0);
+
+  int32_t size = 0;
+  buffer[size++] = flags;
+  put_varint(buffer, size, static_cast<uint32_t>(count));
+
+  uint64_t* residuals = encoder->residuals.data();
+  const sample* previous = encoder->previous.data();
+
+  int64_t last = 0;
+  int64_t before_last = 0;
+
+  for (int32_t n = 0; n < count; ++n) {
+    const int64_t angle = steps ? sweep::trig::millideg_to_step(samples[n].angle) : samples[n].angle;
+
+    residuals[n] = zigzag(angle - predict_angle(n, last, before_last));
+
+    before_last = last;
+    last = angle;
+  }
+
+  pack_residuals(residuals, count, buffer, size);
+
+  // Samples without a return as one bit each, costing nothing but the width byte in blocks without any
+  for (int32_t n = 0; n < count; ++n)
+    residuals[n] = samples[n].distance == 0 ? 1 : 0;
+
+  pack_residuals(residuals, count, buffer, size);
+
+  int32_t returns = 0;
+  int64_t last_distance = 0;
+
+  for (int32_t n = 0; n < count; ++n) {
+    if (samples[n].distance == 0)
+      continue;
+
+    const int64_t predicted = inter && previous[n].distance > 0 ? previous[n].distance : last_distance;
+    residuals[returns++] = zigzag(samples[n].distance - predicted);
+
+    last_distance = samples[n].distance;
+  }
+
+  pack_residuals(residuals, returns, buffer, size);
+
+  for (int32_t n = 0; n < count; ++n) {
+    const int64_t predicted = inter ? previous[n].signal_strength : n > 0 ? samples[n - 1].signal_strength : 0;
+    residuals[n] = zigzag(samples[n].signal_strength - predicted);
+  }
+
+  pack_residuals(residuals, count, buffer, size);
+
+  std::copy_n(samples, count, encoder->previous.begin());
+  encoder->previous_count = count;
+  encoder->since_keyframe = inter ? encoder->since_keyframe + 1 : 0;
+
+  return size;
+}
+
+sweep_scan_decoder_s sweep_scan_decoder_construct(sweep_error_s* error) try {
+  SWEEP_ASSERT(error);
+
+  return new sweep_scan_decoder;
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_scan_decoder_destruct(sweep_scan_decoder_s decoder) {
+  SWEEP_ASSERT(decoder);
+
+  delete decoder;
+}
+
+void sweep_scan_decoder_reset(sweep_scan_decoder_s decoder) {
+  SWEEP_ASSERT(decoder);
+
+  decoder->previous_count = -1;
+}
+
+int32_t sweep_scan_decoder_decode(sweep_scan_decoder_s decoder, const uint8_t* buffer, int32_t size, sweep_scan_s scan,
+                                  sweep_error_s* error) try {
+  SWEEP_ASSERT(decoder);
+  SWEEP_ASSERT(buffer || size == 0);
+  SWEEP_ASSERT(size >= 0);
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(error);
+
+  int32_t offset = 0;
+
+  if (size == 0)
+    return 0;
+
+  const uint8_t flags = buffer[offset++];
+
+  if ((flags & ~SWEEP_CODEC_FLAGS) != 0)
+    throw std::runtime_error{"invalid flags in encoded scan"};
+
+  uint32_t count = 0;
+
+  if (!get_varint(buffer, size, offset, count))
+    return 0;
+
+  if (count > SWEEP_MAX_SAMPLES)
+    throw std::runtime_error{"too many samples in encoded scan"};
+
+  const bool inter = (flags & SWEEP_CODEC_FLAG_INTER) != 0;
+  const bool steps = (flags & SWEEP_CODEC_FLAG_STEPS) != 0;
+
+  if (inter && decoder->previous_count != static_cast<int32_t>(count))
+    throw std::runtime_error{"encoded scan refers to a previous scan the decoder has not seen"};
+
+  uint64_t* residuals = decoder->residuals.data();
+  sample* current = decoder->current.data();
+  const sample* previous = decoder->previous.data();
+
+  const int32_t samples = static_cast<int32_t>(count);
+
+  if (!unpack_residuals(buffer, size, offset, samples, residuals))
+    return 0;
+
+  int64_t last = 0;
+  int64_t before_last = 0;
+
+  for (int32_t n = 0; n < samples; ++n) {
+    const int64_t angle = predict_angle(n, last, before_last) + unzigzag(residuals[n]);
+    const int64_t limit = steps ? sweep::trig::ANGLE_STEPS : 360000;
+
+    if (angle < 0 || angle >= limit)
+      throw std::runtime_error{"invalid angle in encoded scan"};
+
+    current[n].angle = steps ? sweep::trig::step_to_millideg(static_cast<int32_t>(angle)) : static_cast<int32_t>(angle);
+
+    before_last = last;
+    last = angle;
+  }
+
+  if (!unpack_residuals(buffer, size, offset, samples, residuals))
+    return 0;
+
+  int32_t returns = 0;
+
+  for (int32_t n = 0; n < samples; ++n) {
+    if (residuals[n] > 1)
+      throw std::runtime_error{"invalid return flag in encoded scan"};
+
+    current[n].distance = residuals[n] == 0 ? 1 : 0; // marks samples with a return until their distance is known
+    returns += current[n].distance;
+  }
+
+  if (!unpack_residuals(buffer, size, offset, returns, residuals))
+    return 0;
+
+  int64_t last_distance = 0;
+  int32_t next = 0;
+
+  for (int32_t n = 0; n < samples; ++n) {
+    if (current[n].distance == 0)
+      continue;
+
+    const int64_t predicted = inter && previous[n].distance > 0 ? previous[n].distance : last_distance;
+    const int64_t distance = predicted + unzigzag(residuals[next++]);
+
+    if (distance <= 0 || distance > std::numeric_limits<int32_t>::max())
+      throw std::runtime_error{"invalid distance in encoded scan"};
+
+    current[n].distance = static_cast<int32_t>(distance);
+    last_distance = distance;
+  }
+
+  if (!unpack_residuals(buffer, size, offset, samples, residuals))
+    return 0;
+
+  for (int32_t n = 0; n < samples; ++n) {
+    const int64_t predicted = inter ? previous[n].signal_strength : n > 0 ? current[n - 1].signal_strength : 0;
+    const int64_t signal_strength = predicted + unzigzag(residuals[n]);
+
+    if (signal_strength < 0 || signal_strength > 255)
+      throw std::runtime_error{"invalid signal strength in encoded scan"};
+
+    current[n].signal_strength = static_cast<int32_t>(signal_strength);
+  }
+
+  std::copy_n(current, samples, scan->samples);
+  scan->count = samples;
+
+  std::swap(decoder->current, decoder->previous);
+  decoder->previous_count = samples;
+
+  return offset;
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return -1;
+}
@@ -0,0 +1,211 @@
+#include "error.hpp"
+#include "pool.hpp"
+#include "protocol.hpp"
+#include "serial.hpp"
+
+#include "sweep.h"
+
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Consecutive valid scan packets needed to take a port's traffic for a device streaming scans
+#define SWEEP_DISCOVERY_STREAM_PACKETS 4
+
+struct discovered_device {
+  std::string port;
+  std::string serial_number;
+  int32_t firmware_version;
+  int32_t motor_speed;
+  int32_t sample_rate;
+  bool scanning;
+};
+
+struct sweep_discovery {
+  std::vector<discovered_device> devices;
+};
+
+using probe_clock = std::chrono::steady_clock;
+using serial_owner = std::unique_ptr<sweep::serial::device, decltype(&sweep::serial::device_destruct)>;
+
+// Decimal number from ASCII digits, -1 if there are other characters
+static int32_t ascii_to_integral(const uint8_t* digits, int32_t size) {
+  int32_t value = 0;
+
+  for (int32_t n = 0; n < size; ++n) {
+    if (digits[n] < '0' || digits[n] > '9')
+      return -1;
+
+    value = value * 10 + (digits[n] - '0');
+  }
+
+  return value;
+}
+
+static bool is_streaming(const std::vector<uint8_t>& traffic) {
+  const auto size = static_cast<int32_t>(traffic.size());
+  return sweep::protocol::find_scan_packets(traffic.data(), size, SWEEP_DISCOVERY_STREAM_PACKETS) != -1;
+}
+
+// Sends the command and collects the port's traffic until its response shows up or the deadline passes; the traffic is
+// kept for telling what else is attached to the port
+static bool query(sweep::serial::device_s serial, const uint8_t cmd[2], void* response, int32_t size,
+                  probe_clock::time_point deadline, std::vector<uint8_t>& traffic) {
+  sweep::protocol::write_command(serial, cmd);
+
+  size_t searched = traffic.size();
+
+  for (;;) {
+    for (; searched + size <= traffic.size(); ++searched) {
+      const uint8_t* at = traffic.data() + searched;
+
+      if (at[0] == cmd[0] && at[1] == cmd[1] && at[size - 1] == '\n') {
+        std::memcpy(response, at, size);
+        return true;
+      }
+    }
+
+    const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - probe_clock::now()).count();
+
+    if (remaining <= 0)
+      return false;
+
+    uint8_t chunk[256];
+    const int32_t received = sweep::serial::device_read_some(serial, chunk, sizeof(chunk), static_cast<int32_t>(remaining));
+
+    traffic.insert(traffic.end(), chunk, chunk + received);
+  }
+}
+
+// Asks the port for version and device information, without the stop handshake a full device construction does
+static bool probe(const std::string& port, int32_t timeout, discovered_device& out) try {
+  const auto deadline = probe_clock::now() + std::chrono::milliseconds(timeout);
+
+  const serial_owner serial{sweep::serial::device_construct(port.c_str(), 115200), &sweep::serial::device_destruct};
+
+  out.port = port;
+  out.firmware_version = 0;
+  out.motor_speed = -1;
+  out.sample_rate = -1;
+  out.scanning = false;
+
+  std::vector<uint8_t> traffic;
+
+  sweep::protocol::response_info_version_s version;
+  const bool answered = query(serial.get(), sweep::protocol::VERSION_INFORMATION, &version, sizeof(version), deadline, traffic);
+
+  // A streaming device may not answer, stopping it is up to whoever takes it over
+  if (!answered) {
+    out.scanning = is_streaming(traffic);
+    return out.scanning;
+  }
+
+  const int32_t firmware_major = ascii_to_integral(&version.firmware_major, 1);
+  const int32_t firmware_minor = ascii_to_integral(&version.firmware_minor, 1);
+
+  if (firmware_major < 0 || firmware_minor < 0)
+    return false;
+
+  out.serial_number.assign(version.serial_no, version.serial_no + sizeof(version.serial_no));
+  out.firmware_version = (firmware_major << 16) | firmware_minor;
+
+  sweep::protocol::response_info_device_s info;
+
+  if (query(serial.get(), sweep::protocol::DEVICE_INFORMATION, &info, sizeof(info), deadline, traffic)) {
+    out.motor_speed = ascii_to_integral(info.motor_speed, sizeof(info.motor_speed));
+    out.sample_rate = ascii_to_integral(info.sample_rate, sizeof(info.sample_rate));
+  }
+
+  out.scanning = is_streaming(traffic);
+  return true;
+} catch (const std::exception&) {
+  // Ports failing to open or to configure have no device behind them we could talk to
+  return false;
+}
+
+sweep_discovery_s sweep_discover_devices(const char* const* ports, int32_t count, int32_t timeout, sweep_error_s* error) try {
+  SWEEP_ASSERT(count >= 0);
+  SWEEP_ASSERT(ports || count == 0);
+  SWEEP_ASSERT(timeout > 0);
+  SWEEP_ASSERT(error);
+
+  const auto candidates = count > 0 ? std::vector<std::string>(ports, ports + count) : sweep::serial::enumerate_ports();
+  const auto size = static_cast<int32_t>(candidates.size());
+
+  std::vector<discovered_device> probed(size);
+  std::vector<uint8_t> found(size, 0);
+
+  // Probes mostly wait on the ports, so every port gets a thread of its own
+  if (size > 0) {
+    sweep::pool::pool pool{size};
+    pool.parallel_for(size, [&](int32_t n) { found[n] = probe(candidates[n], timeout, probed[n]); });
+  }
+
+  std::unique_ptr<sweep_discovery> out{new sweep_discovery};
+
+  for (int32_t n = 0; n < size; ++n)
+    if (found[n])
+      out->devices.push_back(std::move(probed[n]));
+
+  return out.release();
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_discovery_destruct(sweep_discovery_s discovery) {
+  SWEEP_ASSERT(discovery);
+
+  delete discovery;
+}
+
+int32_t sweep_discovery_get_number_of_devices(sweep_discovery_s discovery) {
+  SWEEP_ASSERT(discovery);
+
+  return static_cast<int32_t>(discovery->devices.size());
+}
+
+const char* sweep_discovery_get_port(sweep_discovery_s discovery, int32_t index) {
+  SWEEP_ASSERT(discovery);
+  SWEEP_ASSERT(index >= 0 && index < static_cast<int32_t>(discovery->devices.size()));
+
+  return discovery->devices[index].port.c_str();
+}
+
+const char* sweep_discovery_get_serial_number(sweep_discovery_s discovery, int32_t index) {
+  SWEEP_ASSERT(discovery);
+  SWEEP_ASSERT(index >= 0 && index < static_cast<int32_t>(discovery->devices.size()));
+
+  return discovery->devices[index].serial_number.c_str();
+}
+
+int32_t sweep_discovery_get_firmware_version(sweep_discovery_s discovery, int32_t index) {
+  SWEEP_ASSERT(discovery);
+  SWEEP_ASSERT(index >= 0 && index < static_cast<int32_t>(discovery->devices.size()));
+
+  return discovery->devices[index].firmware_version;
+}
+
+int32_t sweep_discovery_get_motor_speed(sweep_discovery_s discovery, int32_t index) {
+  SWEEP_ASSERT(discovery);
+  SWEEP_ASSERT(index >= 0 && index < static_cast<int32_t>(discovery->devices.size()));
+
+  return discovery->devices[index].motor_speed;
+}
+
+int32_t sweep_discovery_get_sample_rate(sweep_discovery_s discovery, int32_t index) {
+  SWEEP_ASSERT(discovery);
+  SWEEP_ASSERT(index >= 0 && index < static_cast<int32_t>(discovery->devices.size()));
+
+  return discovery->devices[index].sample_rate;
+}
+
+bool sweep_discovery_get_scanning(sweep_discovery_s discovery, int32_t index) {
+  SWEEP_ASSERT(discovery);
+  SWEEP_ASSERT(index >= 0 && index < static_cast<int32_t>(discovery->devices.size()));
+
+  return discovery->devices[index].scanning;
+}
@@ -0,0 +1,141 @@
+#include "distance.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Columns are processed in strips this wide so the inner loop runs over contiguous memory
+#define SWEEP_DISTANCE_STRIP_WIDTH 256
+
+// Rows are split into this many blocks at most, each with its own envelope buffers
+#define SWEEP_DISTANCE_MAX_BLOCKS 64
+
+namespace sweep {
+namespace distance {
+
+static int32_t number_of_blocks(int32_t height) { return std::min(height, SWEEP_DISTANCE_MAX_BLOCKS); }
+
+transform::transform(int32_t width, int32_t height)
+    : width{width}, height{height}, columns(static_cast<size_t>(width) * height),
+      parabolas(static_cast<size_t>(number_of_blocks(height)) * width),
+      boundaries(static_cast<size_t>(number_of_blocks(height)) * (width + 1)) {}
+
+// Forward and backward scan along the columns in [first, last); rows are visited in order, columns innermost
+static void transform_columns(transform& transform, const uint8_t* seeds, int32_t first, int32_t last) {
+  const int32_t width = transform.width;
+  const int32_t height = transform.height;
+  const int32_t none = width + height; // further than any seed can be
+
+  int32_t* columns = transform.columns.data();
+
+  for (int32_t x = first; x < last; ++x)
+    columns[x] = seeds[x] ? 0 : none;
+
+  for (int32_t y = 1; y < height; ++y) {
+    const uint8_t* seed = seeds + static_cast<size_t>(y) * width;
+    const int32_t* above = columns + static_cast<size_t>(y - 1) * width;
+    int32_t* row = columns + static_cast<size_t>(y) * width;
+
+    for (int32_t x = first; x < last; ++x)
+      row[x] = seed[x] ? 0 : std::min(above[x] + 1, none);
+  }
+
+  for (int32_t y = height - 2; y >= 0; --y) {
+    const int32_t* below = columns + static_cast<size_t>(y + 1) * width;
+    int32_t* row = columns + static_cast<size_t>(y) * width;
+
+    for (int32_t x = first; x < last; ++x)
+      row[x] = std::min(row[x], below[x] + 1);
+  }
+}
+
+// One dimensional transform of a row given the squared column distances f: d(x) = min_q (x - q)^2 + f(q).
+// Only parabolas of finite f enter the lower envelope. Squared distances are passed through store on their way out.
+template <typename Store>
+static void transform_row(const int32_t* columns, int32_t width, int32_t none, int32_t* parabolas, float* boundaries,
+                          float* distance, Store store) {
+  const float infinity = std::numeric_limits<float>::infinity();
+
+  const auto f = [columns](int32_t q) { return static_cast<float>(columns[q]) * columns[q]; };
+
+  int32_t k = -1;
+
+  for (int32_t q = 0; q < width; ++q) {
+    if (columns[q] >= none)
+      continue;
+
+    const float fq = f(q) + static_cast<float>(q) * q;
+
+    float s = -infinity;
+
+    while (k >= 0) {
+      const int32_t v = parabolas[k];
+      s = (fq - (f(v) + static_cast<float>(v) * v)) / (2.0f * (q - v));
+
+      if (s > boundaries[k])
+        break;
+
+      k -= 1;
+    }
+
+    k += 1;
+    parabolas[k] = q;
+    boundaries[k] = k == 0 ? -infinity : s;
+    boundaries[k + 1] = infinity;
+  }
+
+  if (k < 0) {
+    std::fill(distance, distance + width, infinity);
+    return;
+  }
+
+  int32_t j = 0;
+
+  for (int32_t x = 0; x < width; ++x) {
+    while (boundaries[j + 1] < x)
+      j += 1;
+
+    const float dx = static_cast<float>(x - parabolas[j]);
+    distance[x] = store(dx * dx + f(parabolas[j]));
+  }
+}
+
+template <typename Store>
+static void transform_grid(transform& transform, const uint8_t* seeds, float* distance, pool::pool& pool, Store store) {
+  const int32_t width = transform.width;
+  const int32_t height = transform.height;
+  const int32_t none = width + height;
+
+  const int32_t strips = (width + SWEEP_DISTANCE_STRIP_WIDTH - 1) / SWEEP_DISTANCE_STRIP_WIDTH;
+
+  pool.parallel_for(strips, [&transform, seeds, width](int32_t strip) {
+    const int32_t first = strip * SWEEP_DISTANCE_STRIP_WIDTH;
+    transform_columns(transform, seeds, first, std::min(first + SWEEP_DISTANCE_STRIP_WIDTH, width));
+  });
+
+  const int32_t blocks = number_of_blocks(height);
+
+  pool.parallel_for(blocks, [&transform, distance, width, height, none, blocks, store](int32_t block) {
+    int32_t* parabolas = transform.parabolas.data() + static_cast<size_t>(block) * width;
+    float* boundaries = transform.boundaries.data() + static_cast<size_t>(block) * (width + 1);
+
+    const int32_t first = static_cast<int32_t>(static_cast<int64_t>(height) * block / blocks);
+    const int32_t last = static_cast<int32_t>(static_cast<int64_t>(height) * (block + 1) / blocks);
+
+    for (int32_t y = first; y < last; ++y) {
+      const size_t offset = static_cast<size_t>(y) * width;
+      transform_row(transform.columns.data() + offset, width, none, parabolas, boundaries, distance + offset, store);
+    }
+  });
+}
+
+void squared(transform& transform, const uint8_t* seeds, float* distance, pool::pool& pool) {
+  transform_grid(transform, seeds, distance, pool, [](float squared) { return squared; });
+}
+
+void euclidean(transform& transform, const uint8_t* seeds, float* distance, float scale, pool::pool& pool) {
+  transform_grid(transform, seeds, distance, pool, [scale](float squared) { return std::sqrt(squared) * scale; });
+}
+
+} // ns distance
+} // ns sweep
@@ -1,38 +1,83 @@
+#include "device.hpp"
+#include "error.hpp"
+#include "scan.hpp"
+
 #include "sweep.h"
 
+#include <atomic>
 #include <chrono>
+#include <memory>
 #include <string>
 #include <thread>
 
 int32_t sweep_get_version(void) { return SWEEP_VERSION; }
 bool sweep_is_abi_compatible(void) { return sweep_get_version() >> 16u == SWEEP_VERSION_MAJOR; }
 
-struct sweep_error {
-  std::string what;
-};
-
 struct sweep_device {
   bool is_scanning;
   int32_t motor_speed;
   int32_t sample_rate;
   int32_t nth_scan_request;
-};
+  sweep_zone_monitor_s zone_monitor;
+  int64_t packets;
 
-struct sweep_scan {
-  int32_t count;
-  int32_t nth;
+  // Only a sink gets its scans from a background thread, sweep_device_get_scan makes them on request
+  sweep::device::sink sink;
+  std::atomic<bool> stop_thread;
+  std::thread worker;
 };
 
-const char* sweep_error_message(sweep_error_s error) {
-  SWEEP_ASSERT(error);
+// Four clusters of four samples each at 0, 90, 180 and 270 degrees, slowly rotating with every scan
+static sample make_sample(int32_t n, int32_t nth) {
+  int32_t angle = 360;
+  int32_t delta = (n % 4) * 2 + nth;
 
-  return error->what.c_str();
+  switch (n / 4) {
+  case 0:
+    angle = 0;
+    break;
+  case 1:
+    angle = 90;
+    break;
+  case 2:
+    angle = 180;
+    break;
+  case 3:
+    angle = 270;
+    break;
+  }
+
+  sample ret;
+  ret.angle = ((angle + delta) % 360) * 1000;
+  ret.distance = 2 * 100; // 2 meter
+  ret.signal_strength = 200;
+  return ret;
 }
 
-void sweep_error_destruct(sweep_error_s error) {
-  SWEEP_ASSERT(error);
+// The next scan, taking as long as a rotation
+static std::unique_ptr<sweep_scan> sweep_device_make_scan(sweep_device_s device) {
+  std::unique_ptr<sweep_scan> out{new sweep_scan};
+  out->count = device->is_scanning ? 16 : 0;
 
-  delete error;
+  for (int32_t n = 0; n < out->count; ++n) {
+    out->samples[n] = make_sample(n, device->nth_scan_request);
+
+    if (device->zone_monitor)
+      sweep_zone_monitor_check(device->zone_monitor, out->samples[n].angle, out->samples[n].distance);
+  }
+
+  device->nth_scan_request += 1;
+  device->packets += out->count;
+
+  // Artificially introduce slowdown, to simulate device rotation
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  return out;
+}
+
+static void sweep_device_feed_sink(sweep_device_s device) {
+  while (!device->stop_thread)
+    device->sink(sweep_device_make_scan(device), nullptr);
 }
 
 static void sweep_device_wait_until_motor_ready(sweep_device_s device, sweep_error_s* error) {
@@ -54,6 +99,7 @@ static void sweep_device_attempt_start_scanning(sweep_device_s device, sweep_err
     return;
 
   device->is_scanning = true;
+  device->packets = 0;
 }
 
 static void sweep_device_attempt_set_motor_speed(sweep_device_s device, int32_t hz, sweep_error_s* error) {
@@ -80,13 +126,24 @@ sweep_device_s sweep_device_construct(const char* port, int32_t bitrate, sweep_e
   (void)bitrate;
   (void)error;
 
-  auto out = new sweep_device{/*is_scanning=*/false, /*motor_speed=*/5, /*sample_rate*/ 500, /*nth_scan_request=*/0};
+  auto out = new sweep_device{/*is_scanning=*/false, /*motor_speed=*/5, /*sample_rate*/ 500, /*nth_scan_request=*/0,
+                              /*zone_monitor=*/nullptr, /*packets=*/0,
+                              /*sink=*/{},           /*stop_thread=*/{false}, /*worker=*/{}};
   return out;
 }
 
+sweep_device_s sweep_device_construct_warm(const char* port, int32_t bitrate, sweep_error_s* error) {
+  SWEEP_ASSERT(error);
+
+  return sweep_device_construct(port, bitrate, error);
+}
+
 void sweep_device_destruct(sweep_device_s device) {
   SWEEP_ASSERT(device);
 
+  sweep_error_s ignore = nullptr;
+  sweep_device_stop_scanning(device, &ignore);
+
   delete device;
 }
 
@@ -100,6 +157,12 @@ void sweep_device_start_scanning(sweep_device_s device, sweep_error_s* error) {
     return;
 
   device->is_scanning = true;
+  device->packets = 0;
+
+  if (device->sink) {
+    device->stop_thread = false;
+    device->worker = std::thread(sweep_device_feed_sink, device);
+  }
 }
 
 void sweep_device_stop_scanning(sweep_device_s device, sweep_error_s* error) {
@@ -107,23 +170,45 @@ void sweep_device_stop_scanning(sweep_device_s device, sweep_error_s* error) {
   SWEEP_ASSERT(error);
   (void)error;
 
+  device->stop_thread = true;
+
+  if (device->worker.joinable())
+    device->worker.join();
+
   device->is_scanning = false;
 }
 
+bool sweep_device_get_scanning(sweep_device_s device) {
+  SWEEP_ASSERT(device);
+
+  return device->is_scanning;
+}
+
 sweep_scan_s sweep_device_get_scan(sweep_device_s device, sweep_error_s* error) {
   SWEEP_ASSERT(device);
   SWEEP_ASSERT(error);
   SWEEP_ASSERT(device->is_scanning);
+  SWEEP_ASSERT(!device->sink);
   (void)error;
 
-  auto out = new sweep_scan{/*count=*/device->is_scanning ? 16 : 0, /*nth=*/device->nth_scan_request};
+  return sweep_device_make_scan(device).release();
+}
 
-  device->nth_scan_request += 1;
+sweep_scan_s sweep_device_get_scan_timeout(sweep_device_s device, int32_t timeout, sweep_error_s* error) {
+  SWEEP_ASSERT(device);
+  SWEEP_ASSERT(timeout >= 0);
+  SWEEP_ASSERT(error);
+  SWEEP_ASSERT(device->is_scanning);
+  SWEEP_ASSERT(!device->sink);
+  (void)error;
 
-  // Artificially introduce slowdown, to simulate device rotation
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  // Scans take 100 ms each
+  if (timeout < 100) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+    return nullptr;
+  }
 
-  return out;
+  return sweep_device_make_scan(device).release();
 }
 
 bool sweep_device_get_motor_ready(sweep_device_s device, sweep_error_s* error) {
@@ -175,59 +260,22 @@ void sweep_device_set_sample_rate(sweep_device_s device, int32_t hz, sweep_error
   device->sample_rate = hz;
 }
 
-int32_t sweep_scan_get_number_of_samples(sweep_scan_s scan) {
-  SWEEP_ASSERT(scan);
-
-  return scan->count;
-}
-
-int32_t sweep_scan_get_angle(sweep_scan_s scan, int32_t sample) {
-  SWEEP_ASSERT(scan);
-  SWEEP_ASSERT(sample >= 0 && sample < scan->count && "sample index out of bounds");
-
-  int32_t angle = 360;
-  int32_t delta = (sample % 4) * 2 + scan->nth;
-
-  switch (sample / 4) {
-  case 0:
-    angle = 0;
-    break;
-  case 1:
-    angle = 90;
-    break;
-  case 2:
-    angle = 180;
-    break;
-  case 3:
-    angle = 270;
-    break;
-  }
-
-  return ((angle + delta) % 360) * 1000;
-}
-
-int32_t sweep_scan_get_distance(sweep_scan_s scan, int32_t sample) {
-  SWEEP_ASSERT(scan);
-  SWEEP_ASSERT(sample >= 0 && sample < scan->count && "sample index out of bounds");
-  (void)scan;
-  (void)sample;
-
-  return 2 * 100; // 2 meter
-}
-
-int32_t sweep_scan_get_signal_strength(sweep_scan_s scan, int32_t sample) {
-  SWEEP_ASSERT(scan);
-  SWEEP_ASSERT(sample >= 0 && sample < scan->count && "sample index out of bounds");
-  (void)scan;
-  (void)sample;
+// One packet per sample, none of them corrupted
+void sweep_device_get_packet_counts(sweep_device_s device, int64_t* packets, int64_t* error_packets, int64_t* checksum_failures) {
+  SWEEP_ASSERT(device);
+  SWEEP_ASSERT(packets);
+  SWEEP_ASSERT(error_packets);
+  SWEEP_ASSERT(checksum_failures);
 
-  return 200;
+  *packets = device->packets;
+  *error_packets = 0;
+  *checksum_failures = 0;
 }
 
-void sweep_scan_destruct(sweep_scan_s scan) {
-  SWEEP_ASSERT(scan);
+void sweep_device_set_zone_monitor(sweep_device_s device, sweep_zone_monitor_s monitor) {
+  SWEEP_ASSERT(device);
 
-  delete scan;
+  device->zone_monitor = monitor;
 }
 
 void sweep_device_reset(sweep_device_s device, sweep_error_s* error) {
@@ -237,3 +285,16 @@ void sweep_device_reset(sweep_device_s device, sweep_error_s* error) {
   (void)device;
   (void)error;
 }
+
+namespace sweep {
+namespace device {
+
+void set_sink(sweep_device_s device, sink fn) {
+  SWEEP_ASSERT(device);
+  SWEEP_ASSERT(!device->is_scanning);
+
+  device->sink = std::move(fn);
+}
+
+} // ns device
+} // ns sweep
@@ -0,0 +1,22 @@
+#include "error.hpp"
+
+#include "sweep.h"
+
+sweep_error_s sweep_error_construct(const char* what) {
+  SWEEP_ASSERT(what);
+
+  auto out = new sweep_error{what};
+  return out;
+}
+
+const char* sweep_error_message(sweep_error_s error) {
+  SWEEP_ASSERT(error);
+
+  return error->what.c_str();
+}
+
+void sweep_error_destruct(sweep_error_s error) {
+  SWEEP_ASSERT(error);
+
+  delete error;
+}
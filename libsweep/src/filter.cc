@@ -0,0 +1,211 @@
+#include "error.hpp"
+#include "scan.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct filter_stage {
+  enum kind { range_gate, signal_threshold, median, speckle_removal };
+
+  kind type;
+  int32_t first;
+  int32_t second;
+};
+
+struct sweep_filter {
+  std::vector<filter_stage> stages;
+};
+
+// All stages work in place and in a single pass, making use of the samples' angular order.
+// Stages removing samples compact the scan, keeping the remaining samples in order.
+// A scan is a full rotation, so neighbourhoods wrap around: the last sample neighbours the first.
+
+static void apply_range_gate(sweep_scan& scan, int32_t min_distance, int32_t max_distance) {
+  int32_t kept = 0;
+
+  for (int32_t n = 0; n < scan.count; ++n) {
+    const sample s = scan.samples[n];
+    scan.samples[kept] = s;
+    kept += s.distance >= min_distance && s.distance <= max_distance;
+  }
+
+  scan.count = kept;
+}
+
+static void apply_signal_threshold(sweep_scan& scan, int32_t min_signal_strength) {
+  int32_t kept = 0;
+
+  for (int32_t n = 0; n < scan.count; ++n) {
+    const sample s = scan.samples[n];
+    scan.samples[kept] = s;
+    kept += s.signal_strength >= min_signal_strength;
+  }
+
+  scan.count = kept;
+}
+
+// Replaces each distance with the median over its angular neighbours [n - radius, n + radius].
+// Samples without a return (zero distance) neither take part nor get replaced.
+static void apply_median(sweep_scan& scan, int32_t radius) {
+  const int32_t count = scan.count;
+
+  // Scans too short to wrap without a sample showing up twice in a window are clamped at their ends instead
+  const bool wrap = count > 2 * radius;
+
+  // history[k] holds the original distance of sample n - 1 - k, already overwritten in the scan;
+  // head[k] the original distance of sample k, for the windows wrapping around past the end
+  int32_t history[SWEEP_FILTER_MAX_MEDIAN_RADIUS];
+  int32_t head[SWEEP_FILTER_MAX_MEDIAN_RADIUS];
+  int32_t window[2 * SWEEP_FILTER_MAX_MEDIAN_RADIUS + 1];
+
+  for (int32_t k = 0; k < std::min(radius, count); ++k)
+    head[k] = scan.samples[k].distance;
+
+  for (int32_t n = 0; n < count; ++n) {
+    const int32_t original = scan.samples[n].distance;
+
+    int32_t size = 0;
+
+    for (int32_t k = 0; k < std::min(radius, n); ++k)
+      if (history[k] > 0)
+        window[size++] = history[k];
+
+    // Samples at the end are not overwritten yet while the window wraps around to them
+    if (wrap)
+      for (int32_t k = count + n - radius; k < count; ++k)
+        if (scan.samples[k].distance > 0)
+          window[size++] = scan.samples[k].distance;
+
+    for (int32_t k = n; k <= std::min(n + radius, count - 1); ++k)
+      if (scan.samples[k].distance > 0)
+        window[size++] = scan.samples[k].distance;
+
+    if (wrap)
+      for (int32_t k = 0; k < n + radius - (count - 1); ++k)
+        if (head[k] > 0)
+          window[size++] = head[k];
+
+    for (int32_t k = radius - 1; k > 0; --k)
+      history[k] = history[k - 1];
+    history[0] = original;
+
+    if (original > 0) {
+      const auto median = window + (size - 1) / 2;
+      std::nth_element(window, median, window + size);
+      scan.samples[n].distance = *median;
+    }
+  }
+}
+
+// Removes samples whose distance differs by more than max_jump from both angular neighbours
+static void apply_speckle_removal(sweep_scan& scan, int32_t max_jump) {
+  const auto close = [max_jump](int32_t lhs, int32_t rhs) { return lhs > 0 && rhs > 0 && std::abs(lhs - rhs) <= max_jump; };
+
+  const int32_t count = scan.count;
+
+  // With fewer samples the first and last ones would be each other's only neighbours on both sides
+  const bool wrap = count >= 3;
+  const int32_t first = count > 0 ? scan.samples[0].distance : 0; // compacting may overwrite the first sample
+
+  int32_t kept = 0;
+  int32_t previous = wrap ? scan.samples[count - 1].distance : 0; // original distance of the previous sample
+
+  for (int32_t n = 0; n < count; ++n) {
+    const sample s = scan.samples[n];
+    const int32_t next = n + 1 < count ? scan.samples[n + 1].distance : (wrap ? first : 0);
+
+    scan.samples[kept] = s;
+    kept += close(s.distance, previous) || close(s.distance, next);
+
+    previous = s.distance;
+  }
+
+  scan.count = kept;
+}
+
+sweep_filter_s sweep_filter_construct(sweep_error_s* error) try {
+  SWEEP_ASSERT(error);
+
+  return new sweep_filter{};
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_filter_destruct(sweep_filter_s filter) {
+  SWEEP_ASSERT(filter);
+
+  delete filter;
+}
+
+void sweep_filter_add_range_gate(sweep_filter_s filter, int32_t min_distance, int32_t max_distance, sweep_error_s* error) try {
+  SWEEP_ASSERT(filter);
+  SWEEP_ASSERT(min_distance >= 0 && min_distance <= max_distance);
+  SWEEP_ASSERT(error);
+
+  filter->stages.push_back({filter_stage::range_gate, min_distance, max_distance});
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+}
+
+void sweep_filter_add_signal_threshold(sweep_filter_s filter, int32_t min_signal_strength, sweep_error_s* error) try {
+  SWEEP_ASSERT(filter);
+  SWEEP_ASSERT(min_signal_strength >= 0 && min_signal_strength <= 255);
+  SWEEP_ASSERT(error);
+
+  filter->stages.push_back({filter_stage::signal_threshold, min_signal_strength, 0});
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+}
+
+void sweep_filter_add_median(sweep_filter_s filter, int32_t radius, sweep_error_s* error) try {
+  SWEEP_ASSERT(filter);
+  SWEEP_ASSERT(radius > 0);
+  SWEEP_ASSERT(error);
+
+  // Bounds the window kept on the stack while filtering
+  if (radius > SWEEP_FILTER_MAX_MEDIAN_RADIUS)
+    throw std::runtime_error{"median radius above " + std::to_string(SWEEP_FILTER_MAX_MEDIAN_RADIUS)};
+
+  filter->stages.push_back({filter_stage::median, radius, 0});
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+}
+
+void sweep_filter_add_speckle_removal(sweep_filter_s filter, int32_t max_jump, sweep_error_s* error) try {
+  SWEEP_ASSERT(filter);
+  SWEEP_ASSERT(max_jump >= 0);
+  SWEEP_ASSERT(error);
+
+  filter->stages.push_back({filter_stage::speckle_removal, max_jump, 0});
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+}
+
+void sweep_filter_apply(sweep_filter_s filter, sweep_scan_s scan) {
+  SWEEP_ASSERT(filter);
+  SWEEP_ASSERT(scan);
+
+  for (const auto& stage : filter->stages) {
+    switch (stage.type) {
+    case filter_stage::range_gate:
+      apply_range_gate(*scan, stage.first, stage.second);
+      break;
+    case filter_stage::signal_threshold:
+      apply_signal_threshold(*scan, stage.first);
+      break;
+    case filter_stage::median:
+      apply_median(*scan, stage.first);
+      break;
+    case filter_stage::speckle_removal:
+      apply_speckle_removal(*scan, stage.first);
+      break;
+    }
+  }
+}
@@ -0,0 +1,212 @@
+#include "device.hpp"
+#include "error.hpp"
+#include "pool.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Scans waiting for the caller, per device; beyond, the oldest get dropped so acquisition never waits on the caller
+#define SWEEP_FLEET_QUEUE_PER_DEVICE 16
+
+struct fleet_item {
+  int32_t device;
+  sweep_scan_s scan; // null if the device failed
+  std::string error;
+};
+
+struct sweep_fleet {
+  std::vector<std::string> ports;
+  std::vector<sweep_device_s> devices;
+
+  // Filled by the devices' background threads, drained by the caller waiting on any device
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<fleet_item> items;
+  int64_t dropped;
+  bool stop;
+};
+
+// Takes a scan or failure from a device's background thread into the shared queue, unless the fleet stops
+static void fleet_receive(sweep_fleet_s fleet, int32_t index, std::unique_ptr<sweep_scan> scan, std::exception_ptr error) {
+  const size_t capacity = SWEEP_FLEET_QUEUE_PER_DEVICE * fleet->devices.size();
+
+  fleet_item item{index, nullptr, {}};
+
+  if (error) {
+    try {
+      std::rethrow_exception(error);
+    } catch (const std::exception& e) {
+      item.error = e.what();
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{fleet->mutex};
+
+    if (fleet->stop)
+      return;
+
+    // Failures are kept, every device reports at most one
+    if (fleet->items.size() >= capacity) {
+      const auto oldest =
+          std::find_if(fleet->items.begin(), fleet->items.end(), [](const fleet_item& queued) { return queued.scan; });
+
+      sweep_scan_destruct(oldest->scan);
+      fleet->items.erase(oldest);
+      fleet->dropped += 1;
+    }
+
+    item.scan = scan.release();
+    fleet->items.push_back(std::move(item));
+  }
+
+  fleet->ready.notify_one();
+}
+
+// Opens, configures and starts one device; returns why it failed, empty on success
+static std::string fleet_bring_up(sweep_fleet_s fleet, int32_t index, int32_t motor_speed, int32_t sample_rate) {
+  sweep_error_s error = nullptr;
+
+  // Construction hands out the device even if stopping a running stream failed
+  sweep_device_s device = sweep_device_construct_simple(fleet->ports[index].c_str(), &error);
+
+  if (!error && motor_speed > 0)
+    sweep_device_set_motor_speed(device, motor_speed, &error);
+
+  if (!error && sample_rate > 0)
+    sweep_device_set_sample_rate(device, sample_rate, &error);
+
+  if (!error) {
+    sweep::device::set_sink(device, [fleet, index](std::unique_ptr<sweep_scan> scan, std::exception_ptr failure) {
+      fleet_receive(fleet, index, std::move(scan), failure);
+    });
+
+    sweep_device_start_scanning(device, &error);
+  }
+
+  if (error) {
+    const std::string what = sweep_error_message(error);
+    sweep_error_destruct(error);
+
+    if (device)
+      sweep_device_destruct(device);
+
+    return what;
+  }
+
+  fleet->devices[index] = device;
+  return {};
+}
+
+// Bring-up and teardown mostly wait on the devices, so every device gets a thread of its own
+static void fleet_for_each_device(int32_t count, std::function<void(int32_t)> fn) {
+  sweep::pool::pool pool{count};
+  pool.parallel_for(count, std::move(fn));
+}
+
+sweep_fleet_s sweep_fleet_construct(const char* const* ports, int32_t count, int32_t motor_speed, int32_t sample_rate,
+                                    sweep_error_s* error) try {
+  SWEEP_ASSERT(ports);
+  SWEEP_ASSERT(count > 0);
+  SWEEP_ASSERT(motor_speed >= 0 && motor_speed <= 10);
+  SWEEP_ASSERT(sample_rate == 0 || sample_rate == 500 || sample_rate == 750 || sample_rate == 1000);
+  SWEEP_ASSERT(error);
+
+  std::unique_ptr<sweep_fleet> fleet{new sweep_fleet};
+  fleet->ports.assign(ports, ports + count);
+  fleet->devices.assign(count, nullptr);
+  fleet->dropped = 0;
+  fleet->stop = false;
+
+  std::vector<std::string> failures(count);
+
+  fleet_for_each_device(count, [&](int32_t n) { failures[n] = fleet_bring_up(fleet.get(), n, motor_speed, sample_rate); });
+
+  std::string failed;
+
+  for (int32_t n = 0; n < count; ++n)
+    if (!failures[n].empty())
+      failed += (failed.empty() ? "" : "; ") + fleet->ports[n] + ": " + failures[n];
+
+  if (!failed.empty()) {
+    fleet_for_each_device(count, [&](int32_t n) {
+      if (fleet->devices[n])
+        sweep_device_destruct(fleet->devices[n]);
+    });
+
+    throw std::runtime_error{failed};
+  }
+
+  return fleet.release();
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_fleet_destruct(sweep_fleet_s fleet) {
+  SWEEP_ASSERT(fleet);
+
+  {
+    std::lock_guard<std::mutex> lock{fleet->mutex};
+    fleet->stop = true;
+  }
+
+  // Background threads notice within a poll interval, scans still arriving are dropped
+  fleet_for_each_device(static_cast<int32_t>(fleet->devices.size()),
+                        [fleet](int32_t n) { sweep_device_destruct(fleet->devices[n]); });
+
+  for (const auto& item : fleet->items)
+    if (item.scan)
+      sweep_scan_destruct(item.scan);
+
+  delete fleet;
+}
+
+int32_t sweep_fleet_get_number_of_devices(sweep_fleet_s fleet) {
+  SWEEP_ASSERT(fleet);
+
+  return static_cast<int32_t>(fleet->devices.size());
+}
+
+sweep_scan_s sweep_fleet_get_scan(sweep_fleet_s fleet, int32_t timeout, int32_t* device, sweep_error_s* error) try {
+  SWEEP_ASSERT(fleet);
+  SWEEP_ASSERT(timeout >= 0);
+  SWEEP_ASSERT(device);
+  SWEEP_ASSERT(error);
+
+  std::unique_lock<std::mutex> lock{fleet->mutex};
+
+  if (!fleet->ready.wait_for(lock, std::chrono::milliseconds(timeout), [fleet] { return !fleet->items.empty(); }))
+    return nullptr;
+
+  const fleet_item item = std::move(fleet->items.front());
+  fleet->items.pop_front();
+
+  *device = item.device;
+
+  if (!item.scan)
+    throw std::runtime_error{fleet->ports[item.device] + ": " + item.error};
+
+  return item.scan;
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+int64_t sweep_fleet_get_dropped(sweep_fleet_s fleet) {
+  SWEEP_ASSERT(fleet);
+
+  std::lock_guard<std::mutex> lock{fleet->mutex};
+  return fleet->dropped;
+}
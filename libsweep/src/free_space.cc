@@ -0,0 +1,216 @@
+#include "error.hpp"
+#include "scan.hpp"
+#include "trig.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <vector>
+
+// Boundary points come from samples or from bins, whichever is more; bins never exceed the device's angle steps
+#define SWEEP_FREE_SPACE_MAX_POINTS (SWEEP_MAX_SAMPLES > sweep::trig::ANGLE_STEPS ? SWEEP_MAX_SAMPLES : sweep::trig::ANGLE_STEPS)
+
+struct sweep_free_space {
+  sweep_free_space()
+      : bin_distance(SWEEP_FREE_SPACE_MAX_POINTS), bin_cos(SWEEP_FREE_SPACE_MAX_POINTS), bin_sin(SWEEP_FREE_SPACE_MAX_POINTS),
+        x(SWEEP_FREE_SPACE_MAX_POINTS), y(SWEEP_FREE_SPACE_MAX_POINTS),
+        keep(SWEEP_FREE_SPACE_MAX_POINTS), stack(2 * SWEEP_FREE_SPACE_MAX_POINTS) {}
+
+  float max_range = 4000.0f; // in cm; samples without a return or further away are clamped to it
+  int32_t bins = 360;        // zero uses the samples directly
+  float tolerance = 5.0f;    // in cm; zero disables simplification
+
+  // Working buffers, sized once for the largest possible boundary; bin directions are computed when bins change
+  std::vector<float> bin_distance;
+  std::vector<float> bin_cos;
+  std::vector<float> bin_sin;
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<uint8_t> keep;
+  std::vector<int32_t> stack;
+};
+
+static void compute_bin_directions(sweep_free_space& space) {
+  for (int32_t bin = 0; bin < space.bins; ++bin) {
+    const double radian = (bin + 0.5) * 6.283185307179586 / space.bins;
+
+    space.bin_cos[bin] = static_cast<float>(std::cos(radian));
+    space.bin_sin[bin] = static_cast<float>(std::sin(radian));
+  }
+}
+
+static float clamp_range(int32_t distance, float max_range) {
+  return distance <= 0 ? max_range : std::min(static_cast<float>(distance), max_range);
+}
+
+// Boundary from the samples themselves, in angular order
+static int32_t boundary_from_samples(sweep_free_space& space, const sweep_scan& scan) {
+  const auto& table = sweep::trig::lookup();
+
+  for (int32_t n = 0; n < scan.count; ++n) {
+    const int32_t step = sweep::trig::millideg_to_step(scan.samples[n].angle);
+    const float range = clamp_range(scan.samples[n].distance, space.max_range);
+
+    space.x[n] = table.cos[step] * range;
+    space.y[n] = table.sin[step] * range;
+  }
+
+  return scan.count;
+}
+
+// Boundary with one point per angular bin at the bin's center, the nearest sample in the bin keeping the free space
+// conservative; bins without samples lie at max range like samples without a return
+static int32_t boundary_from_bins(sweep_free_space& space, const sweep_scan& scan) {
+  const int32_t bins = space.bins;
+
+  std::fill_n(space.bin_distance.begin(), bins, space.max_range);
+
+  for (int32_t n = 0; n < scan.count; ++n) {
+    const int32_t bin = static_cast<int32_t>(static_cast<int64_t>(scan.samples[n].angle) * bins / 360000);
+    space.bin_distance[bin] = std::min(space.bin_distance[bin], clamp_range(scan.samples[n].distance, space.max_range));
+  }
+
+  for (int32_t bin = 0; bin < bins; ++bin) {
+    space.x[bin] = space.bin_cos[bin] * space.bin_distance[bin];
+    space.y[bin] = space.bin_sin[bin] * space.bin_distance[bin];
+  }
+
+  return bins;
+}
+
+// Douglas-Peucker on the chain from first to last, inclusive, with an explicit stack; indices wrap around count
+static void simplify_chain(sweep_free_space& space, int32_t count, int32_t first, int32_t last) {
+  const float tolerance_squared = space.tolerance * space.tolerance;
+
+  int32_t top = 0;
+  space.stack[top++] = first;
+  space.stack[top++] = last;
+
+  while (top > 0) {
+    const int32_t to = space.stack[--top];
+    const int32_t from = space.stack[--top];
+
+    const int32_t a = from % count;
+    const int32_t b = to % count;
+
+    const float dx = space.x[b] - space.x[a];
+    const float dy = space.y[b] - space.y[a];
+    const float length_squared = dx * dx + dy * dy;
+
+    // Squared distance to the segment's line scaled by its squared length, avoiding a division per point
+    float worst = 0.0f;
+    int32_t worst_index = -1;
+
+    for (int32_t n = from + 1; n < to; ++n) {
+      const int32_t i = n % count;
+      const float px = space.x[i] - space.x[a];
+      const float py = space.y[i] - space.y[a];
+
+      const float cross = dx * py - dy * px;
+      const float deviation = length_squared > 0.0f ? cross * cross : (px * px + py * py);
+
+      if (deviation > worst) {
+        worst = deviation;
+        worst_index = n;
+      }
+    }
+
+    const float limit = length_squared > 0.0f ? tolerance_squared * length_squared : tolerance_squared;
+
+    if (worst_index < 0 || worst <= limit)
+      continue;
+
+    space.keep[worst_index % count] = 1;
+
+    space.stack[top++] = from;
+    space.stack[top++] = worst_index;
+    space.stack[top++] = worst_index;
+    space.stack[top++] = to;
+  }
+}
+
+sweep_free_space_s sweep_free_space_construct(sweep_error_s* error) try {
+  SWEEP_ASSERT(error);
+
+  auto space = new sweep_free_space;
+  compute_bin_directions(*space);
+  return space;
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_free_space_destruct(sweep_free_space_s space) {
+  SWEEP_ASSERT(space);
+
+  delete space;
+}
+
+void sweep_free_space_set_parameters(sweep_free_space_s space, float max_range, int32_t bins, float tolerance) {
+  SWEEP_ASSERT(space);
+  SWEEP_ASSERT(max_range > 0.0f);
+  SWEEP_ASSERT(bins == 0 || (bins >= 3 && bins <= sweep::trig::ANGLE_STEPS));
+  SWEEP_ASSERT(tolerance >= 0.0f);
+
+  space->max_range = max_range;
+  space->bins = bins;
+  space->tolerance = tolerance;
+
+  compute_bin_directions(*space);
+}
+
+int32_t sweep_free_space_extract(sweep_free_space_s space, sweep_scan_s scan, float* x, float* y, int32_t capacity) {
+  SWEEP_ASSERT(space);
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(capacity >= 0);
+  SWEEP_ASSERT((x && y) || capacity == 0);
+
+  const int32_t count = space->bins > 0 ? boundary_from_bins(*space, *scan) : boundary_from_samples(*space, *scan);
+
+  if (count < 3)
+    return 0;
+
+  if (space->tolerance > 0.0f) {
+    std::fill_n(space->keep.begin(), count, static_cast<uint8_t>(0));
+
+    // The closed boundary is split at the first point and the point furthest from it, both always kept
+    int32_t opposite = 0;
+    float furthest = -1.0f;
+
+    for (int32_t n = 1; n < count; ++n) {
+      const float dx = space->x[n] - space->x[0];
+      const float dy = space->y[n] - space->y[0];
+
+      if (dx * dx + dy * dy > furthest) {
+        furthest = dx * dx + dy * dy;
+        opposite = n;
+      }
+    }
+
+    space->keep[0] = 1;
+    space->keep[opposite] = 1;
+
+    simplify_chain(*space, count, 0, opposite);
+    simplify_chain(*space, count, opposite, count);
+  } else {
+    std::fill_n(space->keep.begin(), count, static_cast<uint8_t>(1));
+  }
+
+  int32_t vertices = 0;
+
+  for (int32_t n = 0; n < count; ++n) {
+    if (!space->keep[n])
+      continue;
+
+    if (vertices < capacity) {
+      x[vertices] = space->x[n];
+      y[vertices] = space->y[n];
+    }
+
+    vertices += 1;
+  }
+
+  return vertices;
+}
@@ -0,0 +1,256 @@
+#include "error.hpp"
+#include "scan.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <memory>
+#include <vector>
+
+// Scans kept per device for sets still to come; beyond, the oldest get dropped when sets are not merged
+#define SWEEP_FUSION_MAX_SCANS 16
+
+// A scan in the common frame, its samples' times interpolated from when the previous scan ended to when it ended
+struct fusion_scan {
+  fusion_scan() : x(SWEEP_MAX_SAMPLES), y(SWEEP_MAX_SAMPLES), angle(SWEEP_MAX_SAMPLES) {}
+
+  int64_t begin; // in microseconds, on the common clock
+  int64_t end;
+  int32_t count;
+
+  // Buffers sized once for the largest possible scan, recycled across scans
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<int32_t> angle; // in millidegrees around the common frame's origin, -1 for samples without a return
+};
+
+struct fusion_device {
+  int32_t mount_angle;
+  float mount_x;
+  float mount_y;
+  int64_t clock_offset;
+
+  // When the latest scan ended and how long its rotation took, kept while its samples are of no more use
+  bool active;
+  int64_t end;
+  int64_t duration;
+
+  std::vector<std::unique_ptr<fusion_scan>> scans; // oldest first
+};
+
+struct fusion_point {
+  int32_t angle;
+  int32_t device;
+  float x;
+  float y;
+};
+
+struct sweep_fusion {
+  int64_t period;
+  int64_t window;
+  int64_t next; // end of the next set's window, zero until the first scan arrives
+
+  std::vector<fusion_device> devices;
+  std::vector<std::unique_ptr<fusion_scan>> spare;
+
+  // Reused across sets; the outputs stay valid until the next merge
+  std::vector<fusion_point> points;
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<int32_t> angle;
+  std::vector<int32_t> device;
+};
+
+sweep_fusion_s sweep_fusion_construct(int32_t devices, int64_t period, int64_t window, sweep_error_s* error) try {
+  SWEEP_ASSERT(devices > 0);
+  SWEEP_ASSERT(period > 0);
+  SWEEP_ASSERT(window > 0);
+  SWEEP_ASSERT(error);
+
+  std::unique_ptr<sweep_fusion> out{new sweep_fusion};
+  out->period = period;
+  out->window = window;
+  out->next = 0;
+
+  out->devices.resize(devices);
+
+  for (auto& device : out->devices) {
+    device.mount_angle = 0;
+    device.mount_x = 0.0f;
+    device.mount_y = 0.0f;
+    device.clock_offset = 0;
+    device.active = false;
+    device.end = 0;
+    device.duration = 0;
+  }
+
+  return out.release();
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_fusion_destruct(sweep_fusion_s fusion) {
+  SWEEP_ASSERT(fusion);
+
+  delete fusion;
+}
+
+void sweep_fusion_set_device(sweep_fusion_s fusion, int32_t device, int32_t mount_angle, float mount_x, float mount_y,
+                             int64_t clock_offset) {
+  SWEEP_ASSERT(fusion);
+  SWEEP_ASSERT(device >= 0 && device < static_cast<int32_t>(fusion->devices.size()));
+
+  auto& target = fusion->devices[device];
+  target.mount_angle = mount_angle;
+  target.mount_x = mount_x;
+  target.mount_y = mount_y;
+  target.clock_offset = clock_offset;
+}
+
+void sweep_fusion_add_scan(sweep_fusion_s fusion, int32_t device, sweep_scan_s scan, int64_t timestamp) {
+  SWEEP_ASSERT(fusion);
+  SWEEP_ASSERT(device >= 0 && device < static_cast<int32_t>(fusion->devices.size()));
+  SWEEP_ASSERT(scan);
+
+  auto& source = fusion->devices[device];
+
+  const int64_t end = timestamp + source.clock_offset;
+
+  if (fusion->next == 0)
+    fusion->next = end + fusion->window;
+
+  // Without knowing when its rotation began, a device's first scan only tells when the second one begins
+  if (!source.active) {
+    source.active = true;
+    source.end = end;
+    return;
+  }
+
+  // Scans no longer reaching into the next set's window, or the oldest if sets are not merged
+  auto& scans = source.scans;
+
+  while (!scans.empty() &&
+         (scans.front()->end <= fusion->next - fusion->window || scans.size() >= SWEEP_FUSION_MAX_SCANS)) {
+    fusion->spare.push_back(std::move(scans.front()));
+    scans.erase(scans.begin());
+  }
+
+  std::unique_ptr<fusion_scan> entry;
+
+  if (fusion->spare.empty()) {
+    entry.reset(new fusion_scan);
+  } else {
+    entry = std::move(fusion->spare.back());
+    fusion->spare.pop_back();
+  }
+
+  // A rotation lasts from the previous scan's end; after a gap, e.g. scans lost, as long as the previous rotation did
+  int64_t begin = std::min(source.end, end);
+
+  if (source.duration > 0 && end - begin > 2 * source.duration)
+    begin = end - source.duration;
+
+  source.end = end;
+  source.duration = end - begin;
+
+  entry->begin = begin;
+  entry->end = end;
+  entry->count = scan->count;
+
+  sweep_scan_to_cartesian(scan, source.mount_angle, source.mount_x, source.mount_y, entry->x.data(), entry->y.data());
+
+  for (int32_t n = 0; n < entry->count; ++n) {
+    // Would end up at the mount position; kept in place as the other samples' times depend on their index
+    if (scan->samples[n].distance <= 0) {
+      entry->angle[n] = -1;
+      continue;
+    }
+
+    const float millideg_float = std::atan2(entry->y[n], entry->x[n]) * 57295.7795f;
+    const auto millideg = static_cast<int32_t>(std::lround(millideg_float));
+
+    entry->angle[n] = millideg < 0 ? millideg + 360000 : millideg;
+  }
+
+  scans.push_back(std::move(entry));
+}
+
+// Appends the scan's samples taken within (from, to]
+static void collect_samples(const fusion_scan& scan, int32_t device, int64_t from, int64_t to,
+                            std::vector<fusion_point>& points) {
+  const int64_t duration = scan.end - scan.begin;
+
+  for (int32_t n = 0; n < scan.count; ++n) {
+    const int64_t time = scan.begin + duration * (n + 1) / scan.count;
+
+    if (time > from && time <= to && scan.angle[n] >= 0)
+      points.push_back(fusion_point{scan.angle[n], device, scan.x[n], scan.y[n]});
+  }
+}
+
+int32_t sweep_fusion_merge(sweep_fusion_s fusion, int64_t now, const float** x, const float** y, const int32_t** angle,
+                           const int32_t** device) {
+  SWEEP_ASSERT(fusion);
+  SWEEP_ASSERT(x);
+  SWEEP_ASSERT(y);
+  SWEEP_ASSERT(angle);
+  SWEEP_ASSERT(device);
+
+  const int64_t to = fusion->next;
+  const int64_t from = to - fusion->window;
+
+  if (to == 0 || now < to)
+    return -1;
+
+  // Samples arrive with the scan they belong to, so the set waits for every device to deliver a scan ending past it;
+  // a device lagging a whole window behind is left out
+  if (now < to + fusion->window)
+    for (const auto& source : fusion->devices)
+      if (source.active && source.end < to)
+        return -1;
+
+  fusion->points.clear();
+
+  for (int32_t n = 0; n < static_cast<int32_t>(fusion->devices.size()); ++n)
+    for (const auto& scan : fusion->devices[n].scans)
+      if (scan->end > from && scan->begin < to)
+        collect_samples(*scan, n, from, to, fusion->points);
+
+  std::sort(fusion->points.begin(), fusion->points.end(),
+            [](const fusion_point& lhs, const fusion_point& rhs) { return lhs.angle < rhs.angle; });
+
+  const auto count = fusion->points.size();
+
+  fusion->x.resize(count);
+  fusion->y.resize(count);
+  fusion->angle.resize(count);
+  fusion->device.resize(count);
+
+  for (size_t n = 0; n < count; ++n) {
+    const auto& point = fusion->points[n];
+
+    fusion->x[n] = point.x;
+    fusion->y[n] = point.y;
+    fusion->angle[n] = point.angle;
+    fusion->device[n] = point.device;
+  }
+
+  // Sets the caller fell more than a window behind on are skipped
+  fusion->next = std::max(to + fusion->period, now - fusion->window);
+
+  *x = fusion->x.data();
+  *y = fusion->y.data();
+  *angle = fusion->angle.data();
+  *device = fusion->device.data();
+
+  return static_cast<int32_t>(count);
+}
+
+int64_t sweep_fusion_get_next(sweep_fusion_s fusion) {
+  SWEEP_ASSERT(fusion);
+
+  return fusion->next;
+}
@@ -0,0 +1,446 @@
+#include "error.hpp"
+#include "scan.hpp"
+#include "trig.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <vector>
+
+// Every segment is supported by at least two samples
+#define SWEEP_LINE_MAX_SEGMENTS (SWEEP_MAX_SAMPLES / 2)
+
+// Running sums over a segment's points; a least squares line fit needs nothing else and sums can be
+// added up, which makes growing and merging segments constant time.
+// Doubles since squared coordinates of points 40 m away do not leave enough precision in floats.
+struct line_sums {
+  double n = 0;
+  double x = 0;
+  double y = 0;
+  double xx = 0;
+  double yy = 0;
+  double xy = 0;
+};
+
+static void add_point(line_sums& sums, double x, double y) {
+  sums.n += 1;
+  sums.x += x;
+  sums.y += y;
+  sums.xx += x * x;
+  sums.yy += y * y;
+  sums.xy += x * y;
+}
+
+static line_sums add_sums(const line_sums& lhs, const line_sums& rhs) {
+  line_sums sums;
+  sums.n = lhs.n + rhs.n;
+  sums.x = lhs.x + rhs.x;
+  sums.y = lhs.y + rhs.y;
+  sums.xx = lhs.xx + rhs.xx;
+  sums.yy = lhs.yy + rhs.yy;
+  sums.xy = lhs.xy + rhs.xy;
+  return sums;
+}
+
+// Total least squares fit: the line through the centroid along the principal axis of the points
+struct line_fit {
+  double mean_x;
+  double mean_y;
+  double normal_x;
+  double normal_y;
+  double min_variance; // per point variance across the line
+  double max_variance; // per point variance along the line
+};
+
+static line_fit fit_line(const line_sums& sums) {
+  line_fit fit;
+
+  fit.mean_x = sums.x / sums.n;
+  fit.mean_y = sums.y / sums.n;
+
+  const double sxx = sums.xx / sums.n - fit.mean_x * fit.mean_x;
+  const double syy = sums.yy / sums.n - fit.mean_y * fit.mean_y;
+  const double sxy = sums.xy / sums.n - fit.mean_x * fit.mean_y;
+
+  const double half_trace = 0.5 * (sxx + syy);
+  const double root = std::sqrt(0.25 * (sxx - syy) * (sxx - syy) + sxy * sxy);
+
+  fit.min_variance = std::max(half_trace - root, 0.0);
+  fit.max_variance = half_trace + root;
+
+  // The normal is the eigenvector of the smaller eigenvalue; of the two equivalent formulas take the better conditioned one
+  const double ax = sxy, ay = fit.min_variance - sxx;
+  const double bx = fit.min_variance - syy, by = sxy;
+
+  const double a = ax * ax + ay * ay;
+  const double b = bx * bx + by * by;
+
+  if (a == 0 && b == 0) {
+    fit.normal_x = 1;
+    fit.normal_y = 0;
+  } else if (a >= b) {
+    fit.normal_x = ax / std::sqrt(a);
+    fit.normal_y = ay / std::sqrt(a);
+  } else {
+    fit.normal_x = bx / std::sqrt(b);
+    fit.normal_y = by / std::sqrt(b);
+  }
+
+  return fit;
+}
+
+static double distance_to_line(const line_fit& fit, float x, float y) {
+  return std::abs((x - fit.mean_x) * fit.normal_x + (y - fit.mean_y) * fit.normal_y);
+}
+
+struct line_segment {
+  line_sums sums;
+
+  float start_x;
+  float start_y;
+  float end_x;
+  float end_y;
+
+  float alpha; // normal direction in radian
+  float r;     // distance from the origin in cm
+  float covariance[3];
+
+  int32_t first;
+  int32_t last;
+};
+
+struct sweep_line_extractor {
+  sweep_line_extractor() : segments(SWEEP_LINE_MAX_SEGMENTS) {}
+
+  float max_deviation = 3.0f;
+  float max_gap = 30.0f;
+  int32_t min_samples = 6;
+  float min_length = 20.0f;
+
+  std::vector<line_segment> segments;
+  int32_t number_of_segments = 0;
+
+  // The segment starting at the rotation's first return may still merge with its last one: held back until finish
+  line_segment head;
+  bool holding_head = false;
+
+  // The segment currently growing, spanning samples [first, last]
+  line_sums open;
+  int32_t first = 0;
+  int32_t last = 0;
+  float first_x = 0.0f;
+  float first_y = 0.0f;
+  float last_x = 0.0f;
+  float last_y = 0.0f;
+
+  // The last point if it did not continue the open segment, see push_point
+  bool pending = false;
+  int32_t pending_sample = 0;
+  float pending_x = 0.0f;
+  float pending_y = 0.0f;
+
+  // Samples pushed since begin, including the ones without a return
+  int32_t pushed = 0;
+  int32_t first_valid = -1;
+};
+
+// Fills in the segment's line parameters, endpoints and covariance from its sums and extreme points
+static void finalize_segment(line_segment& segment, float first_x, float first_y, float last_x, float last_y) {
+  const line_fit fit = fit_line(segment.sums);
+
+  // Hessian normal form x cos(alpha) + y sin(alpha) = r with r >= 0
+  double r = fit.mean_x * fit.normal_x + fit.mean_y * fit.normal_y;
+  double cos_alpha = fit.normal_x;
+  double sin_alpha = fit.normal_y;
+
+  if (r < 0) {
+    r = -r;
+    cos_alpha = -cos_alpha;
+    sin_alpha = -sin_alpha;
+  }
+
+  segment.alpha = static_cast<float>(std::atan2(sin_alpha, cos_alpha));
+  segment.r = static_cast<float>(r);
+
+  // Endpoints are the extreme supporting points projected onto the line
+  const auto project = [&](float x, float y, float& px, float& py) {
+    const double d = x * cos_alpha + y * sin_alpha - r;
+    px = static_cast<float>(x - d * cos_alpha);
+    py = static_cast<float>(y - d * sin_alpha);
+  };
+
+  project(first_x, first_y, segment.start_x, segment.start_y);
+  project(last_x, last_y, segment.end_x, segment.end_y);
+
+  // First order error propagation assuming independent isotropic noise per point, estimated from the residuals
+  const double n = segment.sums.n;
+  const double noise = n > 2 ? n * fit.min_variance / (n - 2) : 0.0;
+
+  const double var_alpha = fit.max_variance > 0 ? noise / (n * fit.max_variance) : 0.0;
+  // Position of the centroid along the line; r changes with alpha by this lever arm
+  const double along = -fit.mean_x * sin_alpha + fit.mean_y * cos_alpha;
+
+  segment.covariance[0] = static_cast<float>(var_alpha);
+  segment.covariance[1] = static_cast<float>(along * var_alpha);
+  segment.covariance[2] = static_cast<float>(noise / n + along * along * var_alpha);
+}
+
+static float segment_length(float start_x, float start_y, float end_x, float end_y) {
+  return std::hypot(end_x - start_x, end_y - start_y);
+}
+
+// Emits the open segment if it is supported well enough, then starts over empty
+static void close_segment(sweep_line_extractor& extractor) {
+  const int32_t stored = extractor.number_of_segments + extractor.holding_head;
+
+  if (extractor.open.n >= extractor.min_samples && stored < SWEEP_LINE_MAX_SEGMENTS) {
+    const bool is_head = extractor.first == extractor.first_valid;
+    line_segment& segment = is_head ? extractor.head : extractor.segments[extractor.number_of_segments];
+
+    segment.sums = extractor.open;
+    segment.first = extractor.first;
+    segment.last = extractor.last;
+
+    finalize_segment(segment, extractor.first_x, extractor.first_y, extractor.last_x, extractor.last_y);
+
+    if (segment_length(segment.start_x, segment.start_y, segment.end_x, segment.end_y) >= extractor.min_length) {
+      if (is_head)
+        extractor.holding_head = true;
+      else
+        extractor.number_of_segments += 1;
+    }
+  }
+
+  extractor.open = line_sums{};
+}
+
+static void start_segment(sweep_line_extractor& extractor, int32_t sample, float x, float y) {
+  add_point(extractor.open, x, y);
+  extractor.first = extractor.last = sample;
+  extractor.first_x = extractor.last_x = x;
+  extractor.first_y = extractor.last_y = y;
+}
+
+// Whether the point continues the open segment without growing it yet
+static bool continues_segment(const sweep_line_extractor& extractor, const line_sums& grown, float x, float y) {
+  if (std::hypot(x - extractor.last_x, y - extractor.last_y) > extractor.max_gap)
+    return false;
+
+  // Short segments' directions are too noisy to extrapolate: they are refitted with the new point included.
+  // Longer ones predict well and the new point has to lie on the line fitted so far, which keeps corners sharp.
+  const line_fit fit = fit_line(extractor.open.n < extractor.min_samples ? grown : extractor.open);
+
+  return distance_to_line(fit, x, y) <= extractor.max_deviation;
+}
+
+static void push_point(sweep_line_extractor& extractor, int32_t sample, float x, float y) {
+  if (extractor.open.n == 0) {
+    start_segment(extractor, sample, x, y);
+    return;
+  }
+
+  line_sums grown = extractor.open;
+  add_point(grown, x, y);
+
+  if (continues_segment(extractor, grown, x, y)) {
+    // A single point off the line in between is dropped as outlier
+    extractor.pending = false;
+
+    extractor.open = grown;
+    extractor.last = sample;
+    extractor.last_x = x;
+    extractor.last_y = y;
+    return;
+  }
+
+  // The first point off the line is held back: only a second one in a row ends the segment
+  if (!extractor.pending) {
+    extractor.pending = true;
+    extractor.pending_sample = sample;
+    extractor.pending_x = x;
+    extractor.pending_y = y;
+    return;
+  }
+
+  extractor.pending = false;
+
+  close_segment(extractor);
+  start_segment(extractor, extractor.pending_sample, extractor.pending_x, extractor.pending_y);
+  push_point(extractor, sample, x, y);
+}
+
+// The rotation's last segment may continue its first one across the zero angle; merges them if the combined fit holds
+static bool merge_wrap_around(sweep_line_extractor& extractor) {
+  if (extractor.open.n == 0 || !extractor.holding_head)
+    return false;
+
+  line_segment& head = extractor.head;
+
+  if (std::hypot(head.start_x - extractor.last_x, head.start_y - extractor.last_y) > extractor.max_gap)
+    return false;
+
+  const line_sums merged = add_sums(head.sums, extractor.open);
+  const line_fit fit = fit_line(merged);
+
+  const bool holds = distance_to_line(fit, extractor.first_x, extractor.first_y) <= extractor.max_deviation &&
+                     distance_to_line(fit, extractor.last_x, extractor.last_y) <= extractor.max_deviation &&
+                     distance_to_line(fit, head.start_x, head.start_y) <= extractor.max_deviation &&
+                     distance_to_line(fit, head.end_x, head.end_y) <= extractor.max_deviation;
+
+  if (!holds)
+    return false;
+
+  const float end_x = head.end_x;
+  const float end_y = head.end_y;
+
+  head.sums = merged;
+  head.first = extractor.first;
+
+  finalize_segment(head, extractor.first_x, extractor.first_y, end_x, end_y);
+
+  extractor.open = line_sums{};
+  return true;
+}
+
+sweep_line_extractor_s sweep_line_extractor_construct(sweep_error_s* error) try {
+  SWEEP_ASSERT(error);
+
+  return new sweep_line_extractor;
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_line_extractor_destruct(sweep_line_extractor_s extractor) {
+  SWEEP_ASSERT(extractor);
+
+  delete extractor;
+}
+
+void sweep_line_extractor_set_thresholds(sweep_line_extractor_s extractor, float max_deviation, float max_gap,
+                                         int32_t min_samples, float min_length) {
+  SWEEP_ASSERT(extractor);
+  SWEEP_ASSERT(max_deviation > 0.0f);
+  SWEEP_ASSERT(max_gap > 0.0f);
+  SWEEP_ASSERT(min_samples >= 2);
+  SWEEP_ASSERT(min_length >= 0.0f);
+
+  extractor->max_deviation = max_deviation;
+  extractor->max_gap = max_gap;
+  extractor->min_samples = min_samples;
+  extractor->min_length = min_length;
+}
+
+void sweep_line_extractor_begin(sweep_line_extractor_s extractor) {
+  SWEEP_ASSERT(extractor);
+
+  extractor->number_of_segments = 0;
+  extractor->holding_head = false;
+  extractor->open = line_sums{};
+  extractor->pending = false;
+  extractor->pushed = 0;
+  extractor->first_valid = -1;
+}
+
+int32_t sweep_line_extractor_push(sweep_line_extractor_s extractor, int32_t angle, int32_t distance) {
+  SWEEP_ASSERT(extractor);
+  SWEEP_ASSERT(angle >= 0 && angle < 360000);
+  SWEEP_ASSERT(extractor->pushed < SWEEP_MAX_SAMPLES && "too many samples in one rotation");
+
+  const int32_t sample = extractor->pushed++;
+
+  // Samples without a return neither extend nor break segments; the gap check catches actual discontinuities
+  if (distance <= 0)
+    return extractor->number_of_segments;
+
+  if (extractor->first_valid < 0)
+    extractor->first_valid = sample;
+
+  const auto& table = sweep::trig::lookup();
+  const int32_t step = sweep::trig::millideg_to_step(angle);
+
+  push_point(*extractor, sample, table.cos[step] * distance, table.sin[step] * distance);
+
+  return extractor->number_of_segments;
+}
+
+int32_t sweep_line_extractor_finish(sweep_line_extractor_s extractor) {
+  SWEEP_ASSERT(extractor);
+
+  // A point still held back at the end can not start a segment of its own and is dropped
+  extractor->pending = false;
+
+  if (!merge_wrap_around(*extractor))
+    close_segment(*extractor);
+
+  // Reported last so that the indices handed out while pushing stay valid
+  if (extractor->holding_head) {
+    extractor->segments[extractor->number_of_segments] = extractor->head;
+    extractor->number_of_segments += 1;
+    extractor->holding_head = false;
+  }
+
+  return extractor->number_of_segments;
+}
+
+int32_t sweep_line_extractor_extract(sweep_line_extractor_s extractor, sweep_scan_s scan) {
+  SWEEP_ASSERT(extractor);
+  SWEEP_ASSERT(scan);
+
+  sweep_line_extractor_begin(extractor);
+
+  for (int32_t n = 0; n < scan->count; ++n)
+    sweep_line_extractor_push(extractor, scan->samples[n].angle, scan->samples[n].distance);
+
+  return sweep_line_extractor_finish(extractor);
+}
+
+int32_t sweep_line_extractor_get_number_of_segments(sweep_line_extractor_s extractor) {
+  SWEEP_ASSERT(extractor);
+
+  return extractor->number_of_segments;
+}
+
+static const line_segment& get_segment(sweep_line_extractor_s extractor, int32_t segment) {
+  SWEEP_ASSERT(extractor);
+  SWEEP_ASSERT(segment >= 0 && segment < extractor->number_of_segments && "segment index out of bounds");
+
+  return extractor->segments[segment];
+}
+
+void sweep_line_extractor_get_segment(sweep_line_extractor_s extractor, int32_t segment, float* start_x, float* start_y,
+                                      float* end_x, float* end_y) {
+  SWEEP_ASSERT(start_x && start_y && end_x && end_y);
+
+  const line_segment& s = get_segment(extractor, segment);
+
+  *start_x = s.start_x;
+  *start_y = s.start_y;
+  *end_x = s.end_x;
+  *end_y = s.end_y;
+}
+
+void sweep_line_extractor_get_segment_line(sweep_line_extractor_s extractor, int32_t segment, float* alpha, float* r,
+                                           float* covariance) {
+  SWEEP_ASSERT(alpha && r && covariance);
+
+  const line_segment& s = get_segment(extractor, segment);
+
+  *alpha = s.alpha;
+  *r = s.r;
+  covariance[0] = s.covariance[0];
+  covariance[1] = s.covariance[1];
+  covariance[2] = s.covariance[2];
+}
+
+void sweep_line_extractor_get_segment_samples(sweep_line_extractor_s extractor, int32_t segment, int32_t* first,
+                                              int32_t* last) {
+  SWEEP_ASSERT(first && last);
+
+  const line_segment& s = get_segment(extractor, segment);
+
+  *first = s.first;
+  *last = s.last;
+}
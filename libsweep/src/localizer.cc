@@ -0,0 +1,411 @@
+#include "distance.hpp"
+#include "error.hpp"
+#include "pool.hpp"
+#include "scan.hpp"
+#include "trig.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+// Particles are evaluated in chunks of this many, one chunk per task
+#define SWEEP_LOCALIZER_CHUNK 128
+
+// Beams are transformed into field indices in blocks of this many before their likelihoods are gathered
+#define SWEEP_LOCALIZER_BLOCK 64
+
+// Caps the map per axis in cells
+#define SWEEP_LOCALIZER_MAX_MAP_SIZE 32768
+
+static const float kMillidegreeToRadian = 0.017453292519943295f / 1000.0f;
+static const float kTwoPi = 6.283185307179586f;
+
+// Particles as structure of arrays, angles in radian
+struct localizer_particles {
+  explicit localizer_particles(int32_t capacity) : x(capacity), y(capacity), angle(capacity), weight(capacity) {}
+
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> angle;
+  std::vector<float> weight;
+};
+
+struct sweep_localizer {
+  sweep_localizer(int32_t max_particles, int32_t threads)
+      : max_particles{max_particles}, particles(max_particles), resampled(max_particles), scores(max_particles),
+        beam_x(SWEEP_MAX_SAMPLES), beam_y(SWEEP_MAX_SAMPLES), x(SWEEP_MAX_SAMPLES), y(SWEEP_MAX_SAMPLES), pool{threads} {}
+
+  int32_t max_particles;
+  int32_t count = 0;
+
+  // Likelihood field: log likelihood of a beam ending in each cell. Padded by one cell on all sides holding the
+  // likelihood of a beam ending far from any obstacle so beams leaving the map clamp onto the padding.
+  int32_t field_width = 0;
+  int32_t field_height = 0;
+  float resolution = 0.0f; // in cm per cell
+  float origin_x = 0.0f;   // corner of the map's first cell in cm
+  float origin_y = 0.0f;
+  std::vector<float> squared_distance; // in cells, padded as the field
+  std::vector<float> field;
+
+  // Beam model: Gaussian around the nearest obstacle with standard deviation sigma in cm mixed with a uniform floor
+  float sigma = 10.0f;
+  float random = 0.05f;
+
+  // Every beam_step-th sample with a return is evaluated
+  int32_t beam_step = 4;
+
+  localizer_particles particles;
+  localizer_particles resampled;
+  std::vector<float> scores;
+
+  // Working buffers, sized once for the largest possible scan; beams in field cells relative to the sensor
+  std::vector<float> beam_x;
+  std::vector<float> beam_y;
+  std::vector<float> x;
+  std::vector<float> y;
+
+  std::mt19937 rng{5489u};
+
+  sweep::pool::pool pool;
+};
+
+static void build_field(sweep_localizer& localizer) {
+  const float floor = std::log(localizer.random);
+  const float scale = localizer.resolution * localizer.resolution / (2.0f * localizer.sigma * localizer.sigma);
+
+  localizer.field.resize(localizer.squared_distance.size());
+
+  for (size_t n = 0; n < localizer.field.size(); ++n)
+    localizer.field[n] = std::log(std::exp(-localizer.squared_distance[n] * scale) + localizer.random);
+
+  const int32_t width = localizer.field_width;
+  const int32_t height = localizer.field_height;
+
+  for (int32_t cx = 0; cx < width; ++cx) {
+    localizer.field[cx] = floor;
+    localizer.field[static_cast<size_t>(height - 1) * width + cx] = floor;
+  }
+
+  for (int32_t cy = 0; cy < height; ++cy) {
+    localizer.field[static_cast<size_t>(cy) * width] = floor;
+    localizer.field[static_cast<size_t>(cy) * width + width - 1] = floor;
+  }
+}
+
+// Sum of the beams' log likelihoods for a sensor at cell coordinates (cx, cy) facing angle
+static float score_particle(const sweep_localizer& localizer, int32_t beams, float cx, float cy, float angle) {
+  const float c = std::cos(angle);
+  const float s = std::sin(angle);
+
+  const float max_x = static_cast<float>(localizer.field_width - 1);
+  const float max_y = static_cast<float>(localizer.field_height - 1);
+  const int32_t width = localizer.field_width;
+
+  const float* beam_x = localizer.beam_x.data();
+  const float* beam_y = localizer.beam_y.data();
+  const float* field = localizer.field.data();
+
+  float score = 0.0f;
+
+  for (int32_t first = 0; first < beams; first += SWEEP_LOCALIZER_BLOCK) {
+    const int32_t size = std::min(beams - first, SWEEP_LOCALIZER_BLOCK);
+
+    // Branch free transform and clamp, vectorizable; the gather below is not
+    int32_t index[SWEEP_LOCALIZER_BLOCK];
+
+    for (int32_t n = 0; n < size; ++n) {
+      const float bx = beam_x[first + n];
+      const float by = beam_y[first + n];
+
+      const float px = std::min(std::max(cx + c * bx - s * by, 0.0f), max_x);
+      const float py = std::min(std::max(cy + s * bx + c * by, 0.0f), max_y);
+
+      index[n] = static_cast<int32_t>(py) * width + static_cast<int32_t>(px);
+    }
+
+    for (int32_t n = 0; n < size; ++n)
+      score += field[index[n]];
+  }
+
+  return score;
+}
+
+// Low variance resampling: a single random offset, then equally spaced picks along the cumulative weights
+static void resample(sweep_localizer& localizer) {
+  auto& from = localizer.particles;
+  auto& to = localizer.resampled;
+
+  const int32_t count = localizer.count;
+  const float step = 1.0f / count;
+
+  std::uniform_real_distribution<float> offset{0.0f, step};
+
+  float target = offset(localizer.rng);
+  float cumulative = from.weight[0];
+  int32_t picked = 0;
+
+  for (int32_t n = 0; n < count; ++n) {
+    while (target > cumulative && picked < count - 1)
+      cumulative += from.weight[++picked];
+
+    to.x[n] = from.x[picked];
+    to.y[n] = from.y[picked];
+    to.angle[n] = from.angle[picked];
+    to.weight[n] = step;
+
+    target += step;
+  }
+
+  std::swap(localizer.particles, localizer.resampled);
+}
+
+sweep_localizer_s sweep_localizer_construct(int32_t max_particles, int32_t threads, sweep_error_s* error) try {
+  SWEEP_ASSERT(max_particles > 0);
+  SWEEP_ASSERT(threads >= 0);
+  SWEEP_ASSERT(error);
+
+  return new sweep_localizer{max_particles, threads};
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_localizer_destruct(sweep_localizer_s localizer) {
+  SWEEP_ASSERT(localizer);
+
+  delete localizer;
+}
+
+void sweep_localizer_set_map(sweep_localizer_s localizer, const uint8_t* occupied, int32_t width, int32_t height,
+                             float resolution, float origin_x, float origin_y, sweep_error_s* error) try {
+  SWEEP_ASSERT(localizer);
+  SWEEP_ASSERT(occupied);
+  SWEEP_ASSERT(resolution > 0.0f);
+  SWEEP_ASSERT(error);
+
+  if (width <= 0 || height <= 0 || width > SWEEP_LOCALIZER_MAX_MAP_SIZE || height > SWEEP_LOCALIZER_MAX_MAP_SIZE)
+    throw std::runtime_error{"invalid map size"};
+
+  const int32_t padded_width = width + 2;
+  const int32_t padded_height = height + 2;
+  const size_t cells = static_cast<size_t>(padded_width) * padded_height;
+
+  std::vector<uint8_t> seeds(cells);
+
+  for (int32_t cy = 0; cy < height; ++cy)
+    std::copy_n(occupied + static_cast<size_t>(cy) * width, width, seeds.begin() + static_cast<size_t>(cy + 1) * padded_width + 1);
+
+  std::vector<float> squared_distance(cells);
+  sweep::distance::transform transform{padded_width, padded_height};
+  sweep::distance::squared(transform, seeds.data(), squared_distance.data(), localizer->pool);
+
+  localizer->squared_distance = std::move(squared_distance);
+  localizer->field_width = padded_width;
+  localizer->field_height = padded_height;
+  localizer->resolution = resolution;
+  localizer->origin_x = origin_x;
+  localizer->origin_y = origin_y;
+
+  build_field(*localizer);
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+}
+
+void sweep_localizer_set_model(sweep_localizer_s localizer, float sigma, float random) {
+  SWEEP_ASSERT(localizer);
+  SWEEP_ASSERT(sigma > 0.0f);
+  SWEEP_ASSERT(random > 0.0f && random < 1.0f);
+
+  localizer->sigma = sigma;
+  localizer->random = random;
+
+  if (!localizer->squared_distance.empty())
+    build_field(*localizer);
+}
+
+void sweep_localizer_set_beam_step(sweep_localizer_s localizer, int32_t beam_step) {
+  SWEEP_ASSERT(localizer);
+  SWEEP_ASSERT(beam_step >= 1);
+
+  localizer->beam_step = beam_step;
+}
+
+void sweep_localizer_reset(sweep_localizer_s localizer, int32_t count, int32_t angle, float x, float y, int32_t angular_spread,
+                           float linear_spread) {
+  SWEEP_ASSERT(localizer);
+  SWEEP_ASSERT(count > 0 && count <= localizer->max_particles);
+  SWEEP_ASSERT(angular_spread >= 0);
+  SWEEP_ASSERT(linear_spread >= 0.0f);
+
+  std::normal_distribution<float> angular{0.0f, angular_spread * kMillidegreeToRadian};
+  std::normal_distribution<float> linear{0.0f, linear_spread};
+
+  auto& particles = localizer->particles;
+  auto& rng = localizer->rng;
+
+  localizer->count = count;
+
+  for (int32_t n = 0; n < count; ++n) {
+    particles.x[n] = x + (linear_spread > 0.0f ? linear(rng) : 0.0f);
+    particles.y[n] = y + (linear_spread > 0.0f ? linear(rng) : 0.0f);
+    particles.angle[n] = angle * kMillidegreeToRadian + (angular_spread > 0 ? angular(rng) : 0.0f);
+    particles.weight[n] = 1.0f / count;
+  }
+}
+
+void sweep_localizer_predict(sweep_localizer_s localizer, int32_t angle, float x, float y, int32_t angular_noise,
+                             float linear_noise) {
+  SWEEP_ASSERT(localizer);
+  SWEEP_ASSERT(angular_noise >= 0);
+  SWEEP_ASSERT(linear_noise >= 0.0f);
+
+  std::normal_distribution<float> angular{0.0f, angular_noise * kMillidegreeToRadian};
+  std::normal_distribution<float> linear{0.0f, linear_noise};
+
+  auto& particles = localizer->particles;
+  auto& rng = localizer->rng;
+
+  const float rotation = angle * kMillidegreeToRadian;
+
+  for (int32_t n = 0; n < localizer->count; ++n) {
+    const float dx = x + (linear_noise > 0.0f ? linear(rng) : 0.0f);
+    const float dy = y + (linear_noise > 0.0f ? linear(rng) : 0.0f);
+
+    // The motion is given in the particle's own frame
+    const float c = std::cos(particles.angle[n]);
+    const float s = std::sin(particles.angle[n]);
+
+    particles.x[n] += c * dx - s * dy;
+    particles.y[n] += s * dx + c * dy;
+    particles.angle[n] = std::remainder(particles.angle[n] + rotation + (angular_noise > 0 ? angular(rng) : 0.0f), kTwoPi);
+  }
+}
+
+float sweep_localizer_update(sweep_localizer_s localizer, sweep_scan_s scan) {
+  SWEEP_ASSERT(localizer);
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(!localizer->field.empty());
+  SWEEP_ASSERT(localizer->count > 0);
+
+  const int32_t count = localizer->count;
+  const float scale = 1.0f / localizer->resolution;
+
+  sweep_scan_to_cartesian_simple(scan, localizer->x.data(), localizer->y.data());
+
+  int32_t beams = 0;
+  int32_t valid = 0;
+
+  for (int32_t n = 0; n < scan->count; ++n) {
+    if (scan->samples[n].distance <= 0)
+      continue;
+
+    if (valid++ % localizer->beam_step != 0)
+      continue;
+
+    localizer->beam_x[beams] = localizer->x[n] * scale;
+    localizer->beam_y[beams] = localizer->y[n] * scale;
+    beams += 1;
+  }
+
+  if (beams == 0)
+    return static_cast<float>(count);
+
+  // Particle positions in field cells; the padding shifts everything by one cell
+  const float offset_x = 1.0f - localizer->origin_x * scale;
+  const float offset_y = 1.0f - localizer->origin_y * scale;
+
+  const int32_t chunks = (count + SWEEP_LOCALIZER_CHUNK - 1) / SWEEP_LOCALIZER_CHUNK;
+
+  localizer->pool.parallel_for(chunks, [localizer, count, beams, scale, offset_x, offset_y](int32_t chunk) {
+    const auto& particles = localizer->particles;
+
+    const int32_t first = chunk * SWEEP_LOCALIZER_CHUNK;
+    const int32_t last = std::min(first + SWEEP_LOCALIZER_CHUNK, count);
+
+    for (int32_t n = first; n < last; ++n)
+      localizer->scores[n] = score_particle(*localizer, beams, particles.x[n] * scale + offset_x,
+                                            particles.y[n] * scale + offset_y, particles.angle[n]);
+  });
+
+  // Weights are multiplied by the likelihoods relative to the best particle's, then normalized
+  auto& particles = localizer->particles;
+
+  const float best = *std::max_element(localizer->scores.begin(), localizer->scores.begin() + count);
+
+  double total = 0.0;
+
+  for (int32_t n = 0; n < count; ++n) {
+    particles.weight[n] *= std::exp(localizer->scores[n] - best);
+    total += particles.weight[n];
+  }
+
+  double squares = 0.0;
+
+  for (int32_t n = 0; n < count; ++n) {
+    particles.weight[n] = static_cast<float>(particles.weight[n] / total);
+    squares += static_cast<double>(particles.weight[n]) * particles.weight[n];
+  }
+
+  const float effective = static_cast<float>(1.0 / squares);
+
+  if (effective < count / 2.0f)
+    resample(*localizer);
+
+  return effective;
+}
+
+void sweep_localizer_get_pose(sweep_localizer_s localizer, int32_t* angle, float* x, float* y) {
+  SWEEP_ASSERT(localizer);
+  SWEEP_ASSERT(angle);
+  SWEEP_ASSERT(x);
+  SWEEP_ASSERT(y);
+  SWEEP_ASSERT(localizer->count > 0);
+
+  const auto& particles = localizer->particles;
+
+  double mean_x = 0.0, mean_y = 0.0, mean_cos = 0.0, mean_sin = 0.0;
+
+  for (int32_t n = 0; n < localizer->count; ++n) {
+    const double weight = particles.weight[n];
+
+    mean_x += weight * particles.x[n];
+    mean_y += weight * particles.y[n];
+    mean_cos += weight * std::cos(particles.angle[n]);
+    mean_sin += weight * std::sin(particles.angle[n]);
+  }
+
+  const double radian = std::atan2(mean_sin, mean_cos);
+
+  *angle = sweep::trig::wrap_millideg(static_cast<int32_t>(std::lround(radian / kMillidegreeToRadian)));
+  *x = static_cast<float>(mean_x);
+  *y = static_cast<float>(mean_y);
+}
+
+int32_t sweep_localizer_get_number_of_particles(sweep_localizer_s localizer) {
+  SWEEP_ASSERT(localizer);
+
+  return localizer->count;
+}
+
+void sweep_localizer_get_particles(sweep_localizer_s localizer, int32_t* angle, float* x, float* y, float* weight) {
+  SWEEP_ASSERT(localizer);
+  SWEEP_ASSERT(angle);
+  SWEEP_ASSERT(x);
+  SWEEP_ASSERT(y);
+  SWEEP_ASSERT(weight);
+
+  const auto& particles = localizer->particles;
+
+  for (int32_t n = 0; n < localizer->count; ++n) {
+    angle[n] = sweep::trig::wrap_millideg(static_cast<int32_t>(std::lround(particles.angle[n] / kMillidegreeToRadian)));
+    x[n] = particles.x[n];
+    y[n] = particles.y[n];
+    weight[n] = particles.weight[n];
+  }
+}
@@ -0,0 +1,207 @@
+#include "error.hpp"
+#include "pool.hpp"
+#include "scan.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <vector>
+
+// Cells are stored in square tiles of 64 x 64 cells (8 KiB) for cache locality.
+// Rows of tiles are the unit of work: exactly one thread writes to a row of tiles at a time.
+#define SWEEP_GRID_TILE_SHIFT 6
+#define SWEEP_GRID_TILE_SIZE (1 << SWEEP_GRID_TILE_SHIFT)
+#define SWEEP_GRID_TILE_MASK (SWEEP_GRID_TILE_SIZE - 1)
+
+// Ray positions are fixed point cell coordinates with 16 fractional bits
+#define SWEEP_GRID_FIXED_SHIFT 16
+
+struct grid_ray {
+  int64_t step_x; // per step along the ray, fixed point
+  int64_t step_y;
+  int32_t steps; // the hit cell is reached after this many steps
+};
+
+struct sweep_occupancy_grid {
+  sweep_occupancy_grid(int32_t width, int32_t height, int32_t resolution, int32_t threads)
+      : width{width}, height{height}, resolution{resolution},                     //
+        tiles_x{(width + SWEEP_GRID_TILE_MASK) >> SWEEP_GRID_TILE_SHIFT},         //
+        tiles_y{(height + SWEEP_GRID_TILE_MASK) >> SWEEP_GRID_TILE_SHIFT},         //
+        cells(static_cast<size_t>(tiles_x) * tiles_y * SWEEP_GRID_TILE_SIZE * SWEEP_GRID_TILE_SIZE), //
+        x(SWEEP_MAX_SAMPLES), y(SWEEP_MAX_SAMPLES), rays(SWEEP_MAX_SAMPLES), pool{threads} {}
+
+  int32_t width;
+  int32_t height;
+  int32_t resolution; // in cm per cell
+  int32_t tiles_x;
+  int32_t tiles_y;
+
+  // Log-odds in hundredths, defaults correspond to p(hit) = 0.7 and p(miss) = 0.4, clamped to p = 0.03 / 0.97
+  int16_t hit = 85;
+  int16_t miss = -41;
+  int16_t min = -350;
+  int16_t max = 350;
+
+  std::vector<int16_t> cells;
+
+  // Working buffers, sized once for the largest possible scan
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<grid_ray> rays;
+
+  sweep::pool::pool pool;
+};
+
+static size_t cell_index(const sweep_occupancy_grid& grid, int32_t cx, int32_t cy) {
+  const size_t tile = static_cast<size_t>(cy >> SWEEP_GRID_TILE_SHIFT) * grid.tiles_x + (cx >> SWEEP_GRID_TILE_SHIFT);
+  return (tile << (2 * SWEEP_GRID_TILE_SHIFT)) + ((cy & SWEEP_GRID_TILE_MASK) << SWEEP_GRID_TILE_SHIFT) + (cx & SWEEP_GRID_TILE_MASK);
+}
+
+static int64_t floor_div(int64_t num, int64_t den) {
+  SWEEP_ASSERT(den > 0);
+  return num >= 0 ? num / den : -((-num + den - 1) / den);
+}
+
+// Narrows [first, last] to the steps for which start + step * i lies within [lo, hi)
+static void clip_steps(int64_t start, int64_t step, int64_t lo, int64_t hi, int32_t& first, int32_t& last) {
+  if (step == 0) {
+    if (start < lo || start >= hi)
+      last = first - 1;
+    return;
+  }
+
+  int64_t from;
+  int64_t to;
+
+  if (step > 0) {
+    from = -floor_div(start - lo, step);         // ceil((lo - start) / step)
+    to = -floor_div(start - hi, step) - 1;        // ceil((hi - start) / step) - 1
+  } else {
+    from = floor_div(start - hi, -step) + 1;
+    to = floor_div(start - lo, -step);
+  }
+
+  first = static_cast<int32_t>(std::max<int64_t>(first, from));
+  last = static_cast<int32_t>(std::min<int64_t>(last, to));
+}
+
+static void update_cell(sweep_occupancy_grid& grid, size_t index, int32_t delta) {
+  const int32_t value = grid.cells[index] + delta;
+  grid.cells[index] = static_cast<int16_t>(std::min<int32_t>(std::max<int32_t>(value, grid.min), grid.max));
+}
+
+// Casts all rays, writing only to cells in the given row of tiles
+static void cast_rays_in_tile_row(sweep_occupancy_grid& grid, int32_t count, int64_t start_x, int64_t start_y, int32_t tile_row) {
+  const int64_t one = int64_t{1} << SWEEP_GRID_FIXED_SHIFT;
+
+  const int64_t row_lo = static_cast<int64_t>(tile_row) * SWEEP_GRID_TILE_SIZE * one;
+  const int64_t row_hi = std::min<int64_t>((tile_row + 1) * SWEEP_GRID_TILE_SIZE, grid.height) * one;
+  const int64_t col_hi = static_cast<int64_t>(grid.width) * one;
+
+  for (int32_t n = 0; n < count; ++n) {
+    const grid_ray& ray = grid.rays[n];
+
+    int32_t first = 0;
+    int32_t last = ray.steps;
+
+    clip_steps(start_y, ray.step_y, row_lo, row_hi, first, last);
+    clip_steps(start_x, ray.step_x, 0, col_hi, first, last);
+
+    for (int32_t i = first; i <= last; ++i) {
+      const int32_t cx = static_cast<int32_t>((start_x + ray.step_x * i) >> SWEEP_GRID_FIXED_SHIFT);
+      const int32_t cy = static_cast<int32_t>((start_y + ray.step_y * i) >> SWEEP_GRID_FIXED_SHIFT);
+
+      update_cell(grid, cell_index(grid, cx, cy), i == ray.steps ? grid.hit : grid.miss);
+    }
+  }
+}
+
+sweep_occupancy_grid_s sweep_occupancy_grid_construct(int32_t width, int32_t height, int32_t resolution, int32_t threads,
+                                                      sweep_error_s* error) try {
+  SWEEP_ASSERT(width > 0 && width <= 32768);
+  SWEEP_ASSERT(height > 0 && height <= 32768);
+  SWEEP_ASSERT(resolution > 0);
+  SWEEP_ASSERT(threads >= 0);
+  SWEEP_ASSERT(error);
+
+  return new sweep_occupancy_grid{width, height, resolution, threads};
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_occupancy_grid_destruct(sweep_occupancy_grid_s grid) {
+  SWEEP_ASSERT(grid);
+
+  delete grid;
+}
+
+void sweep_occupancy_grid_set_log_odds(sweep_occupancy_grid_s grid, int32_t hit, int32_t miss, int32_t min, int32_t max) {
+  SWEEP_ASSERT(grid);
+  SWEEP_ASSERT(hit >= 0 && hit <= 32767);
+  SWEEP_ASSERT(miss <= 0 && miss >= -32768);
+  SWEEP_ASSERT(min <= 0 && min >= -32768);
+  SWEEP_ASSERT(max >= 0 && max <= 32767);
+
+  grid->hit = static_cast<int16_t>(hit);
+  grid->miss = static_cast<int16_t>(miss);
+  grid->min = static_cast<int16_t>(min);
+  grid->max = static_cast<int16_t>(max);
+}
+
+void sweep_occupancy_grid_clear(sweep_occupancy_grid_s grid) {
+  SWEEP_ASSERT(grid);
+
+  std::fill(grid->cells.begin(), grid->cells.end(), static_cast<int16_t>(0));
+}
+
+void sweep_occupancy_grid_update(sweep_occupancy_grid_s grid, sweep_scan_s scan, int32_t pose_angle, float pose_x, float pose_y) {
+  SWEEP_ASSERT(grid);
+  SWEEP_ASSERT(scan);
+
+  sweep_scan_to_cartesian(scan, pose_angle, pose_x, pose_y, grid->x.data(), grid->y.data());
+
+  const int64_t one = int64_t{1} << SWEEP_GRID_FIXED_SHIFT;
+  const float scale = 1.0f / grid->resolution;
+
+  // The grid's center cell holds the frame's origin
+  const auto to_cell = [scale](float v, int32_t size) { return static_cast<int32_t>(std::floor(v * scale)) + size / 2; };
+
+  const int32_t origin_x = to_cell(pose_x, grid->width);
+  const int32_t origin_y = to_cell(pose_y, grid->height);
+
+  // Rays run from cell center to cell center, one cell per step along the major axis (DDA)
+  const int64_t start_x = origin_x * one + one / 2;
+  const int64_t start_y = origin_y * one + one / 2;
+
+  int32_t count = 0;
+
+  for (int32_t n = 0; n < scan->count; ++n) {
+    if (scan->samples[n].distance <= 0)
+      continue;
+
+    const int32_t delta_x = to_cell(grid->x[n], grid->width) - origin_x;
+    const int32_t delta_y = to_cell(grid->y[n], grid->height) - origin_y;
+    const int32_t steps = std::max(std::abs(delta_x), std::abs(delta_y));
+
+    grid_ray& ray = grid->rays[count++];
+    ray.steps = steps;
+    ray.step_x = steps == 0 ? 0 : delta_x * one / steps;
+    ray.step_y = steps == 0 ? 0 : delta_y * one / steps;
+  }
+
+  grid->pool.parallel_for(grid->tiles_y, [grid, count, start_x, start_y](int32_t tile_row) {
+    cast_rays_in_tile_row(*grid, count, start_x, start_y, tile_row);
+  });
+}
+
+void sweep_occupancy_grid_get_log_odds(sweep_occupancy_grid_s grid, int16_t* log_odds) {
+  SWEEP_ASSERT(grid);
+  SWEEP_ASSERT(log_odds);
+
+  for (int32_t cy = 0; cy < grid->height; ++cy)
+    for (int32_t cx = 0; cx < grid->width; ++cx)
+      log_odds[static_cast<size_t>(cy) * grid->width + cx] = grid->cells[cell_index(*grid, cx, cy)];
+}
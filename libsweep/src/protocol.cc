@@ -1,4 +1,5 @@
 #include <chrono>
+#include <cstring>
 #include <thread>
 
 #include "protocol.hpp"
@@ -101,14 +102,47 @@ response_scan_packet_s read_response_scan(serial::device_s serial) {
   response_scan_packet_s scan;
   serial::device_read(serial, &scan, sizeof(scan));
 
-  uint8_t checksum = checksum_response_scan_packet(scan);
-
-  if (checksum != scan.checksum)
+  if (!is_valid_scan_packet(scan))
     throw error{"invalid scan response commands"};
 
   return scan;
 }
 
+bool is_valid_scan_packet(const response_scan_packet_s& packet) {
+  // Angles are sixteenths of a degree within a rotation
+  return checksum_response_scan_packet(packet) == packet.checksum && packet.angle < 360 * 16;
+}
+
+int32_t find_scan_packets(const uint8_t* bytes, int32_t size, int32_t count) {
+  SWEEP_ASSERT(bytes || size == 0);
+  SWEEP_ASSERT(size >= 0);
+  SWEEP_ASSERT(count > 0);
+
+  const int32_t packet_size = sizeof(response_scan_packet_s);
+  const uint8_t zero[sizeof(response_scan_packet_s)] = {0};
+
+  for (int32_t offset = 0; offset + count * packet_size <= size; ++offset) {
+    int32_t valid = 0;
+
+    while (valid < count) {
+      const uint8_t* at = bytes + offset + valid * packet_size;
+
+      response_scan_packet_s packet;
+      std::memcpy(&packet, at, sizeof(packet));
+
+      if (!is_valid_scan_packet(packet) || std::memcmp(at, zero, sizeof(zero)) == 0)
+        break;
+
+      valid += 1;
+    }
+
+    if (valid == count)
+      return offset;
+  }
+
+  return -1;
+}
+
 response_info_motor_ready_s read_response_info_motor_ready(serial::device_s serial) {
   SWEEP_ASSERT(serial);
 
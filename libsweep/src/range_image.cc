@@ -0,0 +1,126 @@
+#include "scan.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+// Samples without a return are reported with zero distance and never contribute to a bin
+static bool has_return(const sample& s) { return s.distance > 0; }
+
+static int32_t bin_of(int32_t angle, int32_t bins) {
+  SWEEP_ASSERT(angle >= 0 && angle < 360000);
+  return static_cast<int32_t>(static_cast<int64_t>(angle) * bins / 360000);
+}
+
+// Twice the bin's center angle in millidegrees against twice the sample angle; doubled to stay integral
+static int64_t offset_from_center(const sample& s, int32_t bin, int32_t bins) {
+  const int64_t center = (2 * static_cast<int64_t>(bin) + 1) * 360000 / bins;
+  return std::llabs(2 * static_cast<int64_t>(s.angle) - center);
+}
+
+// Reduces the samples with a return in the run [first, last) falling into the same bin to a single distance.
+// Returns false if there is not a single return in the run.
+static bool reduce_run(const sample* first, const sample* last, int32_t bin, int32_t bins, int32_t reduction,
+                       int32_t* scratch, int32_t* out) {
+  int32_t count = 0;
+
+  for (auto it = first; it != last; ++it)
+    if (has_return(*it))
+      scratch[count++] = static_cast<int32_t>(it - first);
+
+  if (count == 0)
+    return false;
+
+  switch (reduction) {
+  case SWEEP_REDUCTION_MIN: {
+    int32_t distance = first[scratch[0]].distance;
+    for (int32_t n = 1; n < count; ++n)
+      distance = std::min(distance, first[scratch[n]].distance);
+    *out = distance;
+    return true;
+  }
+
+  case SWEEP_REDUCTION_NEAREST: {
+    int32_t best = scratch[0];
+    for (int32_t n = 1; n < count; ++n)
+      if (offset_from_center(first[scratch[n]], bin, bins) < offset_from_center(first[best], bin, bins))
+        best = scratch[n];
+    *out = first[best].distance;
+    return true;
+  }
+
+  case SWEEP_REDUCTION_MEDIAN: {
+    for (int32_t n = 0; n < count; ++n)
+      scratch[n] = first[scratch[n]].distance;
+
+    // Lower median for even counts, keeps the result an actual measurement
+    const auto median = scratch + (count - 1) / 2;
+    std::nth_element(scratch, median, scratch + count);
+    *out = *median;
+    return true;
+  }
+
+  default:
+    SWEEP_ASSERT(false && "reduction unknown");
+    return false;
+  }
+}
+
+// Reduces each run of samples falling into the same bin; returns false if the samples are not ordered by angle, so a bin
+// may turn up again after its run ended
+static bool reduce_runs(const sample* samples, int32_t count, int32_t bins, int32_t reduction, int32_t* distance,
+                        uint8_t* valid) {
+  int32_t scratch[SWEEP_MAX_SAMPLES];
+
+  int32_t n = 0;
+  int32_t previous = -1;
+
+  while (n < count) {
+    const int32_t bin = bin_of(samples[n].angle, bins);
+
+    if (bin <= previous)
+      return false;
+
+    int32_t end = n + 1;
+    while (end < count && bin_of(samples[end].angle, bins) == bin)
+      end += 1;
+
+    int32_t reduced = 0;
+
+    if (reduce_run(samples + n, samples + end, bin, bins, reduction, scratch, &reduced)) {
+      distance[bin] = reduced;
+      valid[bin] = 1;
+    }
+
+    previous = bin;
+    n = end;
+  }
+
+  return true;
+}
+
+void sweep_scan_to_range_image(sweep_scan_s scan, int32_t bins, int32_t reduction, int32_t* distance, uint8_t* valid) {
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(bins > 0 && bins <= 360000);
+  SWEEP_ASSERT(distance);
+  SWEEP_ASSERT(valid);
+
+  std::fill_n(distance, bins, 0);
+  std::fill_n(valid, bins, static_cast<uint8_t>(0));
+
+  // Samples arrive ordered by angle, therefore all samples of a bin form a single run: one linear pass suffices
+  if (reduce_runs(scan->samples, scan->count, bins, reduction, distance, valid))
+    return;
+
+  // Otherwise the samples are put in order first, keeping the scan's order within a bin
+  std::vector<sample> sorted(scan->samples, scan->samples + scan->count);
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [bins](const sample& lhs, const sample& rhs) { return bin_of(lhs.angle, bins) < bin_of(rhs.angle, bins); });
+
+  std::fill_n(distance, bins, 0);
+  std::fill_n(valid, bins, static_cast<uint8_t>(0));
+
+  reduce_runs(sorted.data(), scan->count, bins, reduction, distance, valid);
+}
@@ -0,0 +1,164 @@
+#include "scan.hpp"
+#include "trig.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Range noise assumed at least, in cm; the spread within a run is used when larger
+#define SWEEP_REFLECTOR_RANGE_NOISE 1.0f
+
+// Consecutive bright samples further apart belong to different runs, in millidegrees
+#define SWEEP_REFLECTOR_MAX_ANGLE_GAP 3000
+
+// Running sums over a run of bright samples, in the sensor's frame
+struct reflector_run {
+  float weight;
+  float x;
+  float y;
+  float range;
+  float range_squared;
+  int32_t count;
+  float first_x;
+  float first_y;
+  float last_x;
+  float last_y;
+};
+
+// Weights are floored at one: with a min_signal_strength of zero a run of zero signal samples would have no centre
+static void add_to_run(reflector_run& run, float x, float y, float range, float signal_strength) {
+  const float weight = std::max(signal_strength, 1.0f);
+
+  if (run.count == 0) {
+    run.first_x = x;
+    run.first_y = y;
+  }
+
+  run.weight += weight;
+  run.x += weight * x;
+  run.y += weight * y;
+  run.range += range;
+  run.range_squared += range * range;
+  run.count += 1;
+  run.last_x = x;
+  run.last_y = y;
+}
+
+static reflector_run merge_runs(const reflector_run& lhs, const reflector_run& rhs) {
+  reflector_run run = lhs;
+
+  run.weight += rhs.weight;
+  run.x += rhs.x;
+  run.y += rhs.y;
+  run.range += rhs.range;
+  run.range_squared += rhs.range_squared;
+  run.count += rhs.count;
+  run.last_x = rhs.last_x;
+  run.last_y = rhs.last_y;
+
+  return run;
+}
+
+// Writes the run's signal weighted centre if it is a plausible reflector and there is room left, counting it either way
+static void emit_run(const reflector_run& run, int32_t min_samples, float max_width, float* x, float* y, float* covariance,
+                     int32_t& found, int32_t capacity) {
+  if (run.count < min_samples)
+    return;
+
+  const float width = std::hypot(run.last_x - run.first_x, run.last_y - run.first_y);
+
+  if (width > max_width)
+    return;
+
+  if (found < capacity) {
+    const float cx = run.x / run.weight;
+    const float cy = run.y / run.weight;
+
+    // Radial uncertainty from the range spread within the run, tangential from the run's angular sampling;
+    // both shrink with the number of samples averaged and are rotated into the sensor's frame by the bearing
+    const float mean_range = run.range / run.count;
+    const float spread = std::max(run.range_squared / run.count - mean_range * mean_range, 0.0f);
+    const float range_noise = std::max(spread, SWEEP_REFLECTOR_RANGE_NOISE * SWEEP_REFLECTOR_RANGE_NOISE);
+
+    const float spacing = run.count > 1 ? width / (run.count - 1) : mean_range * 0.0010908f; // 1/16 degree
+    const float radial = range_noise / run.count;
+    const float tangential = spacing * spacing / 12.0f;
+
+    const float bearing = std::atan2(cy, cx);
+    const float c = std::cos(bearing);
+    const float s = std::sin(bearing);
+
+    x[found] = cx;
+    y[found] = cy;
+    covariance[found * 3 + 0] = c * c * radial + s * s * tangential;
+    covariance[found * 3 + 1] = c * s * (radial - tangential);
+    covariance[found * 3 + 2] = s * s * radial + c * c * tangential;
+  }
+
+  found += 1;
+}
+
+int32_t sweep_scan_find_reflectors(sweep_scan_s scan, int32_t min_signal_strength, int32_t min_samples, float max_width,
+                                   float* x, float* y, float* covariance, int32_t capacity) {
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(min_signal_strength >= 0 && min_signal_strength <= 255);
+  SWEEP_ASSERT(min_samples >= 1);
+  SWEEP_ASSERT(max_width > 0.0f);
+  SWEEP_ASSERT(capacity >= 0);
+  SWEEP_ASSERT((x && y && covariance) || capacity == 0);
+
+  const auto& table = sweep::trig::lookup();
+
+  const sample* samples = scan->samples;
+  const int32_t count = scan->count;
+
+  int32_t found = 0;
+
+  // A run starting at the first sample may continue the run ending at the last one across zero degree, hold it back
+  reflector_run head{};
+  bool holding_head = count > 0 && samples[0].distance > 0 && samples[0].signal_strength >= min_signal_strength;
+
+  reflector_run run{};
+  int32_t first_angle = 0;
+  int32_t previous_angle = 0;
+
+  for (int32_t n = 0; n < count; ++n) {
+    const sample& s = samples[n];
+    const bool bright = s.distance > 0 && s.signal_strength >= min_signal_strength;
+
+    if (run.count > 0 && (!bright || s.angle - previous_angle > SWEEP_REFLECTOR_MAX_ANGLE_GAP)) {
+      if (holding_head && head.count == 0)
+        head = run;
+      else
+        emit_run(run, min_samples, max_width, x, y, covariance, found, capacity);
+
+      run = reflector_run{};
+    }
+
+    if (!bright)
+      continue;
+
+    const int32_t step = sweep::trig::millideg_to_step(s.angle);
+    const float range = static_cast<float>(s.distance);
+
+    if (n == 0)
+      first_angle = s.angle;
+
+    add_to_run(run, table.cos[step] * range, table.sin[step] * range, range, static_cast<float>(s.signal_strength));
+    previous_angle = s.angle;
+  }
+
+  const bool wraps = head.count > 0 && run.count > 0 && first_angle + 360000 - previous_angle <= SWEEP_REFLECTOR_MAX_ANGLE_GAP;
+
+  if (wraps) {
+    emit_run(merge_runs(run, head), min_samples, max_width, x, y, covariance, found, capacity);
+  } else {
+    if (run.count > 0)
+      emit_run(run, min_samples, max_width, x, y, covariance, found, capacity);
+    if (head.count > 0)
+      emit_run(head, min_samples, max_width, x, y, covariance, found, capacity);
+  }
+
+  return found;
+}
@@ -0,0 +1,256 @@
+#include "error.hpp"
+#include "file.hpp"
+#include "scan.hpp"
+
+#include "sweep.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+// Shared memory layout: a header followed by the slots, each holding one scan. A single writer fills slot
+// sequence % slots and readers follow on their own, without any locks:
+//
+//   writer  state = 2 * sequence + 1, copy the scan, state = 2 * sequence + 2, head = sequence + 1
+//   reader  load head, check the slot's state is 2 * sequence + 2, use the scan, check the state again
+//
+// A reader falling more than slots - 1 scans behind skips ahead and counts the scans it missed.
+#define SWEEP_RING_MAGIC 0x47525753u // "SWRG"
+#define SWEEP_RING_VERSION 1u
+
+// Readers wait for the next scan polling the head this often; scans arrive every 100 ms or so
+#define SWEEP_RING_POLL_INTERVAL std::chrono::microseconds(500)
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "atomics in shared memory have to be lock-free to work across processes");
+
+struct ring_header {
+  std::atomic<uint32_t> magic; // written last by the writer once the ring is set up
+  uint32_t version;
+  uint32_t slots;
+  std::atomic<uint32_t> closed;
+  std::atomic<uint64_t> head; // sequence number of the next scan
+  uint8_t padding[40];        // keeps the head's cache line to itself
+};
+
+struct ring_slot {
+  std::atomic<uint64_t> state;
+  int64_t timestamp;
+  int32_t count;
+  int32_t reserved;
+  sample samples[SWEEP_MAX_SAMPLES];
+};
+
+static_assert(sizeof(ring_header) == 64, "ring header spans one cache line");
+static_assert(sizeof(ring_slot) % 8 == 0, "ring slots keep eight byte alignment");
+
+struct sweep_ring_writer {
+  sweep::file::shared_s shared;
+  ring_header* header;
+  ring_slot* slots;
+  uint64_t head;
+};
+
+struct sweep_ring_reader {
+  sweep::file::shared_s shared;
+  const ring_header* header;
+  const ring_slot* slots;
+  uint64_t next;
+  int64_t dropped;
+};
+
+static int64_t ring_bytes(int32_t slots) { return sizeof(ring_header) + static_cast<int64_t>(slots) * sizeof(ring_slot); }
+
+static uint64_t complete_state(uint64_t sequence) { return 2 * sequence + 2; }
+
+sweep_ring_writer_s sweep_ring_writer_construct(const char* name, int32_t slots, sweep_error_s* error) try {
+  SWEEP_ASSERT(name);
+  SWEEP_ASSERT(slots >= 2);
+  SWEEP_ASSERT(error);
+
+  auto shared = sweep::file::shared_create(name, ring_bytes(slots));
+  auto data = sweep::file::shared_data(shared);
+
+  auto writer = new sweep_ring_writer{shared, reinterpret_cast<ring_header*>(data),
+                                      reinterpret_cast<ring_slot*>(data + sizeof(ring_header)), 0};
+
+  writer->header->version = SWEEP_RING_VERSION;
+  writer->header->slots = static_cast<uint32_t>(slots);
+  writer->header->magic.store(SWEEP_RING_MAGIC, std::memory_order_release);
+
+  return writer;
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_ring_writer_destruct(sweep_ring_writer_s writer) {
+  SWEEP_ASSERT(writer);
+
+  // Readers still mapping the ring see it closed and can reconnect to a new one
+  writer->header->closed.store(1, std::memory_order_release);
+
+  sweep::file::shared_destruct(writer->shared);
+  delete writer;
+}
+
+int64_t sweep_ring_writer_publish(sweep_ring_writer_s writer, sweep_scan_s scan, int64_t timestamp) {
+  SWEEP_ASSERT(writer);
+  SWEEP_ASSERT(scan);
+
+  const uint64_t sequence = writer->head;
+  ring_slot& slot = writer->slots[sequence % writer->header->slots];
+
+  slot.state.store(complete_state(sequence) - 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot.timestamp = timestamp;
+  slot.count = scan->count;
+  std::memcpy(slot.samples, scan->samples, static_cast<size_t>(scan->count) * sizeof(sample));
+
+  slot.state.store(complete_state(sequence), std::memory_order_release);
+
+  writer->head = sequence + 1;
+  writer->header->head.store(writer->head, std::memory_order_release);
+
+  return static_cast<int64_t>(sequence);
+}
+
+sweep_ring_reader_s sweep_ring_reader_construct(const char* name, sweep_error_s* error) try {
+  SWEEP_ASSERT(name);
+  SWEEP_ASSERT(error);
+
+  auto shared = sweep::file::shared_open(name);
+  auto data = sweep::file::shared_data(shared);
+
+  const auto header = reinterpret_cast<const ring_header*>(data);
+
+  if (sweep::file::shared_size(shared) < static_cast<int64_t>(sizeof(ring_header)) ||
+      header->magic.load(std::memory_order_acquire) != SWEEP_RING_MAGIC || header->version != SWEEP_RING_VERSION ||
+      header->slots < 2 || sweep::file::shared_size(shared) < ring_bytes(static_cast<int32_t>(header->slots))) {
+    sweep::file::shared_destruct(shared);
+    throw std::runtime_error{"not a scan ring, not set up yet or unsupported version"};
+  }
+
+  // Starts with the next scan published
+  const uint64_t head = header->head.load(std::memory_order_acquire);
+
+  return new sweep_ring_reader{shared, header, reinterpret_cast<const ring_slot*>(data + sizeof(ring_header)), head, 0};
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_ring_reader_destruct(sweep_ring_reader_s reader) {
+  SWEEP_ASSERT(reader);
+
+  sweep::file::shared_destruct(reader->shared);
+  delete reader;
+}
+
+int64_t sweep_ring_reader_next(sweep_ring_reader_s reader, int32_t timeout, int64_t* timestamp, const int32_t** samples,
+                               int32_t* count, sweep_error_s* error) try {
+  SWEEP_ASSERT(reader);
+  SWEEP_ASSERT(timeout >= 0);
+  SWEEP_ASSERT(timestamp);
+  SWEEP_ASSERT(samples);
+  SWEEP_ASSERT(count);
+  SWEEP_ASSERT(error);
+
+  const uint64_t slots = reader->header->slots;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+  for (;;) {
+    const uint64_t head = reader->header->head.load(std::memory_order_acquire);
+
+    // The slot of head - slots may be getting overwritten right now, the ones after it are safe
+    if (head >= slots && reader->next < head - slots + 1) {
+      reader->dropped += static_cast<int64_t>(head - slots + 1 - reader->next);
+      reader->next = head - slots + 1;
+    }
+
+    if (reader->next < head) {
+      const uint64_t sequence = reader->next;
+      const ring_slot& slot = reader->slots[sequence % slots];
+
+      if (slot.state.load(std::memory_order_acquire) == complete_state(sequence)) {
+        const int64_t stamp = slot.timestamp;
+        const int32_t samples_in_slot = slot.count;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (slot.state.load(std::memory_order_relaxed) == complete_state(sequence)) {
+          *timestamp = stamp;
+          *count = samples_in_slot;
+          *samples = reinterpret_cast<const int32_t*>(slot.samples);
+
+          reader->next = sequence + 1;
+          return static_cast<int64_t>(sequence);
+        }
+      }
+
+      // Overwritten since loading the head; skips ahead on the next round
+      continue;
+    }
+
+    if (reader->header->closed.load(std::memory_order_acquire))
+      throw std::runtime_error{"scan ring closed by its writer"};
+
+    if (std::chrono::steady_clock::now() >= deadline)
+      return -1;
+
+    std::this_thread::sleep_for(SWEEP_RING_POLL_INTERVAL);
+  }
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return -1;
+}
+
+bool sweep_ring_reader_is_valid(sweep_ring_reader_s reader, int64_t sequence) {
+  SWEEP_ASSERT(reader);
+  SWEEP_ASSERT(sequence >= 0);
+
+  const auto value = static_cast<uint64_t>(sequence);
+  const ring_slot& slot = reader->slots[value % reader->header->slots];
+
+  // Orders the caller's reads of the samples before checking they were not overwritten meanwhile
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  return slot.state.load(std::memory_order_relaxed) == complete_state(value);
+}
+
+int64_t sweep_ring_reader_read(sweep_ring_reader_s reader, int32_t timeout, sweep_scan_s scan, int64_t* timestamp,
+                               sweep_error_s* error) {
+  SWEEP_ASSERT(reader);
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(timestamp);
+  SWEEP_ASSERT(error);
+
+  for (;;) {
+    const int32_t* samples = nullptr;
+    int32_t count = 0;
+
+    const int64_t sequence = sweep_ring_reader_next(reader, timeout, timestamp, &samples, &count, error);
+
+    if (sequence < 0)
+      return -1;
+
+    std::memcpy(scan->samples, samples, static_cast<size_t>(count) * sizeof(sample));
+    scan->count = count;
+
+    if (sweep_ring_reader_is_valid(reader, sequence))
+      return sequence;
+
+    // Torn by the writer lapping us while copying
+    reader->dropped += 1;
+  }
+}
+
+int64_t sweep_ring_reader_get_dropped(sweep_ring_reader_s reader) {
+  SWEEP_ASSERT(reader);
+
+  return reader->dropped;
+}
@@ -0,0 +1,76 @@
+#include "error.hpp"
+#include "scan.hpp"
+
+#include "sweep.h"
+
+#include <exception>
+
+sweep_scan_s sweep_scan_construct(int32_t number_of_samples, sweep_error_s* error) try {
+  SWEEP_ASSERT(number_of_samples >= 0 && number_of_samples <= SWEEP_MAX_SAMPLES);
+  SWEEP_ASSERT(error);
+
+  auto out = new sweep_scan;
+  out->count = number_of_samples;
+
+  for (int32_t n = 0; n < number_of_samples; ++n)
+    out->samples[n] = sample{0, 0, 0};
+
+  return out;
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+int32_t sweep_scan_get_number_of_samples(sweep_scan_s scan) {
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(scan->count >= 0);
+
+  return scan->count;
+}
+
+void sweep_scan_set_number_of_samples(sweep_scan_s scan, int32_t number_of_samples) {
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(number_of_samples >= 0 && number_of_samples <= SWEEP_MAX_SAMPLES);
+
+  for (int32_t n = scan->count; n < number_of_samples; ++n)
+    scan->samples[n] = sample{0, 0, 0};
+
+  scan->count = number_of_samples;
+}
+
+int32_t sweep_scan_get_angle(sweep_scan_s scan, int32_t sample) {
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(sample >= 0 && sample < scan->count && "sample index out of bounds");
+
+  return scan->samples[sample].angle;
+}
+
+int32_t sweep_scan_get_distance(sweep_scan_s scan, int32_t sample) {
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(sample >= 0 && sample < scan->count && "sample index out of bounds");
+
+  return scan->samples[sample].distance;
+}
+
+int32_t sweep_scan_get_signal_strength(sweep_scan_s scan, int32_t sample) {
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(sample >= 0 && sample < scan->count && "sample index out of bounds");
+
+  return scan->samples[sample].signal_strength;
+}
+
+void sweep_scan_set_sample(sweep_scan_s scan, int32_t sample, int32_t angle, int32_t distance, int32_t signal_strength) {
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(sample >= 0 && sample < scan->count && "sample index out of bounds");
+  SWEEP_ASSERT(angle >= 0 && angle < 360000);
+  SWEEP_ASSERT(distance >= 0);
+  SWEEP_ASSERT(signal_strength >= 0 && signal_strength <= 255);
+
+  scan->samples[sample] = ::sample{angle, distance, signal_strength};
+}
+
+void sweep_scan_destruct(sweep_scan_s scan) {
+  SWEEP_ASSERT(scan);
+
+  delete scan;
+}
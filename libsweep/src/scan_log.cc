@@ -0,0 +1,513 @@
+#include "error.hpp"
+#include "file.hpp"
+#include "scan.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// File layout, all integers in host byte order and every structure aligned to eight bytes:
+//
+//   header   magic, version
+//   chunk*   magic, number of records, bytes of records following; records are the timestamp, the number of samples
+//            and the samples as angle, distance, signal strength int32 triples padded to eight bytes
+//   index    one entry per scan: timestamp, offset of its record and number of samples
+//   trailer  offset of the index, number of entries, magic, version
+//
+// Chunks are written whole and synced one after the other; index and trailer are written when the writer is closed.
+// Logs without a trailer, e.g. after a crash, are indexed by walking the chunks, ignoring a torn last one.
+#define SWEEP_LOG_MAGIC 0x474c5753u         // "SWLG"
+#define SWEEP_LOG_CHUNK_MAGIC 0x4b435753u   // "SWCK"
+#define SWEEP_LOG_TRAILER_MAGIC 0x58495753u // "SWIX"
+#define SWEEP_LOG_VERSION 1u
+
+// Records are batched into chunks of about this many bytes before being written and synced
+#define SWEEP_LOG_CHUNK_BYTES (1 << 20)
+
+// Partially filled chunks are written and synced at least this often
+#define SWEEP_LOG_FLUSH_INTERVAL std::chrono::milliseconds(1000)
+
+// Full chunks waiting while the disk falls behind are capped at this many; appending beyond drops scans instead of
+// blocking or growing without bounds
+#define SWEEP_LOG_MAX_QUEUED_CHUNKS 64
+
+struct log_header {
+  uint32_t magic;
+  uint32_t version;
+};
+
+struct chunk_header {
+  uint32_t magic;
+  uint32_t records;
+  int64_t bytes;
+};
+
+struct record_header {
+  int64_t timestamp;
+  int32_t count;
+  int32_t reserved;
+};
+
+struct index_entry {
+  int64_t timestamp;
+  int64_t offset;
+  int32_t count;
+  int32_t reserved;
+};
+
+struct log_trailer {
+  int64_t index_offset;
+  int64_t entries;
+  uint32_t magic;
+  uint32_t version;
+};
+
+static_assert(sizeof(sample) == 3 * sizeof(int32_t), "samples are stored as packed int32 triples");
+static_assert(sizeof(log_header) % 8 == 0 && sizeof(chunk_header) % 8 == 0 && sizeof(record_header) % 8 == 0 &&
+                  sizeof(index_entry) % 8 == 0 && sizeof(log_trailer) % 8 == 0,
+              "file structures keep eight byte alignment");
+
+static int64_t record_bytes(int32_t count) {
+  const int64_t bytes = sizeof(record_header) + static_cast<int64_t>(count) * sizeof(sample);
+  return (bytes + 7) & ~int64_t{7};
+}
+
+struct log_chunk {
+  std::vector<uint8_t> records;
+  std::vector<index_entry> index; // offsets relative to the start of records
+};
+
+struct sweep_log_writer {
+  sweep::file::writer_s file = nullptr;
+
+  std::mutex mutex;
+  std::condition_variable wakeup;
+
+  // Filled by the acquisition thread and queued once full for the writer thread; written chunks are recycled so
+  // appending copies the scan and nothing else, never reallocating or waiting on the disk
+  log_chunk current;
+  std::deque<log_chunk> queued;
+  std::vector<log_chunk> spare;
+
+  int64_t last_timestamp = std::numeric_limits<int64_t>::min();
+  int64_t dropped = 0;
+  bool closing = false;
+  std::string failure; // set by the writer thread, reported by the next append
+
+  // Owned by the writer thread
+  std::vector<index_entry> index;
+  int64_t offset = 0;
+
+  std::thread thread;
+};
+
+struct sweep_log_reader {
+  sweep::file::mapping_s mapping = nullptr;
+
+  // Points into the mapping if the log has a trailer, otherwise into the recovered index
+  const index_entry* index = nullptr;
+  int64_t entries = 0;
+  bool indexed = false;
+
+  std::vector<index_entry> recovered;
+};
+
+static log_chunk take_chunk(sweep_log_writer& writer) {
+  if (writer.spare.empty()) {
+    log_chunk chunk;
+    chunk.records.reserve(SWEEP_LOG_CHUNK_BYTES);
+    return chunk;
+  }
+
+  auto chunk = std::move(writer.spare.back());
+  writer.spare.pop_back();
+  return chunk;
+}
+
+static void write_chunk(sweep_log_writer& writer, const log_chunk& chunk) {
+  const chunk_header header{SWEEP_LOG_CHUNK_MAGIC, static_cast<uint32_t>(chunk.index.size()),
+                            static_cast<int64_t>(chunk.records.size())};
+
+  sweep::file::writer_write(writer.file, &header, sizeof(header));
+  sweep::file::writer_write(writer.file, chunk.records.data(), static_cast<int64_t>(chunk.records.size()));
+  sweep::file::writer_sync(writer.file);
+
+  const int64_t base = writer.offset + static_cast<int64_t>(sizeof(header));
+
+  for (auto entry : chunk.index) {
+    entry.offset += base;
+    writer.index.push_back(entry);
+  }
+
+  writer.offset = base + static_cast<int64_t>(chunk.records.size());
+}
+
+static void write_index(sweep_log_writer& writer) {
+  const log_trailer trailer{writer.offset, static_cast<int64_t>(writer.index.size()), SWEEP_LOG_TRAILER_MAGIC,
+                            SWEEP_LOG_VERSION};
+
+  sweep::file::writer_write(writer.file, writer.index.data(), static_cast<int64_t>(writer.index.size() * sizeof(index_entry)));
+  sweep::file::writer_write(writer.file, &trailer, sizeof(trailer));
+  sweep::file::writer_sync(writer.file);
+}
+
+static void write_loop(sweep_log_writer& writer) {
+  std::unique_lock<std::mutex> lock{writer.mutex};
+
+  for (;;) {
+    writer.wakeup.wait_for(lock, SWEEP_LOG_FLUSH_INTERVAL, [&writer] { return writer.closing || !writer.queued.empty(); });
+
+    const bool closing = writer.closing;
+
+    // Nothing full after the flush interval: the partially filled chunk goes out on its own
+    if (!writer.current.index.empty() && (closing || writer.queued.empty())) {
+      writer.queued.push_back(std::move(writer.current));
+      writer.current = take_chunk(writer);
+    }
+
+    while (!writer.queued.empty()) {
+      auto chunk = std::move(writer.queued.front());
+      writer.queued.pop_front();
+
+      lock.unlock();
+
+      try {
+        write_chunk(writer, chunk);
+      } catch (const std::exception& e) {
+        lock.lock();
+        writer.failure = e.what();
+        return;
+      }
+
+      chunk.records.clear();
+      chunk.index.clear();
+
+      lock.lock();
+      writer.spare.push_back(std::move(chunk));
+    }
+
+    if (closing)
+      break;
+  }
+
+  lock.unlock();
+
+  try {
+    write_index(writer);
+  } catch (const std::exception& e) {
+    lock.lock();
+    writer.failure = e.what();
+  }
+}
+
+sweep_log_writer_s sweep_log_writer_construct(const char* path, sweep_error_s* error) try {
+  SWEEP_ASSERT(path);
+  SWEEP_ASSERT(error);
+
+  auto writer = new sweep_log_writer;
+
+  try {
+    writer->file = sweep::file::writer_construct(path);
+
+    const log_header header{SWEEP_LOG_MAGIC, SWEEP_LOG_VERSION};
+    sweep::file::writer_write(writer->file, &header, sizeof(header));
+    writer->offset = sizeof(header);
+
+    writer->current = take_chunk(*writer);
+
+    writer->thread = std::thread{write_loop, std::ref(*writer)};
+  } catch (...) {
+    if (writer->file)
+      sweep::file::writer_destruct(writer->file);
+
+    delete writer;
+    throw;
+  }
+
+  return writer;
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_log_writer_destruct(sweep_log_writer_s writer) {
+  SWEEP_ASSERT(writer);
+
+  {
+    std::lock_guard<std::mutex> lock{writer->mutex};
+    writer->closing = true;
+  }
+
+  writer->wakeup.notify_one();
+  writer->thread.join();
+
+  sweep::file::writer_destruct(writer->file);
+  delete writer;
+}
+
+void sweep_log_writer_append(sweep_log_writer_s writer, sweep_scan_s scan, int64_t timestamp, sweep_error_s* error) try {
+  SWEEP_ASSERT(writer);
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(error);
+
+  const int64_t bytes = record_bytes(scan->count);
+  bool queued = false;
+
+  {
+    std::lock_guard<std::mutex> lock{writer->mutex};
+
+    if (!writer->failure.empty())
+      throw std::runtime_error{writer->failure};
+
+    if (timestamp < writer->last_timestamp)
+      throw std::runtime_error{"scan log timestamps have to be non-decreasing"};
+
+    if (static_cast<int64_t>(writer->current.records.size()) + bytes > SWEEP_LOG_CHUNK_BYTES) {
+      if (writer->queued.size() >= SWEEP_LOG_MAX_QUEUED_CHUNKS) {
+        writer->dropped += 1;
+        return;
+      }
+
+      writer->queued.push_back(std::move(writer->current));
+      writer->current = take_chunk(*writer);
+      queued = true;
+    }
+
+    writer->last_timestamp = timestamp;
+
+    auto& chunk = writer->current;
+
+    const auto offset = static_cast<int64_t>(chunk.records.size());
+    const size_t payload = sizeof(record_header) + static_cast<size_t>(scan->count) * sizeof(sample);
+    const record_header header{timestamp, scan->count, 0};
+
+    chunk.records.resize(static_cast<size_t>(offset + bytes));
+
+    uint8_t* out = chunk.records.data() + offset;
+    std::memcpy(out, &header, sizeof(header));
+    std::memcpy(out + sizeof(header), scan->samples, payload - sizeof(header));
+    std::memset(out + payload, 0, static_cast<size_t>(bytes) - payload);
+
+    chunk.index.push_back(index_entry{timestamp, offset, scan->count, 0});
+  }
+
+  if (queued)
+    writer->wakeup.notify_one();
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+}
+
+int64_t sweep_log_writer_get_dropped(sweep_log_writer_s writer) {
+  SWEEP_ASSERT(writer);
+
+  std::lock_guard<std::mutex> lock{writer->mutex};
+  return writer->dropped;
+}
+
+// Index entries have to refer to whole records in order, between the header and end, with timestamps not decreasing
+static bool valid_index(const index_entry* index, int64_t entries, int64_t end) {
+  int64_t offset = sizeof(log_header);
+  int64_t timestamp = std::numeric_limits<int64_t>::min();
+
+  for (int64_t n = 0; n < entries; ++n) {
+    const auto& entry = index[n];
+
+    if (entry.offset < offset || entry.offset > end || entry.offset % 8 != 0 || entry.timestamp < timestamp ||
+        entry.count < 0 || entry.count > SWEEP_MAX_SAMPLES || entry.offset + record_bytes(entry.count) > end)
+      return false;
+
+    offset = entry.offset + record_bytes(entry.count);
+    timestamp = entry.timestamp;
+  }
+
+  return true;
+}
+
+static bool load_index(sweep_log_reader& reader, const uint8_t* data, int64_t size) {
+  if (size < static_cast<int64_t>(sizeof(log_header) + sizeof(log_trailer)))
+    return false;
+
+  log_trailer trailer;
+  std::memcpy(&trailer, data + size - sizeof(trailer), sizeof(trailer));
+
+  if (trailer.magic != SWEEP_LOG_TRAILER_MAGIC || trailer.version != SWEEP_LOG_VERSION)
+    return false;
+
+  const int64_t index_bytes = size - static_cast<int64_t>(sizeof(trailer)) - trailer.index_offset;
+
+  if (trailer.index_offset < static_cast<int64_t>(sizeof(log_header)) || trailer.index_offset % 8 != 0 ||
+      index_bytes < 0 || index_bytes % sizeof(index_entry) != 0 || trailer.entries != index_bytes / static_cast<int64_t>(sizeof(index_entry)))
+    return false;
+
+  const auto index = reinterpret_cast<const index_entry*>(data + trailer.index_offset);
+
+  if (!valid_index(index, trailer.entries, trailer.index_offset))
+    return false;
+
+  reader.index = index;
+  reader.entries = trailer.entries;
+  reader.indexed = true;
+  return true;
+}
+
+// Walks the chunks from the start, stopping at the first one that is torn or not a chunk at all
+static void recover_index(sweep_log_reader& reader, const uint8_t* data, int64_t size) {
+  int64_t offset = sizeof(log_header);
+  int64_t timestamp = std::numeric_limits<int64_t>::min();
+
+  while (offset + static_cast<int64_t>(sizeof(chunk_header)) <= size) {
+    chunk_header chunk;
+    std::memcpy(&chunk, data + offset, sizeof(chunk));
+
+    const int64_t begin = offset + sizeof(chunk);
+
+    if (chunk.magic != SWEEP_LOG_CHUNK_MAGIC || chunk.bytes < 0 || chunk.bytes % 8 != 0 || chunk.bytes > size - begin)
+      break;
+
+    const int64_t end = begin + chunk.bytes;
+
+    const auto before = reader.recovered.size();
+    int64_t at = begin;
+
+    for (uint32_t n = 0; n < chunk.records; ++n) {
+      if (at + static_cast<int64_t>(sizeof(record_header)) > end)
+        break;
+
+      record_header record;
+      std::memcpy(&record, data + at, sizeof(record));
+
+      if (record.count < 0 || record.count > SWEEP_MAX_SAMPLES || record.timestamp < timestamp ||
+          at + record_bytes(record.count) > end)
+        break;
+
+      reader.recovered.push_back(index_entry{record.timestamp, at, record.count, 0});
+
+      timestamp = record.timestamp;
+      at += record_bytes(record.count);
+    }
+
+    // A chunk that does not add up is garbage; keep what came before it
+    if (at != end || reader.recovered.size() - before != chunk.records) {
+      reader.recovered.resize(before);
+      break;
+    }
+
+    offset = end;
+  }
+
+  reader.index = reader.recovered.data();
+  reader.entries = static_cast<int64_t>(reader.recovered.size());
+  reader.indexed = false;
+}
+
+sweep_log_reader_s sweep_log_reader_construct(const char* path, sweep_error_s* error) try {
+  SWEEP_ASSERT(path);
+  SWEEP_ASSERT(error);
+
+  auto mapping = sweep::file::mapping_construct(path);
+
+  const uint8_t* data = sweep::file::mapping_data(mapping);
+  const int64_t size = sweep::file::mapping_size(mapping);
+
+  log_header header{0, 0};
+
+  if (size >= static_cast<int64_t>(sizeof(header)))
+    std::memcpy(&header, data, sizeof(header));
+
+  if (header.magic != SWEEP_LOG_MAGIC || header.version != SWEEP_LOG_VERSION) {
+    sweep::file::mapping_destruct(mapping);
+    throw std::runtime_error{"not a scan log or unsupported version"};
+  }
+
+  auto reader = new sweep_log_reader;
+  reader->mapping = mapping;
+
+  try {
+    if (!load_index(*reader, data, size))
+      recover_index(*reader, data, size);
+
+    if (reader->entries > std::numeric_limits<int32_t>::max())
+      throw std::runtime_error{"scan log holds too many scans"};
+  } catch (...) {
+    sweep::file::mapping_destruct(mapping);
+    delete reader;
+    throw;
+  }
+
+  return reader;
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_log_reader_destruct(sweep_log_reader_s reader) {
+  SWEEP_ASSERT(reader);
+
+  sweep::file::mapping_destruct(reader->mapping);
+  delete reader;
+}
+
+bool sweep_log_reader_is_indexed(sweep_log_reader_s reader) {
+  SWEEP_ASSERT(reader);
+
+  return reader->indexed;
+}
+
+int32_t sweep_log_reader_get_number_of_scans(sweep_log_reader_s reader) {
+  SWEEP_ASSERT(reader);
+
+  return static_cast<int32_t>(reader->entries);
+}
+
+int32_t sweep_log_reader_seek(sweep_log_reader_s reader, int64_t timestamp) {
+  SWEEP_ASSERT(reader);
+
+  const auto first = std::lower_bound(reader->index, reader->index + reader->entries, timestamp,
+                                      [](const index_entry& entry, int64_t value) { return entry.timestamp < value; });
+
+  return static_cast<int32_t>(first - reader->index);
+}
+
+int64_t sweep_log_reader_get_timestamp(sweep_log_reader_s reader, int32_t index) {
+  SWEEP_ASSERT(reader);
+  SWEEP_ASSERT(index >= 0 && index < reader->entries);
+
+  return reader->index[index].timestamp;
+}
+
+const int32_t* sweep_log_reader_get_samples(sweep_log_reader_s reader, int32_t index, int32_t* count) {
+  SWEEP_ASSERT(reader);
+  SWEEP_ASSERT(index >= 0 && index < reader->entries);
+  SWEEP_ASSERT(count);
+
+  const auto& entry = reader->index[index];
+  const uint8_t* record = sweep::file::mapping_data(reader->mapping) + entry.offset;
+
+  *count = entry.count;
+  return reinterpret_cast<const int32_t*>(record + sizeof(record_header));
+}
+
+void sweep_log_reader_read(sweep_log_reader_s reader, int32_t index, sweep_scan_s scan) {
+  SWEEP_ASSERT(reader);
+  SWEEP_ASSERT(index >= 0 && index < reader->entries);
+  SWEEP_ASSERT(scan);
+
+  int32_t count = 0;
+  const int32_t* samples = sweep_log_reader_get_samples(reader, index, &count);
+
+  std::memcpy(scan->samples, samples, static_cast<size_t>(count) * sizeof(sample));
+  scan->count = count;
+}
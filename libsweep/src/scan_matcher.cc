@@ -0,0 +1,560 @@
+#include "error.hpp"
+#include "scan.hpp"
+#include "trig.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <vector>
+
+// Reference cells in the correlative search grid score high, their direct neighbours low
+#define SWEEP_MATCHER_SCORE_HIT 2
+#define SWEEP_MATCHER_SCORE_NEAR 1
+
+// Each coarse search cell spans this many fine cells per axis
+#define SWEEP_MATCHER_COARSE_FACTOR 4
+
+// Caps correlative grid sizes per axis, points beyond simply do not score
+#define SWEEP_MATCHER_MAX_GRID_SIZE 4096
+
+struct matcher_grid {
+  std::vector<uint8_t> cells;
+  int32_t width = 0;
+  int32_t height = 0;
+  float resolution = 0.0f;
+  float origin_x = 0.0f;
+  float origin_y = 0.0f;
+};
+
+struct matcher_pose {
+  float angle; // in radian
+  float x;
+  float y;
+};
+
+struct sweep_scan_matcher {
+  sweep_scan_matcher()
+      : reference_x(SWEEP_MAX_SAMPLES), reference_y(SWEEP_MAX_SAMPLES), reference_step(SWEEP_MAX_SAMPLES),
+        reference_index(sweep::trig::ANGLE_STEPS),
+        reference_previous(sweep::trig::ANGLE_STEPS), source_x(SWEEP_MAX_SAMPLES), source_y(SWEEP_MAX_SAMPLES),
+        moved_x(SWEEP_MAX_SAMPLES), moved_y(SWEEP_MAX_SAMPLES), cell_x(SWEEP_MAX_SAMPLES), cell_y(SWEEP_MAX_SAMPLES),
+        jacobian_x(SWEEP_MAX_SAMPLES), jacobian_y(SWEEP_MAX_SAMPLES), jacobian_angle(SWEEP_MAX_SAMPLES),
+        residual(SWEEP_MAX_SAMPLES) {}
+
+  // Correlative search window and resolution in cm, angular window in millidegrees; zero window disables the search
+  float linear_window = 30.0f;
+  int32_t angular_window = 5000;
+  float resolution = 5.0f;
+
+  // Point-to-line ICP refinement
+  int32_t iterations = 20;
+  float max_distance = 50.0f;
+
+  // Reference scan: valid samples in angular order and for every 1/16 degree step the index of the nearest one
+  std::vector<float> reference_x;
+  std::vector<float> reference_y;
+  std::vector<int32_t> reference_step;
+  std::vector<int16_t> reference_index;
+  std::vector<int16_t> reference_previous;
+  int32_t reference_count = 0;
+
+  matcher_grid fine;
+  matcher_grid coarse;
+
+  // Working buffers, sized once for the largest possible scan
+  std::vector<float> source_x;
+  std::vector<float> source_y;
+  int32_t source_count = 0;
+
+  std::vector<float> moved_x;
+  std::vector<float> moved_y;
+  std::vector<int32_t> cell_x;
+  std::vector<int32_t> cell_y;
+
+  std::vector<float> jacobian_x;
+  std::vector<float> jacobian_y;
+  std::vector<float> jacobian_angle;
+  std::vector<float> residual;
+};
+
+static const float kDegreeToRadian = 0.017453292519943295f;
+
+// Copies the samples with a return into x and y, keeping their angular order; returns their number
+static int32_t collect_points(sweep_scan_s scan, float* x, float* y, int32_t* step) {
+  sweep_scan_to_cartesian_simple(scan, x, y);
+
+  int32_t count = 0;
+
+  for (int32_t n = 0; n < scan->count; ++n) {
+    if (scan->samples[n].distance <= 0)
+      continue;
+
+    x[count] = x[n];
+    y[count] = y[n];
+    if (step)
+      step[count] = sweep::trig::millideg_to_step(scan->samples[n].angle);
+    count += 1;
+  }
+
+  return count;
+}
+
+static int32_t angle_to_step(float x, float y) {
+  const float degree = std::atan2(y, x) / kDegreeToRadian;
+  const int32_t step = static_cast<int32_t>(std::floor(degree * 16.0f + 0.5f));
+  return (step % sweep::trig::ANGLE_STEPS + sweep::trig::ANGLE_STEPS) % sweep::trig::ANGLE_STEPS;
+}
+
+// For every angle step find the reference point with the nearest angle, in linear passes over all steps
+static void build_reference_index(sweep_scan_matcher& matcher) {
+  const int32_t steps = sweep::trig::ANGLE_STEPS;
+  const int32_t count = matcher.reference_count;
+
+  auto& index = matcher.reference_index;
+  auto& previous = matcher.reference_previous;
+
+  std::fill(index.begin(), index.end(), static_cast<int16_t>(-1));
+
+  if (count == 0)
+    return;
+
+  // Points owning a step; the first one wins on duplicates
+  for (int32_t n = count - 1; n >= 0; --n)
+    index[matcher.reference_step[n]] = static_cast<int16_t>(n);
+
+  const auto circular_distance = [steps](int32_t lhs, int32_t rhs) {
+    const int32_t d = std::abs(lhs - rhs);
+    return std::min(d, steps - d);
+  };
+
+  // Nearest owner at or before each step, wrapping around
+  int16_t carried = -1;
+  for (int32_t s = steps - 1; s >= 0 && carried < 0; --s)
+    carried = index[s];
+
+  for (int32_t s = 0; s < steps; ++s) {
+    if (index[s] >= 0)
+      carried = index[s];
+    previous[s] = carried;
+  }
+
+  // Nearest owner at or after each step, wrapping around; keep whichever is closer
+  carried = -1;
+  for (int32_t s = 0; s < steps && carried < 0; ++s)
+    carried = index[s];
+
+  for (int32_t s = steps - 1; s >= 0; --s) {
+    if (index[s] >= 0)
+      carried = index[s];
+
+    const int16_t before = previous[s];
+    const bool before_closer = circular_distance(matcher.reference_step[before], s) <= circular_distance(matcher.reference_step[carried], s);
+
+    index[s] = before_closer ? before : carried;
+  }
+}
+
+// Marks reference points in the fine grid and derives the coarse grid, each coarse cell the maximum of its fine cells.
+// The coarse score of a pose therefore bounds the fine score of all poses within the coarse cell from above.
+static void build_grids(sweep_scan_matcher& matcher) {
+  auto& fine = matcher.fine;
+  auto& coarse = matcher.coarse;
+
+  const int32_t count = matcher.reference_count;
+
+  float min_x = 0.0f, max_x = 0.0f, min_y = 0.0f, max_y = 0.0f;
+
+  for (int32_t n = 0; n < count; ++n) {
+    min_x = std::min(min_x, matcher.reference_x[n]);
+    max_x = std::max(max_x, matcher.reference_x[n]);
+    min_y = std::min(min_y, matcher.reference_y[n]);
+    max_y = std::max(max_y, matcher.reference_y[n]);
+  }
+
+  // Leave room for the search window and a border of coarse cells
+  const float margin = matcher.linear_window + 2 * SWEEP_MATCHER_COARSE_FACTOR * matcher.resolution;
+
+  const auto cells_for = [&matcher, margin](float lo, float hi) {
+    const int32_t cells = static_cast<int32_t>(std::ceil((hi - lo + 2 * margin) / matcher.resolution)) + 1;
+    const int32_t rounded = (cells + SWEEP_MATCHER_COARSE_FACTOR - 1) / SWEEP_MATCHER_COARSE_FACTOR * SWEEP_MATCHER_COARSE_FACTOR;
+    return std::min(rounded, SWEEP_MATCHER_MAX_GRID_SIZE);
+  };
+
+  fine.resolution = matcher.resolution;
+  fine.origin_x = min_x - margin;
+  fine.origin_y = min_y - margin;
+  fine.width = cells_for(min_x, max_x);
+  fine.height = cells_for(min_y, max_y);
+
+  // Only ever grows, re-using the storage from previous reference scans
+  fine.cells.resize(std::max(fine.cells.size(), static_cast<size_t>(fine.width) * fine.height));
+  std::fill_n(fine.cells.begin(), static_cast<size_t>(fine.width) * fine.height, static_cast<uint8_t>(0));
+
+  for (int32_t n = 0; n < count; ++n) {
+    const int32_t cx = static_cast<int32_t>((matcher.reference_x[n] - fine.origin_x) / fine.resolution);
+    const int32_t cy = static_cast<int32_t>((matcher.reference_y[n] - fine.origin_y) / fine.resolution);
+
+    for (int32_t dy = -1; dy <= 1; ++dy) {
+      for (int32_t dx = -1; dx <= 1; ++dx) {
+        const int32_t x = cx + dx;
+        const int32_t y = cy + dy;
+
+        if (x < 0 || y < 0 || x >= fine.width || y >= fine.height)
+          continue;
+
+        const uint8_t score = dx == 0 && dy == 0 ? SWEEP_MATCHER_SCORE_HIT : SWEEP_MATCHER_SCORE_NEAR;
+        auto& cell = fine.cells[static_cast<size_t>(y) * fine.width + x];
+        cell = std::max(cell, score);
+      }
+    }
+  }
+
+  coarse.resolution = fine.resolution * SWEEP_MATCHER_COARSE_FACTOR;
+  coarse.origin_x = fine.origin_x;
+  coarse.origin_y = fine.origin_y;
+  coarse.width = fine.width / SWEEP_MATCHER_COARSE_FACTOR;
+  coarse.height = fine.height / SWEEP_MATCHER_COARSE_FACTOR;
+
+  coarse.cells.resize(std::max(coarse.cells.size(), static_cast<size_t>(coarse.width) * coarse.height));
+  std::fill_n(coarse.cells.begin(), static_cast<size_t>(coarse.width) * coarse.height, static_cast<uint8_t>(0));
+
+  for (int32_t y = 0; y < fine.height; ++y) {
+    for (int32_t x = 0; x < fine.width; ++x) {
+      auto& cell = coarse.cells[static_cast<size_t>(y / SWEEP_MATCHER_COARSE_FACTOR) * coarse.width + x / SWEEP_MATCHER_COARSE_FACTOR];
+      cell = std::max(cell, fine.cells[static_cast<size_t>(y) * fine.width + x]);
+    }
+  }
+}
+
+// Rotates and translates the source points into the reference frame
+static void move_source(sweep_scan_matcher& matcher, const matcher_pose& pose) {
+  const float c = std::cos(pose.angle);
+  const float s = std::sin(pose.angle);
+
+  const float* sx = matcher.source_x.data();
+  const float* sy = matcher.source_y.data();
+  float* mx = matcher.moved_x.data();
+  float* my = matcher.moved_y.data();
+
+  for (int32_t n = 0; n < matcher.source_count; ++n) {
+    mx[n] = c * sx[n] - s * sy[n] + pose.x;
+    my[n] = s * sx[n] + c * sy[n] + pose.y;
+  }
+}
+
+// Sums the grid scores of the moved source points shifted by whole cells (dx, dy) for all shifts in [-radius, radius]
+static void search_translations(sweep_scan_matcher& matcher, const matcher_grid& grid, int32_t radius, int32_t& best_score,
+                                int32_t& best_dx, int32_t& best_dy, bool& improved) {
+  const int32_t count = matcher.source_count;
+
+  int32_t* cx = matcher.cell_x.data();
+  int32_t* cy = matcher.cell_y.data();
+
+  for (int32_t n = 0; n < count; ++n) {
+    cx[n] = static_cast<int32_t>(std::floor((matcher.moved_x[n] - grid.origin_x) / grid.resolution));
+    cy[n] = static_cast<int32_t>(std::floor((matcher.moved_y[n] - grid.origin_y) / grid.resolution));
+  }
+
+  for (int32_t dy = -radius; dy <= radius; ++dy) {
+    for (int32_t dx = -radius; dx <= radius; ++dx) {
+      int32_t score = 0;
+
+      for (int32_t n = 0; n < count; ++n) {
+        const int32_t x = cx[n] + dx;
+        const int32_t y = cy[n] + dy;
+
+        if (x >= 0 && y >= 0 && x < grid.width && y < grid.height)
+          score += grid.cells[static_cast<size_t>(y) * grid.width + x];
+      }
+
+      if (score > best_score) {
+        best_score = score;
+        best_dx = dx;
+        best_dy = dy;
+        improved = true;
+      }
+    }
+  }
+}
+
+// Exhaustive search over the window on the coarse grid, then over the best coarse cell on the fine grid
+static matcher_pose correlative_search(sweep_scan_matcher& matcher, const matcher_pose& guess) {
+  // Angular steps moving a point 10m away by about one cell
+  const float fine_angle = matcher.resolution / 1000.0f;
+  const float coarse_angle = fine_angle * SWEEP_MATCHER_COARSE_FACTOR;
+
+  const float window = matcher.angular_window / 1000.0f * kDegreeToRadian;
+
+  matcher_pose best = guess;
+  int32_t best_score = -1;
+
+  const int32_t coarse_radius = static_cast<int32_t>(std::ceil(matcher.linear_window / matcher.coarse.resolution));
+  const int32_t coarse_angles = static_cast<int32_t>(std::ceil(window / coarse_angle));
+
+  for (int32_t a = -coarse_angles; a <= coarse_angles; ++a) {
+    const matcher_pose rotated{guess.angle + a * coarse_angle, guess.x, guess.y};
+    move_source(matcher, rotated);
+
+    int32_t dx = 0, dy = 0;
+    bool improved = false;
+    search_translations(matcher, matcher.coarse, coarse_radius, best_score, dx, dy, improved);
+
+    if (improved)
+      best = {rotated.angle, rotated.x + dx * matcher.coarse.resolution, rotated.y + dy * matcher.coarse.resolution};
+  }
+
+  const matcher_pose center = best;
+  const int32_t fine_radius = SWEEP_MATCHER_COARSE_FACTOR;
+  best_score = -1;
+
+  for (int32_t a = -SWEEP_MATCHER_COARSE_FACTOR; a <= SWEEP_MATCHER_COARSE_FACTOR; ++a) {
+    const matcher_pose rotated{center.angle + a * fine_angle, center.x, center.y};
+    move_source(matcher, rotated);
+
+    int32_t dx = 0, dy = 0;
+    bool improved = false;
+    search_translations(matcher, matcher.fine, fine_radius, best_score, dx, dy, improved);
+
+    if (improved)
+      best = {rotated.angle, rotated.x + dx * matcher.fine.resolution, rotated.y + dy * matcher.fine.resolution};
+  }
+
+  return best;
+}
+
+// Finds the reference point nearest to p among the ones next to p's angle, and the normal of the reference's surface there.
+// Makes use of the reference's angular order: no search structure, constant time per point.
+static bool correspond(const sweep_scan_matcher& matcher, float px, float py, float& qx, float& qy, float& nx, float& ny) {
+  const int32_t count = matcher.reference_count;
+  const int32_t nearest = matcher.reference_index[angle_to_step(px, py)];
+
+  if (nearest < 0)
+    return false;
+
+  const float* rx = matcher.reference_x.data();
+  const float* ry = matcher.reference_y.data();
+
+  const auto squared_distance = [rx, ry, px, py](int32_t n) {
+    const float dx = rx[n] - px;
+    const float dy = ry[n] - py;
+    return dx * dx + dy * dy;
+  };
+
+  int32_t best = nearest;
+  for (int32_t n = std::max(0, nearest - 1); n <= std::min(count - 1, nearest + 1); ++n)
+    if (squared_distance(n) < squared_distance(best))
+      best = n;
+
+  const float max_squared = matcher.max_distance * matcher.max_distance;
+
+  if (squared_distance(best) > max_squared)
+    return false;
+
+  // Surface tangent through the angular neighbours, as long as they are on the same surface
+  const auto close_to_best = [rx, ry, best, max_squared](int32_t n) {
+    const float dx = rx[n] - rx[best];
+    const float dy = ry[n] - ry[best];
+    return dx * dx + dy * dy <= max_squared;
+  };
+
+  const int32_t before = best > 0 && close_to_best(best - 1) ? best - 1 : best;
+  const int32_t after = best + 1 < count && close_to_best(best + 1) ? best + 1 : best;
+
+  if (before == after)
+    return false;
+
+  const float tx = rx[after] - rx[before];
+  const float ty = ry[after] - ry[before];
+  const float length = std::sqrt(tx * tx + ty * ty);
+
+  if (length <= 0.0f)
+    return false;
+
+  qx = rx[best];
+  qy = ry[best];
+  nx = -ty / length;
+  ny = tx / length;
+  return true;
+}
+
+static double determinant(const double m[3][3]) {
+  return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - //
+         m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) + //
+         m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+// Solves h delta = -g with Cramer's rule; false for (nearly) degenerate geometry, e.g. a single straight wall
+static bool solve_normal_equations(const double h[3][3], const double g[3], double delta[3]) {
+  const double det = determinant(h);
+
+  if (std::fabs(det) < 1e-9)
+    return false;
+
+  for (int32_t column = 0; column < 3; ++column) {
+    double m[3][3];
+
+    for (int32_t row = 0; row < 3; ++row)
+      for (int32_t k = 0; k < 3; ++k)
+        m[row][k] = k == column ? -g[row] : h[row][k];
+
+    delta[column] = determinant(m) / det;
+  }
+
+  return true;
+}
+
+// Gauss-Newton on the point-to-line distances, linearized around the current pose
+static int32_t refine(sweep_scan_matcher& matcher, matcher_pose& pose) {
+  int32_t inliers = 0;
+
+  for (int32_t iteration = 0; iteration < matcher.iterations; ++iteration) {
+    move_source(matcher, pose);
+
+    inliers = 0;
+
+    for (int32_t n = 0; n < matcher.source_count; ++n) {
+      const float px = matcher.moved_x[n];
+      const float py = matcher.moved_y[n];
+
+      float qx, qy, nx, ny;
+
+      if (!correspond(matcher, px, py, qx, qy, nx, ny))
+        continue;
+
+      matcher.jacobian_x[inliers] = nx;
+      matcher.jacobian_y[inliers] = ny;
+      matcher.jacobian_angle[inliers] = nx * -py + ny * px;
+      matcher.residual[inliers] = nx * (px - qx) + ny * (py - qy);
+      inliers += 1;
+    }
+
+    if (inliers < 3)
+      return inliers;
+
+    // Normal equations accumulated over plain arrays; compilers vectorize this reduction
+    const float* jx = matcher.jacobian_x.data();
+    const float* jy = matcher.jacobian_y.data();
+    const float* ja = matcher.jacobian_angle.data();
+    const float* r = matcher.residual.data();
+
+    float hxx = 0, hxy = 0, hxa = 0, hyy = 0, hya = 0, haa = 0, gx = 0, gy = 0, ga = 0;
+
+    for (int32_t n = 0; n < inliers; ++n) {
+      hxx += jx[n] * jx[n];
+      hxy += jx[n] * jy[n];
+      hxa += jx[n] * ja[n];
+      hyy += jy[n] * jy[n];
+      hya += jy[n] * ja[n];
+      haa += ja[n] * ja[n];
+      gx += jx[n] * r[n];
+      gy += jy[n] * r[n];
+      ga += ja[n] * r[n];
+    }
+
+    const double h[3][3] = {{hxx, hxy, hxa}, {hxy, hyy, hya}, {hxa, hya, haa}};
+    const double g[3] = {gx, gy, ga};
+
+    double delta[3];
+
+    if (!solve_normal_equations(h, g, delta))
+      return inliers;
+
+    const double dx = delta[0];
+    const double dy = delta[1];
+    const double da = delta[2];
+
+    // The update rotates around the reference frame's origin, then translates
+    const float c = std::cos(static_cast<float>(da));
+    const float s = std::sin(static_cast<float>(da));
+
+    pose = {pose.angle + static_cast<float>(da), c * pose.x - s * pose.y + static_cast<float>(dx),
+            s * pose.x + c * pose.y + static_cast<float>(dy)};
+
+    if (std::fabs(dx) < 0.01 && std::fabs(dy) < 0.01 && std::fabs(da) < 1e-5)
+      break;
+  }
+
+  return inliers;
+}
+
+sweep_scan_matcher_s sweep_scan_matcher_construct(sweep_error_s* error) try {
+  SWEEP_ASSERT(error);
+
+  return new sweep_scan_matcher;
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_scan_matcher_destruct(sweep_scan_matcher_s matcher) {
+  SWEEP_ASSERT(matcher);
+
+  delete matcher;
+}
+
+void sweep_scan_matcher_set_search_window(sweep_scan_matcher_s matcher, float linear_window, int32_t angular_window,
+                                          float resolution) {
+  SWEEP_ASSERT(matcher);
+  SWEEP_ASSERT(linear_window >= 0.0f);
+  SWEEP_ASSERT(angular_window >= 0 && angular_window <= 180000);
+  SWEEP_ASSERT(resolution > 0.0f);
+
+  matcher->linear_window = linear_window;
+  matcher->angular_window = angular_window;
+  matcher->resolution = resolution;
+
+  // Grids depend on the window and resolution
+  build_grids(*matcher);
+}
+
+void sweep_scan_matcher_set_refinement(sweep_scan_matcher_s matcher, int32_t iterations, float max_distance) {
+  SWEEP_ASSERT(matcher);
+  SWEEP_ASSERT(iterations >= 0);
+  SWEEP_ASSERT(max_distance > 0.0f);
+
+  matcher->iterations = iterations;
+  matcher->max_distance = max_distance;
+}
+
+void sweep_scan_matcher_set_reference(sweep_scan_matcher_s matcher, sweep_scan_s scan, sweep_error_s* error) try {
+  SWEEP_ASSERT(matcher);
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(error);
+
+  matcher->reference_count =
+      collect_points(scan, matcher->reference_x.data(), matcher->reference_y.data(), matcher->reference_step.data());
+
+  build_reference_index(*matcher);
+  build_grids(*matcher);
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+}
+
+int32_t sweep_scan_matcher_match(sweep_scan_matcher_s matcher, sweep_scan_s scan, int32_t* angle, float* x, float* y) {
+  SWEEP_ASSERT(matcher);
+  SWEEP_ASSERT(scan);
+  SWEEP_ASSERT(angle);
+  SWEEP_ASSERT(x);
+  SWEEP_ASSERT(y);
+
+  matcher->source_count = collect_points(scan, matcher->source_x.data(), matcher->source_y.data(), nullptr);
+
+  if (matcher->reference_count == 0 || matcher->source_count == 0)
+    return 0;
+
+  matcher_pose pose{sweep::trig::wrap_millideg(*angle) / 1000.0f * kDegreeToRadian, *x, *y};
+
+  if (matcher->linear_window > 0.0f || matcher->angular_window > 0)
+    pose = correlative_search(*matcher, pose);
+
+  const int32_t inliers = refine(*matcher, pose);
+
+  const float degree = pose.angle / kDegreeToRadian;
+  *angle = sweep::trig::wrap_millideg(static_cast<int32_t>(std::floor(degree * 1000.0f + 0.5f)));
+  *x = pose.x;
+  *y = pose.y;
+
+  return inliers;
+}
@@ -0,0 +1,305 @@
+#include "error.hpp"
+#include "scan.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <vector>
+
+// Uniform grid of buckets over a square around the origin, stored as flat arrays (compressed rows):
+// points are counting-sorted by bucket, bucket b holds the sorted points [start[b], start[b + 1]).
+// Points outside the square go into an overflow list which queries check exhaustively.
+struct sweep_spatial_index {
+  sweep_spatial_index(float cell_size, float extent, int32_t max_points)
+      : cell_size{cell_size}, extent{extent}, cells_per_side{static_cast<int32_t>(std::ceil(2 * extent / cell_size))},
+        start(static_cast<size_t>(cells_per_side) * cells_per_side + 1), x(max_points), y(max_points), bucket(max_points),
+        sorted_x(max_points), sorted_y(max_points), sorted_id(max_points), overflow(max_points) {}
+
+  float cell_size;
+  float extent;
+  int32_t cells_per_side;
+
+  std::vector<int32_t> start;
+
+  // Points in insertion order
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<int32_t> bucket;
+  int32_t count = 0;
+
+  // Points sorted by bucket
+  std::vector<float> sorted_x;
+  std::vector<float> sorted_y;
+  std::vector<int32_t> sorted_id;
+
+  std::vector<int32_t> overflow;
+  int32_t overflow_count = 0;
+};
+
+// Clamped to one cell outside the grid: cells farther out hold no buckets either, and far off, infinite or NaN
+// coordinates must not overflow the cast. Moving a query out of the grid only moves it farther from every bucket.
+static int32_t cell_of(const sweep_spatial_index& index, float v) {
+  const float cell = std::floor((v + index.extent) / index.cell_size);
+
+  if (!(cell > -1.0f))
+    return -1;
+
+  if (cell >= index.cells_per_side)
+    return index.cells_per_side;
+
+  return static_cast<int32_t>(cell);
+}
+
+static bool in_grid(const sweep_spatial_index& index, int32_t cx, int32_t cy) {
+  return cx >= 0 && cy >= 0 && cx < index.cells_per_side && cy < index.cells_per_side;
+}
+
+// Checks all points in bucket (cx, cy) against the current nearest
+static void nearest_in_bucket(const sweep_spatial_index& index, int32_t cx, int32_t cy, float x, float y, float& best_squared,
+                              int32_t& best) {
+  if (!in_grid(index, cx, cy))
+    return;
+
+  const int32_t b = cy * index.cells_per_side + cx;
+
+  for (int32_t n = index.start[b]; n < index.start[b + 1]; ++n) {
+    const float dx = index.sorted_x[n] - x;
+    const float dy = index.sorted_y[n] - y;
+    const float squared = dx * dx + dy * dy;
+
+    if (squared < best_squared) {
+      best_squared = squared;
+      best = index.sorted_id[n];
+    }
+  }
+}
+
+static int32_t nearest(const sweep_spatial_index& index, float x, float y, float max_distance) {
+  float best_squared = max_distance * max_distance;
+  int32_t best = -1;
+
+  for (int32_t n = 0; n < index.overflow_count; ++n) {
+    const int32_t id = index.overflow[n];
+    const float dx = index.x[id] - x;
+    const float dy = index.y[id] - y;
+    const float squared = dx * dx + dy * dy;
+
+    if (squared <= best_squared) {
+      best_squared = squared;
+      best = id;
+    }
+  }
+
+  // All points in overflow
+  if (index.overflow_count == index.count)
+    return best;
+
+  const int32_t cx = cell_of(index, x);
+  const int32_t cy = cell_of(index, y);
+
+  // From one cell outside the grid no bucket is more than cells_per_side rings away, bounding infinite or huge distances
+  const float rings = std::ceil(max_distance / index.cell_size) + 1;
+  const int32_t max_ring = rings < index.cells_per_side ? static_cast<int32_t>(rings) : index.cells_per_side;
+
+  // Expanding square rings of buckets; points in ring r + 1 and beyond are at least r cells away
+  for (int32_t ring = 0; ring <= max_ring; ++ring) {
+    if (ring == 0) {
+      nearest_in_bucket(index, cx, cy, x, y, best_squared, best);
+    } else {
+      for (int32_t d = -ring; d <= ring; ++d) {
+        nearest_in_bucket(index, cx + d, cy - ring, x, y, best_squared, best);
+        nearest_in_bucket(index, cx + d, cy + ring, x, y, best_squared, best);
+      }
+      for (int32_t d = -ring + 1; d <= ring - 1; ++d) {
+        nearest_in_bucket(index, cx - ring, cy + d, x, y, best_squared, best);
+        nearest_in_bucket(index, cx + ring, cy + d, x, y, best_squared, best);
+      }
+    }
+
+    const float covered = ring * index.cell_size;
+
+    if (best >= 0 && best_squared <= covered * covered)
+      break;
+  }
+
+  return best;
+}
+
+sweep_spatial_index_s sweep_spatial_index_construct(float cell_size, float extent, int32_t max_points, sweep_error_s* error) try {
+  SWEEP_ASSERT(cell_size > 0.0f);
+  SWEEP_ASSERT(extent > 0.0f);
+  SWEEP_ASSERT(2 * extent / cell_size <= 16384.0f && "too many buckets");
+  SWEEP_ASSERT(max_points > 0);
+  SWEEP_ASSERT(error);
+
+  return new sweep_spatial_index{cell_size, extent, max_points};
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_spatial_index_destruct(sweep_spatial_index_s index) {
+  SWEEP_ASSERT(index);
+
+  delete index;
+}
+
+void sweep_spatial_index_clear(sweep_spatial_index_s index) {
+  SWEEP_ASSERT(index);
+
+  index->count = 0;
+  index->overflow_count = 0;
+  std::fill(index->start.begin(), index->start.end(), 0);
+}
+
+void sweep_spatial_index_add_scan(sweep_spatial_index_s index, sweep_scan_s scan, int32_t pose_angle, float pose_x,
+                                  float pose_y) {
+  SWEEP_ASSERT(index);
+  SWEEP_ASSERT(scan);
+
+  const int32_t capacity = static_cast<int32_t>(index->x.size());
+  SWEEP_ASSERT(index->count + scan->count <= capacity && "spatial index is full");
+  (void)capacity;
+
+  float* x = index->x.data() + index->count;
+  float* y = index->y.data() + index->count;
+
+  sweep_scan_to_cartesian(scan, pose_angle, pose_x, pose_y, x, y);
+
+  // Keep samples with a return only, compacting in place
+  int32_t added = 0;
+
+  for (int32_t n = 0; n < scan->count; ++n) {
+    if (scan->samples[n].distance <= 0)
+      continue;
+
+    x[added] = x[n];
+    y[added] = y[n];
+    added += 1;
+  }
+
+  index->count += added;
+}
+
+void sweep_spatial_index_build(sweep_spatial_index_s index) {
+  SWEEP_ASSERT(index);
+
+  auto& start = index->start;
+  const int32_t buckets = index->cells_per_side * index->cells_per_side;
+
+  std::fill(start.begin(), start.end(), 0);
+  index->overflow_count = 0;
+
+  // Counting sort: histogram, prefix sum, scatter; linear in points plus buckets
+  for (int32_t n = 0; n < index->count; ++n) {
+    const int32_t cx = cell_of(*index, index->x[n]);
+    const int32_t cy = cell_of(*index, index->y[n]);
+
+    if (!in_grid(*index, cx, cy)) {
+      index->bucket[n] = -1;
+      index->overflow[index->overflow_count++] = n;
+      continue;
+    }
+
+    const int32_t b = cy * index->cells_per_side + cx;
+    index->bucket[n] = b;
+    start[b + 1] += 1;
+  }
+
+  for (int32_t b = 0; b < buckets; ++b)
+    start[b + 1] += start[b];
+
+  for (int32_t n = 0; n < index->count; ++n) {
+    const int32_t b = index->bucket[n];
+
+    if (b < 0)
+      continue;
+
+    // start[b] serves as the running insertion cursor and ends up at the next bucket's start
+    const int32_t slot = start[b]++;
+    index->sorted_x[slot] = index->x[n];
+    index->sorted_y[slot] = index->y[n];
+    index->sorted_id[slot] = n;
+  }
+
+  // Shift the cursors back into bucket starts
+  for (int32_t b = buckets; b > 0; --b)
+    start[b] = start[b - 1];
+  start[0] = 0;
+}
+
+int32_t sweep_spatial_index_get_number_of_points(sweep_spatial_index_s index) {
+  SWEEP_ASSERT(index);
+
+  return index->count;
+}
+
+void sweep_spatial_index_get_point(sweep_spatial_index_s index, int32_t point, float* x, float* y) {
+  SWEEP_ASSERT(index);
+  SWEEP_ASSERT(point >= 0 && point < index->count && "point index out of bounds");
+  SWEEP_ASSERT(x);
+  SWEEP_ASSERT(y);
+
+  *x = index->x[point];
+  *y = index->y[point];
+}
+
+void sweep_spatial_index_nearest(sweep_spatial_index_s index, const float* x, const float* y, int32_t count, float max_distance,
+                                 int32_t* points) {
+  SWEEP_ASSERT(index);
+  SWEEP_ASSERT(x);
+  SWEEP_ASSERT(y);
+  SWEEP_ASSERT(count >= 0);
+  SWEEP_ASSERT(max_distance >= 0.0f);
+  SWEEP_ASSERT(points);
+
+  for (int32_t n = 0; n < count; ++n)
+    points[n] = nearest(*index, x[n], y[n], max_distance);
+}
+
+int32_t sweep_spatial_index_within(sweep_spatial_index_s index, float x, float y, float radius, int32_t* points,
+                                   int32_t capacity) {
+  SWEEP_ASSERT(index);
+  SWEEP_ASSERT(radius >= 0.0f);
+  SWEEP_ASSERT(capacity >= 0);
+  SWEEP_ASSERT(points || capacity == 0);
+
+  const float radius_squared = radius * radius;
+  int32_t found = 0;
+
+  const auto visit = [&](int32_t id, float px, float py) {
+    const float dx = px - x;
+    const float dy = py - y;
+
+    if (dx * dx + dy * dy <= radius_squared) {
+      if (found < capacity)
+        points[found] = id;
+      found += 1;
+    }
+  };
+
+  for (int32_t n = 0; n < index->overflow_count; ++n) {
+    const int32_t id = index->overflow[n];
+    visit(id, index->x[id], index->y[id]);
+  }
+
+  const int32_t last = index->cells_per_side - 1;
+
+  const int32_t min_cx = std::max(0, cell_of(*index, x - radius));
+  const int32_t max_cx = std::min(last, cell_of(*index, x + radius));
+  const int32_t min_cy = std::max(0, cell_of(*index, y - radius));
+  const int32_t max_cy = std::min(last, cell_of(*index, y + radius));
+
+  for (int32_t cy = min_cy; cy <= max_cy; ++cy) {
+    for (int32_t cx = min_cx; cx <= max_cx; ++cx) {
+      const int32_t b = cy * index->cells_per_side + cx;
+
+      for (int32_t n = index->start[b]; n < index->start[b + 1]; ++n)
+        visit(index->sorted_id[n], index->sorted_x[n], index->sorted_y[n]);
+    }
+  }
+
+  return found;
+}
@@ -1,25 +1,552 @@
 #include <cinttypes>
+#include <csignal>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
 #include <sweep/sweep.hpp>
 
 static const auto kMotorSpeedCmd = "motor_speed";
 static const auto kSampleRateCmd = "sample_rate";
+static const auto kLogCmd = "log";
+static const auto kRecordCmd = "record";
+static const auto kStreamCmd = "stream";
+static const auto kBenchCmd = "bench";
+static const auto kDiscoverCmd = "discover";
+
+// Ports not answering within this many milli-seconds have no device behind them
+static const std::int32_t kDiscoverTimeout = 250;
+
+// Scans waiting for the output; beyond, acquisition drops them instead of waiting on a slow disk or pipe
+static const std::size_t kMaxQueued = 64;
+
+// Output is written in chunks of about this size, or whenever the queue runs dry
+static const std::size_t kWriteBytes = 1 << 20;
+
+static std::atomic<bool> stop{false};
+
+static void handle_signal(int) { stop = true; }
 
 static void usage() {
   std::fprintf(stderr, "Usage:\n");
+  std::fprintf(stderr, "  sweep-ctl discover [<dev>...]\n");
   std::fprintf(stderr, "  sweep-ctl dev get (motor_speed|sample_rate)\n");
   std::fprintf(stderr, "  sweep-ctl dev set (motor_speed|sample_rate) <value>\n");
+  std::fprintf(stderr, "  sweep-ctl dev record <file>\n");
+  std::fprintf(stderr, "  sweep-ctl dev stream [--format=bin|csv]\n");
+  std::fprintf(stderr, "  sweep-ctl dev bench [--duration=60s]\n");
+  std::fprintf(stderr, "  sweep-ctl log info <file>\n");
+  std::fprintf(stderr, "  sweep-ctl log dump <file> [<from> [<to>]]\n");
+  std::fprintf(stderr, "  sweep-ctl log bench <file>\n");
   std::exit(EXIT_FAILURE);
 }
 
+// Summary of a scan log from its index alone, without touching any samples
+static void log_info(const std::string& path) {
+  sweep::log_reader log{path.c_str()};
+
+  const auto scans = log.get_number_of_scans();
+
+  std::printf("scans     %" PRId32 "\n", scans);
+  std::printf("indexed   %s\n", log.is_indexed() ? "yes" : "no, recovered up to the last full chunk");
+
+  if (scans == 0)
+    return;
+
+  const auto first = log.get(0).timestamp;
+  const auto last = log.get(scans - 1).timestamp;
+
+  std::int64_t samples = 0;
+  for (std::int32_t n = 0; n < scans; ++n)
+    samples += log.get(n).count;
+
+  const double seconds = (last - first) / 1e6;
+
+  std::printf("first     %" PRId64 "\n", first);
+  std::printf("last      %" PRId64 "\n", last);
+  std::printf("duration  %.3f s\n", seconds);
+  std::printf("rate      %.2f Hz\n", seconds > 0 ? (scans - 1) / seconds : 0.0);
+  std::printf("samples   %.1f per scan\n", static_cast<double>(samples) / scans);
+}
+
+// Samples of the scans in [from, to) as CSV, seeking to from without reading the scans before it
+static void log_dump(const std::string& path, std::int64_t from, std::int64_t to) {
+  sweep::log_reader log{path.c_str()};
+
+  const auto scans = log.get_number_of_scans();
+
+  std::printf("timestamp,angle,distance,signal_strength\n");
+
+  for (auto n = log.seek(from); n < scans; ++n) {
+    const auto entry = log.get(n);
+
+    if (entry.timestamp >= to)
+      break;
+
+    for (std::int32_t i = 0; i < entry.count; ++i) {
+      const auto& sample = entry.samples[i];
+      std::printf("%" PRId64 ",%" PRId32 ",%" PRId32 ",%" PRId32 "\n", entry.timestamp, sample.angle, sample.distance,
+                  sample.signal_strength);
+    }
+  }
+}
+
+// Micro-seconds since the epoch as of the first call, advanced by the monotonic clock from there: the wall clock being
+// set, e.g. by NTP, neither runs timestamps backwards, which scan logs refuse, nor shows up as scan interval jitter
+static std::int64_t now_us() {
+  static const auto wall = std::chrono::system_clock::now().time_since_epoch();
+  static const auto start = std::chrono::steady_clock::now();
+
+  const auto now = wall + (std::chrono::steady_clock::now() - start);
+  return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+// Tells about drops while running, at most once a second
+static void report_drops(std::int64_t dropped, std::int64_t& reported) {
+  if (dropped > reported) {
+    std::fprintf(stderr, "%" PRId64 " scans dropped so far, output can not keep up\n", dropped);
+    reported = dropped;
+  }
+}
+
+// Records into a scan log, whose writer thread takes care of large writes and drops scans the disk can not keep up with
+static void record(const std::string& dev, const std::string& path) {
+  sweep::log_writer log{path.c_str()};
+  sweep::sweep device{dev.c_str()};
+
+  device.start_scanning();
+
+  std::int64_t scans = 0, reported = 0;
+  auto report = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+  while (!stop) {
+    log.append(device.get_scan(), now_us());
+    scans += 1;
+
+    if (std::chrono::steady_clock::now() >= report) {
+      report_drops(log.get_dropped(), reported);
+      report += std::chrono::seconds(1);
+    }
+  }
+
+  device.stop_scanning();
+
+  std::fprintf(stderr, "%" PRId64 " scans recorded, %" PRId64 " dropped\n", scans - log.get_dropped(), log.get_dropped());
+}
+
+struct timed_scan {
+  std::int64_t timestamp;
+  sweep::scan scan;
+};
+
+// Handed from acquisition to the writer thread
+struct output_queue {
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<timed_scan> scans;
+  std::int64_t dropped = 0;
+  bool done = false;
+  bool failed = false;
+};
+
+static void put_le(std::vector<std::uint8_t>& out, std::uint64_t value, std::size_t bytes) {
+  for (std::size_t n = 0; n < bytes; ++n)
+    out.push_back(static_cast<std::uint8_t>(value >> (8 * n)));
+}
+
+// The framing sweep-stream uses on the network: a 32 byte header followed by a scan codec frame
+static void format_bin(sweep::encoder& encoder, std::uint64_t sequence, const timed_scan& item, std::vector<std::uint8_t>& out) {
+  const auto header = out.size();
+
+  put_le(out, 0x46535753, 4); // "SWSF"
+  put_le(out, 1, 1);          // version
+  put_le(out, 0, 1);          // sector
+  put_le(out, 1, 1);          // sectors
+  put_le(out, 0, 1);
+  put_le(out, sequence, 8);
+  put_le(out, static_cast<std::uint64_t>(item.timestamp), 8);
+  put_le(out, 0, 8); // payload bytes and reserved, patched below
+
+  encoder.encode(item.scan, out);
+
+  const auto payload = out.size() - header - 32;
+
+  for (std::size_t n = 0; n < 4; ++n)
+    out[header + 24 + n] = static_cast<std::uint8_t>(payload >> (8 * n));
+}
+
+static void format_csv(const timed_scan& item, std::vector<std::uint8_t>& out) {
+  char line[96];
+
+  for (const auto& sample : item.scan.samples) {
+    const int length = std::snprintf(line, sizeof(line), "%" PRId64 ",%" PRId32 ",%" PRId32 ",%" PRId32 "\n", item.timestamp,
+                                     sample.angle, sample.distance, sample.signal_strength);
+    out.insert(out.end(), line, line + length);
+  }
+}
+
+static bool write_all(std::vector<std::uint8_t>& buffer) {
+  const bool written = std::fwrite(buffer.data(), 1, buffer.size(), stdout) == buffer.size();
+  buffer.clear();
+  return written;
+}
+
+// Formats scans and writes them out in large chunks, without ever holding up acquisition
+static void write_output(output_queue& queue, bool binary) {
+  sweep::encoder encoder;
+
+  std::vector<std::uint8_t> buffer;
+  buffer.reserve(kWriteBytes + (1 << 16));
+
+  std::deque<timed_scan> scans;
+  std::uint64_t sequence = 0;
+
+  if (!binary) {
+    const std::string header = "timestamp,angle,distance,signal_strength\n";
+    buffer.insert(buffer.end(), header.begin(), header.end());
+  }
+
+  bool written = true;
+
+  while (written) {
+    {
+      std::unique_lock<std::mutex> lock{queue.mutex};
+      queue.ready.wait(lock, [&queue] { return !queue.scans.empty() || queue.done; });
+
+      if (queue.scans.empty())
+        break;
+
+      scans.swap(queue.scans);
+    }
+
+    for (const auto& item : scans) {
+      if (binary)
+        format_bin(encoder, sequence, item, buffer);
+      else
+        format_csv(item, buffer);
+
+      sequence += 1;
+
+      if (buffer.size() >= kWriteBytes && !write_all(buffer))
+        written = false;
+    }
+
+    scans.clear();
+
+    written = written && write_all(buffer);
+  }
+
+  if (!written) {
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    queue.failed = true;
+  }
+}
+
+// Streams live scans to stdout for piping, through a writer thread so a slow consumer only costs dropped scans
+static void stream(const std::string& dev, bool binary) {
+#ifdef _WIN32
+  if (binary)
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+  // Large writes go straight through
+  std::setvbuf(stdout, nullptr, _IONBF, 0);
+
+  sweep::sweep device{dev.c_str()};
+
+  output_queue queue;
+  std::thread writer{write_output, std::ref(queue), binary};
+
+  device.start_scanning();
+
+  std::int64_t scans = 0, reported = 0;
+  auto report = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+  while (!stop) {
+    timed_scan item{0, device.get_scan()};
+    item.timestamp = now_us();
+    scans += 1;
+
+    std::int64_t dropped = 0;
+
+    {
+      std::lock_guard<std::mutex> lock{queue.mutex};
+
+      if (queue.failed)
+        break;
+
+      if (queue.scans.size() >= kMaxQueued)
+        queue.dropped += 1;
+      else
+        queue.scans.push_back(std::move(item));
+
+      dropped = queue.dropped;
+    }
+
+    queue.ready.notify_one();
+
+    if (std::chrono::steady_clock::now() >= report) {
+      report_drops(dropped, reported);
+      report += std::chrono::seconds(1);
+    }
+  }
+
+  device.stop_scanning();
+
+  {
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    queue.done = true;
+  }
+
+  queue.ready.notify_one();
+  writer.join();
+
+  if (queue.failed)
+    throw std::runtime_error{"writing to stdout failed"};
+
+  std::fprintf(stderr, "%" PRId64 " scans streamed, %" PRId64 " dropped\n", scans - queue.dropped, queue.dropped);
+}
+
+// Arrival times in us and sample counts of consecutive scans, live or recorded
+struct scan_timing {
+  std::vector<std::int64_t> timestamps;
+  std::vector<std::int32_t> samples;
+};
+
+static double percentile(const std::vector<double>& sorted, double p) {
+  return sorted[static_cast<std::size_t>(p * (sorted.size() - 1) + 0.5)];
+}
+
+// Rates measured from the second scan on, the first one may have started mid-rotation; nominal values of zero are unknown
+static void report_timing(const scan_timing& timing, std::int32_t motor_speed, std::int32_t sample_rate) {
+  const auto scans = timing.timestamps.size();
+
+  if (scans < 3)
+    throw std::runtime_error{"too few scans for measuring, bench for longer"};
+
+  const double seconds = (timing.timestamps.back() - timing.timestamps.front()) / 1e6;
+
+  std::int64_t samples = 0;
+  for (std::size_t n = 1; n < scans; ++n)
+    samples += timing.samples[n];
+
+  std::vector<double> intervals;
+  for (std::size_t n = 1; n < scans; ++n)
+    intervals.push_back((timing.timestamps[n] - timing.timestamps[n - 1]) / 1e3);
+
+  std::sort(intervals.begin(), intervals.end());
+
+  std::printf("duration     %.3f s\n", seconds);
+  std::printf("scans        %zu\n", scans);
+
+  std::printf("scans/s      %.3f", (scans - 1) / seconds);
+  if (motor_speed > 0)
+    std::printf(" (motor speed %" PRId32 " Hz)", motor_speed);
+  std::printf("\n");
+
+  // The firmware only guarantees ranges: 500-600, 750-800 and 1000-1050 Hz
+  std::printf("samples/s    %.1f", samples / seconds);
+  if (sample_rate > 0)
+    std::printf(" (nominal %" PRId32 "-%" PRId32 " Hz)", sample_rate,
+                sample_rate == 500 ? 600 : sample_rate == 750 ? 800 : 1050);
+  std::printf("\n");
+
+  std::printf("interval     p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms", percentile(intervals, 0.5),
+              percentile(intervals, 0.9), percentile(intervals, 0.99), intervals.back());
+  if (motor_speed > 0)
+    std::printf(" (nominal %.2f ms)", 1e3 / motor_speed);
+  std::printf("\n");
+
+  // Spread around the median, independent of whether the motor runs at its nominal speed
+  std::printf("jitter       p90 %.2f ms, p99 %.2f ms\n", percentile(intervals, 0.9) - percentile(intervals, 0.5),
+              percentile(intervals, 0.99) - percentile(intervals, 0.5));
+}
+
+// CPU time the process spent so far, in user and kernel mode over all threads
+static double process_cpu_seconds() {
+#ifdef _WIN32
+  FILETIME creation, exit, kernel, user;
+
+  if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+    return 0.0;
+
+  const auto ticks = [](const FILETIME& t) { return (static_cast<std::uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime; };
+
+  // In 100 ns ticks
+  return (ticks(kernel) + ticks(user)) / 1e7;
+#else
+  rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0.0;
+
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#endif
+}
+
+// Measures what a live sensor actually delivers against its settings, including packet level errors and the process's
+// CPU time while receiving, nearly all of it spent by libsweep's background thread as this thread only waits for scans
+static void bench(const std::string& dev, std::int64_t duration) {
+  sweep::sweep device{dev.c_str()};
+
+  const auto motor_speed = device.get_motor_speed();
+  const auto sample_rate = device.get_sample_rate();
+
+  const auto startup = std::chrono::steady_clock::now();
+  device.start_scanning();
+
+  std::fprintf(stderr, "Scanning after %.2f s, measuring for %" PRId64 " s\n",
+               std::chrono::duration<double>(std::chrono::steady_clock::now() - startup).count(), duration);
+
+  scan_timing timing;
+
+  const double cpu = process_cpu_seconds();
+  const auto begin = std::chrono::steady_clock::now();
+  const auto end = begin + std::chrono::seconds(duration);
+
+  while (!stop && std::chrono::steady_clock::now() < end) {
+    const auto scan = device.get_scan();
+
+    timing.timestamps.push_back(now_us());
+    timing.samples.push_back(static_cast<std::int32_t>(scan.samples.size()));
+  }
+
+  const double cpu_seconds = process_cpu_seconds() - cpu;
+  const double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+  const auto counts = device.get_packet_counts();
+
+  device.stop_scanning();
+
+  report_timing(timing, motor_speed, sample_rate);
+
+  std::printf("packets      %" PRId64 ", %.1f/s\n", counts.packets, counts.packets / wall_seconds);
+  std::printf("error bits   %" PRId64 " packets\n", counts.error_packets);
+  std::printf("checksum     %" PRId64 " failures\n", counts.checksum_failures);
+  std::printf("process cpu  %.2f %% of a core\n", 100.0 * cpu_seconds / wall_seconds);
+}
+
+// The same measurements on a recorded scan log, e.g. a capture from the field
+static void log_bench(const std::string& path) {
+  sweep::log_reader log{path.c_str()};
+
+  scan_timing timing;
+
+  for (std::int32_t n = 0; n < log.get_number_of_scans(); ++n) {
+    const auto entry = log.get(n);
+
+    timing.timestamps.push_back(entry.timestamp);
+    timing.samples.push_back(entry.count);
+  }
+
+  report_timing(timing, 0, 0);
+}
+
+// Seconds, with an optional unit: 90, 90s, 15m or 2h
+static std::int64_t parse_duration(const std::string& arg) {
+  const std::string prefix = "--duration=";
+
+  if (arg.compare(0, prefix.size(), prefix) != 0)
+    usage();
+
+  std::size_t end = 0;
+  const auto value = std::stoll(arg.substr(prefix.size()), &end);
+  const auto unit = arg.substr(prefix.size() + end);
+
+  const std::int64_t scale = unit.empty() || unit == "s" ? 1 : unit == "m" ? 60 : unit == "h" ? 3600 : 0;
+
+  if (value <= 0 || scale == 0)
+    usage();
+
+  return value * scale;
+}
+
+// One line per device found: port, serial number, firmware version, motor speed and sample rate, tab separated;
+// streaming devices are marked scanning
+static void discover(const std::vector<std::string>& ports) {
+  for (const auto& device : sweep::discover_devices(kDiscoverTimeout, ports)) {
+    if (device.firmware_version == 0) {
+      std::printf("%s\tscanning\n", device.port.c_str());
+      continue;
+    }
+
+    std::printf("%s\t%s\t%" PRId32 ".%" PRId32 "\t%" PRId32 "\t%" PRId32 "%s\n", device.port.c_str(),
+                device.serial_number.c_str(), device.firmware_version >> 16, device.firmware_version & 0xffff, device.motor_speed,
+                device.sample_rate, device.scanning ? "\tscanning" : "");
+  }
+}
+
 int main(int argc, char** argv) try {
   std::vector<std::string> args{argv, argv + argc};
 
+  if (args.size() >= 2 && args[1] == kDiscoverCmd) {
+    discover({args.begin() + 2, args.end()});
+    return EXIT_SUCCESS;
+  }
+
+  if (args.size() == 4 && args[1] == kLogCmd && args[2] == "info") {
+    log_info(args[3]);
+    return EXIT_SUCCESS;
+  }
+
+  if (args.size() >= 4 && args.size() <= 6 && args[1] == kLogCmd && args[2] == "dump") {
+    const auto from = args.size() > 4 ? std::stoll(args[4]) : std::numeric_limits<std::int64_t>::min();
+    const auto to = args.size() > 5 ? std::stoll(args[5]) : std::numeric_limits<std::int64_t>::max();
+
+    log_dump(args[3], from, to);
+    return EXIT_SUCCESS;
+  }
+
+  if (args.size() == 4 && args[1] == kLogCmd && args[2] == kBenchCmd) {
+    log_bench(args[3]);
+    return EXIT_SUCCESS;
+  }
+
+  std::signal(SIGINT, handle_signal);
+  std::signal(SIGTERM, handle_signal);
+
+  if ((args.size() == 3 || args.size() == 4) && args[2] == kBenchCmd) {
+    bench(args[1], args.size() == 4 ? parse_duration(args[3]) : 60);
+    return EXIT_SUCCESS;
+  }
+
+  if (args.size() == 4 && args[2] == kRecordCmd) {
+    record(args[1], args[3]);
+    return EXIT_SUCCESS;
+  }
+
+  if ((args.size() == 3 || args.size() == 4) && args[2] == kStreamCmd) {
+    const auto format = args.size() == 4 ? args[3] : std::string{"--format=csv"};
+
+    if (format != "--format=bin" && format != "--format=csv")
+      usage();
+
+    stream(args[1], format == "--format=bin");
+    return EXIT_SUCCESS;
+  }
+
   const auto get = args.size() == 4 && args[2] == "get";
   const auto set = args.size() == 5 && args[2] == "set";
 
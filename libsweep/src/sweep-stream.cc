@@ -0,0 +1,730 @@
+// Publishes scans over TCP and UDP in a compact binary framing, read from a device or from the scan ring of sweepd.
+//
+// Every frame is a 32 byte header followed by a scan codec frame decodable on its own, see sweep_scan_decoder_s.
+// Header fields are little-endian:
+//
+//   0  magic "SWSF"     5  sector      8  sequence number   24  payload bytes
+//   4  version          6  sectors    16  timestamp in us   28  reserved
+//
+// TCP subscribers get one frame per scan. Frames are encoded once into pooled buffers shared by all subscribers and
+// sent without copying, batching whatever is queued for a subscriber into one scatter-gather sendmsg. Subscribers
+// falling more than the queue length behind are handled by their drop policy, chosen by sending a line
+// "policy (drop-oldest|drop-newest|disconnect)" at any time. UDP subscribers register by sending "subscribe" to the
+// same port, at least every 10 seconds; they get scans split into sectors small enough for one datagram each, with
+// consecutive sectors batched into as few datagrams as possible.
+//
+// Both listen on loopback unless bound to another address, as any host reaching the port could otherwise subscribe
+// some third party's address to the datagrams.
+
+#include <cinttypes>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <errno.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <sweep/sweep.h>
+
+static const std::uint32_t kMagic = 0x46535753; // "SWSF"
+static const std::uint8_t kVersion = 1;
+static const std::size_t kHeaderBytes = 32;
+
+// Datagrams stay below the MTU of common paths, avoiding IP fragmentation
+static const std::size_t kDatagramBytes = 1400;
+
+static const auto kSubscriptionTimeout = std::chrono::seconds(10);
+static const auto kStatsInterval = std::chrono::seconds(10);
+
+// Scans waiting for the network thread; the oldest get dropped beyond, so the source never blocks
+static const std::size_t kMaxBacklog = 16;
+
+// Bounds what the kernel buffers per TCP subscriber, so slow ones run into their drop policy instead of lagging
+// seconds behind in socket buffers
+static const int kSendBuffer = 256 * 1024;
+
+// Frames gathered into one sendmsg call
+static const std::size_t kMaxBatch = 64;
+
+// Lines longer than this are not commands; the subscriber gets disconnected
+static const std::size_t kMaxLine = 256;
+
+static std::atomic<bool> stop{false};
+
+static void handle_signal(int) { stop = true; }
+
+static void usage() {
+  std::fprintf(stderr, "Usage:\n");
+  std::fprintf(stderr, "  sweep-stream (dev|ring:<name>) [--bind=127.0.0.1] [--port=5000] [--queue=8]\n"
+                       "               [--policy=drop-oldest|drop-newest|disconnect]\n");
+  std::exit(EXIT_FAILURE);
+}
+
+// Turns errors from the C interface into exceptions
+static void check(sweep_error_s error) {
+  if (error) {
+    const std::string what = sweep_error_message(error);
+    sweep_error_destruct(error);
+    throw std::runtime_error{what};
+  }
+}
+
+static std::int64_t now_us() {
+  const auto now = std::chrono::system_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+enum class policy { drop_oldest, drop_newest, disconnect };
+
+static bool parse_policy(const std::string& name, policy& out) {
+  if (name == "drop-oldest")
+    out = policy::drop_oldest;
+  else if (name == "drop-newest")
+    out = policy::drop_newest;
+  else if (name == "disconnect")
+    out = policy::disconnect;
+  else
+    return false;
+
+  return true;
+}
+
+// A scan encoded once, for TCP as a single frame or for UDP as sector frames with the byte ranges of the datagrams
+// batching them
+struct frame {
+  std::vector<std::uint8_t> bytes;
+  std::vector<std::pair<std::size_t, std::size_t>> datagrams;
+};
+
+using frame_ptr = std::shared_ptr<frame>;
+
+struct client {
+  int fd;
+  policy drop_policy;
+  std::deque<frame_ptr> queue;
+  std::size_t offset; // bytes of the queue's front already sent
+  std::int64_t dropped;
+  std::string input;
+};
+
+struct subscriber {
+  sockaddr_storage address;
+  socklen_t length;
+  std::chrono::steady_clock::time_point expires;
+};
+
+struct source_scan {
+  sweep_scan_s scan;
+  std::int64_t timestamp;
+};
+
+struct server {
+  std::string source;
+  std::string bind = "127.0.0.1";
+  std::uint16_t port = 5000;
+  std::size_t queue = 8;
+  policy drop_policy = policy::drop_oldest;
+
+  // Handed over from the source thread, which wakes the network thread through the pipe
+  std::mutex mutex;
+  std::deque<source_scan> incoming;
+  std::vector<sweep_scan_s> spare;
+  std::int64_t backlog_dropped = 0;
+  int wake[2];
+  std::atomic<bool> failed{false};
+
+  // Owned by the network thread
+  int listener = -1;
+  int udp = -1;
+
+  sweep_scan_encoder_s encoder = nullptr;
+  sweep_scan_s sector = nullptr;
+  std::int32_t sector_samples = 0;
+
+  std::vector<frame_ptr> pool;
+  std::vector<client> clients;
+  std::vector<subscriber> subscribers;
+
+  std::uint64_t sequence = 0;
+  std::int64_t policy_dropped = 0;
+};
+
+// Keeps a few scans around for the ring source to read into; the device source hands out new ones anyway
+static void recycle(server& s, sweep_scan_s scan) {
+  if (s.spare.size() < kMaxBacklog)
+    s.spare.push_back(scan);
+  else
+    sweep_scan_destruct(scan);
+}
+
+// Source thread: scans from the device, or from the ring, attaching again whenever the ring's writer restarts
+static void produce(server& s) try {
+  const bool from_ring = s.source.compare(0, 5, "ring:") == 0;
+
+  sweep_device_s device = nullptr;
+  sweep_ring_reader_s reader = nullptr;
+
+  sweep_error_s error = nullptr;
+
+  if (!from_ring) {
+    device = sweep_device_construct_simple(s.source.c_str(), &error);
+    check(error);
+
+    sweep_device_start_scanning(device, &error);
+
+    if (error)
+      sweep_device_destruct(device);
+
+    check(error);
+  }
+
+  while (!stop) {
+    source_scan item{nullptr, 0};
+
+    if (device) {
+      item.scan = sweep_device_get_scan(device, &error);
+
+      if (error)
+        sweep_device_destruct(device);
+
+      check(error);
+      item.timestamp = now_us();
+    } else {
+      if (!reader) {
+        reader = sweep_ring_reader_construct(s.source.c_str() + 5, &error);
+
+        if (error) {
+          sweep_error_destruct(error);
+          error = nullptr;
+          std::this_thread::sleep_for(std::chrono::seconds(1));
+          continue;
+        }
+      }
+
+      {
+        std::lock_guard<std::mutex> lock{s.mutex};
+
+        if (!s.spare.empty()) {
+          item.scan = s.spare.back();
+          s.spare.pop_back();
+        }
+      }
+
+      if (!item.scan) {
+        item.scan = sweep_scan_construct(0, &error);
+        check(error);
+      }
+
+      const auto sequence = sweep_ring_reader_read(reader, 200, item.scan, &item.timestamp, &error);
+
+      if (sequence < 0) {
+        std::lock_guard<std::mutex> lock{s.mutex};
+        recycle(s, item.scan);
+      }
+
+      // Closed by its writer
+      if (error) {
+        sweep_error_destruct(error);
+        error = nullptr;
+        sweep_ring_reader_destruct(reader);
+        reader = nullptr;
+      }
+
+      if (sequence < 0)
+        continue;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock{s.mutex};
+
+      if (s.incoming.size() >= kMaxBacklog) {
+        recycle(s, s.incoming.front().scan);
+        s.incoming.pop_front();
+        s.backlog_dropped += 1;
+      }
+
+      s.incoming.push_back(item);
+    }
+
+    const char signal = 1;
+    (void)write(s.wake[1], &signal, 1);
+  }
+
+  if (device)
+    sweep_device_destruct(device);
+
+  if (reader)
+    sweep_ring_reader_destruct(reader);
+} catch (const std::exception& e) {
+  std::fprintf(stderr, "Error: %s\n", e.what());
+  s.failed = true;
+  stop = true;
+}
+
+static void put_le(std::uint8_t* out, std::uint64_t value, std::size_t bytes) {
+  for (std::size_t n = 0; n < bytes; ++n)
+    out[n] = static_cast<std::uint8_t>(value >> (8 * n));
+}
+
+// Appends a frame holding the scan to out
+static void append_frame(server& s, sweep_scan_s scan, std::uint8_t sector, std::uint8_t sectors, std::int64_t timestamp,
+                         std::vector<std::uint8_t>& out) {
+  const auto offset = out.size();
+  const auto bound = sweep_scan_encode_bound(sweep_scan_get_number_of_samples(scan));
+
+  out.resize(offset + kHeaderBytes + bound);
+
+  const auto size = sweep_scan_encoder_encode(s.encoder, scan, out.data() + offset + kHeaderBytes, bound);
+
+  out.resize(offset + kHeaderBytes + size);
+
+  std::uint8_t* header = out.data() + offset;
+  std::memset(header, 0, kHeaderBytes);
+
+  put_le(header, kMagic, 4);
+  header[4] = kVersion;
+  header[5] = sector;
+  header[6] = sectors;
+  put_le(header + 8, s.sequence, 8);
+  put_le(header + 16, static_cast<std::uint64_t>(timestamp), 8);
+  put_le(header + 24, static_cast<std::uint32_t>(size), 4);
+}
+
+// Buffers nobody refers to anymore get reused, so steady state streaming does not allocate
+static frame_ptr take_frame(server& s) {
+  for (const auto& f : s.pool) {
+    if (f.use_count() == 1) {
+      f->bytes.clear();
+      f->datagrams.clear();
+      return f;
+    }
+  }
+
+  s.pool.push_back(std::make_shared<frame>());
+  return s.pool.back();
+}
+
+static frame_ptr encode_scan(server& s, const source_scan& item) {
+  auto f = take_frame(s);
+  append_frame(s, item.scan, 0, 1, item.timestamp, f->bytes);
+  return f;
+}
+
+static frame_ptr encode_sectors(server& s, const source_scan& item) {
+  auto f = take_frame(s);
+
+  const auto count = sweep_scan_get_number_of_samples(item.scan);
+  const auto sectors = std::max<std::int32_t>(1, (count + s.sector_samples - 1) / s.sector_samples);
+
+  std::size_t datagram = 0;
+
+  for (std::int32_t sector = 0; sector < sectors; ++sector) {
+    const auto first = sector * s.sector_samples;
+    const auto last = std::min(count, first + s.sector_samples);
+
+    sweep_scan_set_number_of_samples(s.sector, last - first);
+
+    for (auto n = first; n < last; ++n)
+      sweep_scan_set_sample(s.sector, n - first, sweep_scan_get_angle(item.scan, n), sweep_scan_get_distance(item.scan, n),
+                            sweep_scan_get_signal_strength(item.scan, n));
+
+    const auto begin = f->bytes.size();
+    append_frame(s, s.sector, static_cast<std::uint8_t>(sector), static_cast<std::uint8_t>(sectors), item.timestamp, f->bytes);
+
+    // Starts a new datagram if this sector does not fit into the current one anymore
+    if (f->bytes.size() - datagram > kDatagramBytes) {
+      f->datagrams.emplace_back(datagram, begin - datagram);
+      datagram = begin;
+    }
+  }
+
+  f->datagrams.emplace_back(datagram, f->bytes.size() - datagram);
+  return f;
+}
+
+// Sends as much of the queue as the socket takes; returns false if the client has to be disconnected
+static bool flush(client& c) {
+  while (!c.queue.empty()) {
+    iovec iov[kMaxBatch];
+    std::size_t count = 0;
+
+    for (const auto& f : c.queue) {
+      if (count == kMaxBatch)
+        break;
+
+      const std::size_t skip = count == 0 ? c.offset : 0;
+
+      iov[count].iov_base = f->bytes.data() + skip;
+      iov[count].iov_len = f->bytes.size() - skip;
+      count += 1;
+    }
+
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = iov;
+    message.msg_iovlen = count;
+
+    ssize_t sent = sendmsg(c.fd, &message, 0);
+
+    if (sent < 0) {
+      if (errno == EINTR)
+        continue;
+
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+
+    while (sent > 0) {
+      const auto remaining = c.queue.front()->bytes.size() - c.offset;
+
+      if (static_cast<std::size_t>(sent) >= remaining) {
+        sent -= static_cast<ssize_t>(remaining);
+        c.queue.pop_front();
+        c.offset = 0;
+      } else {
+        c.offset += static_cast<std::size_t>(sent);
+        sent = 0;
+      }
+    }
+  }
+
+  return true;
+}
+
+// Returns false if the client has to be disconnected
+static bool enqueue(server& s, client& c, const frame_ptr& f) {
+  if (c.queue.size() >= s.queue) {
+    c.dropped += 1;
+    s.policy_dropped += 1;
+
+    switch (c.drop_policy) {
+    case policy::disconnect:
+      return false;
+    case policy::drop_newest:
+      return true;
+    case policy::drop_oldest: {
+      // A partially sent frame has to go out whole to keep the stream in sync; if it is all there is, the new one goes
+      const std::size_t oldest = c.offset > 0 ? 1 : 0;
+
+      if (oldest == c.queue.size())
+        return true;
+
+      c.queue.erase(c.queue.begin() + static_cast<std::ptrdiff_t>(oldest));
+      break;
+    }
+    }
+  }
+
+  c.queue.push_back(f);
+  return flush(c);
+}
+
+static void publish(server& s, const source_scan& item) {
+  if (!s.clients.empty()) {
+    const auto f = encode_scan(s, item);
+
+    for (std::size_t n = s.clients.size(); n > 0; --n) {
+      if (!enqueue(s, s.clients[n - 1], f)) {
+        close(s.clients[n - 1].fd);
+        s.clients.erase(s.clients.begin() + static_cast<std::ptrdiff_t>(n - 1));
+      }
+    }
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+
+  s.subscribers.erase(std::remove_if(s.subscribers.begin(), s.subscribers.end(),
+                                     [now](const subscriber& sub) { return sub.expires < now; }),
+                      s.subscribers.end());
+
+  if (!s.subscribers.empty()) {
+    const auto f = encode_sectors(s, item);
+
+    // Datagrams the kernel can not take right now are lost, as they would be on the wire
+    for (const auto& sub : s.subscribers)
+      for (const auto& datagram : f->datagrams)
+        sendto(s.udp, f->bytes.data() + datagram.first, datagram.second, 0, reinterpret_cast<const sockaddr*>(&sub.address),
+               sub.length);
+  }
+
+  s.sequence += 1;
+}
+
+// Registers, renews or removes UDP subscribers
+static void receive_datagram(server& s) {
+  char buffer[64];
+  subscriber sub;
+  sub.length = sizeof(sub.address);
+
+  const ssize_t received = recvfrom(s.udp, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&sub.address), &sub.length);
+
+  if (received <= 0)
+    return;
+
+  const std::string message{buffer, static_cast<std::size_t>(received)};
+  const bool subscribe = message.compare(0, 9, "subscribe") == 0;
+  const bool unsubscribe = message.compare(0, 11, "unsubscribe") == 0;
+
+  if (!subscribe && !unsubscribe)
+    return;
+
+  const auto same = [&sub](const subscriber& other) {
+    return other.length == sub.length && std::memcmp(&other.address, &sub.address, sub.length) == 0;
+  };
+
+  s.subscribers.erase(std::remove_if(s.subscribers.begin(), s.subscribers.end(), same), s.subscribers.end());
+
+  if (subscribe) {
+    sub.expires = std::chrono::steady_clock::now() + kSubscriptionTimeout;
+    s.subscribers.push_back(sub);
+  }
+}
+
+// Handles policy lines; returns false if the client has to be disconnected
+static bool receive(client& c) {
+  char buffer[kMaxLine];
+  const ssize_t received = recv(c.fd, buffer, sizeof(buffer), 0);
+
+  if (received == 0)
+    return false;
+
+  if (received < 0)
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+
+  c.input.append(buffer, static_cast<std::size_t>(received));
+
+  for (auto end = c.input.find('\n'); end != std::string::npos; end = c.input.find('\n')) {
+    const auto line = c.input.substr(0, end);
+    c.input.erase(0, end + 1);
+
+    if (line.compare(0, 7, "policy ") == 0)
+      parse_policy(line.substr(7), c.drop_policy);
+  }
+
+  return c.input.size() <= kMaxLine;
+}
+
+static void set_non_blocking(int fd) { fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK); }
+
+static void accept_client(server& s) {
+  const int fd = accept(s.listener, nullptr, nullptr);
+
+  if (fd == -1)
+    return;
+
+  set_non_blocking(fd);
+
+  // Frames go out as soon as they are queued; batching happens in flush
+  const int enable = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+  setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &kSendBuffer, sizeof(kSendBuffer));
+
+  s.clients.push_back(client{fd, s.drop_policy, {}, 0, 0, {}});
+}
+
+static void open_sockets(server& s) {
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(s.port);
+
+  if (inet_pton(AF_INET, s.bind.c_str(), &address.sin_addr) != 1)
+    throw std::runtime_error{"invalid bind address " + s.bind};
+
+  s.listener = socket(AF_INET, SOCK_STREAM, 0);
+  s.udp = socket(AF_INET, SOCK_DGRAM, 0);
+
+  if (s.listener == -1 || s.udp == -1)
+    throw std::runtime_error{"creating sockets failed"};
+
+  const int enable = 1;
+  setsockopt(s.listener, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+  if (bind(s.listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1 || listen(s.listener, 64) == -1)
+    throw std::runtime_error{"binding TCP port failed"};
+
+  if (bind(s.udp, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1)
+    throw std::runtime_error{"binding UDP port failed"};
+
+  set_non_blocking(s.listener);
+  set_non_blocking(s.udp);
+}
+
+static void print_stats(server& s) {
+  std::int64_t backlog_dropped = 0;
+
+  {
+    std::lock_guard<std::mutex> lock{s.mutex};
+    backlog_dropped = s.backlog_dropped;
+  }
+
+  std::fprintf(stderr, "scans %" PRIu64 ", tcp subscribers %zu, udp subscribers %zu, dropped %" PRId64 " by policy, %" PRId64
+                       " by backlog\n",
+               s.sequence, s.clients.size(), s.subscribers.size(), s.policy_dropped, backlog_dropped);
+}
+
+// Network thread: a single poll loop over the wake-up pipe, both listening sockets and all TCP subscribers
+static void serve(server& s) {
+  std::vector<pollfd> fds;
+  std::vector<source_scan> scans;
+
+  auto stats = std::chrono::steady_clock::now() + kStatsInterval;
+
+  while (!stop) {
+    fds.clear();
+    fds.push_back(pollfd{s.wake[0], POLLIN, 0});
+    fds.push_back(pollfd{s.listener, POLLIN, 0});
+    fds.push_back(pollfd{s.udp, POLLIN, 0});
+
+    for (const auto& c : s.clients)
+      fds.push_back(pollfd{c.fd, static_cast<short>(POLLIN | (c.queue.empty() ? 0 : POLLOUT)), 0});
+
+    if (poll(fds.data(), fds.size(), 200) < 0 && errno != EINTR)
+      throw std::runtime_error{"polling sockets failed"};
+
+    // Clients first, as publishing below may disconnect some and shift the indices
+    for (std::size_t n = s.clients.size(); n > 0; --n) {
+      const auto events = fds[2 + n].revents;
+      auto& c = s.clients[n - 1];
+
+      const bool keep = (!(events & POLLIN) || receive(c)) && (!(events & POLLOUT) || flush(c)) &&
+                        !(events & (POLLERR | POLLHUP | POLLNVAL));
+
+      if (!keep) {
+        close(c.fd);
+        s.clients.erase(s.clients.begin() + static_cast<std::ptrdiff_t>(n - 1));
+      }
+    }
+
+    if (fds[1].revents & POLLIN)
+      accept_client(s);
+
+    if (fds[2].revents & POLLIN)
+      receive_datagram(s);
+
+    if (fds[0].revents & POLLIN) {
+      char drain[64];
+      (void)read(s.wake[0], drain, sizeof(drain));
+
+      {
+        std::lock_guard<std::mutex> lock{s.mutex};
+        scans.assign(s.incoming.begin(), s.incoming.end());
+        s.incoming.clear();
+      }
+
+      for (const auto& item : scans)
+        publish(s, item);
+
+      std::lock_guard<std::mutex> lock{s.mutex};
+
+      for (const auto& item : scans)
+        recycle(s, item.scan);
+    }
+
+    if (std::chrono::steady_clock::now() >= stats) {
+      print_stats(s);
+      stats += kStatsInterval;
+    }
+  }
+}
+
+int main(int argc, char** argv) try {
+  std::vector<std::string> args{argv, argv + argc};
+
+  if (args.size() < 2)
+    usage();
+
+  server s;
+  s.source = args[1];
+
+  for (std::size_t n = 2; n < args.size(); ++n) {
+    const auto& arg = args[n];
+
+    if (arg.compare(0, 7, "--bind=") == 0)
+      s.bind = arg.substr(7);
+    else if (arg.compare(0, 7, "--port=") == 0)
+      s.port = static_cast<std::uint16_t>(std::stoi(arg.substr(7)));
+    else if (arg.compare(0, 8, "--queue=") == 0)
+      s.queue = static_cast<std::size_t>(std::max(1, std::stoi(arg.substr(8))));
+    else if (arg.compare(0, 9, "--policy=") != 0 || !parse_policy(arg.substr(9), s.drop_policy))
+      usage();
+  }
+
+  std::signal(SIGINT, handle_signal);
+  std::signal(SIGTERM, handle_signal);
+  std::signal(SIGPIPE, SIG_IGN);
+
+  if (pipe(s.wake) == -1)
+    throw std::runtime_error{"creating wake-up pipe failed"};
+
+  set_non_blocking(s.wake[0]);
+  set_non_blocking(s.wake[1]);
+
+  open_sockets(s);
+
+  sweep_error_s error = nullptr;
+
+  s.encoder = sweep_scan_encoder_construct(0, &error);
+  check(error);
+
+  s.sector = sweep_scan_construct(0, &error);
+  check(error);
+
+  // As many samples per sector as always fit into one datagram
+  s.sector_samples = 1;
+  while (kHeaderBytes + static_cast<std::size_t>(sweep_scan_encode_bound(s.sector_samples + 1)) <= kDatagramBytes)
+    s.sector_samples += 1;
+
+  std::fprintf(stderr, "Streaming scans from %s on %s port %u\n", s.source.c_str(), s.bind.c_str(), static_cast<unsigned>(s.port));
+
+  std::thread source{produce, std::ref(s)};
+
+  serve(s);
+
+  stop = true;
+  source.join();
+
+  for (const auto& c : s.clients)
+    close(c.fd);
+
+  for (const auto& item : s.incoming)
+    sweep_scan_destruct(item.scan);
+
+  for (const auto scan : s.spare)
+    sweep_scan_destruct(scan);
+
+  sweep_scan_destruct(s.sector);
+  sweep_scan_encoder_destruct(s.encoder);
+
+  close(s.listener);
+  close(s.udp);
+  close(s.wake[0]);
+  close(s.wake[1]);
+
+  return s.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+
+} catch (const std::exception& e) {
+  std::fprintf(stderr, "Error: %s\n", e.what());
+  return EXIT_FAILURE;
+}
@@ -1,36 +1,23 @@
+#include "device.hpp"
 #include "error.hpp"
 #include "protocol.hpp"
 #include "queue.hpp"
+#include "scan.hpp"
 #include "serial.hpp"
 
 #include "sweep.h"
 
 #include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <exception>
 #include <string>
 #include <thread>
+#include <vector>
 
 int32_t sweep_get_version(void) { return SWEEP_VERSION; }
 bool sweep_is_abi_compatible(void) { return sweep_get_version() >> 16u == SWEEP_VERSION_MAJOR; }
 
-struct sweep_error {
-  std::string what;
-};
-
-#define SWEEP_MAX_SAMPLES 4096
-
-struct sample {
-  int32_t angle;           // in millidegrees
-  int32_t distance;        // in cm
-  int32_t signal_strength; // range 0:255
-};
-
-struct sweep_scan {
-  sample samples[SWEEP_MAX_SAMPLES];
-  int32_t count;
-};
-
 static sample parse_payload(const sweep::protocol::response_scan_packet_s& msg) {
   sample ret;
   ret.angle = msg.get_angle_millideg();
@@ -43,6 +30,7 @@ struct sweep_device {
   sweep::serial::device_s serial; // serial port communication
   bool is_scanning;
   std::atomic<bool> stop_thread;
+  std::atomic<sweep_zone_monitor_s> zone_monitor; // checked per sample by the background thread
 
   struct Element {
     std::unique_ptr<sweep_scan> scan;
@@ -50,27 +38,33 @@ struct sweep_device {
   };
 
   sweep::queue::queue<Element> scan_queue;
+  sweep::device::sink sink; // takes the scans instead of the queue if set
+
+  // Counted by the background thread since scanning started
+  std::atomic<int64_t> packets;
+  std::atomic<int64_t> error_packets;
+  std::atomic<int64_t> checksum_failures;
+
+  // Joined before talking to the device again, it would otherwise read the responses meant for the caller
+  std::thread worker;
 };
 
-// Constructor hidden from users
-static sweep_error_s sweep_error_construct(const char* what) {
-  SWEEP_ASSERT(what);
+// A corrupted byte costs a packet, a stream that does not checksum for this long is not scan data
+#define SWEEP_MAX_RESYNC_BYTES 4096
 
-  auto out = new sweep_error{what};
-  return out;
-}
+// Consecutive valid packets taking the stream for back in sync; single packets checksum by chance too often
+#define SWEEP_RESYNC_PACKETS 3
 
-const char* sweep_error_message(sweep_error_s error) {
-  SWEEP_ASSERT(error);
+// Time in ms the background thread waits on the port at once before checking whether it is to stop
+#define SWEEP_STOP_POLL_INTERVAL 100
 
-  return error->what.c_str();
-}
+// Consecutive valid scan packets needed to take the incoming bytes for a running scan stream
+#define SWEEP_WARM_STREAM_PACKETS 4
 
-void sweep_error_destruct(sweep_error_s error) {
-  SWEEP_ASSERT(error);
+// Time in ms an idle device gets to answer, or a streaming one to show its stream, before it is stopped after all
+#define SWEEP_WARM_ATTACH_TIMEOUT 100
 
-  delete error;
-}
+enum class sweep_device_state { idle, streaming, unknown };
 
 // Blocks until the device is ready.
 // Device is ready when the calibration completes and motor speed stabilizes
@@ -96,20 +90,117 @@ static void sweep_device_wait_until_motor_ready(sweep_device_s device, sweep_err
   *error = sweep_error_construct(e.what());
 }
 
+// Reads exactly len bytes unless the background thread is to stop first, then returns false. A device quitting its stream
+// without closing the port, e.g. on a motor stall or a stop from elsewhere, would otherwise block the thread for good,
+// and with it whoever joins the thread.
+static bool sweep_device_read_stream(sweep_device_s device, void* to, int32_t len) {
+  auto* bytes = static_cast<uint8_t*>(to);
+
+  while (len > 0) {
+    if (device->stop_thread)
+      return false;
+
+    const int32_t received = sweep::serial::device_read_some(device->serial, bytes, len, SWEEP_STOP_POLL_INTERVAL);
+
+    bytes += received;
+    len -= received;
+  }
+
+  return true;
+}
+
+// Slides through the stream a byte at a time, starting from the invalid packets[0], until SWEEP_RESYNC_PACKETS
+// consecutive packets are valid and writes them to packets; returns false if the thread is to stop first.
+static bool sweep_device_resync_stream(sweep_device_s device, sweep::protocol::response_scan_packet_s* packets) {
+  const int32_t size = sizeof(sweep::protocol::response_scan_packet_s) * SWEEP_RESYNC_PACKETS;
+
+  uint8_t window[sizeof(sweep::protocol::response_scan_packet_s) * SWEEP_RESYNC_PACKETS];
+  std::memcpy(window, packets, sizeof(sweep::protocol::response_scan_packet_s));
+
+  int32_t filled = sizeof(sweep::protocol::response_scan_packet_s);
+
+  for (int32_t skipped = 1; skipped <= SWEEP_MAX_RESYNC_BYTES; ++skipped) {
+    std::memmove(window, window + 1, filled - 1);
+    filled -= 1;
+
+    if (!sweep_device_read_stream(device, window + filled, size - filled))
+      return false;
+
+    filled = size;
+
+    if (sweep::protocol::find_scan_packets(window, size, SWEEP_RESYNC_PACKETS) == 0) {
+      std::memcpy(packets, window, size);
+      return true;
+    }
+  }
+
+  throw sweep::protocol::error{"lost sync with scan response stream"};
+}
+
+// Passes a scan or error on to the sink, or to the queue sweep_device_get_scan waits on
+static void sweep_device_hand_out(sweep_device_s device, sweep_device::Element element) {
+  if (device->sink)
+    device->sink(std::move(element.scan), element.error);
+  else
+    device->scan_queue.enqueue(std::move(element));
+}
+
 // Accumulates scans in a queue. Used by background thread
-static void sweep_device_accumulate_scans(sweep_device_s device) try {
+static void sweep_device_accumulate_scans(sweep_device_s device, bool adopted) try {
   SWEEP_ASSERT(device);
   SWEEP_ASSERT(device->is_scanning);
 
   sample buffer[SWEEP_MAX_SAMPLES];
   int32_t received = 0;
 
+  // An adopted stream is joined mid rotation, samples up to its next sync belong to no complete scan
+  bool synced = !adopted;
+
+  // Packets read ahead while resyncing, handed out before reading on
+  sweep::protocol::response_scan_packet_s resynced[SWEEP_RESYNC_PACKETS];
+  int32_t ahead = 0;
+
   while (!device->stop_thread && received < SWEEP_MAX_SAMPLES) {
 
-    const auto response = sweep::protocol::read_response_scan(device->serial);
+    sweep::protocol::response_scan_packet_s response;
+
+    if (ahead > 0) {
+      response = resynced[SWEEP_RESYNC_PACKETS - ahead];
+      ahead -= 1;
+    } else {
+      if (!sweep_device_read_stream(device, &response, sizeof(response)))
+        return;
+
+      if (!sweep::protocol::is_valid_scan_packet(response)) {
+        device->checksum_failures += 1;
+
+        resynced[0] = response;
+
+        if (!sweep_device_resync_stream(device, resynced))
+          return;
+
+        response = resynced[0];
+        ahead = SWEEP_RESYNC_PACKETS - 1;
+      }
+    }
+
+    device->packets += 1;
+
+    if (response.has_error())
+      device->error_packets += 1;
+
+    if (!synced && !response.is_sync())
+      continue;
+
+    synced = true;
 
     if (!response.has_error()) {
       buffer[received] = parse_payload(response);
+
+      // Check zones right away instead of once the scan is complete, bounding reaction time by the sample period
+      if (sweep_zone_monitor_s monitor = device->zone_monitor)
+        sweep_zone_monitor_check(monitor, buffer[received].angle, buffer[received].distance);
+
       received++;
     }
 
@@ -122,7 +213,7 @@ static void sweep_device_accumulate_scans(sweep_device_s device) try {
       std::copy_n(std::begin(buffer), received - 1, std::begin(out->samples));
 
       // place the scan in the queue
-      device->scan_queue.enqueue({std::move(out), nullptr});
+      sweep_device_hand_out(device, {std::move(out), nullptr});
 
       // place the sync reading at the start for the next scan
       buffer[0] = buffer[received - 1];
@@ -133,7 +224,67 @@ static void sweep_device_accumulate_scans(sweep_device_s device) try {
   }
 } catch (...) {
   // worker thread is dead at this point
-  device->scan_queue.enqueue({nullptr, std::current_exception()});
+  sweep_device_hand_out(device, {nullptr, std::current_exception()});
+}
+
+// Asks whether the motor is ready and watches what comes back: an idle device answers right away, a streaming one keeps
+// streaming. A streaming device's port is left at a packet boundary.
+static sweep_device_state sweep_device_detect_state(sweep::serial::device_s serial) try {
+  SWEEP_ASSERT(serial);
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(SWEEP_WARM_ATTACH_TIMEOUT);
+
+  const int32_t packet_size = sizeof(sweep::protocol::response_scan_packet_s);
+  const int32_t response_size = sizeof(sweep::protocol::response_info_motor_ready_s);
+
+  sweep::protocol::write_command(serial, sweep::protocol::MOTOR_READY);
+
+  std::vector<uint8_t> traffic;
+
+  for (;;) {
+    const auto size = static_cast<int32_t>(traffic.size());
+    const int32_t stream = sweep::protocol::find_scan_packets(traffic.data(), size, SWEEP_WARM_STREAM_PACKETS);
+
+    if (stream != -1) {
+      // The last packet may have arrived in part, its remaining bytes come next unless the stream just stopped
+      int32_t missing = (packet_size - (size - stream) % packet_size) % packet_size;
+
+      while (missing > 0) {
+        const auto left =
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+
+        uint8_t rest[sizeof(sweep::protocol::response_scan_packet_s)];
+        const int32_t received =
+            left > 0 ? sweep::serial::device_read_some(serial, rest, missing, static_cast<int32_t>(left)) : 0;
+
+        if (received == 0)
+          return sweep_device_state::unknown;
+
+        missing -= received;
+      }
+
+      return sweep_device_state::streaming;
+    }
+
+    // Anything but the bare response, e.g. leftovers of an earlier session, has to be sorted out by stopping the device
+    if (size == response_size && traffic[0] == sweep::protocol::MOTOR_READY[0] &&
+        traffic[1] == sweep::protocol::MOTOR_READY[1] && traffic[response_size - 1] == '\n')
+      return sweep_device_state::idle;
+
+    const auto remaining =
+        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+
+    if (remaining <= 0)
+      return sweep_device_state::unknown;
+
+    uint8_t chunk[256];
+    const int32_t received = sweep::serial::device_read_some(serial, chunk, sizeof(chunk), static_cast<int32_t>(remaining));
+
+    traffic.insert(traffic.end(), chunk, chunk + received);
+  }
+} catch (const std::exception&) {
+  // Stopping the device reports what is wrong with the port
+  return sweep_device_state::unknown;
 }
 
 // Attempts to start scanning without waiting for motor ready. Can error on failure.
@@ -214,7 +365,9 @@ sweep_device_s sweep_device_construct(const char* port, int32_t bitrate, sweep_e
   sweep::serial::device_s serial = sweep::serial::device_construct(port, bitrate);
 
   // initialize assuming the device is scanning
-  auto out = new sweep_device{serial, /*is_scanning=*/true, /*stop_thread=*/{false}, /*scan_queue=*/{20}};
+  auto out = new sweep_device{serial,           /*is_scanning=*/true, /*stop_thread=*/{false},  /*zone_monitor=*/{nullptr},
+                              /*scan_queue=*/{20}, /*sink=*/{},         /*packets=*/{0},       /*error_packets=*/{0},
+                              /*checksum_failures=*/{0}, /*worker=*/{}};
 
   // send a stop scanning command in case the scanner was powered on and scanning
   sweep_device_stop_scanning(out, error);
@@ -225,6 +378,35 @@ sweep_device_s sweep_device_construct(const char* port, int32_t bitrate, sweep_e
   return nullptr;
 }
 
+sweep_device_s sweep_device_construct_warm(const char* port, int32_t bitrate, sweep_error_s* error) try {
+  SWEEP_ASSERT(port);
+  SWEEP_ASSERT(bitrate > 0);
+  SWEEP_ASSERT(error);
+
+  sweep::serial::device_s serial = sweep::serial::device_construct(port, bitrate);
+
+  auto out = new sweep_device{serial,           /*is_scanning=*/true, /*stop_thread=*/{false},  /*zone_monitor=*/{nullptr},
+                              /*scan_queue=*/{20}, /*sink=*/{},         /*packets=*/{0},       /*error_packets=*/{0},
+                              /*checksum_failures=*/{0}, /*worker=*/{}};
+
+  switch (sweep_device_detect_state(serial)) {
+  case sweep_device_state::idle:
+    out->is_scanning = false;
+    break;
+  case sweep_device_state::streaming:
+    out->worker = std::thread(sweep_device_accumulate_scans, out, /*adopted=*/true);
+    break;
+  case sweep_device_state::unknown:
+    sweep_device_stop_scanning(out, error);
+    break;
+  }
+
+  return out;
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
 void sweep_device_destruct(sweep_device_s device) {
   SWEEP_ASSERT(device);
 
@@ -265,13 +447,14 @@ void sweep_device_start_scanning(sweep_device_s device, sweep_error_s* error) tr
 
   // Start SCAN WORKER
   device->scan_queue.clear();
+  device->packets = 0;
+  device->error_packets = 0;
+  device->checksum_failures = 0;
   device->is_scanning = true;
   // START background worker thread
   device->stop_thread = false;
   // create a thread
-  std::thread th = std::thread(sweep_device_accumulate_scans, device);
-  // detach the thread so that it runs in the background and cleans itself up
-  th.detach();
+  device->worker = std::thread(sweep_device_accumulate_scans, device, /*adopted=*/false);
 } catch (const std::exception& e) {
   *error = sweep_error_construct(e.what());
 }
@@ -283,6 +466,10 @@ void sweep_device_stop_scanning(sweep_device_s device, sweep_error_s* error) try
   // STOP the background thread from accumulating scans
   device->stop_thread = true;
 
+  // The thread checks for stopping at least every SWEEP_STOP_POLL_INTERVAL, streaming or not
+  if (device->worker.joinable())
+    device->worker.join();
+
   sweep::protocol::write_command(device->serial, sweep::protocol::DATA_ACQUISITION_STOP);
 
   // Wait some time for a few reasons:
@@ -316,6 +503,12 @@ void sweep_device_stop_scanning(sweep_device_s device, sweep_error_s* error) try
   *error = sweep_error_construct(e.what());
 }
 
+bool sweep_device_get_scanning(sweep_device_s device) {
+  SWEEP_ASSERT(device);
+
+  return device->is_scanning;
+}
+
 // Retrieves a scan from the queue (will block until scan is available)
 sweep_scan_s sweep_device_get_scan(sweep_device_s device, sweep_error_s* error) try {
   SWEEP_ASSERT(device);
@@ -335,6 +528,28 @@ sweep_scan_s sweep_device_get_scan(sweep_device_s device, sweep_error_s* error)
   return nullptr;
 }
 
+sweep_scan_s sweep_device_get_scan_timeout(sweep_device_s device, int32_t timeout, sweep_error_s* error) try {
+  SWEEP_ASSERT(device);
+  SWEEP_ASSERT(timeout >= 0);
+  SWEEP_ASSERT(error);
+  SWEEP_ASSERT(device->is_scanning);
+
+  sweep_device::Element out;
+
+  if (!device->scan_queue.dequeue_for(out, timeout))
+    return nullptr;
+
+  if (out.error != nullptr) {
+    std::rethrow_exception(out.error);
+  }
+
+  return out.scan.release();
+
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
 bool sweep_device_get_motor_ready(sweep_device_s device, sweep_error_s* error) try {
   SWEEP_ASSERT(device);
   SWEEP_ASSERT(error);
@@ -463,38 +678,21 @@ void sweep_device_set_sample_rate(sweep_device_s device, int32_t hz, sweep_error
   *error = sweep_error_construct(e.what());
 }
 
-int32_t sweep_scan_get_number_of_samples(sweep_scan_s scan) {
-  SWEEP_ASSERT(scan);
-  SWEEP_ASSERT(scan->count >= 0);
-
-  return scan->count;
-}
-
-int32_t sweep_scan_get_angle(sweep_scan_s scan, int32_t sample) {
-  SWEEP_ASSERT(scan);
-  SWEEP_ASSERT(sample >= 0 && sample < scan->count && "sample index out of bounds");
-
-  return scan->samples[sample].angle;
-}
-
-int32_t sweep_scan_get_distance(sweep_scan_s scan, int32_t sample) {
-  SWEEP_ASSERT(scan);
-  SWEEP_ASSERT(sample >= 0 && sample < scan->count && "sample index out of bounds");
-
-  return scan->samples[sample].distance;
-}
-
-int32_t sweep_scan_get_signal_strength(sweep_scan_s scan, int32_t sample) {
-  SWEEP_ASSERT(scan);
-  SWEEP_ASSERT(sample >= 0 && sample < scan->count && "sample index out of bounds");
+void sweep_device_get_packet_counts(sweep_device_s device, int64_t* packets, int64_t* error_packets, int64_t* checksum_failures) {
+  SWEEP_ASSERT(device);
+  SWEEP_ASSERT(packets);
+  SWEEP_ASSERT(error_packets);
+  SWEEP_ASSERT(checksum_failures);
 
-  return scan->samples[sample].signal_strength;
+  *packets = device->packets;
+  *error_packets = device->error_packets;
+  *checksum_failures = device->checksum_failures;
 }
 
-void sweep_scan_destruct(sweep_scan_s scan) {
-  SWEEP_ASSERT(scan);
+void sweep_device_set_zone_monitor(sweep_device_s device, sweep_zone_monitor_s monitor) {
+  SWEEP_ASSERT(device);
 
-  delete scan;
+  device->zone_monitor = monitor;
 }
 
 void sweep_device_reset(sweep_device_s device, sweep_error_s* error) try {
@@ -506,3 +704,16 @@ void sweep_device_reset(sweep_device_s device, sweep_error_s* error) try {
 } catch (const std::exception& e) {
   *error = sweep_error_construct(e.what());
 }
+
+namespace sweep {
+namespace device {
+
+void set_sink(sweep_device_s device, sink fn) {
+  SWEEP_ASSERT(device);
+  SWEEP_ASSERT(!device->is_scanning);
+
+  device->sink = std::move(fn);
+}
+
+} // ns device
+} // ns sweep
@@ -0,0 +1,349 @@
+// Owns a device and publishes its scans into a shared memory ring any number of local processes read from without
+// copies, see sweep_ring_reader_s. Configuration commands are passed through a unix socket, one per line:
+//
+//   get (motor_speed|sample_rate)       ok <value>
+//   set (motor_speed|sample_rate) <hz>  ok <value>
+//   status                              ok scans <published> ring <name> slots <slots>
+//
+// Errors are answered with "error <message>". The device can not be queried while scanning, so settings are read
+// once on startup and after setting them; setting stops scanning, applies the setting and starts scanning again.
+
+#include <cinttypes>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <sweep/sweep.h>
+
+static const auto kMotorSpeedCmd = "motor_speed";
+static const auto kSampleRateCmd = "sample_rate";
+
+static const auto kDefaultRing = "sweepd";
+static const auto kDefaultSocket = "/tmp/sweepd.sock";
+static const std::int32_t kRingSlots = 64;
+
+// Longest the acquisition thread holds on to the device while no scan arrives, e.g. from a stalled device, keeping
+// commands and stop requests from waiting on it
+static const std::int32_t kScanTimeout = 200;
+
+// Lines longer than this are not commands; the client gets disconnected
+static const std::size_t kMaxLine = 256;
+
+static std::atomic<bool> stop{false};
+
+static void handle_signal(int) { stop = true; }
+
+static void usage() {
+  std::fprintf(stderr, "Usage:\n");
+  std::fprintf(stderr, "  sweepd dev [<ring> [<socket>]]\n");
+  std::fprintf(stderr, "Defaults to ring %s and socket %s\n", kDefaultRing, kDefaultSocket);
+  std::exit(EXIT_FAILURE);
+}
+
+// Turns errors from the C interface into exceptions
+static void check(sweep_error_s error) {
+  if (error) {
+    const std::string what = sweep_error_message(error);
+    sweep_error_destruct(error);
+    throw std::runtime_error{what};
+  }
+}
+
+struct server {
+  sweep_device_s device;
+  sweep_ring_writer_s ring;
+  std::string ring_name;
+
+  // Held by the acquisition thread while waiting for a scan, for at most kScanTimeout, and by commands reconfiguring
+  // the device; commands announce themselves so the acquisition thread does not grab the mutex right back
+  std::mutex device_mutex;
+  std::atomic<std::int32_t> waiting{0};
+
+  std::int32_t motor_speed;
+  std::int32_t sample_rate;
+
+  std::atomic<std::int64_t> published{0};
+  std::atomic<bool> failed{false};
+};
+
+static std::int64_t now_us() {
+  const auto now = std::chrono::system_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+// Scans go straight from the device into the ring, without passing through the C++ wrapper's copies
+static void acquire(server& d) try {
+  while (!stop) {
+    if (d.waiting > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      continue;
+    }
+
+    sweep_error_s error = nullptr;
+    sweep_scan_s scan = nullptr;
+
+    {
+      std::lock_guard<std::mutex> lock{d.device_mutex};
+      scan = sweep_device_get_scan_timeout(d.device, kScanTimeout, &error);
+    }
+
+    check(error);
+
+    if (!scan)
+      continue;
+
+    sweep_ring_writer_publish(d.ring, scan, now_us());
+    sweep_scan_destruct(scan);
+
+    d.published += 1;
+  }
+} catch (const std::exception& e) {
+  std::fprintf(stderr, "Error: %s\n", e.what());
+  d.failed = true;
+  stop = true;
+}
+
+static void read_settings(server& d) {
+  sweep_error_s error = nullptr;
+
+  d.motor_speed = sweep_device_get_motor_speed(d.device, &error);
+  check(error);
+
+  d.sample_rate = sweep_device_get_sample_rate(d.device, &error);
+  check(error);
+}
+
+static void start(server& d) {
+  sweep_error_s error = nullptr;
+  sweep_device_start_scanning(d.device, &error);
+  check(error);
+}
+
+static void apply(server& d, const std::string& key, std::int32_t value) {
+  d.waiting += 1;
+
+  std::unique_lock<std::mutex> lock{d.device_mutex};
+
+  d.waiting -= 1;
+
+  sweep_error_s error = nullptr;
+  sweep_device_stop_scanning(d.device, &error);
+  check(error);
+
+  // Scanning has to resume even if the setting is rejected
+  try {
+    if (key == kMotorSpeedCmd)
+      sweep_device_set_motor_speed(d.device, value, &error);
+    else
+      sweep_device_set_sample_rate(d.device, value, &error);
+
+    check(error);
+    read_settings(d);
+  } catch (...) {
+    start(d);
+    throw;
+  }
+
+  start(d);
+}
+
+static std::string execute(server& d, const std::string& line) try {
+  std::istringstream in{line};
+
+  std::string cmd, key;
+  in >> cmd >> key;
+
+  if (cmd == "status") {
+    return "ok scans " + std::to_string(d.published.load()) + " ring " + d.ring_name + " slots " + std::to_string(kRingSlots);
+  }
+
+  if (cmd != "get" && cmd != "set")
+    return "error unknown command";
+
+  if (key != kMotorSpeedCmd && key != kSampleRateCmd)
+    return "error unknown property";
+
+  if (cmd == "set") {
+    std::int32_t value = 0;
+
+    if (!(in >> value))
+      return "error missing value";
+
+    apply(d, key, value);
+  }
+
+  return "ok " + std::to_string(key == kMotorSpeedCmd ? d.motor_speed : d.sample_rate);
+} catch (const std::exception& e) {
+  return std::string{"error "} + e.what();
+}
+
+struct client {
+  int fd;
+  std::string buffer;
+};
+
+// Executes complete lines; returns false if the client has to be disconnected
+static bool serve(server& d, client& c) {
+  char chunk[kMaxLine];
+  const ssize_t received = recv(c.fd, chunk, sizeof(chunk), 0);
+
+  if (received <= 0)
+    return false;
+
+  c.buffer.append(chunk, static_cast<std::size_t>(received));
+
+  for (auto end = c.buffer.find('\n'); end != std::string::npos; end = c.buffer.find('\n')) {
+    const auto response = execute(d, c.buffer.substr(0, end)) + "\n";
+    c.buffer.erase(0, end + 1);
+
+    if (send(c.fd, response.data(), response.size(), 0) != static_cast<ssize_t>(response.size()))
+      return false;
+  }
+
+  return c.buffer.size() <= kMaxLine;
+}
+
+static int listen_on(const std::string& path) {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+
+  if (path.size() >= sizeof(address.sun_path))
+    throw std::runtime_error{"socket path too long"};
+
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (fd == -1)
+    throw std::runtime_error{"creating control socket failed"};
+
+  // A socket left behind by a previous instance
+  unlink(path.c_str());
+
+  if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1 || listen(fd, 8) == -1) {
+    close(fd);
+    throw std::runtime_error{"binding control socket failed"};
+  }
+
+  return fd;
+}
+
+// Control connections are served on the main thread, waking up regularly to check for a stop request
+static void control(server& d, int listener) {
+  std::vector<client> clients;
+
+  while (!stop) {
+    std::vector<pollfd> fds{pollfd{listener, POLLIN, 0}};
+
+    for (const auto& c : clients)
+      fds.push_back(pollfd{c.fd, POLLIN, 0});
+
+    if (poll(fds.data(), fds.size(), 200) <= 0)
+      continue;
+
+    for (std::size_t n = clients.size(); n > 0; --n) {
+      if (fds[n].revents == 0)
+        continue;
+
+      if (!serve(d, clients[n - 1])) {
+        close(clients[n - 1].fd);
+        clients.erase(clients.begin() + static_cast<std::ptrdiff_t>(n - 1));
+      }
+    }
+
+    if (fds[0].revents & POLLIN) {
+      const int fd = accept(listener, nullptr, nullptr);
+
+      if (fd != -1)
+        clients.push_back(client{fd, {}});
+    }
+  }
+
+  for (const auto& c : clients)
+    close(c.fd);
+}
+
+int main(int argc, char** argv) try {
+  std::vector<std::string> args{argv, argv + argc};
+
+  if (args.size() < 2 || args.size() > 4)
+    usage();
+
+  const auto& dev = args[1];
+  const auto ring_name = args.size() > 2 ? args[2] : kDefaultRing;
+  const auto socket_path = args.size() > 3 ? args[3] : kDefaultSocket;
+
+  std::signal(SIGINT, handle_signal);
+  std::signal(SIGTERM, handle_signal);
+  std::signal(SIGPIPE, SIG_IGN);
+
+  sweep_error_s error = nullptr;
+
+  server d;
+  d.ring_name = ring_name;
+
+  d.device = sweep_device_construct_simple(dev.c_str(), &error);
+  check(error);
+
+  try {
+    read_settings(d);
+
+    d.ring = sweep_ring_writer_construct(ring_name.c_str(), kRingSlots, &error);
+    check(error);
+  } catch (...) {
+    sweep_device_destruct(d.device);
+    throw;
+  }
+
+  int listener = -1;
+
+  try {
+    listener = listen_on(socket_path);
+    start(d);
+  } catch (...) {
+    if (listener != -1)
+      close(listener);
+
+    sweep_ring_writer_destruct(d.ring);
+    sweep_device_destruct(d.device);
+    throw;
+  }
+
+  std::fprintf(stderr, "Publishing scans to ring %s, control socket %s\n", ring_name.c_str(), socket_path.c_str());
+
+  std::thread acquisition{acquire, std::ref(d)};
+
+  control(d, listener);
+
+  acquisition.join();
+
+  close(listener);
+  unlink(socket_path.c_str());
+
+  sweep_ring_writer_destruct(d.ring);
+  sweep_device_destruct(d.device);
+
+  return d.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+
+} catch (const std::exception& e) {
+  std::fprintf(stderr, "Error: %s\n", e.what());
+  return EXIT_FAILURE;
+}
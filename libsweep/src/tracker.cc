@@ -0,0 +1,348 @@
+#include "error.hpp"
+#include "scan.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <vector>
+
+// Caps the association candidates per update; pairs beyond are not considered
+#define SWEEP_TRACKER_MAX_CANDIDATES 65536
+
+#define SWEEP_TRACKER_TWO_PI 6.283185307179586f
+
+struct track_candidate {
+  float squared_distance;
+  int32_t detection;
+  int32_t track;
+};
+
+// Tracks live in a structure of arrays pool, compacted on removal; the constant velocity Kalman filter is run per axis
+// and since both axes see the same noise and updates their 2x2 covariance is shared.
+struct sweep_tracker {
+  sweep_tracker(int32_t capacity)
+      : capacity{capacity}, id(capacity), x(capacity), y(capacity), vx(capacity), vy(capacity), p00(capacity), p01(capacity),
+        p11(capacity), hits(capacity), misses(capacity), bearing(capacity), order(capacity), remap(capacity),
+        track_assigned(capacity), detection_assigned(SWEEP_MAX_SAMPLES), confirmed(capacity),
+        candidates(SWEEP_TRACKER_MAX_CANDIDATES) {}
+
+  int32_t capacity;
+
+  float max_distance = 50.0f;
+  int32_t confirm_hits = 3;
+  int32_t max_misses = 5;
+
+  float process_noise = 10000.0f;    // acceleration spectral density in cm^2/s^3
+  float measurement_noise = 25.0f;   // in cm^2
+  float initial_velocity = 40000.0f; // velocity variance of new tracks in cm^2/s^2
+
+  int32_t count = 0;
+  int32_t next_id = 0;
+
+  std::vector<int32_t> id;
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> vx;
+  std::vector<float> vy;
+  std::vector<float> p00;
+  std::vector<float> p01;
+  std::vector<float> p11;
+  std::vector<int32_t> hits;
+  std::vector<int32_t> misses;
+
+  // Predicted bearings and the tracks sorted by them; the order carries over updates, keeping re-sorting cheap
+  std::vector<float> bearing;
+  std::vector<int32_t> order;
+  std::vector<int32_t> remap;
+
+  std::vector<uint8_t> track_assigned;
+  std::vector<uint8_t> detection_assigned;
+
+  // Indices of confirmed tracks for output
+  std::vector<int32_t> confirmed;
+  int32_t number_of_confirmed = 0;
+
+  std::vector<track_candidate> candidates;
+};
+
+static float bearing_of(float x, float y) {
+  const float angle = std::atan2(y, x);
+  return angle < 0.0f ? angle + SWEEP_TRACKER_TWO_PI : angle;
+}
+
+static void predict(sweep_tracker& tracker, float dt) {
+  const float q = tracker.process_noise;
+
+  for (int32_t n = 0; n < tracker.count; ++n) {
+    tracker.x[n] += tracker.vx[n] * dt;
+    tracker.y[n] += tracker.vy[n] * dt;
+
+    const float p01 = tracker.p01[n];
+    const float p11 = tracker.p11[n];
+
+    tracker.p00[n] += dt * (2.0f * p01 + dt * p11) + q * dt * dt * dt / 3.0f;
+    tracker.p01[n] += dt * p11 + q * dt * dt / 2.0f;
+    tracker.p11[n] += q * dt;
+  }
+}
+
+static void correct(sweep_tracker& tracker, int32_t n, float zx, float zy) {
+  const float s = tracker.p00[n] + tracker.measurement_noise;
+  const float k0 = tracker.p00[n] / s;
+  const float k1 = tracker.p01[n] / s;
+
+  const float ix = zx - tracker.x[n];
+  const float iy = zy - tracker.y[n];
+
+  tracker.x[n] += k0 * ix;
+  tracker.y[n] += k0 * iy;
+  tracker.vx[n] += k1 * ix;
+  tracker.vy[n] += k1 * iy;
+
+  const float p01 = tracker.p01[n];
+
+  tracker.p11[n] -= k1 * p01;
+  tracker.p00[n] *= 1.0f - k0;
+  tracker.p01[n] *= 1.0f - k0;
+}
+
+static void spawn(sweep_tracker& tracker, float zx, float zy) {
+  if (tracker.count == tracker.capacity)
+    return;
+
+  const int32_t n = tracker.count++;
+
+  tracker.id[n] = tracker.next_id++;
+  tracker.x[n] = zx;
+  tracker.y[n] = zy;
+  tracker.vx[n] = 0.0f;
+  tracker.vy[n] = 0.0f;
+  tracker.p00[n] = tracker.measurement_noise;
+  tracker.p01[n] = 0.0f;
+  tracker.p11[n] = tracker.initial_velocity;
+  tracker.hits[n] = 1;
+  tracker.misses[n] = 0;
+  tracker.order[n] = n;
+}
+
+// Removes tracks missed too often by compacting the pool, keeping the bearing order of the others
+static void prune(sweep_tracker& tracker) {
+  const int32_t before = tracker.count;
+  int32_t kept = 0;
+
+  for (int32_t n = 0; n < before; ++n) {
+    if (tracker.misses[n] > tracker.max_misses) {
+      tracker.remap[n] = -1;
+      continue;
+    }
+
+    tracker.remap[n] = kept;
+
+    tracker.id[kept] = tracker.id[n];
+    tracker.x[kept] = tracker.x[n];
+    tracker.y[kept] = tracker.y[n];
+    tracker.vx[kept] = tracker.vx[n];
+    tracker.vy[kept] = tracker.vy[n];
+    tracker.p00[kept] = tracker.p00[n];
+    tracker.p01[kept] = tracker.p01[n];
+    tracker.p11[kept] = tracker.p11[n];
+    tracker.hits[kept] = tracker.hits[n];
+    tracker.misses[kept] = tracker.misses[n];
+
+    kept += 1;
+  }
+
+  tracker.count = kept;
+  kept = 0;
+
+  for (int32_t m = 0; m < before; ++m) {
+    const int32_t track = tracker.remap[tracker.order[m]];
+
+    if (track >= 0)
+      tracker.order[kept++] = track;
+  }
+}
+
+// Sorts tracks by predicted bearing; insertion sort is linear for the nearly sorted order from the last update
+static void sort_by_bearing(sweep_tracker& tracker) {
+  for (int32_t n = 0; n < tracker.count; ++n)
+    tracker.bearing[n] = bearing_of(tracker.x[n], tracker.y[n]);
+
+  auto& order = tracker.order;
+  const auto& bearing = tracker.bearing;
+
+  for (int32_t n = 1; n < tracker.count; ++n) {
+    const int32_t track = order[n];
+    int32_t m = n;
+
+    for (; m > 0 && bearing[order[m - 1]] > bearing[track]; --m)
+      order[m] = order[m - 1];
+
+    order[m] = track;
+  }
+}
+
+// Collects candidate pairs for tracks with predicted bearings in [from, to) around the detection
+static void gather(sweep_tracker& tracker, int32_t detection, float zx, float zy, float from, float to, int32_t& count) {
+  const auto& bearing = tracker.bearing;
+  const auto first = std::lower_bound(tracker.order.begin(), tracker.order.begin() + tracker.count, from,
+                                      [&](int32_t track, float value) { return bearing[track] < value; });
+
+  const float gate = tracker.max_distance * tracker.max_distance;
+
+  for (auto it = first; it != tracker.order.begin() + tracker.count && bearing[*it] < to; ++it) {
+    const float dx = tracker.x[*it] - zx;
+    const float dy = tracker.y[*it] - zy;
+    const float squared = dx * dx + dy * dy;
+
+    if (squared > gate || count == SWEEP_TRACKER_MAX_CANDIDATES)
+      continue;
+
+    tracker.candidates[count++] = track_candidate{squared, detection, *it};
+  }
+}
+
+sweep_tracker_s sweep_tracker_construct(int32_t max_tracks, sweep_error_s* error) try {
+  SWEEP_ASSERT(max_tracks > 0);
+  SWEEP_ASSERT(error);
+
+  return new sweep_tracker{max_tracks};
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_tracker_destruct(sweep_tracker_s tracker) {
+  SWEEP_ASSERT(tracker);
+
+  delete tracker;
+}
+
+void sweep_tracker_set_association(sweep_tracker_s tracker, float max_distance, int32_t confirm_hits, int32_t max_misses) {
+  SWEEP_ASSERT(tracker);
+  SWEEP_ASSERT(max_distance > 0.0f);
+  SWEEP_ASSERT(confirm_hits >= 1);
+  SWEEP_ASSERT(max_misses >= 0);
+
+  tracker->max_distance = max_distance;
+  tracker->confirm_hits = confirm_hits;
+  tracker->max_misses = max_misses;
+}
+
+void sweep_tracker_set_noise(sweep_tracker_s tracker, float process_noise, float measurement_noise) {
+  SWEEP_ASSERT(tracker);
+  SWEEP_ASSERT(process_noise >= 0.0f);
+  SWEEP_ASSERT(measurement_noise > 0.0f);
+
+  tracker->process_noise = process_noise;
+  tracker->measurement_noise = measurement_noise;
+}
+
+void sweep_tracker_clear(sweep_tracker_s tracker) {
+  SWEEP_ASSERT(tracker);
+
+  tracker->count = 0;
+  tracker->number_of_confirmed = 0;
+}
+
+int32_t sweep_tracker_update(sweep_tracker_s tracker, const float* x, const float* y, int32_t count, float dt) {
+  SWEEP_ASSERT(tracker);
+  SWEEP_ASSERT(x || count == 0);
+  SWEEP_ASSERT(y || count == 0);
+  SWEEP_ASSERT(count >= 0 && count <= SWEEP_MAX_SAMPLES);
+  SWEEP_ASSERT(dt >= 0.0f);
+
+  predict(*tracker, dt);
+  sort_by_bearing(*tracker);
+
+  // Gating: only tracks within the bearing window a detection's gate subtends can be candidates, found by binary search
+  int32_t candidates = 0;
+
+  for (int32_t d = 0; d < count; ++d) {
+    const float range = std::hypot(x[d], y[d]);
+    const float center = bearing_of(x[d], y[d]);
+
+    if (range <= tracker->max_distance) {
+      gather(*tracker, d, x[d], y[d], 0.0f, SWEEP_TRACKER_TWO_PI + 1.0f, candidates);
+      continue;
+    }
+
+    const float half = std::asin(tracker->max_distance / range);
+    const float from = center - half;
+    const float to = center + half;
+
+    gather(*tracker, d, x[d], y[d], std::max(from, 0.0f), to > SWEEP_TRACKER_TWO_PI ? SWEEP_TRACKER_TWO_PI + 1.0f : to,
+           candidates);
+
+    // Windows crossing the zero bearing continue on the other end
+    if (from < 0.0f)
+      gather(*tracker, d, x[d], y[d], from + SWEEP_TRACKER_TWO_PI, SWEEP_TRACKER_TWO_PI + 1.0f, candidates);
+    if (to > SWEEP_TRACKER_TWO_PI)
+      gather(*tracker, d, x[d], y[d], 0.0f, to - SWEEP_TRACKER_TWO_PI, candidates);
+  }
+
+  // Greedy global nearest neighbour over the gated candidates
+  std::sort(tracker->candidates.begin(), tracker->candidates.begin() + candidates,
+            [](const track_candidate& lhs, const track_candidate& rhs) { return lhs.squared_distance < rhs.squared_distance; });
+
+  std::fill(tracker->detection_assigned.begin(), tracker->detection_assigned.begin() + count, 0);
+  std::fill(tracker->track_assigned.begin(), tracker->track_assigned.begin() + tracker->count, 0);
+
+  for (int32_t c = 0; c < candidates; ++c) {
+    const track_candidate& candidate = tracker->candidates[c];
+
+    if (tracker->track_assigned[candidate.track] || tracker->detection_assigned[candidate.detection])
+      continue;
+
+    tracker->track_assigned[candidate.track] = 1;
+    tracker->detection_assigned[candidate.detection] = 1;
+
+    correct(*tracker, candidate.track, x[candidate.detection], y[candidate.detection]);
+  }
+
+  for (int32_t n = 0; n < tracker->count; ++n) {
+    if (tracker->track_assigned[n]) {
+      tracker->hits[n] = std::min(tracker->hits[n] + 1, tracker->confirm_hits);
+      tracker->misses[n] = 0;
+    } else {
+      tracker->misses[n] += 1;
+    }
+  }
+
+  prune(*tracker);
+
+  for (int32_t d = 0; d < count; ++d)
+    if (!tracker->detection_assigned[d])
+      spawn(*tracker, x[d], y[d]);
+
+  // Confirmed tracks are reported, tentative ones may still turn out to be clutter
+  tracker->number_of_confirmed = 0;
+
+  for (int32_t n = 0; n < tracker->count; ++n)
+    if (tracker->hits[n] >= tracker->confirm_hits)
+      tracker->confirmed[tracker->number_of_confirmed++] = n;
+
+  return tracker->number_of_confirmed;
+}
+
+int32_t sweep_tracker_get_number_of_tracks(sweep_tracker_s tracker) {
+  SWEEP_ASSERT(tracker);
+
+  return tracker->number_of_confirmed;
+}
+
+void sweep_tracker_get_track(sweep_tracker_s tracker, int32_t track, int32_t* id, float* x, float* y, float* vx, float* vy) {
+  SWEEP_ASSERT(tracker);
+  SWEEP_ASSERT(track >= 0 && track < tracker->number_of_confirmed && "track index out of bounds");
+  SWEEP_ASSERT(id && x && y && vx && vy);
+
+  const int32_t n = tracker->confirmed[track];
+
+  *id = tracker->id[n];
+  *x = tracker->x[n];
+  *y = tracker->y[n];
+  *vx = tracker->vx[n];
+  *vy = tracker->vy[n];
+}
@@ -0,0 +1,28 @@
+#include "trig.hpp"
+
+#include <cmath>
+
+namespace sweep {
+namespace trig {
+
+static table make_table() {
+  table out;
+
+  for (int32_t step = 0; step < ANGLE_STEPS; ++step) {
+    const double radian = step / 16.0 * 0.017453292519943295;
+
+    out.cos[step] = static_cast<float>(std::cos(radian));
+    out.sin[step] = static_cast<float>(std::sin(radian));
+  }
+
+  return out;
+}
+
+const table& lookup() {
+  // Initialization of function local statics is thread-safe since C++11
+  static const table cached = make_table();
+  return cached;
+}
+
+} // ns trig
+} // ns sweep
@@ -0,0 +1,223 @@
+#ifndef __FreeBSD__
+/// See serial.cc for why the feature test macro is not set on FreeBSD.
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "file.hpp"
+
+#include <errno.h>
+#include <stdint.h>
+
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace sweep {
+namespace file {
+
+struct writer {
+  int fd;
+};
+
+struct mapping {
+  const uint8_t* data;
+  int64_t size;
+};
+
+struct shared {
+  std::string name; // empty unless owned
+  uint8_t* data;
+  int64_t size;
+};
+
+// Portable shared memory object names start with a slash and contain no other
+static std::string shared_name(const char* name) { return std::string{"/"} + name; }
+
+writer_s writer_construct(const char* path) {
+  SWEEP_ASSERT(path);
+
+  const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+  if (fd == -1)
+    throw error{"opening file for writing failed"};
+
+  return new writer{fd};
+}
+
+void writer_destruct(writer_s writer) {
+  SWEEP_ASSERT(writer);
+
+  close(writer->fd);
+  delete writer;
+}
+
+void writer_write(writer_s writer, const void* from, int64_t len) {
+  SWEEP_ASSERT(writer);
+  SWEEP_ASSERT(from || len == 0);
+  SWEEP_ASSERT(len >= 0);
+
+  auto bytes = static_cast<const uint8_t*>(from);
+
+  while (len > 0) {
+    const ssize_t written = write(writer->fd, bytes, static_cast<size_t>(len));
+
+    if (written == -1) {
+      if (errno == EINTR)
+        continue;
+
+      throw error{"writing to file failed"};
+    }
+
+    bytes += written;
+    len -= written;
+  }
+}
+
+void writer_sync(writer_s writer) {
+  SWEEP_ASSERT(writer);
+
+  if (fsync(writer->fd) == -1)
+    throw error{"syncing file to disk failed"};
+}
+
+mapping_s mapping_construct(const char* path) {
+  SWEEP_ASSERT(path);
+
+  const int fd = open(path, O_RDONLY);
+
+  if (fd == -1)
+    throw error{"opening file for reading failed"};
+
+  struct stat info;
+
+  if (fstat(fd, &info) == -1) {
+    close(fd);
+    throw error{"querying file size failed"};
+  }
+
+  const auto size = static_cast<int64_t>(info.st_size);
+
+  if (size == 0) {
+    close(fd);
+    return new mapping{nullptr, 0};
+  }
+
+  void* data = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_SHARED, fd, 0);
+
+  // The mapping keeps the file referenced on its own
+  close(fd);
+
+  if (data == MAP_FAILED)
+    throw error{"mapping file into memory failed"};
+
+  return new mapping{static_cast<const uint8_t*>(data), size};
+}
+
+void mapping_destruct(mapping_s mapping) {
+  SWEEP_ASSERT(mapping);
+
+  if (mapping->data)
+    munmap(const_cast<uint8_t*>(mapping->data), static_cast<size_t>(mapping->size));
+
+  delete mapping;
+}
+
+const uint8_t* mapping_data(mapping_s mapping) {
+  SWEEP_ASSERT(mapping);
+
+  return mapping->data;
+}
+
+int64_t mapping_size(mapping_s mapping) {
+  SWEEP_ASSERT(mapping);
+
+  return mapping->size;
+}
+
+shared_s shared_create(const char* name, int64_t size) {
+  SWEEP_ASSERT(name);
+  SWEEP_ASSERT(size > 0);
+
+  const auto path = shared_name(name);
+
+  shm_unlink(path.c_str());
+
+  const int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+
+  if (fd == -1)
+    throw error{"creating shared memory failed"};
+
+  if (ftruncate(fd, static_cast<off_t>(size)) == -1) {
+    close(fd);
+    shm_unlink(path.c_str());
+    throw error{"sizing shared memory failed"};
+  }
+
+  void* data = mmap(nullptr, static_cast<size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    shm_unlink(path.c_str());
+    throw error{"mapping shared memory failed"};
+  }
+
+  return new shared{path, static_cast<uint8_t*>(data), size};
+}
+
+shared_s shared_open(const char* name) {
+  SWEEP_ASSERT(name);
+
+  const int fd = shm_open(shared_name(name).c_str(), O_RDONLY, 0);
+
+  if (fd == -1)
+    throw error{"opening shared memory failed"};
+
+  struct stat info;
+
+  if (fstat(fd, &info) == -1 || info.st_size == 0) {
+    close(fd);
+    throw error{"querying shared memory size failed"};
+  }
+
+  const auto size = static_cast<int64_t>(info.st_size);
+
+  void* data = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_SHARED, fd, 0);
+
+  close(fd);
+
+  if (data == MAP_FAILED)
+    throw error{"mapping shared memory failed"};
+
+  return new shared{std::string{}, static_cast<uint8_t*>(data), size};
+}
+
+void shared_destruct(shared_s shared) {
+  SWEEP_ASSERT(shared);
+
+  munmap(shared->data, static_cast<size_t>(shared->size));
+
+  if (!shared->name.empty())
+    shm_unlink(shared->name.c_str());
+
+  delete shared;
+}
+
+uint8_t* shared_data(shared_s shared) {
+  SWEEP_ASSERT(shared);
+
+  return shared->data;
+}
+
+int64_t shared_size(shared_s shared) {
+  SWEEP_ASSERT(shared);
+
+  return shared->size;
+}
+
+} // ns file
+} // ns sweep
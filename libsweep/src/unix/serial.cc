@@ -12,7 +12,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <chrono>
+
 #include <fcntl.h>
+#include <glob.h>
 #include <sys/select.h>
 #include <sys/types.h>
 #include <termios.h>
@@ -72,18 +75,25 @@ device_s device_construct(const char* port, int32_t bitrate) {
   SWEEP_ASSERT(port);
   SWEEP_ASSERT(bitrate > 0);
 
+  // Before opening the port: an unsupported bitrate throws and must not leak the file descriptor
+  speed_t baud = get_baud(bitrate);
+
   int32_t fd = open(port, O_RDWR | O_NOCTTY | O_NONBLOCK);
 
   if (fd == -1)
     throw error{"opening serial port failed"};
 
-  if (!isatty(fd))
+  if (!isatty(fd)) {
+    close(fd);
     throw error{"serial port is not a TTY"};
+  }
 
   struct termios options;
 
-  if (tcgetattr(fd, &options) == -1)
+  if (tcgetattr(fd, &options) == -1) {
+    close(fd);
     throw error{"querying terminal options failed"};
+  }
 
 #ifndef __FreeBSD__
   // Input Flags
@@ -108,14 +118,14 @@ device_s device_construct(const char* port, int32_t bitrate) {
 #endif
 
   // setup baud rate
-  speed_t baud = get_baud(bitrate);
-
   cfsetispeed(&options, baud);
   cfsetospeed(&options, baud);
 
   // flush the port
-  if (tcflush(fd, TCIFLUSH) == -1)
+  if (tcflush(fd, TCIFLUSH) == -1) {
+    close(fd);
     throw error{"flushing the serial port failed"};
+  }
 
   // set port attributes
   if (tcsetattr(fd, TCSANOW, &options) == -1) {
@@ -198,6 +208,70 @@ void device_write(device_s serial, const void* from, int32_t len) {
   SWEEP_ASSERT(bytes_written == len && "reliable write failed to write requested size of bytes");
 }
 
+int32_t device_read_some(device_s serial, void* to, int32_t len, int32_t timeout) {
+  SWEEP_ASSERT(serial);
+  SWEEP_ASSERT(to);
+  SWEEP_ASSERT(len > 0);
+  SWEEP_ASSERT(timeout >= 0);
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+  for (;;) {
+    const auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now());
+
+    if (remaining.count() <= 0)
+      return 0;
+
+    fd_set readfds;
+    FD_ZERO(&readfds);
+    FD_SET(serial->fd, &readfds);
+
+    struct timeval wait;
+    wait.tv_sec = static_cast<time_t>(remaining.count() / 1000000);
+    wait.tv_usec = static_cast<suseconds_t>(remaining.count() % 1000000);
+
+    const int32_t ready = select(serial->fd + 1, &readfds, nullptr, nullptr, &wait);
+
+    if (ready == -1 && errno != EINTR)
+      throw error{"blocking on data to read failed"};
+
+    if (ready <= 0)
+      continue;
+
+    const int ret = read(serial->fd, to, len);
+
+    if (ret == -1) {
+      if (errno == EAGAIN || errno == EINTR)
+        continue;
+
+      throw error{"reading from serial device failed"};
+    }
+
+    if (ret == 0)
+      throw error{"encountered EOF on serial device"};
+
+    return ret;
+  }
+}
+
+std::vector<std::string> enumerate_ports() {
+  // USB serial adapters as named on Linux, macOS and FreeBSD
+  const char* patterns[] = {"/dev/ttyUSB*", "/dev/ttyACM*", "/dev/cu.usbserial*", "/dev/cuaU[0-9]*"};
+
+  std::vector<std::string> ports;
+
+  for (const auto pattern : patterns) {
+    glob_t found;
+
+    if (glob(pattern, 0, nullptr, &found) == 0)
+      ports.insert(ports.end(), found.gl_pathv, found.gl_pathv + found.gl_pathc);
+
+    globfree(&found);
+  }
+
+  return ports;
+}
+
 void device_flush(device_s serial) {
   SWEEP_ASSERT(serial);
 
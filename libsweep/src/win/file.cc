@@ -0,0 +1,211 @@
+#include "file.hpp"
+
+#include <cstdint>
+#include <string>
+
+#include <windows.h>
+
+namespace sweep {
+namespace file {
+
+struct writer {
+  HANDLE handle;
+};
+
+struct mapping {
+  HANDLE file;
+  HANDLE view;
+  const uint8_t* data;
+  int64_t size;
+};
+
+struct shared {
+  HANDLE view;
+  uint8_t* data;
+  int64_t size;
+};
+
+// Session local names; the object goes away with its last handle, so there is nothing stale to replace
+static std::string shared_name(const char* name) { return std::string{"Local\\"} + name; }
+
+writer_s writer_construct(const char* path) {
+  SWEEP_ASSERT(path);
+
+  HANDLE handle = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+  if (handle == INVALID_HANDLE_VALUE)
+    throw error{"opening file for writing failed"};
+
+  return new writer{handle};
+}
+
+void writer_destruct(writer_s writer) {
+  SWEEP_ASSERT(writer);
+
+  CloseHandle(writer->handle);
+  delete writer;
+}
+
+void writer_write(writer_s writer, const void* from, int64_t len) {
+  SWEEP_ASSERT(writer);
+  SWEEP_ASSERT(from || len == 0);
+  SWEEP_ASSERT(len >= 0);
+
+  auto bytes = static_cast<const uint8_t*>(from);
+
+  while (len > 0) {
+    const DWORD chunk = len > (1 << 30) ? (1 << 30) : static_cast<DWORD>(len);
+    DWORD written = 0;
+
+    if (!WriteFile(writer->handle, bytes, chunk, &written, nullptr))
+      throw error{"writing to file failed"};
+
+    bytes += written;
+    len -= written;
+  }
+}
+
+void writer_sync(writer_s writer) {
+  SWEEP_ASSERT(writer);
+
+  if (!FlushFileBuffers(writer->handle))
+    throw error{"syncing file to disk failed"};
+}
+
+mapping_s mapping_construct(const char* path) {
+  SWEEP_ASSERT(path);
+
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+
+  if (file == INVALID_HANDLE_VALUE)
+    throw error{"opening file for reading failed"};
+
+  LARGE_INTEGER size;
+
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    throw error{"querying file size failed"};
+  }
+
+  if (size.QuadPart == 0)
+    return new mapping{file, nullptr, nullptr, 0};
+
+  HANDLE view = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+  if (!view) {
+    CloseHandle(file);
+    throw error{"mapping file into memory failed"};
+  }
+
+  const void* data = MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0);
+
+  if (!data) {
+    CloseHandle(view);
+    CloseHandle(file);
+    throw error{"mapping file into memory failed"};
+  }
+
+  return new mapping{file, view, static_cast<const uint8_t*>(data), size.QuadPart};
+}
+
+void mapping_destruct(mapping_s mapping) {
+  SWEEP_ASSERT(mapping);
+
+  if (mapping->data)
+    UnmapViewOfFile(mapping->data);
+
+  if (mapping->view)
+    CloseHandle(mapping->view);
+
+  CloseHandle(mapping->file);
+  delete mapping;
+}
+
+const uint8_t* mapping_data(mapping_s mapping) {
+  SWEEP_ASSERT(mapping);
+
+  return mapping->data;
+}
+
+int64_t mapping_size(mapping_s mapping) {
+  SWEEP_ASSERT(mapping);
+
+  return mapping->size;
+}
+
+shared_s shared_create(const char* name, int64_t size) {
+  SWEEP_ASSERT(name);
+  SWEEP_ASSERT(size > 0);
+
+  const auto high = static_cast<DWORD>(static_cast<uint64_t>(size) >> 32);
+  const auto low = static_cast<DWORD>(static_cast<uint64_t>(size) & 0xffffffffu);
+
+  HANDLE view = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, high, low, shared_name(name).c_str());
+
+  if (!view)
+    throw error{"creating shared memory failed"};
+
+  if (GetLastError() == ERROR_ALREADY_EXISTS) {
+    CloseHandle(view);
+    throw error{"shared memory is in use by another process"};
+  }
+
+  void* data = MapViewOfFile(view, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+
+  if (!data) {
+    CloseHandle(view);
+    throw error{"mapping shared memory failed"};
+  }
+
+  return new shared{view, static_cast<uint8_t*>(data), size};
+}
+
+shared_s shared_open(const char* name) {
+  SWEEP_ASSERT(name);
+
+  HANDLE view = OpenFileMappingA(FILE_MAP_READ, FALSE, shared_name(name).c_str());
+
+  if (!view)
+    throw error{"opening shared memory failed"};
+
+  void* data = MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0);
+
+  if (!data) {
+    CloseHandle(view);
+    throw error{"mapping shared memory failed"};
+  }
+
+  MEMORY_BASIC_INFORMATION info;
+
+  if (VirtualQuery(data, &info, sizeof(info)) == 0) {
+    UnmapViewOfFile(data);
+    CloseHandle(view);
+    throw error{"querying shared memory size failed"};
+  }
+
+  return new shared{view, static_cast<uint8_t*>(data), static_cast<int64_t>(info.RegionSize)};
+}
+
+void shared_destruct(shared_s shared) {
+  SWEEP_ASSERT(shared);
+
+  UnmapViewOfFile(shared->data);
+  CloseHandle(shared->view);
+  delete shared;
+}
+
+uint8_t* shared_data(shared_s shared) {
+  SWEEP_ASSERT(shared);
+
+  return shared->data;
+}
+
+int64_t shared_size(shared_s shared) {
+  SWEEP_ASSERT(shared);
+
+  return shared->size;
+}
+
+} // ns file
+} // ns sweep
@@ -273,6 +273,52 @@ void device_write(device_s serial, const void* from, int32_t len) {
     throw error{"writing to serial device failed"};
 }
 
+int32_t device_read_some(device_s serial, void* to, int32_t len, int32_t timeout) {
+  SWEEP_ASSERT(serial);
+  SWEEP_ASSERT(to);
+  SWEEP_ASSERT(len > 0);
+  SWEEP_ASSERT(timeout >= 0);
+
+  const auto deadline = GetTickCount64() + static_cast<ULONGLONG>(timeout);
+
+  // Waits for bytes queued by the driver, so the read below completes right away
+  for (;;) {
+    DWORD err = 0;
+    COMSTAT status;
+
+    if (!ClearCommError(serial->h_comm, &err, &status))
+      throw error{"checking for/clearing comm error failed during serial read"};
+
+    if (status.cbInQue > 0) {
+      const auto available = static_cast<int32_t>(status.cbInQue);
+      const auto count = available < len ? available : len;
+
+      device_read(serial, to, count);
+      return count;
+    }
+
+    if (GetTickCount64() >= deadline)
+      return 0;
+
+    Sleep(1);
+  }
+}
+
+std::vector<std::string> enumerate_ports() {
+  std::vector<std::string> ports;
+
+  // Only ports with a device behind them resolve
+  for (int32_t n = 1; n <= 255; ++n) {
+    const auto port = "COM" + std::to_string(n);
+    char target[256];
+
+    if (QueryDosDevice(port.c_str(), target, sizeof(target)) != 0)
+      ports.push_back(port);
+  }
+
+  return ports;
+}
+
 void device_flush(device_s serial) {
   SWEEP_ASSERT(serial);
 
@@ -0,0 +1,253 @@
+#include "error.hpp"
+#include "scan.hpp"
+#include "trig.hpp"
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+
+// Zones are reported as bits in a 32 bit mask
+#define SWEEP_ZONE_MAX_ZONES 32
+
+// Distance intervals a single direction can intersect zones in, over all zones
+#define SWEEP_ZONE_MAX_INTERVALS 4
+
+// For every one of the 5760 directions a sample can be reported at, the distance intervals [near, far) lying in zones.
+// Zone geometry is rasterized into this table when zones are added so checking a sample is a lookup and at most
+// SWEEP_ZONE_MAX_INTERVALS comparisons no matter how many zones there are.
+struct sweep_zone_monitor {
+  sweep_zone_monitor()
+      : intervals(sweep::trig::ANGLE_STEPS), near(sweep::trig::ANGLE_STEPS * SWEEP_ZONE_MAX_INTERVALS),
+        far(sweep::trig::ANGLE_STEPS * SWEEP_ZONE_MAX_INTERVALS), zones(sweep::trig::ANGLE_STEPS * SWEEP_ZONE_MAX_INTERVALS) {}
+
+  int32_t number_of_zones = 0;
+
+  std::vector<int32_t> intervals;
+  std::vector<int32_t> near; // in cm
+  std::vector<int32_t> far;  // in cm
+  std::vector<uint32_t> zones;
+
+  // Set while detached from devices, so the acquisition thread reads them without synchronization
+  sweep_zone_callback_f callback = nullptr;
+  void* user = nullptr;
+
+  // Sticky until cleared; written from the acquisition thread, read from any
+  std::atomic<uint32_t> triggered{0};
+};
+
+// Checks all directions have room for one more interval each before adding any, so failing leaves the monitor untouched
+static void add_intervals(sweep_zone_monitor& monitor, const std::vector<int32_t>& near, const std::vector<int32_t>& far,
+                          const std::vector<int32_t>& counts) {
+  for (int32_t step = 0; step < sweep::trig::ANGLE_STEPS; ++step)
+    if (monitor.intervals[step] + counts[step] > SWEEP_ZONE_MAX_INTERVALS)
+      throw std::runtime_error{"zone overlaps too many other zones"};
+
+  const uint32_t zone = 1u << monitor.number_of_zones;
+
+  for (int32_t step = 0; step < sweep::trig::ANGLE_STEPS; ++step) {
+    for (int32_t n = 0; n < counts[step]; ++n) {
+      const int32_t slot = step * SWEEP_ZONE_MAX_INTERVALS + monitor.intervals[step]++;
+      const int32_t from = step * SWEEP_ZONE_MAX_INTERVALS + n;
+
+      monitor.near[slot] = near[from];
+      monitor.far[slot] = far[from];
+      monitor.zones[slot] = zone;
+    }
+  }
+
+  monitor.number_of_zones += 1;
+}
+
+// Whether the point lies inside the polygon, by counting edge crossings of a ray towards positive x
+static bool inside_polygon(const float* x, const float* y, int32_t count, double px, double py) {
+  bool inside = false;
+
+  for (int32_t n = 0, m = count - 1; n < count; m = n++) {
+    const bool straddles = (y[n] > py) != (y[m] > py);
+
+    if (straddles && px < (x[m] - x[n]) * (py - y[n]) / static_cast<double>(y[m] - y[n]) + x[n])
+      inside = !inside;
+  }
+
+  return inside;
+}
+
+sweep_zone_monitor_s sweep_zone_monitor_construct(sweep_error_s* error) try {
+  SWEEP_ASSERT(error);
+
+  return new sweep_zone_monitor;
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return nullptr;
+}
+
+void sweep_zone_monitor_destruct(sweep_zone_monitor_s monitor) {
+  SWEEP_ASSERT(monitor);
+
+  delete monitor;
+}
+
+int32_t sweep_zone_monitor_add_sector(sweep_zone_monitor_s monitor, int32_t start_angle, int32_t end_angle, int32_t min_distance,
+                                      int32_t max_distance, sweep_error_s* error) try {
+  SWEEP_ASSERT(monitor);
+  SWEEP_ASSERT(start_angle >= 0 && start_angle < 360000);
+  SWEEP_ASSERT(end_angle >= 0 && end_angle < 360000);
+  SWEEP_ASSERT(min_distance >= 0 && min_distance < max_distance);
+  SWEEP_ASSERT(error);
+
+  if (monitor->number_of_zones == SWEEP_ZONE_MAX_ZONES)
+    throw std::runtime_error{"too many zones"};
+
+  std::vector<int32_t> near(sweep::trig::ANGLE_STEPS * SWEEP_ZONE_MAX_INTERVALS);
+  std::vector<int32_t> far(sweep::trig::ANGLE_STEPS * SWEEP_ZONE_MAX_INTERVALS);
+  std::vector<int32_t> counts(sweep::trig::ANGLE_STEPS);
+
+  // Counter-clockwise from start to end, wrapping around zero degree
+  const int32_t first = sweep::trig::millideg_to_step(start_angle);
+  const int32_t last = sweep::trig::millideg_to_step(end_angle);
+  const int32_t steps = (last - first + sweep::trig::ANGLE_STEPS) % sweep::trig::ANGLE_STEPS;
+
+  for (int32_t n = 0; n <= steps; ++n) {
+    const int32_t step = (first + n) % sweep::trig::ANGLE_STEPS;
+
+    near[step * SWEEP_ZONE_MAX_INTERVALS] = min_distance;
+    far[step * SWEEP_ZONE_MAX_INTERVALS] = max_distance;
+    counts[step] = 1;
+  }
+
+  add_intervals(*monitor, near, far, counts);
+  return monitor->number_of_zones - 1;
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return -1;
+}
+
+int32_t sweep_zone_monitor_add_polygon(sweep_zone_monitor_s monitor, const float* x, const float* y, int32_t count,
+                                       sweep_error_s* error) try {
+  SWEEP_ASSERT(monitor);
+  SWEEP_ASSERT(x);
+  SWEEP_ASSERT(y);
+  SWEEP_ASSERT(count >= 3);
+  SWEEP_ASSERT(error);
+
+  if (monitor->number_of_zones == SWEEP_ZONE_MAX_ZONES)
+    throw std::runtime_error{"too many zones"};
+
+  std::vector<int32_t> near(sweep::trig::ANGLE_STEPS * SWEEP_ZONE_MAX_INTERVALS);
+  std::vector<int32_t> far(sweep::trig::ANGLE_STEPS * SWEEP_ZONE_MAX_INTERVALS);
+  std::vector<int32_t> counts(sweep::trig::ANGLE_STEPS);
+
+  std::vector<double> crossings;
+  crossings.reserve(count + 1);
+
+  const bool contains_sensor = inside_polygon(x, y, count, 0.0, 0.0);
+
+  for (int32_t step = 0; step < sweep::trig::ANGLE_STEPS; ++step) {
+    const double radian = step / 16.0 * 0.017453292519943295;
+    const double dx = std::cos(radian);
+    const double dy = std::sin(radian);
+
+    // Distances at which the ray from the sensor crosses the polygon's edges
+    crossings.clear();
+
+    for (int32_t n = 0, m = count - 1; n < count; m = n++) {
+      const double ex = x[n] - x[m];
+      const double ey = y[n] - y[m];
+      const double denominator = dx * ey - dy * ex;
+
+      if (denominator == 0.0)
+        continue;
+
+      const double t = (x[m] * ey - y[m] * ex) / denominator; // along the ray
+      const double u = (x[m] * dy - y[m] * dx) / denominator; // along the edge
+
+      if (t > 0.0 && u >= 0.0 && u < 1.0)
+        crossings.push_back(t);
+    }
+
+    if (contains_sensor)
+      crossings.push_back(0.0);
+
+    std::sort(crossings.begin(), crossings.end());
+
+    // Crossings alternate between entering and leaving; intervals are widened to whole centimeters
+    for (size_t n = 0; n + 1 < crossings.size(); n += 2) {
+      if (counts[step] == SWEEP_ZONE_MAX_INTERVALS)
+        throw std::runtime_error{"polygon zone is too complex"};
+
+      const int32_t slot = step * SWEEP_ZONE_MAX_INTERVALS + counts[step]++;
+
+      near[slot] = static_cast<int32_t>(std::floor(crossings[n]));
+      far[slot] = static_cast<int32_t>(std::ceil(crossings[n + 1]));
+    }
+  }
+
+  add_intervals(*monitor, near, far, counts);
+  return monitor->number_of_zones - 1;
+} catch (const std::exception& e) {
+  *error = sweep_error_construct(e.what());
+  return -1;
+}
+
+void sweep_zone_monitor_set_callback(sweep_zone_monitor_s monitor, sweep_zone_callback_f callback, void* user) {
+  SWEEP_ASSERT(monitor);
+
+  monitor->callback = callback;
+  monitor->user = user;
+}
+
+uint32_t sweep_zone_monitor_check(sweep_zone_monitor_s monitor, int32_t angle, int32_t distance) {
+  SWEEP_ASSERT(monitor);
+
+  // Samples come straight off the wire here, a corrupted one must neither index past the intervals nor trip a stop
+  if (distance <= 0 || angle < 0 || angle >= 360000)
+    return 0;
+
+  const int32_t step = sweep::trig::millideg_to_step(angle);
+  const int32_t first = step * SWEEP_ZONE_MAX_INTERVALS;
+  const int32_t last = first + monitor->intervals[step];
+
+  uint32_t intruded = 0;
+
+  for (int32_t n = first; n < last; ++n)
+    if (distance >= monitor->near[n] && distance < monitor->far[n])
+      intruded |= monitor->zones[n];
+
+  if (intruded != 0) {
+    monitor->triggered.fetch_or(intruded);
+
+    if (monitor->callback)
+      monitor->callback(monitor->user, intruded, angle, distance);
+  }
+
+  return intruded;
+}
+
+uint32_t sweep_zone_monitor_check_scan(sweep_zone_monitor_s monitor, sweep_scan_s scan) {
+  SWEEP_ASSERT(monitor);
+  SWEEP_ASSERT(scan);
+
+  uint32_t intruded = 0;
+
+  for (int32_t n = 0; n < scan->count; ++n)
+    intruded |= sweep_zone_monitor_check(monitor, scan->samples[n].angle, scan->samples[n].distance);
+
+  return intruded;
+}
+
+uint32_t sweep_zone_monitor_get_triggered(sweep_zone_monitor_s monitor) {
+  SWEEP_ASSERT(monitor);
+
+  return monitor->triggered.load();
+}
+
+uint32_t sweep_zone_monitor_clear_triggered(sweep_zone_monitor_s monitor) {
+  SWEEP_ASSERT(monitor);
+
+  return monitor->triggered.exchange(0);
+}
@@ -0,0 +1,1102 @@
+// Smoke and behavior checks for the device independent parts of libsweep; run with ctest.
+// Prints every failed check and exits non-zero if there was one.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "sweep.hpp"
+
+static int failures = 0;
+
+#define SWEEP_CHECK(x)                                                                                                       \
+  do {                                                                                                                       \
+    if (!(x)) {                                                                                                              \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #x << std::endl;                                        \
+      failures += 1;                                                                                                         \
+    }                                                                                                                        \
+  } while (0)
+
+// Samples spread over one rotation at the given distances
+static sweep::scan make_scan(const std::vector<std::int32_t>& distances) {
+  sweep::scan scan;
+  const auto count = static_cast<std::int32_t>(distances.size());
+
+  for (std::int32_t n = 0; n < count; ++n)
+    scan.samples.push_back(sweep::sample{static_cast<std::int32_t>(n * 360000LL / count), distances[n], 100});
+
+  return scan;
+}
+
+// Samples spread over one rotation of a sensor at the pose in a 10 x 8 meter room centered on the origin
+static sweep::scan make_room_scan(const sweep::pose& pose, std::int32_t count = 720) {
+  sweep::scan scan;
+
+  for (std::int32_t n = 0; n < count; ++n) {
+    const auto angle = static_cast<std::int32_t>(n * 360000LL / count);
+    const double radian = (angle + pose.angle) / 1000.0 * 3.14159265358979 / 180.0;
+
+    const double c = std::cos(radian), s = std::sin(radian);
+    const double wall_x = c > 0 ? (500.0 - pose.x) / c : c < 0 ? (-500.0 - pose.x) / c : 1e9;
+    const double wall_y = s > 0 ? (400.0 - pose.y) / s : s < 0 ? (-400.0 - pose.y) / s : 1e9;
+
+    scan.samples.push_back(sweep::sample{angle, static_cast<std::int32_t>(std::lround(std::min(wall_x, wall_y))), 100});
+  }
+
+  return scan;
+}
+
+static std::vector<std::int32_t> distances_of(const sweep::scan& scan) {
+  std::vector<std::int32_t> out;
+
+  for (const auto& sample : scan.samples)
+    out.push_back(sample.distance);
+
+  return out;
+}
+
+static bool same_samples(const sweep::scan& lhs, const sweep::scan& rhs) {
+  if (lhs.samples.size() != rhs.samples.size())
+    return false;
+
+  for (std::size_t n = 0; n < lhs.samples.size(); ++n) {
+    const auto& l = lhs.samples[n];
+    const auto& r = rhs.samples[n];
+
+    if (l.angle != r.angle || l.distance != r.distance || l.signal_strength != r.signal_strength)
+      return false;
+  }
+
+  return true;
+}
+
+// Streams of keyframes and predicted frames decode back to the exact scans, frame by frame
+static void check_codec() {
+  std::mt19937 rng{42};
+  std::uniform_int_distribution<std::int32_t> jitter{-3, 3};
+  std::uniform_int_distribution<std::int32_t> distance{0, 4000};
+  std::uniform_int_distribution<std::int32_t> signal{0, 255};
+
+  for (const std::int32_t keyframe_interval : {0, 4}) {
+    sweep::encoder encoder{keyframe_interval};
+    sweep::decoder decoder;
+
+    std::vector<sweep::scan> scans;
+    std::vector<std::uint8_t> stream;
+
+    scans.push_back(sweep::scan{});
+
+    for (std::int32_t n = 0; n < 10; ++n) {
+      sweep::scan scan;
+
+      // Same sample count for a few scans so that prediction kicks in, then a different one
+      const std::int32_t count = n < 6 ? 500 : 480;
+
+      for (std::int32_t s = 0; s < count; ++s) {
+        const auto angle = static_cast<std::int32_t>(s * 360000LL / count) + jitter(rng) * 62;
+        scan.samples.push_back(sweep::sample{std::max(angle, 0), distance(rng), signal(rng)});
+      }
+
+      scans.push_back(scan);
+    }
+
+    for (const auto& scan : scans)
+      encoder.encode(scan, stream);
+
+    std::size_t offset = 0;
+    std::vector<std::size_t> ends;
+
+    for (const auto& expected : scans) {
+      sweep::scan decoded;
+      const auto consumed = decoder.decode(stream.data() + offset, stream.size() - offset, decoded);
+
+      SWEEP_CHECK(consumed > 0);
+      SWEEP_CHECK(same_samples(decoded, expected));
+
+      offset += consumed;
+      ends.push_back(offset);
+    }
+
+    SWEEP_CHECK(offset == stream.size());
+
+    // A truncated frame is not decoded yet; the second frame is the first one with samples, a keyframe
+    sweep::decoder fresh;
+    sweep::scan untouched;
+
+    SWEEP_CHECK(fresh.decode(stream.data() + ends[0], ends[1] - ends[0] - 1, untouched) == 0);
+    SWEEP_CHECK(untouched.samples.empty());
+  }
+
+  // Residuals between extreme values take the widest blocks there are
+  {
+    sweep::scan scan;
+
+    for (std::int32_t s = 0; s < 100; ++s)
+      scan.samples.push_back(sweep::sample{s % 2 ? 359999 : 0, s % 2 ? std::numeric_limits<std::int32_t>::max() : 1, 255 * (s % 2)});
+
+    sweep::encoder encoder{0};
+    sweep::decoder decoder;
+
+    std::vector<std::uint8_t> stream;
+    encoder.encode(scan, stream);
+
+    sweep::scan decoded;
+    SWEEP_CHECK(decoder.decode(stream.data(), stream.size(), decoded) == stream.size());
+    SWEEP_CHECK(same_samples(decoded, scan));
+  }
+
+  // Wider blocks would overflow decoding and are rejected: a keyframe of one sample, its angle 36 bits wide
+  {
+    const std::vector<std::uint8_t> frame{0, 1, 36, 0, 0, 0, 0, 0};
+
+    sweep::decoder decoder;
+    sweep::scan decoded;
+
+    bool failed = false;
+
+    try {
+      decoder.decode(frame.data(), frame.size(), decoded);
+    } catch (const sweep::device_error&) {
+      failed = true;
+    }
+
+    SWEEP_CHECK(failed);
+  }
+}
+
+// Samples are rotated by the mount angle, then shifted by the mount position; int16 output saturates
+static void check_cartesian() {
+  const auto scan = make_scan({100, 200, 300, 400});
+  const auto points = sweep::to_cartesian(scan, sweep::pose{90000, 10.0f, 20.0f});
+
+  const sweep::point expected[] = {{10.0f, 120.0f}, {-190.0f, 20.0f}, {10.0f, -280.0f}, {410.0f, 20.0f}};
+
+  SWEEP_CHECK(points.size() == 4);
+
+  for (std::size_t n = 0; n < points.size() && n < 4; ++n)
+    SWEEP_CHECK(std::hypot(points[n].x - expected[n].x, points[n].y - expected[n].y) < 0.01f);
+
+  sweep_error_s error = nullptr;
+  sweep_scan_s far = sweep_scan_construct(2, &error);
+  SWEEP_CHECK(!error);
+
+  sweep_scan_set_sample(far, 0, 0, 40000, 100);
+  sweep_scan_set_sample(far, 1, 180000, 40000, 100);
+
+  std::int16_t x[2], y[2];
+  sweep_scan_to_cartesian_int16(far, 0, 0.0f, 0.0f, x, y);
+
+  SWEEP_CHECK(x[0] == 32767 && y[0] == 0);
+  SWEEP_CHECK(x[1] == -32768 && y[1] == 0);
+
+  sweep_scan_destruct(far);
+}
+
+// In a square room the wall ahead is split by the rotation's start; it is merged and reported last, the other walls
+// keep the indices they were handed out with while pushing
+static void check_line_extractor() {
+  std::vector<std::int32_t> distances;
+
+  for (std::int32_t n = 0; n < 360; ++n) {
+    const float radian = n * 3.14159265f / 180.0f;
+    const float nearest_axis = std::max(std::abs(std::cos(radian)), std::abs(std::sin(radian)));
+
+    distances.push_back(static_cast<std::int32_t>(std::lround(200.0f / nearest_axis)));
+  }
+
+  const auto scan = make_scan(distances);
+
+  sweep::line_extractor extractor;
+  extractor.begin();
+
+  std::vector<sweep::segment> pushed;
+
+  for (const auto& sample : scan.samples) {
+    const auto count = extractor.push(sample);
+
+    while (static_cast<std::int32_t>(pushed.size()) < count)
+      pushed.push_back(extractor.get_segment(static_cast<std::int32_t>(pushed.size())));
+  }
+
+  SWEEP_CHECK(pushed.size() == 3);
+  SWEEP_CHECK(extractor.finish() == 4);
+
+  for (std::size_t n = 0; n < pushed.size(); ++n) {
+    const auto segment = extractor.get_segment(static_cast<std::int32_t>(n));
+
+    SWEEP_CHECK(segment.first_sample == pushed[n].first_sample && segment.last_sample == pushed[n].last_sample);
+    SWEEP_CHECK(segment.first_sample < segment.last_sample);
+  }
+
+  std::vector<sweep::segment> segments;
+  extractor.extract(scan, segments);
+
+  SWEEP_CHECK(segments.size() == 4);
+
+  for (const auto& segment : segments)
+    SWEEP_CHECK(std::abs(segment.r - 200.0f) < 1.0f);
+
+  if (segments.size() == 4) {
+    const auto& wrapped = segments[3];
+
+    SWEEP_CHECK(wrapped.first_sample > 300 && wrapped.last_sample < 60);
+    SWEEP_CHECK(std::abs(wrapped.alpha) < 0.01f);
+  }
+}
+
+// Bins reduce all of their samples, also when the scan revisits a bin after its run ended
+static void check_range_image() {
+  sweep::scan scan;
+  scan.samples = {{10000, 100, 100}, {20000, 300, 100}, {95000, 50, 100}, {40000, 500, 100}, {200000, 0, 100}};
+
+  sweep::range_image image;
+
+  sweep::to_range_image(scan, 4, sweep::reduction::min, image);
+  SWEEP_CHECK((image.distance == std::vector<std::int32_t>{100, 50, 0, 0}));
+  SWEEP_CHECK((image.valid == std::vector<std::uint8_t>{1, 1, 0, 0}));
+
+  sweep::to_range_image(scan, 4, sweep::reduction::nearest, image);
+  SWEEP_CHECK(image.distance[0] == 500);
+
+  sweep::to_range_image(scan, 4, sweep::reduction::median, image);
+  SWEEP_CHECK(image.distance[0] == 300);
+  SWEEP_CHECK(image.distance[1] == 50);
+}
+
+static void check_filter() {
+  // Range gate and signal threshold drop samples, keeping the rest in order
+  {
+    auto scan = make_scan({5, 100, 5000, 200, 300});
+    scan.samples[3].signal_strength = 10;
+
+    sweep::filter filter;
+    filter.range_gate(10, 4000).signal_threshold(50).apply(scan);
+
+    SWEEP_CHECK((distances_of(scan) == std::vector<std::int32_t>{100, 300}));
+  }
+
+  // The median removes a spike, also the first sample whose neighbourhood wraps around the seam
+  {
+    auto scan = make_scan({900, 100, 100, 100, 500, 100, 100, 100});
+
+    sweep::filter filter;
+    filter.median(1).apply(scan);
+
+    SWEEP_CHECK((distances_of(scan) == std::vector<std::int32_t>{100, 100, 100, 100, 100, 100, 100, 100}));
+  }
+
+  // Samples without a return are neither taken into account nor replaced
+  {
+    auto scan = make_scan({100, 0, 102, 104, 0, 106});
+
+    sweep::filter filter;
+    filter.median(1).apply(scan);
+
+    SWEEP_CHECK(scan.samples[1].distance == 0);
+    SWEEP_CHECK(scan.samples[4].distance == 0);
+  }
+
+  // Radii beyond the supported window fail instead of overrunning it
+  {
+    sweep::filter filter;
+    filter.median(SWEEP_FILTER_MAX_MEDIAN_RADIUS);
+
+    bool failed = false;
+
+    try {
+      filter.median(SWEEP_FILTER_MAX_MEDIAN_RADIUS + 1);
+    } catch (const sweep::device_error&) {
+      failed = true;
+    }
+
+    SWEEP_CHECK(failed);
+  }
+
+  // Speckles jump away from both neighbours; a single step in distance, e.g. an object's edge, is kept
+  {
+    auto scan = make_scan({800, 200, 200, 200, 900, 200, 200, 500, 500});
+
+    sweep::filter filter;
+    filter.remove_speckles(100).apply(scan);
+
+    SWEEP_CHECK((distances_of(scan) == std::vector<std::int32_t>{200, 200, 200, 200, 200, 500, 500}));
+  }
+}
+
+static void check_zone_monitor() {
+  sweep::zone_monitor monitor;
+
+  // A sector in front and a square one meter to the left
+  const auto sector = monitor.add_sector(350000, 10000, 0, 100);
+  const auto square = monitor.add_polygon({{-50.0f, 100.0f}, {50.0f, 100.0f}, {50.0f, 200.0f}, {-50.0f, 200.0f}});
+
+  SWEEP_CHECK(sector == 0);
+  SWEEP_CHECK(square == 1);
+
+  std::uint32_t notified = 0;
+  monitor.set_callback([&](std::uint32_t zones, const sweep::sample&) { notified |= zones; });
+
+  const auto check = [&](std::int32_t angle, std::int32_t distance) {
+    sweep::scan scan;
+    scan.samples.push_back(sweep::sample{angle, distance, 100});
+    return monitor.check(scan);
+  };
+
+  SWEEP_CHECK(check(5000, 50) == 1u << sector);
+  SWEEP_CHECK(check(355000, 50) == 1u << sector); // the sector wraps around zero
+  SWEEP_CHECK(check(5000, 150) == 0);
+  SWEEP_CHECK(check(90000, 150) == 1u << square);
+  SWEEP_CHECK(check(90000, 250) == 0);
+  SWEEP_CHECK(check(90000, 0) == 0); // no return
+
+  SWEEP_CHECK(notified == ((1u << sector) | (1u << square)));
+  SWEEP_CHECK(monitor.get_triggered() == ((1u << sector) | (1u << square)));
+  SWEEP_CHECK(monitor.clear_triggered() == ((1u << sector) | (1u << square)));
+  SWEEP_CHECK(monitor.get_triggered() == 0);
+
+  // Samples checked one by one can carry any angle; out of range ones intrude no zone
+  sweep_error_s error = nullptr;
+  sweep_zone_monitor_s raw = sweep_zone_monitor_construct(&error);
+
+  SWEEP_CHECK(error == nullptr);
+
+  if (error) {
+    sweep_error_destruct(error);
+    return;
+  }
+
+  sweep_zone_monitor_add_sector(raw, 0, 359000, 0, 100, &error);
+
+  SWEEP_CHECK(error == nullptr);
+  SWEEP_CHECK(sweep_zone_monitor_check(raw, 180000, 50) == 1u);
+  SWEEP_CHECK(sweep_zone_monitor_check(raw, -1000, 50) == 0);
+  SWEEP_CHECK(sweep_zone_monitor_check(raw, 365000, 50) == 0);
+  SWEEP_CHECK(sweep_zone_monitor_check(raw, INT32_MAX, 50) == 0);
+
+  sweep_zone_monitor_destruct(raw);
+}
+
+// With every sample bright, zero signal strengths included, reflectors still have a finite centre
+static void check_reflectors() {
+  sweep::scan scan;
+
+  for (std::int32_t n = 0; n < 5; ++n)
+    scan.samples.push_back(sweep::sample{10000 + n * 500, 300, 0});
+
+  std::vector<sweep::reflector> reflectors;
+  sweep::find_reflectors(scan, 0, 3, 50.0f, reflectors);
+
+  SWEEP_CHECK(reflectors.size() == 1);
+
+  for (const auto& reflector : reflectors) {
+    const auto& p = reflector.position;
+    SWEEP_CHECK(std::isfinite(p.x) && std::isfinite(p.y) && std::abs(std::hypot(p.x, p.y) - 300.0f) < 1.0f);
+  }
+}
+
+// Two devices back to back, one meter apart, each seeing a circle around itself; sets hold both in the common frame
+static void check_fusion() {
+  const std::int64_t period = 100000; // us
+  const std::int32_t radius = 200;    // cm
+
+  sweep::fusion fusion{2, period, period};
+  fusion.set_device(0, sweep::pose{0, 0.0f, 0.0f});
+  fusion.set_device(1, sweep::pose{180000, 100.0f, 0.0f}, 2000);
+
+  const auto circle = make_scan(std::vector<std::int32_t>(100, radius));
+
+  sweep::fused_points points;
+
+  SWEEP_CHECK(fusion.get_next() == 0);
+  SWEEP_CHECK(!fusion.merge(period, points));
+
+  // Device 1's clock runs 2 ms behind
+  fusion.add_scan(0, circle, 1 * period);
+  fusion.add_scan(1, circle, 1 * period - 2000);
+
+  fusion.add_scan(0, circle, 2 * period);
+  SWEEP_CHECK(!fusion.merge(2 * period, points)); // waits for device 1's scan ending past the set
+
+  fusion.add_scan(1, circle, 2 * period - 2000);
+
+  SWEEP_CHECK(fusion.merge(2 * period, points));
+  SWEEP_CHECK(points.x.size() == 200);
+  SWEEP_CHECK(points.x.size() == points.y.size() && points.x.size() == points.angle.size() &&
+              points.x.size() == points.device.size());
+
+  std::int32_t counts[2] = {0, 0};
+
+  for (std::size_t n = 0; n < points.x.size(); ++n) {
+    const auto device = points.device[n];
+    SWEEP_CHECK(device == 0 || device == 1);
+
+    if (device != 0 && device != 1)
+      continue;
+
+    counts[device] += 1;
+
+    const float center = device == 0 ? 0.0f : 100.0f;
+    SWEEP_CHECK(std::abs(std::hypot(points.x[n] - center, points.y[n]) - radius) < 0.5f);
+
+    SWEEP_CHECK(points.angle[n] >= 0 && points.angle[n] < 360000);
+    SWEEP_CHECK(n == 0 || points.angle[n - 1] <= points.angle[n]);
+  }
+
+  SWEEP_CHECK(counts[0] == 100);
+  SWEEP_CHECK(counts[1] == 100);
+
+  // The next set is a period later
+  SWEEP_CHECK(fusion.get_next() == 3 * period);
+  SWEEP_CHECK(!fusion.merge(2 * period + 1, points));
+
+  // Samples without a return are left out instead of ending up at the mount position
+  auto holes = circle;
+
+  for (std::size_t n = 0; n < holes.samples.size(); n += 2)
+    holes.samples[n].distance = 0;
+
+  fusion.add_scan(0, holes, 3 * period);
+  fusion.add_scan(1, circle, 3 * period - 2000);
+
+  SWEEP_CHECK(fusion.merge(3 * period, points));
+  SWEEP_CHECK(points.x.size() == 150);
+
+  for (std::size_t n = 0; n < points.x.size(); ++n) {
+    const float center = points.device[n] == 0 ? 0.0f : 100.0f;
+    SWEEP_CHECK(std::abs(std::hypot(points.x[n] - center, points.y[n]) - radius) < 0.5f);
+  }
+}
+
+// Bins without a return, in a fresh model or left empty while learning, learn from their first return during updates;
+// saved models load back bin for bin
+static void check_background() {
+  std::vector<std::uint8_t> mask;
+  sweep::scan foreground;
+
+  {
+    sweep::background fresh{360};
+    const auto room = make_scan(std::vector<std::int32_t>(360, 300));
+
+    fresh.update(room, mask, foreground);
+    SWEEP_CHECK(foreground.samples.size() == 360);
+
+    fresh.update(room, mask, foreground);
+    SWEEP_CHECK(foreground.samples.empty());
+  }
+
+  // No returns in the first quarter while learning, e.g. open space out of range
+  std::vector<std::int32_t> distances(360, 300);
+  std::fill(distances.begin(), distances.begin() + 90, 0);
+
+  sweep::background model{360};
+  model.learn(make_scan(distances));
+
+  const auto object = make_scan(std::vector<std::int32_t>(360, 250));
+
+  model.update(object, mask, foreground);
+  SWEEP_CHECK(foreground.samples.size() == 360);
+
+  model.update(object, mask, foreground);
+  SWEEP_CHECK(foreground.samples.size() == 270); // the first quarter is background now
+
+  const char* path = "sweep-check-background.model";
+  model.save(path);
+
+  sweep_error_s error = nullptr;
+  sweep_background_s loaded = sweep_background_load(path, &error);
+
+  SWEEP_CHECK(error == nullptr);
+
+  if (error) {
+    sweep_error_destruct(error);
+    return;
+  }
+
+  SWEEP_CHECK(sweep_background_get_number_of_bins(loaded) == 360);
+
+  // Compare against a model taken through the same steps
+  sweep_background_s expected = sweep_background_construct(360, &error);
+  sweep_scan_s scratch = sweep_scan_construct(360, &error);
+
+  for (std::int32_t n = 0; n < 360; ++n)
+    sweep_scan_set_sample(scratch, n, n * 1000, distances[n], 100);
+
+  sweep_background_learn(expected, scratch);
+
+  for (std::int32_t n = 0; n < 360; ++n)
+    sweep_scan_set_sample(scratch, n, n * 1000, 250, 100);
+
+  std::vector<std::uint8_t> flags(360);
+  sweep_background_update(expected, scratch, flags.data());
+  sweep_background_update(expected, scratch, flags.data());
+
+  for (std::int32_t bin = 0; bin < 360; ++bin) {
+    float mean, variance, expected_mean, expected_variance;
+    int32_t count, expected_count;
+
+    sweep_background_get_bin(loaded, bin, &mean, &variance, &count);
+    sweep_background_get_bin(expected, bin, &expected_mean, &expected_variance, &expected_count);
+
+    SWEEP_CHECK(mean == expected_mean && variance == expected_variance && count == expected_count);
+  }
+
+  sweep_scan_destruct(scratch);
+  sweep_background_destruct(expected);
+  sweep_background_destruct(loaded);
+
+  // Anything else does not load
+  std::FILE* file = std::fopen(path, "wb");
+  std::fputs("not a model", file);
+  std::fclose(file);
+
+  SWEEP_CHECK(sweep_background_load(path, &error) == nullptr);
+  SWEEP_CHECK(error != nullptr);
+
+  if (error)
+    sweep_error_destruct(error);
+
+  std::remove(path);
+}
+
+// Rays clear the cells up to a return and mark its cell, clamped to the log-odds range; threads write the same grid
+static void check_occupancy_grid() {
+  const auto scan = make_scan(std::vector<std::int32_t>(720, 300));
+
+  // 100 x 100 cells of 10 cm around the origin: x = 300 cm is column 80, x = 150 cm column 65, row 50 is y = 0
+  const auto cell = [](std::int32_t column, std::int32_t row) { return static_cast<std::size_t>(row) * 100 + column; };
+
+  sweep::occupancy_grid single{100, 100, 10, 1};
+  sweep::occupancy_grid pooled{100, 100, 10, 4};
+
+  for (std::int32_t n = 0; n < 10; ++n) {
+    single.update(scan, sweep::pose{0, 0.0f, 0.0f});
+    pooled.update(scan, sweep::pose{0, 0.0f, 0.0f});
+  }
+
+  const auto log_odds = single.get_log_odds();
+
+  SWEEP_CHECK(log_odds == pooled.get_log_odds());
+
+  SWEEP_CHECK(log_odds[cell(80, 50)] == 350);
+  SWEEP_CHECK(log_odds[cell(65, 50)] == -350);
+  SWEEP_CHECK(log_odds[cell(90, 50)] == 0);
+  SWEEP_CHECK(log_odds[cell(50, 80)] == 350);
+  SWEEP_CHECK(log_odds[cell(20, 50)] == 350);
+
+  // The sensor's pose moves the hits along
+  single.clear();
+  single.update(scan, sweep::pose{0, 100.0f, 0.0f});
+
+  const auto moved = single.get_log_odds();
+
+  SWEEP_CHECK(moved[cell(90, 50)] > 0);
+  SWEEP_CHECK(moved[cell(80, 50)] < 0);
+  SWEEP_CHECK(moved[cell(30, 50)] > 0);
+}
+
+// A scan taken from an offset pose registers back onto the reference from a zero guess, also without the search
+static void check_scan_matcher() {
+  const sweep::pose truth{3000, 20.0f, -15.0f};
+
+  sweep::scan_matcher matcher;
+  matcher.set_reference(make_room_scan(sweep::pose{0, 0.0f, 0.0f}));
+
+  const auto scan = make_room_scan(truth);
+
+  sweep::pose guess{0, 0.0f, 0.0f};
+  const auto correspondences = matcher.match(scan, guess);
+
+  SWEEP_CHECK(correspondences > 600);
+  SWEEP_CHECK(std::abs(guess.angle - truth.angle) <= 200);
+  SWEEP_CHECK(std::hypot(guess.x - truth.x, guess.y - truth.y) < 2.0f);
+
+  // ICP alone converges from a guess close by
+  matcher.set_search_window(0.0f, 0, 5.0f);
+
+  guess = sweep::pose{2500, 15.0f, -10.0f};
+  matcher.match(scan, guess);
+
+  SWEEP_CHECK(std::abs(guess.angle - truth.angle) <= 200);
+  SWEEP_CHECK(std::hypot(guess.x - truth.x, guess.y - truth.y) < 2.0f);
+}
+
+// Nearest neighbour and radius queries agree with checking every point, also for queries and points off the grid
+static void check_spatial_index() {
+  const std::int32_t points_per_scan = 360;
+
+  sweep::spatial_index index{20.0f, 300.0f, 2 * points_per_scan};
+  index.add_scan(make_room_scan(sweep::pose{0, 0.0f, 0.0f}, points_per_scan));
+  index.add_scan(make_room_scan(sweep::pose{45000, 50.0f, 30.0f}, points_per_scan), sweep::pose{45000, 50.0f, 30.0f});
+  index.build();
+
+  std::vector<sweep::point> points;
+
+  for (std::int32_t id = 0; id < 2 * points_per_scan; ++id)
+    points.push_back(index.get_point(id));
+
+  const auto squared = [](const sweep::point& a, const sweep::point& b) {
+    return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y);
+  };
+
+  std::mt19937 rng{42};
+  std::uniform_real_distribution<float> anywhere{-700.0f, 700.0f};
+
+  std::vector<sweep::point> queries;
+
+  for (std::int32_t n = 0; n < 200; ++n)
+    queries.push_back(sweep::point{anywhere(rng), anywhere(rng)});
+
+  for (const float max_distance : {30.0f, std::numeric_limits<float>::infinity()}) {
+    std::vector<std::int32_t> ids;
+    index.nearest(queries, max_distance, ids);
+
+    SWEEP_CHECK(ids.size() == queries.size());
+
+    for (std::size_t n = 0; n < queries.size() && n < ids.size(); ++n) {
+      float best = max_distance * max_distance;
+
+      for (const auto& point : points)
+        best = std::min(best, squared(point, queries[n]));
+
+      if (best == max_distance * max_distance && ids[n] < 0)
+        continue;
+
+      SWEEP_CHECK(ids[n] >= 0 && squared(points[ids[n]], queries[n]) == best);
+    }
+  }
+
+  std::vector<std::int32_t> ids;
+
+  for (const auto& query : queries) {
+    index.within(query, 60.0f, ids);
+    std::sort(ids.begin(), ids.end());
+
+    std::vector<std::int32_t> expected;
+
+    for (std::size_t n = 0; n < points.size(); ++n)
+      if (squared(points[n], query) <= 60.0f * 60.0f)
+        expected.push_back(static_cast<std::int32_t>(n));
+
+    SWEEP_CHECK(ids == expected);
+  }
+}
+
+// Runs of adjacent returns become clusters: one across the rotation's start is merged, range jumps split, specks drop
+static void check_clusterer() {
+  std::vector<std::int32_t> distances(360, 0);
+
+  for (const std::int32_t n : {358, 359, 0, 1, 2})
+    distances[n] = 100;
+  for (std::int32_t n = 90; n <= 95; ++n)
+    distances[n] = 200;
+  for (std::int32_t n = 180; n <= 181; ++n)
+    distances[n] = 250;
+  for (std::int32_t n = 270; n <= 280; ++n)
+    distances[n] = n <= 275 ? 300 : 400;
+
+  sweep::clusterer clusterer;
+
+  std::vector<std::int32_t> ids;
+  std::vector<sweep::cluster> clusters;
+
+  clusterer.run(make_scan(distances), ids, clusters);
+
+  SWEEP_CHECK(clusters.size() == 4);
+  SWEEP_CHECK(ids.size() == 360);
+
+  if (clusters.size() != 4 || ids.size() != 360)
+    return;
+
+  SWEEP_CHECK(ids[358] >= 0 && ids[358] == ids[0] && ids[0] == ids[2]);
+  SWEEP_CHECK(ids[90] >= 0 && ids[90] != ids[0]);
+  SWEEP_CHECK(ids[180] == -1 && ids[181] == -1);
+  SWEEP_CHECK(ids[100] == -1);
+  SWEEP_CHECK(ids[275] >= 0 && ids[276] >= 0 && ids[275] != ids[276]);
+
+  const auto& wrapped = clusters[ids[0]];
+
+  SWEEP_CHECK(wrapped.samples == 5);
+  SWEEP_CHECK(std::abs(wrapped.centroid.x - 100.0f) < 1.0f && std::abs(wrapped.centroid.y) < 1.0f);
+  SWEEP_CHECK(wrapped.min.y < -3.0f && wrapped.max.y > 3.0f);
+}
+
+// Two objects at constant velocity, one crossing the bearing of 180 degree: tracks are confirmed after three updates,
+// keep their ids, converge to the velocities, and a track without detections is dropped after the allowed misses
+static void check_tracker() {
+  const float dt = 0.1f;
+
+  sweep::tracker tracker{8};
+  std::vector<sweep::track> tracks;
+
+  const auto a = [](std::int32_t step) { return sweep::point{200.0f, -100.0f + 10.0f * step}; };
+  const auto b = [](std::int32_t step) { return sweep::point{-150.0f, 100.0f - 5.0f * step}; };
+
+  std::int32_t a_id = -1, b_id = -1;
+
+  for (std::int32_t step = 0; step < 40; ++step) {
+    tracker.update(std::vector<sweep::point>{a(step), b(step)}, dt, tracks);
+
+    SWEEP_CHECK(tracks.size() == (step < 2 ? 0u : 2u));
+
+    for (const auto& track : tracks) {
+      const bool is_a = track.position.x > 0;
+      auto& id = is_a ? a_id : b_id;
+
+      SWEEP_CHECK(id < 0 || id == track.id);
+      id = track.id;
+    }
+  }
+
+  SWEEP_CHECK(a_id >= 0 && b_id >= 0 && a_id != b_id);
+
+  for (const auto& track : tracks) {
+    const bool is_a = track.position.x > 0;
+    const auto truth = is_a ? a(39) : b(39);
+    const sweep::point velocity = is_a ? sweep::point{0.0f, 100.0f} : sweep::point{0.0f, -50.0f};
+
+    SWEEP_CHECK(std::hypot(track.position.x - truth.x, track.position.y - truth.y) < 2.0f);
+    SWEEP_CHECK(std::hypot(track.velocity.x - velocity.x, track.velocity.y - velocity.y) < 5.0f);
+  }
+
+  // Five misses in a row are allowed, the sixth drops the track
+  for (std::int32_t step = 40; step < 46; ++step) {
+    tracker.update(std::vector<sweep::point>{a(step)}, dt, tracks);
+
+    SWEEP_CHECK(tracks.size() == (step < 45 ? 2u : 1u));
+  }
+
+  SWEEP_CHECK(tracks.size() == 1 && tracks[0].id == a_id);
+}
+
+// Particles scattered around a wrong guess converge onto the pose a scan of the mapped room was taken from, with the
+// same result on one thread as on a pool
+static void check_localizer() {
+  const std::int32_t width = 220, height = 180;
+  const float resolution = 5.0f;
+
+  // The room's walls at x = +-500 and y = +-400 cm as the cells on either side, the first cell's corner at (-550, -450)
+  std::vector<std::uint8_t> occupied(static_cast<std::size_t>(width) * height, 0);
+
+  for (std::int32_t row = 0; row < height; ++row) {
+    for (std::int32_t column = 0; column < width; ++column) {
+      const float x = -550.0f + (column + 0.5f) * resolution;
+      const float y = -450.0f + (row + 0.5f) * resolution;
+
+      const bool wall_x = std::abs(std::abs(x) - 500.0f) <= resolution / 2 && std::abs(y) <= 400.0f;
+      const bool wall_y = std::abs(std::abs(y) - 400.0f) <= resolution / 2 && std::abs(x) <= 500.0f;
+
+      occupied[static_cast<std::size_t>(row) * width + column] = wall_x || wall_y;
+    }
+  }
+
+  const sweep::pose truth{10000, 60.0f, -40.0f};
+  const auto scan = make_room_scan(truth);
+
+  sweep::pose poses[2];
+  const std::int32_t threads[] = {1, 4};
+
+  for (std::int32_t n = 0; n < 2; ++n) {
+    sweep::localizer localizer{2000, threads[n]};
+    localizer.set_map(occupied, width, height, resolution, sweep::point{-550.0f, -450.0f});
+    localizer.reset(2000, sweep::pose{0, 0.0f, 0.0f}, 10000, 60.0f);
+
+    for (std::int32_t step = 0; step < 15; ++step) {
+      localizer.predict(sweep::pose{0, 0.0f, 0.0f}, 300, 2.0f);
+      localizer.update(scan);
+    }
+
+    poses[n] = localizer.get_pose();
+  }
+
+  SWEEP_CHECK(std::abs(poses[0].angle - truth.angle) < 300);
+  SWEEP_CHECK(std::hypot(poses[0].x - truth.x, poses[0].y - truth.y) < 3.0f);
+
+  SWEEP_CHECK(poses[0].angle == poses[1].angle && poses[0].x == poses[1].x && poses[0].y == poses[1].y);
+}
+
+// The distance transform is exact: every cell's distance matches the nearest rasterized return found by brute force
+static void check_clearance_map() {
+  const std::int32_t width = 41, height = 31;
+  const float resolution = 10.0f;
+
+  std::mt19937 rng{42};
+  std::uniform_int_distribution<std::int32_t> distance{20, 300};
+
+  std::vector<std::int32_t> distances;
+
+  for (std::int32_t n = 0; n < 60; ++n)
+    distances.push_back(n % 7 == 0 ? 0 : distance(rng));
+
+  const auto scan = make_scan(distances);
+
+  // Rasterized like the map does, the sensor in the center cell
+  std::vector<std::pair<std::int32_t, std::int32_t>> seeds;
+
+  const auto points = sweep::to_cartesian(scan);
+
+  for (std::size_t n = 0; n < points.size(); ++n) {
+    if (scan.samples[n].distance <= 0)
+      continue;
+
+    const auto& point = points[n];
+    const auto column = static_cast<std::int32_t>(std::floor(point.x / resolution)) + width / 2;
+    const auto row = static_cast<std::int32_t>(std::floor(point.y / resolution)) + height / 2;
+
+    if (column >= 0 && column < width && row >= 0 && row < height)
+      seeds.emplace_back(column, row);
+  }
+
+  sweep::clearance_map map{width, height, resolution, 2};
+  std::vector<float> clearance;
+
+  SWEEP_CHECK(map.update(scan, clearance) == static_cast<std::int32_t>(seeds.size()));
+  SWEEP_CHECK(!seeds.empty() && clearance.size() == static_cast<std::size_t>(width) * height);
+
+  for (std::int32_t row = 0; row < height && clearance.size() == static_cast<std::size_t>(width) * height; ++row) {
+    for (std::int32_t column = 0; column < width; ++column) {
+      float expected = std::numeric_limits<float>::infinity();
+
+      for (const auto& seed : seeds)
+        expected = std::min(expected, resolution * std::hypot(float(seed.first - column), float(seed.second - row)));
+
+      SWEEP_CHECK(std::abs(clearance[static_cast<std::size_t>(row) * width + column] - expected) < 1e-3f);
+    }
+  }
+
+  // Without any return in the window every cell is infinitely far
+  SWEEP_CHECK(map.update(make_scan(std::vector<std::int32_t>(60, 5000)), clearance) == 0);
+  SWEEP_CHECK(std::all_of(clearance.begin(), clearance.end(), [](float d) { return std::isinf(d); }));
+}
+
+// The room simplifies to little more than its corners, counter-clockwise and covering its area; samples without a
+// return are placed at the max range, and a zero tolerance keeps every vertex
+static void check_free_space() {
+  const auto signed_area = [](const std::vector<sweep::point>& polygon) {
+    float area = 0.0f;
+
+    for (std::size_t n = 0; n < polygon.size(); ++n) {
+      const auto& a = polygon[n];
+      const auto& b = polygon[(n + 1) % polygon.size()];
+      area += a.x * b.y - b.x * a.y;
+    }
+
+    return area / 2;
+  };
+
+  sweep::free_space space;
+  std::vector<sweep::point> polygon;
+
+  space.extract(make_room_scan(sweep::pose{0, 0.0f, 0.0f}), polygon);
+
+  SWEEP_CHECK(polygon.size() >= 4 && polygon.size() <= 8);
+  // Bins cut the corners a little
+  SWEEP_CHECK(std::abs(signed_area(polygon) - 1000.0f * 800.0f) < 0.02f * 1000.0f * 800.0f);
+
+  for (const auto& vertex : polygon)
+    SWEEP_CHECK(std::abs(std::abs(vertex.x) - 500.0f) < 6.0f || std::abs(std::abs(vertex.y) - 400.0f) < 6.0f);
+
+  space.set_parameters(100.0f, 36, 0.0f);
+  space.extract(make_scan(std::vector<std::int32_t>(720, 0)), polygon);
+
+  SWEEP_CHECK(polygon.size() == 36);
+
+  for (const auto& vertex : polygon)
+    SWEEP_CHECK(std::abs(std::hypot(vertex.x, vertex.y) - 100.0f) < 0.01f);
+
+  SWEEP_CHECK(signed_area(polygon) > 0.0f);
+
+  space.set_parameters(4000.0f, 0, 0.0f);
+  space.extract(make_room_scan(sweep::pose{0, 0.0f, 0.0f}), polygon);
+
+  SWEEP_CHECK(polygon.size() == 720);
+}
+
+// Scans read back by time from a closed log, and from the same log without its index as after a crash: recovery walks
+// the chunks and stops before a torn last one
+static void check_scan_log() {
+  const char* path = "sweep-check.log";
+  const std::int32_t scans = 300; // about two and a half chunks
+
+  const auto scan_at = [](std::int32_t n) { return make_scan(std::vector<std::int32_t>(720, 100 + n)); };
+
+  {
+    sweep::log_writer writer{path};
+
+    for (std::int32_t n = 0; n < scans; ++n)
+      writer.append(scan_at(n), 1000 * n);
+
+    SWEEP_CHECK(writer.get_dropped() == 0);
+  }
+
+  // Every scan has its own timestamp and samples; stops at the first one that differs
+  const auto check_scans = [&](sweep::log_reader& reader, std::int32_t count) {
+    sweep::scan scan;
+
+    for (std::int32_t n = 0; n < count; ++n) {
+      reader.read(n, scan);
+      const auto entry = reader.get(n);
+
+      if (entry.timestamp != 1000 * n || entry.count != 720 || !same_samples(scan, scan_at(n))) {
+        SWEEP_CHECK(!"scan read back differs");
+        return;
+      }
+    }
+  };
+
+  std::vector<char> bytes;
+
+  {
+    sweep::log_reader reader{path};
+
+    SWEEP_CHECK(reader.is_indexed());
+    SWEEP_CHECK(reader.get_number_of_scans() == scans);
+    SWEEP_CHECK(reader.seek(0) == 0 && reader.seek(1500) == 2 && reader.seek(1000 * scans) == scans);
+
+    check_scans(reader, scans);
+
+    std::FILE* file = std::fopen(path, "rb");
+    char buffer[4096];
+
+    for (std::size_t size; (size = std::fread(buffer, 1, sizeof(buffer), file)) > 0;)
+      bytes.insert(bytes.end(), buffer, buffer + size);
+
+    std::fclose(file);
+  }
+
+  // The trailer ends the file and starts with the index's offset; dropping both loses no scans
+  std::int64_t index_offset = 0;
+  std::copy_n(bytes.end() - 24, sizeof(index_offset), reinterpret_cast<char*>(&index_offset));
+
+  SWEEP_CHECK(index_offset > 0 && index_offset < static_cast<std::int64_t>(bytes.size()));
+
+  const auto write_prefix = [&](std::int64_t size) {
+    std::FILE* file = std::fopen(path, "wb");
+    std::fwrite(bytes.data(), 1, static_cast<std::size_t>(size), file);
+    std::fclose(file);
+  };
+
+  write_prefix(index_offset);
+
+  {
+    sweep::log_reader reader{path};
+
+    SWEEP_CHECK(!reader.is_indexed());
+    SWEEP_CHECK(reader.get_number_of_scans() == scans);
+    SWEEP_CHECK(reader.seek(1500) == 2);
+
+    check_scans(reader, scans);
+  }
+
+  write_prefix(index_offset - 1000);
+
+  {
+    sweep::log_reader reader{path};
+    const auto count = reader.get_number_of_scans();
+
+    SWEEP_CHECK(!reader.is_indexed());
+    SWEEP_CHECK(count > 0 && count < scans);
+
+    check_scans(reader, count);
+  }
+
+  std::remove(path);
+}
+
+// A reader lapped by the writer skips ahead to the oldest scan still intact and counts the ones it missed; samples
+// handed out in place are reported overwritten once the writer came around, and a closed ring ends reading
+static void check_ring() {
+  const char* name = "sweep-check";
+  const auto scan_at = [](std::int32_t n) { return make_scan(std::vector<std::int32_t>(360, 100 + n)); };
+
+  std::unique_ptr<sweep::ring_writer> writer{new sweep::ring_writer{name, 4}};
+  sweep::ring_reader reader{name};
+
+  sweep::scan scan;
+  std::int64_t timestamp = 0;
+  std::int32_t published = 0;
+
+  const auto publish = [&](std::int32_t count) {
+    for (std::int32_t n = 0; n < count; ++n, ++published)
+      SWEEP_CHECK(writer->publish(scan_at(published), 1000 * published) == published);
+  };
+
+  publish(2);
+
+  for (std::int32_t n = 0; n < 2; ++n) {
+    SWEEP_CHECK(reader.read(scan, timestamp, 0));
+    SWEEP_CHECK(timestamp == 1000 * n && same_samples(scan, scan_at(n)));
+  }
+
+  SWEEP_CHECK(reader.get_dropped() == 0);
+
+  // Scans 2 to 11 overrun the four slots: 2 to 7 are gone, and 8 is skipped as the writer's next slot
+  publish(10);
+
+  sweep::ring_entry entry;
+
+  SWEEP_CHECK(reader.next(entry, 0));
+  SWEEP_CHECK(entry.sequence == 9 && entry.timestamp == 9000 && entry.count == 360);
+  SWEEP_CHECK(reader.get_dropped() == 7);
+  SWEEP_CHECK(reader.is_valid(entry));
+
+  for (std::int32_t n = 10; n < 12; ++n) {
+    SWEEP_CHECK(reader.read(scan, timestamp, 0));
+    SWEEP_CHECK(timestamp == 1000 * n && same_samples(scan, scan_at(n)));
+  }
+
+  SWEEP_CHECK(!reader.read(scan, timestamp, 0));
+
+  publish(4);
+
+  SWEEP_CHECK(!reader.is_valid(entry));
+
+  writer.reset();
+
+  // The scans published before closing are still read, then reading fails
+  bool failed = false;
+
+  try {
+    while (reader.read(scan, timestamp, 0))
+      ;
+  } catch (const sweep::device_error&) {
+    failed = true;
+  }
+
+  SWEEP_CHECK(failed);
+}
+
+int main() try {
+  check_codec();
+  check_scan_log();
+  check_ring();
+  check_cartesian();
+  check_range_image();
+  check_line_extractor();
+  check_filter();
+  check_occupancy_grid();
+  check_scan_matcher();
+  check_spatial_index();
+  check_clusterer();
+  check_tracker();
+  check_localizer();
+  check_clearance_map();
+  check_free_space();
+  check_zone_monitor();
+  check_reflectors();
+  check_background();
+  check_fusion();
+
+  if (failures > 0) {
+    std::cerr << failures << " checks failed" << std::endl;
+    return 1;
+  }
+} catch (const sweep::device_error& e) {
+  std::cerr << "Error: " << e.what() << std::endl;
+  return 1;
+}